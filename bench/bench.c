@@ -0,0 +1,726 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file bench.c
+ * @brief End-to-end launcher benchmark driver
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Builds a synthetic bundle of the requested shape, launches it N times
+ * and reports percentiles of the time from exec of the launcher to main()
+ * of exec/base, together with CPU time, peak RSS, page faults and context
+ * switches from wait4(). An optional extra run under ptrace counts the
+ * syscalls made by the launcher before it execs the bundle.
+ *
+ * Caches are redirected into the work directory and warmed by the warmup
+ * runs, so the numbers describe repeated launches of an installed bundle.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ftw.h>
+#include <math.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/ptrace.h>
+
+/* Benchmark Configuration */
+#define BENCH_MAX_ARGS          32
+#define BENCH_MAX_LIBS          256
+#define BENCH_DEFAULT_RUNS      100
+#define BENCH_DEFAULT_WARMUP    5
+
+extern char **environ;
+
+/* Metrics collected for every run */
+typedef enum {
+    METRIC_LATENCY,
+    METRIC_USER,
+    METRIC_SYSTEM,
+    METRIC_MAXRSS,
+    METRIC_MINFLT,
+    METRIC_MAJFLT,
+    METRIC_NVCSW,
+    METRIC_NIVCSW,
+    METRIC_COUNT
+} bench_metric_t;
+
+static const char *const metric_names[METRIC_COUNT] = {
+    [METRIC_LATENCY] = "exec-to-main (us)",
+    [METRIC_USER]    = "user cpu (us)",
+    [METRIC_SYSTEM]  = "system cpu (us)",
+    [METRIC_MAXRSS]  = "max rss (KiB)",
+    [METRIC_MINFLT]  = "minor faults",
+    [METRIC_MAJFLT]  = "major faults",
+    [METRIC_NVCSW]   = "voluntary switches",
+    [METRIC_NIVCSW]  = "involuntary switches"
+};
+
+/* Bundle shape and run parameters */
+typedef struct {
+    const char *launcher;
+    const char *source_dir;
+    const char *shim;
+    const char *cc;
+    const char *launcher_args[BENCH_MAX_ARGS];
+    int launcher_arg_count;
+    unsigned int runs;
+    unsigned int warmup;
+    unsigned int depth;
+    unsigned int libs;
+    unsigned int resources;
+    unsigned long resource_size;
+    unsigned long stat_delay_us;
+    int syscalls;
+    int keep;
+    int verbose;
+} bench_config_t;
+
+static char work_dir[PATH_MAX];
+
+/**
+ * @brief Print usage information
+ * @param program_name Name of the program
+ */
+static void print_usage(const char *program_name) {
+    printf("Usage: %s --launcher <path> --source-dir <dir> [options]\n\n", program_name);
+    printf("Options:\n");
+    printf("  --launcher <path>        Launcher binary to measure\n");
+    printf("  --source-dir <dir>       Directory with payload.c and payload_lib.c\n");
+    printf("  --shim <path>            statdelay.so, required for --stat-delay\n");
+    printf("  --cc <compiler>          Compiler for the synthetic bundle (default: $CC or cc)\n");
+    printf("  --runs <n>               Measured launches (default %d)\n", BENCH_DEFAULT_RUNS);
+    printf("  --warmup <n>             Unmeasured launches first (default %d)\n", BENCH_DEFAULT_WARMUP);
+    printf("  --depth <n>              Nest the bundle n directories deep\n");
+    printf("  --libs <n>               Shared libraries exec/base links against\n");
+    printf("  --resources <n>          Files in resources/\n");
+    printf("  --resource-size <bytes>  Size of each resource file\n");
+    printf("  --stat-delay <us>        Delay every libc stat/open/access of the launcher\n");
+    printf("  --launcher-arg <arg>     Extra launcher argument, may be repeated\n");
+    printf("  --syscalls               Count launcher syscalls in one extra traced run\n");
+    printf("  --keep                   Keep the work directory\n");
+    printf("  --verbose                Show launcher output\n");
+}
+
+/**
+ * @brief Read CLOCK_MONOTONIC in nanoseconds
+ * @return Current time
+ */
+static int64_t monotonic_ns(void) {
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @brief Run a command and wait for it
+ * @param argv Command and arguments
+ * @return 0 if the command exited successfully, -1 otherwise
+ */
+static int run_command(char *const argv[]) {
+    pid_t pid;
+    int status;
+    
+    if (posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ) != 0) {
+        fprintf(stderr, "bench: cannot run %s\n", argv[0]);
+        return -1;
+    }
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "bench: %s failed\n", argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Create a directory
+ * @param path Directory to create
+ * @return 0 on success, -1 on failure
+ */
+static int make_directory(const char *path) {
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "bench: cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fill resources/ with files of the configured size
+ * @param config Benchmark configuration
+ * @param bundle Bundle directory
+ * @return 0 on success, -1 on failure
+ */
+static int create_resources(const bench_config_t *config, const char *bundle) {
+    char path[PATH_MAX];
+    char block[4096];
+    
+    memset(block, 'r', sizeof(block));
+    for (unsigned int i = 0; i < config->resources; i++) {
+        unsigned long remaining = config->resource_size;
+        int fd;
+        
+        snprintf(path, sizeof(path), "%s/resources/resource-%05u.dat", bundle, i);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "bench: cannot create %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        while (remaining > 0) {
+            size_t chunk = remaining < sizeof(block) ? remaining : sizeof(block);
+            if (write(fd, block, chunk) != (ssize_t)chunk) {
+                fprintf(stderr, "bench: cannot write %s: %s\n", path, strerror(errno));
+                close(fd);
+                return -1;
+            }
+            remaining -= chunk;
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+/**
+ * @brief Build a synthetic bundle of the configured shape
+ * @param config Benchmark configuration
+ * @param bundle Receives the bundle path
+ * @param size Size of the bundle buffer
+ * @return 0 on success, -1 on failure
+ */
+static int create_bundle(const bench_config_t *config, char *bundle, size_t size) {
+    static char link_args[BENCH_MAX_LIBS][32];
+    char path[PATH_MAX];
+    char source[PATH_MAX];
+    char define[32];
+    char soname[64];
+    char *argv[BENCH_MAX_LIBS + 16];
+    int argc;
+    size_t used;
+    
+    // Deep paths make every absolute lookup walk more components
+    used = (size_t)snprintf(bundle, size, "%s", work_dir);
+    for (unsigned int i = 0; i < config->depth && used < size; i++) {
+        used += (size_t)snprintf(bundle + used, size - used, "/level-%02u", i);
+        if (make_directory(bundle) != 0) {
+            return -1;
+        }
+    }
+    if (used + sizeof("/Bench.app") > size) {
+        fprintf(stderr, "bench: bundle path too long\n");
+        return -1;
+    }
+    strcat(bundle, "/Bench.app");
+    
+    static const char *const subdirs[] = { "", "/exec", "/library", "/resources" };
+    for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", bundle, subdirs[i]);
+        if (make_directory(path) != 0) {
+            return -1;
+        }
+    }
+    
+    snprintf(source, sizeof(source), "%s/payload_lib.c", config->source_dir);
+    for (unsigned int i = 0; i < config->libs; i++) {
+        snprintf(path, sizeof(path), "%s/library/libbench%u.so", bundle, i);
+        snprintf(define, sizeof(define), "-DBENCH_LIB=%u", i);
+        snprintf(soname, sizeof(soname), "-Wl,-soname,libbench%u.so", i);
+        char *lib_argv[] = { (char *)config->cc, "-O2", "-fPIC", "-shared", define, soname,
+                             "-o", path, source, NULL };
+        if (run_command(lib_argv) != 0) {
+            return -1;
+        }
+    }
+    
+    // Link exec/base against every library without an rpath
+    snprintf(source, sizeof(source), "%s/payload.c", config->source_dir);
+    snprintf(path, sizeof(path), "%s/exec/base", bundle);
+    char library_dir[PATH_MAX + 2];
+    snprintf(library_dir, sizeof(library_dir), "-L%s/library", bundle);
+    argc = 0;
+    argv[argc++] = (char *)config->cc;
+    argv[argc++] = "-O2";
+    argv[argc++] = "-o";
+    argv[argc++] = path;
+    argv[argc++] = source;
+    argv[argc++] = library_dir;
+    argv[argc++] = "-Wl,--no-as-needed";
+    for (unsigned int i = 0; i < config->libs; i++) {
+        snprintf(link_args[i], sizeof(link_args[i]), "-lbench%u", i);
+        argv[argc++] = link_args[i];
+    }
+    argv[argc] = NULL;
+    if (run_command(argv) != 0) {
+        return -1;
+    }
+    
+    snprintf(path, sizeof(path), "%s/info.yaml", bundle);
+    FILE *metadata = fopen(path, "we");
+    if (metadata == NULL) {
+        fprintf(stderr, "bench: cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(metadata, "name: Bench\nversion: 1.0.0\nentry: /exec/base\n");
+    fclose(metadata);
+    
+    return create_resources(config, bundle);
+}
+
+/**
+ * @brief Build the launcher command line for a bundle
+ * @param config Benchmark configuration
+ * @param bundle Bundle path
+ * @param argv Receives the argument vector
+ */
+static void launcher_argv(const bench_config_t *config, const char *bundle, char **argv) {
+    int argc = 0;
+    
+    argv[argc++] = (char *)config->launcher;
+    for (int i = 0; i < config->launcher_arg_count; i++) {
+        argv[argc++] = (char *)config->launcher_args[i];
+    }
+    argv[argc++] = (char *)bundle;
+    argv[argc] = NULL;
+}
+
+/**
+ * @brief Prepare the environment of a launched child; runs after fork
+ * @param config Benchmark configuration
+ * @param report_fd Descriptor the payload reports on
+ */
+static void setup_child(const bench_config_t *config, int report_fd) {
+    char fd_text[16];
+    char delay_text[32];
+    
+    snprintf(fd_text, sizeof(fd_text), "%d", report_fd);
+    setenv("VLAUNCH_BENCH_FD", fd_text, 1);
+    if (config->stat_delay_us > 0) {
+        snprintf(delay_text, sizeof(delay_text), "%lu", config->stat_delay_us);
+        setenv("BENCH_STAT_DELAY_US", delay_text, 1);
+        setenv("LD_PRELOAD", config->shim, 1);
+    }
+    
+    if (!config->verbose) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+    }
+}
+
+/**
+ * @brief Launch the bundle once and collect its metrics
+ * @param config Benchmark configuration
+ * @param bundle Bundle path
+ * @param values Receives one value per metric
+ * @return 0 on success, -1 if the launch failed
+ */
+static int run_once(const bench_config_t *config, const char *bundle, double *values) {
+    char *argv[BENCH_MAX_ARGS + 3];
+    int64_t stamps[2];
+    struct rusage usage;
+    size_t received = 0;
+    int report[2];
+    int status;
+    pid_t pid;
+    
+    launcher_argv(config, bundle, argv);
+    if (pipe(report) != 0) {
+        return -1;
+    }
+    fcntl(report[0], F_SETFD, FD_CLOEXEC);
+    
+    pid = fork();
+    if (pid < 0) {
+        close(report[0]);
+        close(report[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        setup_child(config, report[1]);
+        stamps[0] = monotonic_ns();
+        if (write(report[1], &stamps[0], sizeof(stamps[0])) != (ssize_t)sizeof(stamps[0])) {
+            _exit(127);
+        }
+        execv(config->launcher, argv);
+        _exit(127);
+    }
+    
+    // The payload writes its own stamp; EOF follows once every writer is gone
+    close(report[1]);
+    while (received < sizeof(stamps)) {
+        ssize_t n = read(report[0], (char *)stamps + received, sizeof(stamps) - received);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        received += (size_t)n;
+    }
+    close(report[0]);
+    
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        received != sizeof(stamps)) {
+        fprintf(stderr, "bench: launch failed (status %d)\n", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return -1;
+    }
+    
+    values[METRIC_LATENCY] = (double)(stamps[1] - stamps[0]) / 1000.0;
+    values[METRIC_USER] = (double)usage.ru_utime.tv_sec * 1e6 + (double)usage.ru_utime.tv_usec;
+    values[METRIC_SYSTEM] = (double)usage.ru_stime.tv_sec * 1e6 + (double)usage.ru_stime.tv_usec;
+    values[METRIC_MAXRSS] = (double)usage.ru_maxrss;
+    values[METRIC_MINFLT] = (double)usage.ru_minflt;
+    values[METRIC_MAJFLT] = (double)usage.ru_majflt;
+    values[METRIC_NVCSW] = (double)usage.ru_nvcsw;
+    values[METRIC_NIVCSW] = (double)usage.ru_nivcsw;
+    return 0;
+}
+
+/**
+ * @brief Count syscalls of one launch under ptrace
+ * @param config Benchmark configuration
+ * @param bundle Bundle path
+ * @param launcher_calls Receives syscalls made before the bundle was exec'd
+ * @param total_calls Receives syscalls of the whole run
+ * @return 0 on success, -1 on failure
+ */
+static int count_syscalls(const bench_config_t *config, const char *bundle,
+                          unsigned long *launcher_calls, unsigned long *total_calls) {
+    char *argv[BENCH_MAX_ARGS + 3];
+    unsigned long stops = 0;
+    int in_launcher = 1;
+    int status;
+    pid_t pid;
+    
+    *launcher_calls = 0;
+    launcher_argv(config, bundle, argv);
+    
+    pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        setup_child(config, null_fd);
+        ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+        execv(config->launcher, argv);
+        _exit(127);
+    }
+    
+    // The first stop is the exec of the launcher itself
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+        return -1;
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, NULL,
+           (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL));
+    
+    for (;;) {
+        int signal_number = 0;
+        
+        if (ptrace(PTRACE_SYSCALL, pid, NULL, NULL) != 0 || waitpid(pid, &status, 0) < 0) {
+            return -1;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            break;
+        }
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+            stops++;
+        } else if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+            // Entry and exit stops pair up; the exec that replaced the launcher counts to it
+            if (in_launcher) {
+                *launcher_calls = (stops + 1) / 2;
+                in_launcher = 0;
+            }
+        } else {
+            signal_number = WSTOPSIG(status);
+            if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)signal_number) != 0 ||
+                waitpid(pid, &status, 0) < 0) {
+                return -1;
+            }
+            if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                break;
+            }
+            if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+                stops++;
+            }
+        }
+    }
+    
+    *total_calls = (stops + 1) / 2;
+    return 0;
+}
+
+/**
+ * @brief Order doubles ascending
+ * @param a First value
+ * @param b Second value
+ * @return Negative, zero or positive like strcmp
+ */
+static int compare_doubles(const void *a, const void *b) {
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+    
+    return (left > right) - (left < right);
+}
+
+/**
+ * @brief Nearest-rank percentile of sorted values
+ * @param values Sorted values
+ * @param count Number of values
+ * @param percent Percentile between 0 and 100
+ * @return Percentile value
+ */
+static double percentile(const double *values, unsigned int count, double percent) {
+    size_t rank = (size_t)ceil(percent / 100.0 * count);
+    
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * @brief Print the percentile table
+ * @param samples Values per metric, one array each
+ * @param count Number of runs
+ */
+static void report(double *samples[METRIC_COUNT], unsigned int count) {
+    printf("  %-22s %10s %10s %10s %10s %10s %10s\n", "metric", "min", "p50", "p90", "p99", "max", "mean");
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+        double *values = samples[metric];
+        double sum = 0;
+        
+        qsort(values, count, sizeof(double), compare_doubles);
+        for (unsigned int i = 0; i < count; i++) {
+            sum += values[i];
+        }
+        printf("  %-22s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", metric_names[metric],
+               values[0], percentile(values, count, 50), percentile(values, count, 90),
+               percentile(values, count, 99), values[count - 1], sum / count);
+    }
+}
+
+/**
+ * @brief Remove one entry of the work directory
+ * @param path Entry path
+ * @param st Entry status
+ * @param type Entry type
+ * @param ftw Walk state
+ * @return 0 to continue the walk
+ */
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+/**
+ * @brief Parse an unsigned number option
+ * @param text Option argument
+ * @param out Receives the value
+ * @return 0 on success, -1 if the argument is not a number
+ */
+static int parse_number(const char *text, unsigned long *out) {
+    char *end;
+    
+    errno = 0;
+    *out = strtoul(text, &end, 10);
+    return (errno != 0 || end == text || *end != '\0') ? -1 : 0;
+}
+
+/**
+ * @brief Benchmark entry point
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return 0 on success, 1 on failure
+ */
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "launcher",      required_argument, NULL, 'L' },
+        { "source-dir",    required_argument, NULL, 'S' },
+        { "shim",          required_argument, NULL, 'P' },
+        { "cc",            required_argument, NULL, 'C' },
+        { "runs",          required_argument, NULL, 'n' },
+        { "warmup",        required_argument, NULL, 'w' },
+        { "depth",         required_argument, NULL, 'd' },
+        { "libs",          required_argument, NULL, 'l' },
+        { "resources",     required_argument, NULL, 'r' },
+        { "resource-size", required_argument, NULL, 'z' },
+        { "stat-delay",    required_argument, NULL, 'D' },
+        { "launcher-arg",  required_argument, NULL, 'a' },
+        { "syscalls",      no_argument,       NULL, 's' },
+        { "keep",          no_argument,       NULL, 'k' },
+        { "verbose",       no_argument,       NULL, 'v' },
+        { "help",          no_argument,       NULL, 'h' },
+        { NULL,            0,                 NULL, 0   }
+    };
+    bench_config_t config;
+    double *samples[METRIC_COUNT];
+    double values[METRIC_COUNT];
+    char bundle[PATH_MAX];
+    unsigned long number;
+    int failed = 0;
+    int opt;
+    
+    memset(&config, 0, sizeof(config));
+    config.cc = getenv("CC") ? getenv("CC") : "cc";
+    config.runs = BENCH_DEFAULT_RUNS;
+    config.warmup = BENCH_DEFAULT_WARMUP;
+    config.resource_size = 4096;
+    
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'L': config.launcher = optarg; break;
+            case 'S': config.source_dir = optarg; break;
+            case 'P': config.shim = optarg; break;
+            case 'C': config.cc = optarg; break;
+            case 's': config.syscalls = 1; break;
+            case 'k': config.keep = 1; break;
+            case 'v': config.verbose = 1; break;
+            case 'a':
+                if (config.launcher_arg_count == BENCH_MAX_ARGS) {
+                    fprintf(stderr, "bench: too many launcher arguments\n");
+                    return 1;
+                }
+                config.launcher_args[config.launcher_arg_count++] = optarg;
+                break;
+            case 'n': case 'w': case 'd': case 'l': case 'r': case 'z': case 'D':
+                if (parse_number(optarg, &number) != 0) {
+                    fprintf(stderr, "bench: invalid number: %s\n", optarg);
+                    return 1;
+                }
+                if (opt == 'n') config.runs = (unsigned int)number;
+                if (opt == 'w') config.warmup = (unsigned int)number;
+                if (opt == 'd') config.depth = (unsigned int)number;
+                if (opt == 'l') config.libs = (unsigned int)number;
+                if (opt == 'r') config.resources = (unsigned int)number;
+                if (opt == 'z') config.resource_size = number;
+                if (opt == 'D') config.stat_delay_us = number;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    
+    if (!config.launcher || !config.source_dir || config.runs == 0 || optind != argc ||
+        config.libs > BENCH_MAX_LIBS || (config.stat_delay_us > 0 && !config.shim)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    snprintf(work_dir, sizeof(work_dir), "%s/vlaunch-bench.XXXXXX", getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+    if (mkdtemp(work_dir) == NULL) {
+        fprintf(stderr, "bench: cannot create work directory: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    // Keep caches of the launcher inside the work directory
+    char cache_dir[PATH_MAX + 8];
+    snprintf(cache_dir, sizeof(cache_dir), "%s/cache", work_dir);
+    setenv("XDG_CACHE_HOME", cache_dir, 1);
+    
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+        samples[metric] = calloc(config.runs, sizeof(double));
+        failed |= samples[metric] == NULL;
+    }
+    
+    if (!failed) {
+        failed = create_bundle(&config, bundle, sizeof(bundle)) != 0;
+    }
+    
+    if (!failed) {
+        printf("bundle: depth=%u libs=%u resources=%ux%lu stat-delay=%luus args=",
+               config.depth, config.libs, config.resources, config.resource_size, config.stat_delay_us);
+        for (int i = 0; i < config.launcher_arg_count; i++) {
+            printf("%s%s", i ? " " : "", config.launcher_args[i]);
+        }
+        printf("%s\nruns: %u (warmup %u)\n", config.launcher_arg_count ? "" : "(none)", config.runs, config.warmup);
+        fflush(stdout);
+    }
+    
+    for (unsigned int i = 0; !failed && i < config.warmup; i++) {
+        failed = run_once(&config, bundle, values) != 0;
+    }
+    for (unsigned int i = 0; !failed && i < config.runs; i++) {
+        failed = run_once(&config, bundle, values) != 0;
+        for (int metric = 0; !failed && metric < METRIC_COUNT; metric++) {
+            samples[metric][i] = values[metric];
+        }
+    }
+    
+    if (!failed) {
+        report(samples, config.runs);
+        if (config.syscalls) {
+            unsigned long launcher_calls;
+            unsigned long total_calls;
+            
+            if (count_syscalls(&config, bundle, &launcher_calls, &total_calls) == 0) {
+                printf("  syscalls: %lu in the launcher, %lu in total\n", launcher_calls, total_calls);
+            } else {
+                printf("  syscalls: unavailable (ptrace failed)\n");
+            }
+        }
+        printf("\n");
+    }
+    
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+        free(samples[metric]);
+    }
+    if (config.keep) {
+        printf("work directory kept: %s\n", work_dir);
+    } else {
+        nftw(work_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    
+    return failed ? 1 : 0;
+}
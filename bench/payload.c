@@ -0,0 +1,66 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file payload.c
+ * @brief Benchmark bundle executable
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Installed as exec/base of synthetic bundles. Reports the monotonic time
+ * at which main() was reached to the benchmark driver and exits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Report the time main() was reached on VLAUNCH_BENCH_FD
+ * @return Exit code
+ */
+int main(void) {
+    struct timespec now;
+    const char *fd_text = getenv("VLAUNCH_BENCH_FD");
+    int64_t stamp;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    stamp = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    
+    if (fd_text == NULL || write(atoi(fd_text), &stamp, sizeof(stamp)) != (ssize_t)sizeof(stamp)) {
+        return 1;
+    }
+    return 0;
+}
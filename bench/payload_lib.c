@@ -0,0 +1,61 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file payload_lib.c
+ * @brief Benchmark bundle shared library
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Compiled once per synthetic library with a distinct BENCH_LIB number,
+ * so every copy has its own soname and symbol and the dynamic loader has
+ * to search for each of them.
+ */
+
+#ifndef BENCH_LIB
+#define BENCH_LIB 0
+#endif
+
+#define BENCH_CONCAT(a, b)  a##b
+#define BENCH_SYMBOL(n)     BENCH_CONCAT(bench_lib_, n)
+
+/* Some data so each library occupies more than one page */
+static const char bench_lib_data[16384] = { BENCH_LIB };
+
+/**
+ * @brief Library entry point; never called, it only has to exist
+ * @return A byte of the library data
+ */
+int BENCH_SYMBOL(BENCH_LIB)(void) {
+    return bench_lib_data[0];
+}
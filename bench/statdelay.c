@@ -0,0 +1,144 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file statdelay.c
+ * @brief LD_PRELOAD shim that adds latency to file system lookups
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Sleeps BENCH_STAT_DELAY_US microseconds before every stat, open and
+ * access call made through libc, approximating an NFS round trip per
+ * lookup. Lookups issued directly by the dynamic loader or through
+ * io_uring bypass libc and are not delayed.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+static useconds_t stat_delay;
+
+/**
+ * @brief Read the configured delay when the shim is loaded
+ */
+__attribute__((constructor))
+static void statdelay_init(void) {
+    const char *delay = getenv("BENCH_STAT_DELAY_US");
+    
+    stat_delay = delay ? (useconds_t)strtoul(delay, NULL, 10) : 0;
+}
+
+/**
+ * @brief Sleep for the configured delay
+ */
+static void statdelay_wait(void) {
+    if (stat_delay > 0) {
+        usleep(stat_delay);
+    }
+}
+
+/* Forward a call to the next definition after the delay */
+#define STATDELAY_WRAP(ret, name, params, args) \
+    ret name params { \
+        static ret (*next) params; \
+        if (next == NULL) { \
+            void *symbol = dlsym(RTLD_NEXT, #name); \
+            memcpy(&next, &symbol, sizeof(next)); \
+        } \
+        statdelay_wait(); \
+        return next args; \
+    }
+
+STATDELAY_WRAP(int, stat, (const char *path, struct stat *st), (path, st))
+STATDELAY_WRAP(int, lstat, (const char *path, struct stat *st), (path, st))
+STATDELAY_WRAP(int, fstatat, (int dirfd, const char *path, struct stat *st, int flags), (dirfd, path, st, flags))
+STATDELAY_WRAP(int, statx, (int dirfd, const char *path, int flags, unsigned int mask, struct statx *stx),
+               (dirfd, path, flags, mask, stx))
+STATDELAY_WRAP(int, access, (const char *path, int mode), (path, mode))
+STATDELAY_WRAP(int, faccessat, (int dirfd, const char *path, int mode, int flags), (dirfd, path, mode, flags))
+
+/**
+ * @brief Delayed open()
+ * @param path Path to open
+ * @param flags Open flags
+ * @return File descriptor or -1
+ */
+int open(const char *path, int flags, ...) {
+    static int (*next)(const char *, int, ...);
+    mode_t mode = 0;
+    
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    if (next == NULL) {
+        void *symbol = dlsym(RTLD_NEXT, "open");
+        memcpy(&next, &symbol, sizeof(next));
+    }
+    statdelay_wait();
+    return next(path, flags, mode);
+}
+
+/**
+ * @brief Delayed openat()
+ * @param dirfd Directory descriptor
+ * @param path Path to open
+ * @param flags Open flags
+ * @return File descriptor or -1
+ */
+int openat(int dirfd, const char *path, int flags, ...) {
+    static int (*next)(int, const char *, int, ...);
+    mode_t mode = 0;
+    
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    if (next == NULL) {
+        void *symbol = dlsym(RTLD_NEXT, "openat");
+        memcpy(&next, &symbol, sizeof(next));
+    }
+    statdelay_wait();
+    return next(dirfd, path, flags, mode);
+}
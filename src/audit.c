@@ -0,0 +1,114 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file audit.c
+ * @brief LD_AUDIT module resolving bundle libraries through the library index
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Built as vlaunch-audit.so. The launcher sets LD_AUDIT to this module
+ * and VLAUNCH_LD_INDEX to the bundle's index; for every soname the
+ * loader is about to search for, la_objsearch() answers with the
+ * absolute path from the index, so no directory is probed. Names that
+ * are not in the index are passed through to the normal search.
+ */
+
+#define _GNU_SOURCE
+#define LDINDEX_FORMAT_ONLY
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ldindex.h"
+
+static const void *index_map;
+
+/**
+ * @brief Negotiate the audit interface and map the library index
+ * @param version Audit interface version offered by the loader
+ * @return LAV_CURRENT to stay loaded, 0 to unload when there is no usable index
+ */
+unsigned int la_version(unsigned int version) {
+    const char *path = getenv(LDINDEX_ENV);
+    struct stat st;
+    void *map;
+    int fd;
+    
+    if (version < 1 || !path || (fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        return 0;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 0;
+    }
+    
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    if (!ldindex_valid(map, (size_t)st.st_size)) {
+        munmap(map, (size_t)st.st_size);
+        return 0;
+    }
+    
+    // The mapping stays alive for the life of the process; the loader keeps our strings
+    index_map = map;
+    return version < LAV_CURRENT ? version : LAV_CURRENT;
+}
+
+/**
+ * @brief Redirect soname searches to the indexed absolute path
+ * @param name Name the loader is about to search for
+ * @param cookie Object that triggered the search (unused)
+ * @param flag Search stage
+ * @return Absolute path from the index, or the unchanged name
+ */
+char *la_objsearch(const char *name, uintptr_t *cookie, unsigned int flag) {
+    (void)cookie;
+    
+    if (flag == LA_SER_ORIG && index_map && strchr(name, '/') == NULL) {
+        const char *path = ldindex_lookup(index_map, name);
+        if (path) {
+            return (char *)path;
+        }
+    }
+    
+    return (char *)name;
+}
@@ -0,0 +1,336 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file batch.c
+ * @brief Launching several bundles at once
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Preparation (probe, cache lookup, validation, inspection) runs on the
+ * worker pool. The environment is built in the forked child, since
+ * building a library index writes files named after the process and a
+ * batch may list one bundle twice. All children are
+ * forked before any exec status is collected, so one slow exec does not
+ * delay the others.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "trace.h"
+#include "placement.h"
+#include "batch.h"
+#include "environment.h"
+#include "sandbox.h"
+#include "lazy.h"
+
+/* One bundle of the batch */
+typedef struct {
+    const char *path;
+    bundle_probe_t probe;
+    int result;
+    pid_t pid;
+    int status_fd;
+} batch_bundle_t;
+
+/* Work queue shared by the preparation threads */
+typedef struct {
+    batch_bundle_t *bundles;
+    unsigned int count;
+    unsigned int next;
+} batch_queue_t;
+
+/**
+ * @brief Preparation threads take bundles off the shared queue until it is empty
+ * @param arg Shared batch_queue_t
+ * @return Always NULL
+ */
+static void *batch_worker(void *arg) {
+    batch_queue_t *queue = arg;
+    unsigned int index;
+    
+    while ((index = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED)) < queue->count) {
+        batch_bundle_t *bundle = &queue->bundles[index];
+        bundle->result = prepare_application(&bundle->probe, bundle->path);
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Fork a child that configures and execs one prepared bundle
+ * @param bundle Prepared bundle
+ */
+static void start_bundle(batch_bundle_t *bundle) {
+    sandbox_trees_t trees;
+    unsigned int features;
+    int status_pipe[2];
+    int child_result;
+    env_builder_t env;
+    
+    // A sandboxed child is started straight into its namespaces
+    bundle->result = sandbox_features(&bundle->probe, &features);
+    if (bundle->result == EXIT_SUCCESS && features != 0) {
+        bundle->result = sandbox_prepare(&bundle->probe, &trees);
+    }
+    if (bundle->result != EXIT_SUCCESS) {
+        return;
+    }
+    
+    // The pipe is close-on-exec, so EOF without data means exec succeeded
+    if (pipe2(status_pipe, O_CLOEXEC) != 0) {
+        log_message(LOG_ERROR, "Failed to create status pipe: %s", strerror(errno));
+        bundle->result = EXIT_SYSTEM_ERROR;
+        if (features != 0) {
+            sandbox_release(&trees);
+        }
+        return;
+    }
+    
+    log_flush();
+    fflush(NULL);
+    bundle->pid = features != 0 ? sandbox_clone(features) : fork();
+    if (bundle->pid < 0) {
+        log_message(LOG_ERROR, "Failed to fork: %s", strerror(errno));
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        bundle->result = EXIT_SYSTEM_ERROR;
+        if (features != 0) {
+            sandbox_release(&trees);
+        }
+        return;
+    }
+    
+    if (bundle->pid == 0) {
+        // Each child reports its own launch; preparation ran on the pool
+        trace_reset(bundle->path);
+        trace_mark(TRACE_FORK);
+        close(status_pipe[0]);
+        
+        child_result = features != 0 ? sandbox_enter(&bundle->probe, &trees, features) : EXIT_SUCCESS;
+        if (child_result == EXIT_SUCCESS) {
+            child_result = prepare_environment(&bundle->probe, &env);
+        }
+        if (child_result == EXIT_SUCCESS) {
+            trace_mark(TRACE_LIBRARY);
+            child_result = configure_placement(&bundle->probe);
+        }
+        if (child_result == EXIT_SUCCESS) {
+            trace_mark(TRACE_PLACEMENT);
+            child_result = lazy_resources_attach(&bundle->probe);
+        }
+        if (child_result == EXIT_SUCCESS) {
+            child_result = exec_application(&bundle->probe, &env, NULL);
+        }
+        if (write(status_pipe[1], &child_result, sizeof(child_result)) < 0) {
+            // Nothing more we can report
+        }
+        _exit(child_result);
+    }
+    
+    close(status_pipe[1]);
+    bundle->status_fd = status_pipe[0];
+    if (features != 0) {
+        sandbox_release(&trees);
+    }
+}
+
+/**
+ * @brief Wait until a started bundle has exec'd or failed
+ * @param bundle Started bundle
+ */
+static void finish_bundle(batch_bundle_t *bundle) {
+    int child_result;
+    ssize_t n;
+    
+    do {
+        n = read(bundle->status_fd, &child_result, sizeof(child_result));
+    } while (n < 0 && errno == EINTR);
+    close(bundle->status_fd);
+    bundle->status_fd = -1;
+    
+    if (n == (ssize_t)sizeof(child_result)) {
+        waitpid(bundle->pid, NULL, 0);
+        bundle->result = child_result;
+        return;
+    }
+    
+    log_message(LOG_INFO, "Started %s as pid %ld", bundle->path, (long)bundle->pid);
+}
+
+/**
+ * @brief Validate bundles concurrently, then launch each of them
+ * @param bundle_paths Paths to application bundles
+ * @param count Number of bundles
+ * @return EXIT_SUCCESS if every bundle started, otherwise the first failing bundle's code
+ */
+int launch_batch(char *const *bundle_paths, unsigned int count) {
+    pthread_t threads[BATCH_THREADS];
+    unsigned int thread_count = 0;
+    batch_bundle_t *bundles;
+    batch_queue_t queue;
+    int result = EXIT_SUCCESS;
+    
+    if (count > BATCH_MAX_BUNDLES) {
+        log_message(LOG_ERROR, "Too many bundles in one batch (max %d)", BATCH_MAX_BUNDLES);
+        return EXIT_INVALID_ARGS;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        if (strlen(bundle_paths[i]) >= MAX_PATH_LENGTH) {
+            log_message(LOG_ERROR, "Bundle path too long (max %d characters): %s", MAX_PATH_LENGTH - 1, bundle_paths[i]);
+            return EXIT_INVALID_ARGS;
+        }
+    }
+    
+    bundles = calloc(count, sizeof(*bundles));
+    if (bundles == NULL) {
+        log_message(LOG_ERROR, "Out of memory for %u bundles", count);
+        return EXIT_SYSTEM_ERROR;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        bundles[i].path = bundle_paths[i];
+        bundles[i].status_fd = -1;
+    }
+    
+    log_message(LOG_INFO, "Launching %u bundles", count);
+    
+    // The calling thread works the queue as well
+    queue.bundles = bundles;
+    queue.count = count;
+    queue.next = 0;
+    while (thread_count + 1 < BATCH_THREADS && thread_count + 1 < count &&
+           pthread_create(&threads[thread_count], NULL, batch_worker, &queue) == 0) {
+        thread_count++;
+    }
+    batch_worker(&queue);
+    for (unsigned int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    // Fork only once no other thread runs, so no lock is held across fork()
+    for (unsigned int i = 0; i < count; i++) {
+        if (bundles[i].result == EXIT_SUCCESS) {
+            start_bundle(&bundles[i]);
+        }
+    }
+    
+    for (unsigned int i = 0; i < count; i++) {
+        batch_bundle_t *bundle = &bundles[i];
+        
+        if (bundle->status_fd >= 0) {
+            finish_bundle(bundle);
+        }
+        if (bundle->result != EXIT_SUCCESS) {
+            log_message(LOG_ERROR, "Failed to launch %s (exit code %d)", bundle->path, bundle->result);
+            if (result == EXIT_SUCCESS) {
+                result = bundle->result;
+            }
+        }
+        bundle_probe_close(&bundle->probe);
+    }
+    
+    free(bundles);
+    return result;
+}
+
+/**
+ * @brief Launch the bundles named in a list file, one path per line
+ * @param list_path List file; blank lines and lines starting with '#' are skipped
+ * @return EXIT_SUCCESS if every bundle started, error code otherwise
+ */
+int launch_batch_list(const char *list_path) {
+    char *paths[BATCH_MAX_BUNDLES];
+    unsigned int count = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int result;
+    FILE *list;
+    
+    list = fopen(list_path, "re");
+    if (list == NULL) {
+        log_message(LOG_ERROR, "Cannot open bundle list %s: %s", list_path, strerror(errno));
+        return EXIT_INVALID_ARGS;
+    }
+    
+    result = EXIT_SUCCESS;
+    while ((length = getline(&line, &capacity, list)) >= 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' ||
+                              line[length - 1] == ' ' || line[length - 1] == '\t')) {
+            line[--length] = '\0';
+        }
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        if (count == BATCH_MAX_BUNDLES) {
+            log_message(LOG_ERROR, "Too many bundles in %s (max %d)", list_path, BATCH_MAX_BUNDLES);
+            result = EXIT_INVALID_ARGS;
+            break;
+        }
+        paths[count] = strdup(line);
+        if (paths[count] == NULL) {
+            log_message(LOG_ERROR, "Out of memory reading %s", list_path);
+            result = EXIT_SYSTEM_ERROR;
+            break;
+        }
+        count++;
+    }
+    free(line);
+    fclose(list);
+    
+    if (result == EXIT_SUCCESS) {
+        if (count == 0) {
+            log_message(LOG_ERROR, "No bundles listed in %s", list_path);
+            result = EXIT_INVALID_ARGS;
+        } else {
+            result = launch_batch(paths, count);
+        }
+    }
+    
+    for (unsigned int i = 0; i < count; i++) {
+        free(paths[i]);
+    }
+    return result;
+}
@@ -0,0 +1,274 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file cache.c
+ * @brief Persistent bundle validation cache
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Cache entries live under $XDG_CACHE_HOME/vlaunch/validation, one file
+ * per bundle path, and are compared against the results of the bundle
+ * probe. An entry is only written after a bundle passed full
+ * validation, so a lookup whose snapshot matches byte for byte means the
+ * bundle is still valid and every per-component check can be skipped.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "launcher.h"
+#include "cache.h"
+
+/* On-disk cache entry header, followed by the bundle path and snapshot */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t path_length;
+    uint32_t reserved;
+} cache_header_t;
+
+static int validation_cache_enabled = 1;
+
+/**
+ * @brief Enable or disable the validation cache
+ * @param enabled Non-zero to use the cache, 0 to always validate fully
+ */
+void validation_cache_set_enabled(int enabled) {
+    validation_cache_enabled = enabled;
+}
+
+/**
+ * @brief Create a directory if it does not already exist
+ * @param path Directory path
+ * @return 0 on success, -1 on failure
+ */
+static int ensure_directory(const char *path) {
+    if (mkdir(path, 0700) == 0 || errno == EEXIST) {
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Resolve (and create) a launcher cache directory
+ * @param subdir Subdirectory below $XDG_CACHE_HOME/vlaunch, or NULL
+ * @param out Destination buffer
+ * @param size Size of destination buffer
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+int cache_directory(const char *subdir, char *out, size_t size) {
+    const char *base = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    const char *levels[2] = { CACHE_DIR_NAME, subdir };
+    size_t used;
+    int written;
+    
+    // The XDG spec says relative values must be ignored
+    if (base && base[0] == '/') {
+        written = snprintf(out, size, "%s", base);
+    } else if (home && home[0] == '/') {
+        written = snprintf(out, size, "%s/.cache", home);
+    } else {
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (written < 0 || (size_t)written >= size || ensure_directory(out) != 0) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    used = (size_t)written;
+    
+    for (int i = 0; i < 2 && levels[i]; i++) {
+        written = snprintf(out + used, size - used, "/%s", levels[i]);
+        if (written < 0 || (size_t)written >= size - used) {
+            return EXIT_SYSTEM_ERROR;
+        }
+        used += (size_t)written;
+        if (ensure_directory(out) != 0) {
+            return EXIT_SYSTEM_ERROR;
+        }
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Build the path of a per-key cache entry
+ * @param subdir Cache subdirectory the entry lives in
+ * @param key Key the entry is named after, usually a bundle path
+ * @param out Destination buffer
+ * @param size Size of destination buffer
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+int cache_entry_path(const char *subdir, const char *key, char *out, size_t size) {
+    char directory[MAX_PATH_LENGTH];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int written;
+    
+    if (cache_directory(subdir, directory, sizeof(directory)) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // FNV-1a over the key; entries store their key to catch collisions
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    
+    written = snprintf(out, size, "%s/%016llx", directory, (unsigned long long)hash);
+    return (written < 0 || (size_t)written >= size) ? EXIT_SYSTEM_ERROR : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Record the identity of one component
+ * @param stx Stat result of the component
+ * @param state Receives the comparable state
+ */
+void component_state_take(const struct statx *stx, component_state_t *state) {
+    memset(state, 0, sizeof(*state));
+    state->dev = ((uint64_t)stx->stx_dev_major << 32) | stx->stx_dev_minor;
+    state->ino = stx->stx_ino;
+    state->size = stx->stx_size;
+    state->mtime_sec = stx->stx_mtime.tv_sec;
+    state->mtime_nsec = stx->stx_mtime.tv_nsec;
+    state->ctime_sec = stx->stx_ctime.tv_sec;
+    state->ctime_nsec = stx->stx_ctime.tv_nsec;
+    state->mode = stx->stx_mode;
+    state->present = 1;
+}
+
+/**
+ * @brief Convert probe results into a comparable snapshot
+ * @param probe Opened bundle probe
+ * @param snapshot Receives the component states
+ */
+void bundle_snapshot_take(const bundle_probe_t *probe, bundle_snapshot_t *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        if (probe->present[i]) {
+            component_state_take(&probe->components[i], &snapshot->components[i]);
+        }
+    }
+}
+
+/**
+ * @brief Check whether a bundle is unchanged since it was last validated
+ * @param probe Opened bundle probe
+ * @param snapshot Receives the current component states, hit or miss
+ * @return 1 on a cache hit, 0 if full validation is required
+ */
+int validation_cache_lookup(const bundle_probe_t *probe, bundle_snapshot_t *snapshot) {
+    const char *bundle_path = probe->path;
+    char entry_path[MAX_PATH_LENGTH];
+    char stored_path[MAX_PATH_LENGTH];
+    bundle_snapshot_t stored;
+    cache_header_t header;
+    size_t path_length = strlen(bundle_path);
+    int hit = 0;
+    int fd;
+    
+    bundle_snapshot_take(probe, snapshot);
+    if (!probe->present[COMPONENT_ROOT]) {
+        return 0;
+    }
+    if (!validation_cache_enabled ||
+        cache_entry_path(CACHE_VALIDATION_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return 0;
+    }
+    
+    fd = open(entry_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    
+    if (read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        header.magic == CACHE_MAGIC &&
+        header.version == CACHE_FORMAT_VERSION &&
+        header.path_length == path_length &&
+        read(fd, stored_path, path_length) == (ssize_t)path_length &&
+        memcmp(stored_path, bundle_path, path_length) == 0 &&
+        read(fd, &stored, sizeof(stored)) == (ssize_t)sizeof(stored)) {
+        hit = memcmp(&stored, snapshot, sizeof(stored)) == 0;
+    }
+    
+    close(fd);
+    log_message(LOG_DEBUG, "Validation cache %s: %s", hit ? "hit" : "miss", bundle_path);
+    return hit;
+}
+
+/**
+ * @brief Remember that a bundle passed validation in the given state
+ * @param probe Bundle probe that passed validation
+ * @param snapshot Component states taken before validation ran
+ */
+void validation_cache_store(const bundle_probe_t *probe, const bundle_snapshot_t *snapshot) {
+    const char *bundle_path = probe->path;
+    char entry_path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH + 16];
+    cache_header_t header;
+    size_t path_length = strlen(bundle_path);
+    int fd;
+    
+    if (!validation_cache_enabled ||
+        cache_entry_path(CACHE_VALIDATION_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return;
+    }
+    
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", entry_path, (long)getpid());
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        log_message(LOG_DEBUG, "Cannot write validation cache: %s", strerror(errno));
+        return;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_FORMAT_VERSION;
+    header.path_length = (uint32_t)path_length;
+    
+    // Write to a private file and rename so readers never see partial entries
+    int failed = write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+                 write(fd, bundle_path, path_length) != (ssize_t)path_length ||
+                 write(fd, snapshot, sizeof(*snapshot)) != (ssize_t)sizeof(*snapshot);
+    if (close(fd) != 0 || failed || rename(temp_path, entry_path) != 0) {
+        log_message(LOG_DEBUG, "Cannot write validation cache: %s", strerror(errno));
+        unlink(temp_path);
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file cache.h
+ * @brief Persistent bundle validation cache
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Records the inode, mtime and size of every bundle component after a
+ * successful validation so later launches can revalidate from the probe
+ * pass alone.
+ */
+
+#ifndef VLAUNCH_CACHE_H
+#define VLAUNCH_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "probe.h"
+
+/* Cache Configuration */
+#define CACHE_DIR_NAME          "vlaunch"
+#define CACHE_VALIDATION_DIR    "validation"
+#define CACHE_MAGIC             0x43564c56u /* "VLVC" */
+#define CACHE_FORMAT_VERSION    2
+
+/* On-disk state of one component */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    uint32_t mode;
+    uint32_t present;
+} component_state_t;
+
+/* State of all components of a bundle */
+typedef struct {
+    component_state_t components[COMPONENT_COUNT];
+} bundle_snapshot_t;
+
+int cache_directory(const char *subdir, char *out, size_t size);
+int cache_entry_path(const char *subdir, const char *key, char *out, size_t size);
+void component_state_take(const struct statx *stx, component_state_t *state);
+void bundle_snapshot_take(const bundle_probe_t *probe, bundle_snapshot_t *snapshot);
+int validation_cache_lookup(const bundle_probe_t *probe, bundle_snapshot_t *snapshot);
+void validation_cache_store(const bundle_probe_t *probe, const bundle_snapshot_t *snapshot);
+void validation_cache_set_enabled(int enabled);
+
+#endif /* VLAUNCH_CACHE_H */
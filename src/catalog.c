@@ -0,0 +1,920 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file catalog.c
+ * @brief Catalog of installed bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Roots are walked by a pool of threads, each owning a deque of
+ * directories: a thread works depth-first from the back of its own deque
+ * and steals from the front of the others when it runs dry, so one deep
+ * root spreads across the pool. Directories are read with getdents64()
+ * and classified by d_type, so only bundles themselves are stat'ed.
+ * Bundle directories are not descended into.
+ *
+ * In watch mode every walked directory, bundle and exec/ directory gets
+ * an inotify watch; events mark bundles for revalidation and the catalog
+ * is rewritten once events settle. Queue overflows fall back to a full
+ * walk. fanotify would need CAP_SYS_ADMIN, so inotify is used.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/inotify.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "catalog.h"
+
+/* Buffer for one getdents64() call */
+#define CATALOG_DENTS_SIZE  (32 * 1024)
+
+/* Events the watches report */
+#define WATCH_DIRECTORY_MASK    (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+#define WATCH_BUNDLE_MASK       (WATCH_DIRECTORY_MASK | IN_CLOSE_WRITE | IN_ATTRIB)
+
+/* Record layout of getdents64() */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* One bundle while the catalog is being built */
+typedef struct {
+    char *path;
+    char *name;
+    char *version;
+    char *entry;
+    uint32_t status;
+    uint32_t flags;
+    uint64_t dir_ino;
+    int64_t dir_mtime_sec;
+    int64_t dir_mtime_nsec;
+} catalog_record_t;
+
+/* A directory waiting to be walked */
+typedef struct {
+    char *path;
+    unsigned int depth;
+} walk_item_t;
+
+/* Directories owned by one walker thread */
+typedef struct {
+    walk_item_t *items;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+    pthread_mutex_t lock;
+} walk_deque_t;
+
+/* What an inotify watch descriptor stands for */
+typedef enum {
+    WATCH_NONE,
+    WATCH_DIRECTORY,
+    WATCH_BUNDLE
+} watch_kind_t;
+
+/* One inotify watch; bundles watch their root and exec/ under the bundle path */
+typedef struct {
+    char *path;
+    watch_kind_t kind;
+    unsigned int depth;
+} catalog_watch_t;
+
+/* State shared by the walker threads and the watch loop */
+typedef struct {
+    walk_deque_t deques[CATALOG_THREADS];
+    unsigned int thread_count;
+    unsigned int pending;
+    
+    catalog_record_t *records;
+    size_t record_count;
+    size_t record_capacity;
+    pthread_mutex_t records_lock;
+    
+    int inotify_fd;
+    catalog_watch_t *watches;
+    size_t watch_capacity;
+    pthread_mutex_t watches_lock;
+} catalog_state_t;
+
+/* Argument of one walker thread */
+typedef struct {
+    catalog_state_t *state;
+    unsigned int index;
+} walk_worker_t;
+
+/**
+ * @brief Check whether a name ends in the bundle suffix
+ * @param name Directory entry name
+ * @return 1 for bundle directories, 0 otherwise
+ */
+static int is_bundle_name(const char *name) {
+    size_t length = strlen(name);
+    
+    return length > sizeof(CATALOG_SUFFIX) - 1 &&
+           strcmp(name + length - (sizeof(CATALOG_SUFFIX) - 1), CATALOG_SUFFIX) == 0;
+}
+
+/**
+ * @brief Join a directory and an entry name
+ * @param directory Directory path
+ * @param name Entry name
+ * @return Newly allocated path, or NULL if too long or out of memory
+ */
+static char *join_path(const char *directory, const char *name) {
+    char path[MAX_PATH_LENGTH];
+    
+    if (snprintf(path, sizeof(path), "%s/%s", directory, name) >= (int)sizeof(path)) {
+        return NULL;
+    }
+    return strdup(path);
+}
+
+/**
+ * @brief Remember what a watch descriptor stands for
+ * @param state Catalog state
+ * @param path Directory to watch
+ * @param owner Path reported for events: the directory itself or its bundle
+ * @param kind Kind of watch
+ * @param depth Walk depth of a directory watch
+ */
+static void watch_add(catalog_state_t *state, const char *path, const char *owner, watch_kind_t kind, unsigned int depth) {
+    int wd;
+    
+    if (state->inotify_fd < 0) {
+        return;
+    }
+    wd = inotify_add_watch(state->inotify_fd, path, kind == WATCH_BUNDLE ? WATCH_BUNDLE_MASK : WATCH_DIRECTORY_MASK);
+    if (wd < 0) {
+        log_message(LOG_DEBUG, "Cannot watch %s: %s", path, strerror(errno));
+        return;
+    }
+    
+    pthread_mutex_lock(&state->watches_lock);
+    if ((size_t)wd >= state->watch_capacity) {
+        size_t capacity = state->watch_capacity ? state->watch_capacity : 64;
+        catalog_watch_t *grown;
+        
+        while (capacity <= (size_t)wd) {
+            capacity *= 2;
+        }
+        grown = realloc(state->watches, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&state->watches_lock);
+            return;
+        }
+        memset(grown + state->watch_capacity, 0, (capacity - state->watch_capacity) * sizeof(*grown));
+        state->watches = grown;
+        state->watch_capacity = capacity;
+    }
+    
+    // The same inode watched twice yields the same descriptor; the caller
+    // may be handling an event of that watch and still using its path
+    if (state->watches[wd].path && strcmp(state->watches[wd].path, owner) == 0) {
+        state->watches[wd].kind = kind;
+        state->watches[wd].depth = depth;
+        pthread_mutex_unlock(&state->watches_lock);
+        return;
+    }
+    free(state->watches[wd].path);
+    state->watches[wd].path = strdup(owner);
+    state->watches[wd].kind = state->watches[wd].path ? kind : WATCH_NONE;
+    state->watches[wd].depth = depth;
+    pthread_mutex_unlock(&state->watches_lock);
+}
+
+/**
+ * @brief Release one record
+ * @param record Record to release
+ */
+static void record_free(catalog_record_t *record) {
+    free(record->path);
+    free(record->name);
+    free(record->version);
+    free(record->entry);
+}
+
+/**
+ * @brief Copy a metadata value, or a fallback if it is empty
+ * @param value Metadata value
+ * @param fallback String used when the value is empty
+ * @param length Length of the fallback
+ * @return Newly allocated string, or NULL if out of memory
+ */
+static char *copy_value(const metadata_value_t *value, const char *fallback, size_t length) {
+    if (value->length > 0) {
+        return strndup(value->data, value->length);
+    }
+    return strndup(fallback, length);
+}
+
+/**
+ * @brief Validate a bundle and collect its catalog fields
+ * @param state Catalog state, for watches
+ * @param path Canonical bundle path
+ * @param record Receives the record
+ * @return 0 on success, -1 if the bundle cannot be opened
+ */
+static int record_load(catalog_state_t *state, const char *path, catalog_record_t *record) {
+    const char *base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    bundle_snapshot_t snapshot;
+    bundle_probe_t probe;
+    char *exec_dir;
+    
+    memset(record, 0, sizeof(*record));
+    
+    // Watch before probing, so a change made while validating still raises an event
+    watch_add(state, path, path, WATCH_BUNDLE, 0);
+    exec_dir = join_path(path, "exec");
+    if (exec_dir) {
+        watch_add(state, exec_dir, path, WATCH_BUNDLE, 0);
+        free(exec_dir);
+    }
+    
+    if (bundle_probe_open(&probe, path) != EXIT_SUCCESS) {
+        bundle_probe_close(&probe);
+        return -1;
+    }
+    
+    // Same rules and the same cache as a launch
+    if (probe.manifest || validation_cache_lookup(&probe, &snapshot)) {
+        record->status = EXIT_SUCCESS;
+    } else {
+        record->status = (uint32_t)validate_bundle(&probe);
+        if (record->status == EXIT_SUCCESS) {
+            validation_cache_store(&probe, &snapshot);
+        }
+    }
+    
+    record->flags = (bundle_probe_is_file(&probe, COMPONENT_ICON) ? CATALOG_HAS_ICON : 0) |
+                    (bundle_probe_is_directory(&probe, COMPONENT_LIBRARY) ? CATALOG_HAS_LIBRARY : 0) |
+                    (bundle_probe_is_directory(&probe, COMPONENT_RESOURCES) ? CATALOG_HAS_RESOURCES : 0) |
+                    (probe.manifest ? CATALOG_HAS_MANIFEST : 0);
+    record->dir_ino = probe.components[COMPONENT_ROOT].stx_ino;
+    record->dir_mtime_sec = probe.components[COMPONENT_ROOT].stx_mtime.tv_sec;
+    record->dir_mtime_nsec = probe.components[COMPONENT_ROOT].stx_mtime.tv_nsec;
+    record->path = strdup(path);
+    record->name = copy_value(&probe.metadata.name, base, strlen(base) - (sizeof(CATALOG_SUFFIX) - 1));
+    record->version = copy_value(&probe.metadata.version, "", 0);
+    record->entry = copy_value(&probe.metadata.entry, "", 0);
+    bundle_probe_close(&probe);
+    
+    if (!record->path || !record->name || !record->version || !record->entry) {
+        record_free(record);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Add a record, replacing one with the same path
+ * @param state Catalog state
+ * @param record Record to add; ownership passes to the catalog
+ */
+static void records_put(catalog_state_t *state, catalog_record_t *record) {
+    pthread_mutex_lock(&state->records_lock);
+    for (size_t i = 0; i < state->record_count; i++) {
+        if (strcmp(state->records[i].path, record->path) == 0) {
+            record_free(&state->records[i]);
+            state->records[i] = *record;
+            pthread_mutex_unlock(&state->records_lock);
+            return;
+        }
+    }
+    
+    if (state->record_count == state->record_capacity) {
+        size_t capacity = state->record_capacity ? state->record_capacity * 2 : 64;
+        catalog_record_t *grown = realloc(state->records, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&state->records_lock);
+            record_free(record);
+            return;
+        }
+        state->records = grown;
+        state->record_capacity = capacity;
+    }
+    state->records[state->record_count++] = *record;
+    pthread_mutex_unlock(&state->records_lock);
+}
+
+/**
+ * @brief Remove a bundle, or every bundle below a directory
+ * @param state Catalog state
+ * @param path Bundle path, or directory path
+ * @param prefix Non-zero to remove everything below path
+ */
+static void records_remove(catalog_state_t *state, const char *path, int prefix) {
+    size_t length = strlen(path);
+    size_t kept = 0;
+    
+    pthread_mutex_lock(&state->records_lock);
+    for (size_t i = 0; i < state->record_count; i++) {
+        const char *candidate = state->records[i].path;
+        int match = prefix ? strncmp(candidate, path, length) == 0 && candidate[length] == '/'
+                           : strcmp(candidate, path) == 0;
+        if (match) {
+            record_free(&state->records[i]);
+        } else {
+            state->records[kept++] = state->records[i];
+        }
+    }
+    state->record_count = kept;
+    pthread_mutex_unlock(&state->records_lock);
+}
+
+/**
+ * @brief Catalog a bundle, or drop it if it is gone
+ * @param state Catalog state
+ * @param path Canonical bundle path
+ */
+static void update_bundle(catalog_state_t *state, const char *path) {
+    catalog_record_t record;
+    
+    if (record_load(state, path, &record) == 0) {
+        records_put(state, &record);
+    } else {
+        records_remove(state, path, 0);
+    }
+}
+
+/**
+ * @brief Queue a directory on a walker's own deque
+ * @param state Catalog state
+ * @param index Walker index
+ * @param path Directory path; ownership passes to the queue
+ * @param depth Walk depth
+ */
+static void walk_push(catalog_state_t *state, unsigned int index, char *path, unsigned int depth) {
+    walk_deque_t *deque = &state->deques[index];
+    
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+        walk_item_t *grown = realloc(deque->items, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            free(path);
+            return;
+        }
+        deque->items = grown;
+        deque->capacity = capacity;
+    }
+    deque->items[deque->tail].path = path;
+    deque->items[deque->tail].depth = depth;
+    deque->tail++;
+    __atomic_add_fetch(&state->pending, 1, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/**
+ * @brief Take a directory from a deque
+ * @param deque Deque to take from
+ * @param own Non-zero to take the newest item (owner), zero for the oldest (thief)
+ * @param item Receives the directory
+ * @return 1 if a directory was taken, 0 if the deque is empty
+ */
+static int walk_take(walk_deque_t *deque, int own, walk_item_t *item) {
+    int taken = 0;
+    
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *item = own ? deque->items[--deque->tail] : deque->items[deque->head++];
+        taken = 1;
+        if (deque->head == deque->tail) {
+            deque->head = deque->tail = 0;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+/**
+ * @brief Read one directory, cataloguing bundles and queueing subdirectories
+ * @param state Catalog state
+ * @param index Walker index
+ * @param item Directory to read
+ */
+static void walk_directory(catalog_state_t *state, unsigned int index, const walk_item_t *item) {
+    char buffer[CATALOG_DENTS_SIZE];
+    long size;
+    int fd;
+    
+    fd = open(item->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        log_message(LOG_DEBUG, "Cannot read %s: %s", item->path, strerror(errno));
+        return;
+    }
+    watch_add(state, item->path, item->path, WATCH_DIRECTORY, item->depth);
+    
+    while ((size = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < size; ) {
+            const struct linux_dirent64 *entry = (const struct linux_dirent64 *)(buffer + offset);
+            unsigned char type = entry->d_type;
+            char *path;
+            
+            offset += entry->d_reclen;
+            
+            // Hidden entries, including . and .., are never bundles
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+                type = fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+            }
+            if (type != DT_DIR) {
+                continue;
+            }
+            if (!is_bundle_name(entry->d_name) && item->depth >= CATALOG_MAX_DEPTH) {
+                continue;
+            }
+            
+            path = join_path(item->path, entry->d_name);
+            if (path == NULL) {
+                continue;
+            }
+            if (is_bundle_name(entry->d_name)) {
+                update_bundle(state, path);
+                free(path);
+            } else {
+                walk_push(state, index, path, item->depth + 1);
+            }
+        }
+    }
+    
+    close(fd);
+}
+
+/**
+ * @brief Walker thread: drain the own deque, then steal, until no work is left anywhere
+ * @param arg walk_worker_t of this thread
+ * @return Always NULL
+ */
+static void *walk_worker(void *arg) {
+    walk_worker_t *worker = arg;
+    catalog_state_t *state = worker->state;
+    walk_item_t item;
+    
+    for (;;) {
+        int found = walk_take(&state->deques[worker->index], 1, &item);
+        
+        for (unsigned int i = 1; !found && i < state->thread_count; i++) {
+            found = walk_take(&state->deques[(worker->index + i) % state->thread_count], 0, &item);
+        }
+        if (found) {
+            walk_directory(state, worker->index, &item);
+            free(item.path);
+            __atomic_sub_fetch(&state->pending, 1, __ATOMIC_ACQ_REL);
+            continue;
+        }
+        
+        // Work still in flight may queue more directories
+        if (__atomic_load_n(&state->pending, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        }
+        sched_yield();
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Walk directories with the thread pool
+ * @param state Catalog state
+ * @param paths Directories to walk; bundle paths are catalogued directly
+ * @param count Number of directories
+ * @param depth Walk depth of the directories
+ */
+static void walk_paths(catalog_state_t *state, char *const *paths, unsigned int count, unsigned int depth) {
+    pthread_t threads[CATALOG_THREADS];
+    walk_worker_t workers[CATALOG_THREADS];
+    unsigned int started = 0;
+    
+    state->thread_count = CATALOG_THREADS;
+    for (unsigned int i = 0; i < count; i++) {
+        const char *base = strrchr(paths[i], '/') ? strrchr(paths[i], '/') + 1 : paths[i];
+        char *path;
+        
+        if (is_bundle_name(base)) {
+            update_bundle(state, paths[i]);
+        } else if ((path = strdup(paths[i])) != NULL) {
+            walk_push(state, i % CATALOG_THREADS, path, depth);
+        }
+    }
+    
+    for (unsigned int i = 0; i < CATALOG_THREADS; i++) {
+        workers[i].state = state;
+        workers[i].index = i;
+    }
+    while (started + 1 < CATALOG_THREADS &&
+           pthread_create(&threads[started], NULL, walk_worker, &workers[started + 1]) == 0) {
+        started++;
+    }
+    walk_worker(&workers[0]);
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/**
+ * @brief Order records by path
+ * @param a First record
+ * @param b Second record
+ * @return Comparison result for qsort()
+ */
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(((const catalog_record_t *)a)->path, ((const catalog_record_t *)b)->path);
+}
+
+/**
+ * @brief Order record indices by application name
+ * @param a First index
+ * @param b Second index
+ * @param arg Record array
+ * @return Comparison result for qsort_r()
+ */
+static int compare_names(const void *a, const void *b, void *arg) {
+    const catalog_record_t *records = arg;
+    const catalog_record_t *left = &records[*(const uint32_t *)a];
+    const catalog_record_t *right = &records[*(const uint32_t *)b];
+    int cmp = strcasecmp(left->name, right->name);
+    
+    return cmp != 0 ? cmp : strcmp(left->path, right->path);
+}
+
+/**
+ * @brief Append a string to the string table
+ * @param strings String table
+ * @param used Bytes used so far, advanced past the string
+ * @param value String to add
+ * @param out Receives the reference
+ */
+static void add_string(char *strings, size_t *used, const char *value, catalog_string_t *out) {
+    size_t length = strlen(value);
+    
+    out->offset = (uint32_t)*used;
+    out->length = (uint32_t)length;
+    memcpy(strings + *used, value, length + 1);
+    *used += length + 1;
+}
+
+/**
+ * @brief Write the catalog atomically
+ * @param state Catalog state
+ * @param path Catalog path
+ * @param roots Canonical root paths
+ * @param root_count Number of roots
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int write_catalog(catalog_state_t *state, const char *path, char *const *roots, unsigned int root_count) {
+    char temp_path[MAX_PATH_LENGTH + 16];
+    catalog_header_t header;
+    catalog_entry_t *entries;
+    catalog_string_t *root_strings;
+    uint32_t *order;
+    char *strings;
+    size_t count = state->record_count;
+    size_t strings_size = 1;
+    size_t used = 0;
+    int failed;
+    int fd;
+    
+    qsort(state->records, count, sizeof(*state->records), compare_paths);
+    for (size_t i = 0; i < count; i++) {
+        const catalog_record_t *record = &state->records[i];
+        strings_size += strlen(record->path) + strlen(record->name) + strlen(record->version) + strlen(record->entry) + 4;
+    }
+    for (unsigned int i = 0; i < root_count; i++) {
+        strings_size += strlen(roots[i]) + 1;
+    }
+    if (strings_size > UINT32_MAX / 2 || count > UINT32_MAX / sizeof(*entries)) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    entries = calloc(count ? count : 1, sizeof(*entries));
+    order = calloc(count ? count : 1, sizeof(*order));
+    root_strings = calloc(root_count ? root_count : 1, sizeof(*root_strings));
+    strings = malloc(strings_size);
+    if (!entries || !order || !root_strings || !strings) {
+        failed = 1;
+        goto out;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        const catalog_record_t *record = &state->records[i];
+        
+        add_string(strings, &used, record->path, &entries[i].path);
+        add_string(strings, &used, record->name, &entries[i].name);
+        add_string(strings, &used, record->version, &entries[i].version);
+        add_string(strings, &used, record->entry, &entries[i].entry);
+        entries[i].status = record->status;
+        entries[i].flags = record->flags;
+        entries[i].dir_ino = record->dir_ino;
+        entries[i].dir_mtime_sec = record->dir_mtime_sec;
+        entries[i].dir_mtime_nsec = record->dir_mtime_nsec;
+        order[i] = (uint32_t)i;
+    }
+    for (unsigned int i = 0; i < root_count; i++) {
+        add_string(strings, &used, roots[i], &root_strings[i]);
+    }
+    strings[used++] = '\0';
+    qsort_r(order, count, sizeof(*order), compare_names, state->records);
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = CATALOG_MAGIC;
+    header.version = CATALOG_VERSION;
+    header.entry_count = (uint32_t)count;
+    header.root_count = root_count;
+    header.name_order_offset = (uint32_t)(sizeof(header) + count * sizeof(*entries));
+    header.roots_offset = header.name_order_offset + (uint32_t)(count * sizeof(*order));
+    header.strings_offset = header.roots_offset + (uint32_t)(root_count * sizeof(*root_strings));
+    header.strings_size = (uint32_t)used;
+    header.size = header.strings_offset + used;
+    
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long)getpid());
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    failed = fd < 0;
+    if (!failed) {
+        failed = write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+                 write(fd, entries, count * sizeof(*entries)) != (ssize_t)(count * sizeof(*entries)) ||
+                 write(fd, order, count * sizeof(*order)) != (ssize_t)(count * sizeof(*order)) ||
+                 write(fd, root_strings, root_count * sizeof(*root_strings)) != (ssize_t)(root_count * sizeof(*root_strings)) ||
+                 write(fd, strings, used) != (ssize_t)used;
+        failed = close(fd) != 0 || failed || rename(temp_path, path) != 0;
+        if (failed) {
+            unlink(temp_path);
+        }
+    }
+    
+out:
+    free(entries);
+    free(order);
+    free(root_strings);
+    free(strings);
+    return failed ? EXIT_SYSTEM_ERROR : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Write the catalog and report its contents
+ * @param state Catalog state
+ * @param path Catalog path
+ * @param roots Canonical root paths
+ * @param root_count Number of roots
+ * @param started Start of the walk or update, CLOCK_MONOTONIC
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int publish_catalog(catalog_state_t *state, const char *path, char *const *roots, unsigned int root_count,
+                           const struct timespec *started) {
+    struct timespec now;
+    size_t valid = 0;
+    
+    if (write_catalog(state, path, roots, root_count) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "Cannot write catalog %s: %s", path, strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    for (size_t i = 0; i < state->record_count; i++) {
+        valid += state->records[i].status == EXIT_SUCCESS;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    log_message(LOG_INFO, "Catalog %s: %zu bundles, %zu valid (%.1f ms)", path, state->record_count, valid,
+                (double)(now.tv_sec - started->tv_sec) * 1e3 + (double)(now.tv_nsec - started->tv_nsec) / 1e6);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Apply one inotify event to the catalog
+ * @param state Catalog state
+ * @param event Event read from the inotify descriptor
+ * @return 1 if the catalog changed, 0 otherwise
+ */
+static int apply_event(catalog_state_t *state, const struct inotify_event *event) {
+    catalog_watch_t watch;
+    char *child;
+    
+    if (event->wd < 0 || (size_t)event->wd >= state->watch_capacity || state->watches[event->wd].kind == WATCH_NONE) {
+        return 0;
+    }
+    if (event->mask & IN_IGNORED) {
+        free(state->watches[event->wd].path);
+        state->watches[event->wd].path = NULL;
+        state->watches[event->wd].kind = WATCH_NONE;
+        return 0;
+    }
+    
+    watch = state->watches[event->wd];
+    if (watch.kind == WATCH_BUNDLE) {
+        update_bundle(state, watch.path);
+        return 1;
+    }
+    if (event->len == 0 || event->name[0] == '.' || !(event->mask & IN_ISDIR)) {
+        return 0;
+    }
+    
+    child = join_path(watch.path, event->name);
+    if (child == NULL) {
+        return 0;
+    }
+    if (is_bundle_name(event->name)) {
+        update_bundle(state, child);
+    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        records_remove(state, child, 1);
+    } else if (watch.depth < CATALOG_MAX_DEPTH) {
+        walk_paths(state, &child, 1, watch.depth + 1);
+    }
+    free(child);
+    return 1;
+}
+
+/**
+ * @brief Keep the catalog current until the process is stopped
+ * @param state Catalog state with watches on everything walked
+ * @param path Catalog path
+ * @param roots Canonical root paths
+ * @param root_count Number of roots
+ * @return EXIT_SYSTEM_ERROR if the inotify descriptor fails
+ */
+static int watch_catalog(catalog_state_t *state, const char *path, char *const *roots, unsigned int root_count) {
+    char buffer[16 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd poll_fd = { state->inotify_fd, POLLIN, 0 };
+    struct timespec started;
+    int dirty = 0;
+    
+    log_message(LOG_INFO, "Watching %u bundle roots for changes", root_count);
+    for (;;) {
+        // Bursts, such as an install unpacking a bundle, are written out once
+        int ready = poll(&poll_fd, 1, dirty ? CATALOG_SETTLE_MS : -1);
+        ssize_t size;
+        
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0) {
+            return EXIT_SYSTEM_ERROR;
+        }
+        if (ready == 0) {
+            publish_catalog(state, path, roots, root_count, &started);
+            dirty = 0;
+            continue;
+        }
+        
+        size = read(state->inotify_fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            if (size < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            return EXIT_SYSTEM_ERROR;
+        }
+        if (!dirty) {
+            clock_gettime(CLOCK_MONOTONIC, &started);
+        }
+        
+        for (ssize_t offset = 0; offset < size; ) {
+            const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+            
+            offset += (ssize_t)(sizeof(*event) + event->len);
+            if (event->mask & IN_Q_OVERFLOW) {
+                log_message(LOG_WARNING, "Watch queue overflowed, walking all roots again");
+                records_remove(state, "", 1);
+                walk_paths(state, roots, root_count, 0);
+                dirty = 1;
+                continue;
+            }
+            dirty |= apply_event(state, event);
+        }
+    }
+}
+
+/**
+ * @brief Build the catalog of bundles below some roots
+ * @param roots Directories to walk, or bundle paths
+ * @param root_count Number of roots
+ * @param watch Non-zero to keep the catalog current with inotify
+ * @return EXIT_SUCCESS on success, error code on failure; does not return while watching
+ */
+int catalog_build(char *const *roots, unsigned int root_count, int watch) {
+    char catalog_path[MAX_PATH_LENGTH];
+    catalog_state_t state;
+    struct timespec started;
+    char **canonical;
+    unsigned int usable = 0;
+    int result;
+    
+    if (cache_directory(NULL, catalog_path, sizeof(catalog_path)) != EXIT_SUCCESS ||
+        strlen(catalog_path) + sizeof(CATALOG_FILE) + 1 > sizeof(catalog_path)) {
+        log_message(LOG_ERROR, "Cannot locate the launcher cache directory");
+        return EXIT_SYSTEM_ERROR;
+    }
+    strcat(catalog_path, "/" CATALOG_FILE);
+    
+    canonical = calloc(root_count, sizeof(*canonical));
+    if (canonical == NULL) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    for (unsigned int i = 0; i < root_count; i++) {
+        canonical[usable] = realpath(roots[i], NULL);
+        if (canonical[usable] == NULL) {
+            log_message(LOG_WARNING, "Skipping bundle root %s: %s", roots[i], strerror(errno));
+            continue;
+        }
+        usable++;
+    }
+    
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.records_lock, NULL);
+    pthread_mutex_init(&state.watches_lock, NULL);
+    for (unsigned int i = 0; i < CATALOG_THREADS; i++) {
+        pthread_mutex_init(&state.deques[i].lock, NULL);
+    }
+    state.inotify_fd = -1;
+    if (watch) {
+        state.inotify_fd = inotify_init1(IN_CLOEXEC);
+        if (state.inotify_fd < 0) {
+            log_message(LOG_ERROR, "Cannot watch bundle roots: %s", strerror(errno));
+        }
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    walk_paths(&state, canonical, usable, 0);
+    result = publish_catalog(&state, catalog_path, canonical, usable, &started);
+    if (result == EXIT_SUCCESS && state.inotify_fd >= 0) {
+        result = watch_catalog(&state, catalog_path, canonical, usable);
+    } else if (result == EXIT_SUCCESS && watch) {
+        result = EXIT_SYSTEM_ERROR;
+    }
+    
+    if (state.inotify_fd >= 0) {
+        close(state.inotify_fd);
+    }
+    for (size_t i = 0; i < state.watch_capacity; i++) {
+        free(state.watches[i].path);
+    }
+    free(state.watches);
+    for (size_t i = 0; i < state.record_count; i++) {
+        record_free(&state.records[i]);
+    }
+    free(state.records);
+    for (unsigned int i = 0; i < CATALOG_THREADS; i++) {
+        free(state.deques[i].items);
+        pthread_mutex_destroy(&state.deques[i].lock);
+    }
+    pthread_mutex_destroy(&state.records_lock);
+    pthread_mutex_destroy(&state.watches_lock);
+    for (unsigned int i = 0; i < usable; i++) {
+        free(canonical[i]);
+    }
+    free(canonical);
+    return result;
+}
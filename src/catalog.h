@@ -0,0 +1,230 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file catalog.h
+ * @brief Catalog of installed bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * launcher --catalog <root>... walks bundle roots for *.app directories,
+ * validates each one like a launch would and writes what menus and
+ * search need into $XDG_CACHE_HOME/vlaunch/catalog: entries sorted by
+ * path plus an index sorted by application name. With --watch the
+ * launcher stays running and rewrites the catalog as bundles appear,
+ * change or go away.
+ *
+ * Define CATALOG_FORMAT_ONLY to use the reader below without the rest of
+ * the launcher.
+ */
+
+#ifndef VLAUNCH_CATALOG_H
+#define VLAUNCH_CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Catalog Format */
+#define CATALOG_MAGIC       0x54434c56u /* "VLCT" */
+#define CATALOG_VERSION     1
+#define CATALOG_FILE        "catalog"
+#define CATALOG_SUFFIX      ".app"
+
+/* Entry flags */
+#define CATALOG_HAS_ICON        0x1u
+#define CATALOG_HAS_LIBRARY     0x2u
+#define CATALOG_HAS_RESOURCES   0x4u
+#define CATALOG_HAS_MANIFEST    0x8u
+
+/* String in the string table; always NUL-terminated, length excludes the NUL */
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} catalog_string_t;
+
+/* File header; offsets are relative to the start of the file */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t root_count;
+    uint32_t roots_offset;
+    uint32_t name_order_offset;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint64_t size;
+} catalog_header_t;
+
+/* One bundle; status is the launcher exit code validation would give */
+typedef struct {
+    catalog_string_t path;
+    catalog_string_t name;
+    catalog_string_t version;
+    catalog_string_t entry;
+    uint32_t status;
+    uint32_t flags;
+    uint64_t dir_ino;
+    int64_t dir_mtime_sec;
+    int64_t dir_mtime_nsec;
+} catalog_entry_t;
+
+/**
+ * @brief Check that a string reference lies inside the string table
+ * @param header Catalog header
+ * @param string String reference
+ * @return 1 if the string is usable, 0 otherwise
+ */
+static inline int catalog_string_valid(const catalog_header_t *header, const catalog_string_t *string) {
+    return string->offset < header->strings_size &&
+           string->length < header->strings_size - string->offset;
+}
+
+/**
+ * @brief Check that a mapped catalog is structurally sound
+ * @param map Start of the mapped catalog
+ * @param size Size of the mapping
+ * @return 1 if the catalog can be used, 0 otherwise
+ *
+ * Each string is checked here, so the accessors below need no checks.
+ */
+static inline int catalog_valid(const void *map, size_t size) {
+    const catalog_header_t *header = map;
+    const catalog_entry_t *entries = (const catalog_entry_t *)(header + 1);
+    const char *strings = (const char *)map + header->strings_offset;
+    const uint32_t *order;
+    const catalog_string_t *roots;
+    
+    if (size < sizeof(*header) || header->magic != CATALOG_MAGIC || header->version != CATALOG_VERSION ||
+        header->size != size || header->strings_offset > size || header->strings_size > size - header->strings_offset ||
+        header->strings_size == 0 || strings[header->strings_size - 1] != '\0' ||
+        (size - sizeof(*header)) / sizeof(*entries) < header->entry_count ||
+        header->name_order_offset > size || (size - header->name_order_offset) / sizeof(uint32_t) < header->entry_count ||
+        header->roots_offset > size || (size - header->roots_offset) / sizeof(catalog_string_t) < header->root_count ||
+        header->name_order_offset % sizeof(uint32_t) != 0 || header->roots_offset % sizeof(uint32_t) != 0) {
+        return 0;
+    }
+    
+    order = (const uint32_t *)((const char *)map + header->name_order_offset);
+    roots = (const catalog_string_t *)((const char *)map + header->roots_offset);
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const catalog_entry_t *entry = &entries[i];
+        
+        if (!catalog_string_valid(header, &entry->path) || !catalog_string_valid(header, &entry->name) ||
+            !catalog_string_valid(header, &entry->version) || !catalog_string_valid(header, &entry->entry) ||
+            order[i] >= header->entry_count) {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < header->root_count; i++) {
+        if (!catalog_string_valid(header, &roots[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Get a string stored in a validated catalog
+ * @param map Start of the mapped catalog
+ * @param string String reference
+ * @return NUL-terminated string inside the mapping
+ */
+static inline const char *catalog_string(const void *map, const catalog_string_t *string) {
+    const catalog_header_t *header = map;
+    
+    return (const char *)map + header->strings_offset + string->offset;
+}
+
+/**
+ * @brief Get an entry in path order
+ * @param map Start of a validated catalog mapping
+ * @param index Index below entry_count
+ * @return Entry
+ */
+static inline const catalog_entry_t *catalog_entry(const void *map, uint32_t index) {
+    return (const catalog_entry_t *)((const catalog_header_t *)map + 1) + index;
+}
+
+/**
+ * @brief Get an entry in application name order, for menus
+ * @param map Start of a validated catalog mapping
+ * @param index Index below entry_count
+ * @return Entry
+ */
+static inline const catalog_entry_t *catalog_entry_by_name(const void *map, uint32_t index) {
+    const catalog_header_t *header = map;
+    const uint32_t *order = (const uint32_t *)((const char *)map + header->name_order_offset);
+    
+    return catalog_entry(map, order[index]);
+}
+
+/**
+ * @brief Find a bundle by path
+ * @param map Start of a validated catalog mapping
+ * @param path Canonical absolute bundle path
+ * @return Entry, or NULL if the bundle is not in the catalog
+ */
+static inline const catalog_entry_t *catalog_find(const void *map, const char *path) {
+    const catalog_header_t *header = map;
+    uint32_t low = 0;
+    uint32_t high = header->entry_count;
+    
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int cmp = strcmp(path, catalog_string(map, &catalog_entry(map, mid)->path));
+        
+        if (cmp == 0) {
+            return catalog_entry(map, mid);
+        }
+        if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    return NULL;
+}
+
+#ifndef CATALOG_FORMAT_ONLY
+
+/* Walker Configuration */
+#define CATALOG_THREADS     8
+#define CATALOG_MAX_DEPTH   8
+#define CATALOG_SETTLE_MS   200
+
+int catalog_build(char *const *roots, unsigned int root_count, int watch);
+#endif
+
+#endif /* VLAUNCH_CATALOG_H */
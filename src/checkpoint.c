@@ -0,0 +1,570 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file checkpoint.c
+ * @brief Fast resume of bundles from CRIU snapshots
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A snapshot lives in its own directory below CHECKPOINT_CACHE_DIR,
+ * named by a SHA-256 over the bundle path, the metadata file it was
+ * launched from, the identity of the executable, the sealed digest list
+ * if there is one and the state of every file below library/. Changing
+ * the bundle makes the next launch a cold start that takes a fresh
+ * snapshot, and a
+ * snapshot criu fails to restore is discarded. A restored application
+ * resumes with the environment and working directory of the run that
+ * was snapshotted.
+ *
+ * The launcher stays the application's parent in checkpoint mode: criu
+ * restores the process tree as its sibling, and the launcher waits for
+ * it and exits with its status. Stop signals are passed on.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "sha256.h"
+#include "trace.h"
+#include "history.h"
+#include "placement.h"
+#include "environment.h"
+#include "handoff.h"
+#include "checkpoint.h"
+#include "sandbox.h"
+#include "lazy.h"
+#include "integrity.h"
+
+/* Name of the file every criu image set contains */
+#define CHECKPOINT_INVENTORY    "inventory.img"
+
+/* Signals waited for while the application runs */
+static const int wait_signals[] = { SIGCHLD, SIGTERM, SIGINT, SIGHUP };
+
+/**
+ * @brief Find the criu binary, from CHECKPOINT_CRIU_ENV or the PATH
+ * @param out Receives the path of the binary
+ * @param size Size of out
+ * @return 0 if an executable criu was found, -1 otherwise
+ */
+static int find_criu(char *out, size_t size) {
+    const char *name = getenv(CHECKPOINT_CRIU_ENV);
+    const char *search = getenv("PATH");
+    
+    if (name == NULL || name[0] == '\0') {
+        name = CHECKPOINT_CRIU_DEFAULT;
+    }
+    if (strchr(name, '/') != NULL) {
+        if (strlen(name) >= size || access(name, X_OK) != 0) {
+            return -1;
+        }
+        strcpy(out, name);
+        return 0;
+    }
+    
+    while (search != NULL && *search != '\0') {
+        const char *end = strchr(search, ':');
+        size_t length = end ? (size_t)(end - search) : strlen(search);
+        
+        if (length > 0 && (size_t)snprintf(out, size, "%.*s/%s", (int)length, search, name) < size &&
+            access(out, X_OK) == 0) {
+            return 0;
+        }
+        search = end ? end + 1 : NULL;
+    }
+    return -1;
+}
+
+/**
+ * @brief Fold the state of every entry below a directory into a key
+ * @param ctx Key being derived
+ * @param fd Directory, consumed
+ * @param depth Levels of subdirectories still to descend into
+ */
+static void checkpoint_key_tree(sha256_t *ctx, int fd, int depth) {
+    DIR *dir = fdopendir(fd);
+    struct dirent *entry;
+    struct stat st;
+    uint64_t identity[6];
+    
+    if (dir == NULL) {
+        close(fd);
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 ||
+            fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        // The change time catches rewrites that put the old mtime back
+        identity[0] = st.st_ino;
+        identity[1] = st.st_mode;
+        identity[2] = (uint64_t)st.st_size;
+        identity[3] = (uint64_t)st.st_mtim.tv_sec;
+        identity[4] = (uint64_t)st.st_mtim.tv_nsec;
+        identity[5] = (uint64_t)st.st_ctim.tv_sec;
+        sha256_update(ctx, entry->d_name, strlen(entry->d_name) + 1);
+        sha256_update(ctx, identity, sizeof(identity));
+        if (S_ISDIR(st.st_mode) && depth > 0) {
+            int child = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            
+            if (child >= 0) {
+                checkpoint_key_tree(ctx, child, depth - 1);
+            }
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * @brief Derive the snapshot key of a launch
+ * @param probe Probe of a validated bundle
+ * @param hex Receives the key as hex
+ */
+static void checkpoint_key(const bundle_probe_t *probe, char hex[SHA256_HEX_SIZE]) {
+    const struct statx *exec = &probe->components[COMPONENT_EXEC];
+    uint64_t identity[5];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_t ctx;
+    int fd;
+    
+    // The NUL separator keeps the path from running into the metadata
+    sha256_init(&ctx);
+    sha256_update(&ctx, probe->path, strlen(probe->path) + 1);
+    if (probe->metadata.map != NULL) {
+        sha256_update(&ctx, probe->metadata.map, probe->metadata.size);
+    }
+    identity[0] = ((uint64_t)exec->stx_dev_major << 32) | exec->stx_dev_minor;
+    identity[1] = exec->stx_ino;
+    identity[2] = exec->stx_size;
+    identity[3] = (uint64_t)exec->stx_mtime.tv_sec;
+    identity[4] = exec->stx_mtime.tv_nsec;
+    sha256_update(&ctx, identity, sizeof(identity));
+    
+    // A sealed bundle's digest list covers content a stat cannot see change
+    fd = openat(probe->dirfd, INTEGRITY_FILE_NAME, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (sha256_fd(fd, digest) == 0) {
+            sha256_update(&ctx, digest, sizeof(digest));
+        }
+        close(fd);
+    }
+    
+    // Libraries are mapped into the snapshot, so replacing one invalidates it
+    if (bundle_probe_is_directory(probe, COMPONENT_LIBRARY)) {
+        fd = openat(probe->dirfd, bundle_component_paths[COMPONENT_LIBRARY],
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            checkpoint_key_tree(&ctx, fd, CHECKPOINT_KEY_DEPTH);
+        }
+    }
+    sha256_final(&ctx, digest);
+    sha256_hex(digest, hex);
+}
+
+/**
+ * @brief Remove an image directory and the files in it
+ * @param path Image directory
+ */
+static void remove_image(const char *path) {
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    
+    if (dir != NULL) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+                unlinkat(dirfd(dir), entry->d_name, 0);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+/**
+ * @brief Run criu and wait for it
+ * @param argv criu arguments, argv[0] being the binary
+ * @param mask Signal mask for the child
+ * @return criu exit status, or -1 if it could not be run or was killed
+ */
+static int run_criu(char *const argv[], const sigset_t *mask) {
+    int status;
+    pid_t pid;
+    
+    log_flush();
+    pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, mask, NULL);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * @brief Wait for the application to exit, passing on stop signals meanwhile
+ * @param pid Application pid
+ * @param waited Signal set of wait_signals, blocked by the caller
+ * @return Exit status of the application in the manner of a shell
+ */
+static int wait_application(pid_t pid, const sigset_t *waited) {
+    siginfo_t info;
+    int status;
+    
+    for (;;) {
+        pid_t reaped = waitpid(pid, &status, WNOHANG);
+        
+        if (reaped == pid) {
+            return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+        if (reaped < 0 && errno != EINTR) {
+            log_message(LOG_ERROR, "Failed to wait for application: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        
+        // Blocked signals stay pending until taken here, so none is missed
+        if (sigwaitinfo(waited, &info) > 0 && info.si_signo != SIGCHLD) {
+            kill(pid, info.si_signo);
+        }
+    }
+}
+
+/**
+ * @brief Wait until a descriptor becomes readable
+ * @param fd Descriptor
+ * @param timeout Milliseconds to wait
+ * @return Positive if readable, 0 on timeout, -1 on error
+ */
+static int wait_readable(int fd, int timeout) {
+    struct pollfd poll_fd = { fd, POLLIN, 0 };
+    int ready;
+    
+    do {
+        ready = poll(&poll_fd, 1, timeout);
+    } while (ready < 0 && errno == EINTR);
+    return ready;
+}
+
+/**
+ * @brief Wait for the application to report readiness and close the ready descriptor
+ * @param fd Read end of the ready pipe
+ * @return 0 if the application is ready to be snapshotted, -1 otherwise
+ */
+static int wait_ready(int fd) {
+    char buffer[64];
+    ssize_t got;
+    
+    if (wait_readable(fd, CHECKPOINT_READY_MS) <= 0) {
+        log_message(LOG_WARNING, "Application not ready within %d ms, no snapshot taken", CHECKPOINT_READY_MS);
+        return -1;
+    }
+    got = read(fd, buffer, sizeof(buffer));
+    if (got <= 0) {
+        log_message(LOG_INFO, "Application closed %s without signalling readiness", CHECKPOINT_READY_ENV);
+        return -1;
+    }
+    
+    // criu cannot dump a pipe whose other end is outside the snapshot
+    while (wait_readable(fd, CHECKPOINT_CLOSE_MS) > 0) {
+        got = read(fd, buffer, sizeof(buffer));
+        if (got == 0 || (got < 0 && errno != EINTR)) {
+            return got == 0 ? 0 : -1;
+        }
+    }
+    log_message(LOG_WARNING, "Application kept %s open, no snapshot taken", CHECKPOINT_READY_ENV);
+    return -1;
+}
+
+/**
+ * @brief Restore the application from a snapshot and wait for it
+ * @param bundle_path Bundle the snapshot is of
+ * @param criu Path of the criu binary
+ * @param image Image directory
+ * @param waited Signal set of wait_signals, blocked by the caller
+ * @param original Signal mask to give criu
+ * @param status Receives the application's exit status
+ * @return 0 if the snapshot was restored, -1 if it failed to restore
+ */
+static int restore_application(const char *bundle_path, const char *criu, const char *image,
+                               const sigset_t *waited, const sigset_t *original, int *status) {
+    char pid_path[MAX_PATH_LENGTH];
+    char value[32];
+    ssize_t got;
+    pid_t pid;
+    int fd;
+    
+    if ((size_t)snprintf(pid_path, sizeof(pid_path), "%s/restore.%d.pid", image, (int)getpid()) >= sizeof(pid_path)) {
+        return -1;
+    }
+    char *const argv[] = {
+        (char *)criu, "restore", "--images-dir", (char *)image, "--shell-job",
+        "--restore-detached", "--restore-sibling", "--pidfile", pid_path,
+        "--log-file", "restore.log", NULL
+    };
+    
+    log_message(LOG_INFO, "Restoring application from snapshot: %s", image);
+    if (run_criu(argv, original) != 0) {
+        unlink(pid_path);
+        return -1;
+    }
+    
+    fd = open(pid_path, O_RDONLY | O_CLOEXEC);
+    got = fd >= 0 ? read(fd, value, sizeof(value) - 1) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    unlink(pid_path);
+    if (got <= 0) {
+        return -1;
+    }
+    value[got] = '\0';
+    pid = (pid_t)strtol(value, NULL, 10);
+    if (pid <= 0) {
+        return -1;
+    }
+    
+    trace_mark(TRACE_EXEC);
+    history_record(bundle_path, trace_started_ms(), EXIT_SUCCESS, trace_elapsed_ns());
+    trace_emit(EXIT_SUCCESS);
+    log_message(LOG_DEBUG, "Application restored as pid %d", (int)pid);
+    *status = wait_application(pid, waited);
+    return 0;
+}
+
+/**
+ * @brief Start the application cold, snapshot it once ready and wait for it
+ * @param probe Probe of a validated bundle
+ * @param env Environment for the application
+ * @param criu Path of the criu binary
+ * @param image Image directory to store the snapshot in
+ * @param waited Signal set of wait_signals, blocked by the caller
+ * @param original Signal mask to give the application
+ * @return Exit status of the application in the manner of a shell
+ */
+static int cold_start(const bundle_probe_t *probe, env_builder_t *env, const char *criu, const char *image,
+                      const sigset_t *waited, const sigset_t *original) {
+    char staging[MAX_PATH_LENGTH];
+    char pid_value[32];
+    int ready[2];
+    pid_t pid;
+    
+    if (pipe2(ready, O_CLOEXEC) != 0) {
+        log_message(LOG_ERROR, "Failed to create ready pipe: %s", strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_flush();
+    pid = fork();
+    if (pid < 0) {
+        log_message(LOG_ERROR, "Failed to start application: %s", strerror(errno));
+        close(ready[0]);
+        close(ready[1]);
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (pid == 0) {
+        char value[16];
+        int fd;
+        
+        // Kept clear of the range descriptors are handed to the application in
+        close(ready[0]);
+        fd = fcntl(ready[1], F_DUPFD, HANDOFF_FIRST_FD + HANDOFF_MAX_FDS);
+        snprintf(value, sizeof(value), "%d", fd);
+        if (fd < 0 || env_builder_set(env, CHECKPOINT_READY_ENV, value) != 0) {
+            _exit(EXIT_SYSTEM_ERROR);
+        }
+        sigprocmask(SIG_SETMASK, original, NULL);
+        _exit(exec_application(probe, env, NULL));
+    }
+    close(ready[1]);
+    log_message(LOG_DEBUG, "Application started as pid %d", (int)pid);
+    
+    if (wait_ready(ready[0]) == 0) {
+        snprintf(pid_value, sizeof(pid_value), "%d", (int)pid);
+        char *const argv[] = {
+            (char *)criu, "dump", "--tree", pid_value, "--images-dir", staging,
+            "--leave-running", "--shell-job", "--log-file", "dump.log", NULL
+        };
+        
+        // Images are dumped aside and renamed into place, so a restore never sees half a snapshot
+        if ((size_t)snprintf(staging, sizeof(staging), "%s.%d", image, (int)getpid()) >= sizeof(staging)) {
+            log_message(LOG_WARNING, "Snapshot path too long: %s", image);
+        } else if (mkdir(staging, 0700) != 0) {
+            log_message(LOG_WARNING, "Failed to create %s: %s", staging, strerror(errno));
+        } else if (run_criu(argv, original) != 0) {
+            log_message(LOG_WARNING, "criu failed to snapshot the application, see %s/dump.log", staging);
+        } else if (rename(staging, image) != 0) {
+            log_message(LOG_DEBUG, "Snapshot not stored: %s", strerror(errno));
+            remove_image(staging);
+        } else {
+            log_message(LOG_INFO, "Application snapshot stored: %s", image);
+        }
+    }
+    close(ready[0]);
+    
+    return wait_application(pid, waited);
+}
+
+/**
+ * @brief Launch a bundle from its snapshot, taking one first if there is none
+ * @param bundle_path Path to application bundle
+ * @return Exit status of the application, or error code on failure
+ */
+int checkpoint_application(const char *bundle_path) {
+    char criu[MAX_PATH_LENGTH];
+    char root[MAX_PATH_LENGTH];
+    char image[MAX_PATH_LENGTH];
+    char key[SHA256_HEX_SIZE];
+    bundle_probe_t probe;
+    env_builder_t env;
+    sigset_t waited;
+    sigset_t original;
+    unsigned int features;
+    int result;
+    
+    // The exit status is the application's, so failures before it starts are traced here
+    result = prepare_application(&probe, bundle_path);
+    if (result != EXIT_SUCCESS) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    result = prepare_environment(&probe, &env);
+    if (result != EXIT_SUCCESS) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    trace_mark(TRACE_LIBRARY);
+    
+    // Placement is inherited by the application and by criu's restored tree alike
+    result = configure_placement(&probe);
+    if (result != EXIT_SUCCESS) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+        env_builder_free(&env);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    trace_mark(TRACE_PLACEMENT);
+    
+    // criu cannot restore into fresh namespaces or FUSE mounts, so such bundles launch normally
+    result = sandbox_features(&probe, &features);
+    if (result != EXIT_SUCCESS) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+        env_builder_free(&env);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    if (features != 0 || lazy_resources_active(&probe)) {
+        log_message(LOG_INFO, "Sandboxed or lazily fetched bundles are not checkpointed, launching normally");
+        result = sandbox_apply(&probe);
+        if (result == EXIT_SUCCESS) {
+            result = lazy_resources_attach(&probe);
+        }
+        if (result == EXIT_SUCCESS) {
+            result = exec_application(&probe, &env, NULL);
+        }
+        env_builder_free(&env);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    
+    // Without criu or a place for images this is an ordinary launch; the
+    // image path leaves room for the staging and pid file names beside it
+    checkpoint_key(&probe, key);
+    if (find_criu(criu, sizeof(criu)) != 0 || cache_directory(CHECKPOINT_CACHE_DIR, root, sizeof(root)) != 0 ||
+        (size_t)snprintf(image, sizeof(image), "%s/%s", root, key) >= sizeof(image) - 32) {
+        log_message(LOG_INFO, "Checkpointing unavailable, launching normally");
+        result = exec_application(&probe, &env, NULL);
+        env_builder_free(&env);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    
+    sigemptyset(&waited);
+    for (size_t i = 0; i < sizeof(wait_signals) / sizeof(wait_signals[0]); i++) {
+        sigaddset(&waited, wait_signals[i]);
+    }
+    sigprocmask(SIG_BLOCK, &waited, &original);
+    
+    // Whatever criu restores is reparented to the launcher rather than to init
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+    
+    if (access(image, F_OK) == 0) {
+        char inventory[MAX_PATH_LENGTH];
+        
+        if ((size_t)snprintf(inventory, sizeof(inventory), "%s/%s", image, CHECKPOINT_INVENTORY) < sizeof(inventory) &&
+            access(inventory, F_OK) == 0 && restore_application(bundle_path, criu, image, &waited, &original, &result) == 0) {
+            goto done;
+        }
+        log_message(LOG_WARNING, "Discarding snapshot that failed to restore: %s", image);
+        remove_image(image);
+    }
+    
+    log_message(LOG_INFO, "No snapshot of this launch yet, starting cold");
+    result = cold_start(&probe, &env, criu, image, &waited, &original);
+    
+done:
+    sigprocmask(SIG_SETMASK, &original, NULL);
+    env_builder_free(&env);
+    bundle_probe_close(&probe);
+    return result;
+}
@@ -0,0 +1,63 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file checkpoint.h
+ * @brief Fast resume of bundles from CRIU snapshots
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * In checkpoint mode the first launch runs the application up to a ready
+ * marker and snapshots it with criu(8); later launches restore the
+ * snapshot instead of repeating the application's own initialisation.
+ * The application signals readiness by writing a byte to the descriptor
+ * named in CHECKPOINT_READY_ENV and closing it. Without criu the bundle
+ * is launched normally.
+ */
+
+#ifndef VLAUNCH_CHECKPOINT_H
+#define VLAUNCH_CHECKPOINT_H
+
+/* Checkpoint Configuration */
+#define CHECKPOINT_CACHE_DIR    "checkpoint"
+#define CHECKPOINT_READY_ENV    "VLAUNCH_READY_FD"
+#define CHECKPOINT_CRIU_ENV     "VLAUNCH_CRIU"
+#define CHECKPOINT_CRIU_DEFAULT "criu"
+#define CHECKPOINT_READY_MS     30000
+#define CHECKPOINT_CLOSE_MS     1000
+#define CHECKPOINT_KEY_DEPTH    8
+
+int checkpoint_application(const char *bundle_path);
+
+#endif /* VLAUNCH_CHECKPOINT_H */
@@ -0,0 +1,1089 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file daemon.c
+ * @brief Warm-start launch daemon
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The daemon validates each bundle once and keeps the result resident.
+ * Launch requests arrive as single text lines on a Unix socket:
+ *
+ *   LAUNCH <bundle_path>\n   ->   OK <pid>\n  |  ERR <exit_code>\n
+ *
+ * Each request is served by forking the already initialized daemon and
+ * exec'ing the bundle executable in the child. Resident bundles keep
+ * their probe descriptors open, so the child execs the pinned file.
+ *
+ * Bundles that name a toolkit stack are passed on to a host forked for
+ * that stack, see toolkit.h. A host is the same request loop, fed RUN
+ * requests over a socket pair, except that its children load the
+ * executable instead of exec'ing it. A bundle the host cannot start is
+ * exec'd by the daemon as usual.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "daemon.h"
+#include "trace.h"
+#include "history.h"
+#include "placement.h"
+#include "pack.h"
+#include "environment.h"
+#include "handoff.h"
+#include "toolkit.h"
+#include "integrity.h"
+#include "stats.h"
+#include "sandbox.h"
+#include "lazy.h"
+
+/* Descriptors a RUN request may carry: the standard streams and the handoff */
+#define REQUEST_MAX_FDS     (HANDOFF_MAX_FDS + 3)
+
+/* Validated bundle state kept between requests */
+typedef struct {
+    bundle_probe_t probe;
+    env_builder_t env;
+    const toolkit_stack_t *toolkit;
+    sandbox_trees_t sandbox;
+    unsigned int sandbox_features;
+    unsigned long last_used;
+    int in_use;
+} resident_bundle_t;
+
+/* A launched application, remembered until it is reaped for its usage report */
+typedef struct {
+    pid_t pid;
+    struct timespec started;
+    char path[MAX_PATH_LENGTH];
+} launched_child_t;
+
+/* A toolkit host and the daemon's end of its request socket */
+typedef struct {
+    const toolkit_stack_t *stack;
+    pid_t pid;
+    int fd;
+} toolkit_host_t;
+
+static resident_bundle_t resident_bundles[DAEMON_MAX_BUNDLES];
+static unsigned long resident_clock;
+static toolkit_host_t toolkit_hosts[TOOLKIT_MAX_HOSTS];
+static launched_child_t launched_children[DAEMON_MAX_CHILDREN];
+static volatile sig_atomic_t daemon_running = 1;
+static int listen_socket = -1;
+
+// Set in a toolkit host to its stack and its end of the request socket
+static const toolkit_stack_t *host_stack;
+static int host_socket = -1;
+
+static int handle_client(int client_fd);
+static void reap_children(void);
+static int send_request(int fd, const char *bundle_path, const launch_handoff_t *handoff, const int *stdio);
+static ssize_t read_request_line(int fd, char *buffer, size_t size);
+
+/**
+ * @brief Request daemon shutdown from a signal handler
+ * @param sig Signal number (unused)
+ */
+static void handle_shutdown_signal(int sig) {
+    (void)sig;
+    daemon_running = 0;
+}
+
+/**
+ * @brief Wake the main loop when an application exits, so its usage is timed
+ * @param sig Signal number
+ */
+static void handle_child_signal(int sig) {
+    (void)sig;
+}
+
+/**
+ * @brief Check whether two stat results describe the same unchanged file
+ * @param st Current stat result
+ * @param stx Stat result recorded by the probe
+ * @return 1 if identical, 0 otherwise
+ */
+static int stat_matches(const struct stat *st, const struct statx *stx) {
+    return major(st->st_dev) == stx->stx_dev_major &&
+           minor(st->st_dev) == stx->stx_dev_minor &&
+           st->st_ino == stx->stx_ino &&
+           st->st_mode == stx->stx_mode &&
+           (unsigned long long)st->st_size == stx->stx_size &&
+           st->st_mtim.tv_sec == stx->stx_mtime.tv_sec &&
+           st->st_mtim.tv_nsec == (long)stx->stx_mtime.tv_nsec &&
+           st->st_ctim.tv_sec == stx->stx_ctime.tv_sec &&
+           st->st_ctim.tv_nsec == (long)stx->stx_ctime.tv_nsec;
+}
+
+/**
+ * @brief Check whether resident state still describes the bundle on disk
+ * @param bundle Resident bundle entry
+ * @return 1 if the bundle directory and executable are unchanged, 0 otherwise
+ */
+static int resident_bundle_current(const resident_bundle_t *bundle) {
+    const bundle_probe_t *probe = &bundle->probe;
+    struct stat st;
+    
+    // The unpacked tree of an image never changes; a new image is a new tree
+    if (probe->image_path[0] != '\0') {
+        return pack_image_current(probe);
+    }
+    
+    // The path must still name the pinned directory (bundles may be swapped atomically)
+    if (stat(probe->path, &st) != 0 ||
+        major(st.st_dev) != probe->components[COMPONENT_ROOT].stx_dev_major ||
+        minor(st.st_dev) != probe->components[COMPONENT_ROOT].stx_dev_minor ||
+        st.st_ino != probe->components[COMPONENT_ROOT].stx_ino) {
+        return 0;
+    }
+    
+    // A changed info.yaml may move the entry point or change the environment
+    if (fstatat(probe->dirfd, bundle_component_paths[COMPONENT_METADATA], &st, 0) == 0
+            ? !probe->present[COMPONENT_METADATA] || !stat_matches(&st, &probe->components[COMPONENT_METADATA])
+            : probe->present[COMPONENT_METADATA]) {
+        return 0;
+    }
+    
+    if (fstatat(probe->dirfd, probe->exec_path, &st, 0) != 0) {
+        return 0;
+    }
+    
+    if (!stat_matches(&st, &probe->components[COMPONENT_EXEC])) {
+        return 0;
+    }
+    
+    // Libraries are opened by path on every launch, so their digests are rechecked
+    return integrity_verify(probe) == EXIT_SUCCESS;
+}
+
+/**
+ * @brief Find or create validated resident state for a bundle
+ * @param bundle_path Path to application bundle
+ * @param result Receives EXIT_SUCCESS or the validation error code
+ * @return Resident bundle entry, or NULL if validation failed
+ */
+static resident_bundle_t *acquire_resident_bundle(const char *bundle_path, int *result) {
+    resident_bundle_t *slot = NULL;
+    sandbox_trees_t sandbox = { .count = 0 };
+    unsigned int features;
+    bundle_probe_t probe;
+    env_builder_t env;
+    
+    for (int i = 0; i < DAEMON_MAX_BUNDLES; i++) {
+        resident_bundle_t *entry = &resident_bundles[i];
+        const char *source = entry->probe.image_path[0] ? entry->probe.image_path : entry->probe.path;
+        if (entry->in_use && strcmp(source, bundle_path) == 0) {
+            if (resident_bundle_current(entry)) {
+                entry->last_used = ++resident_clock;
+                *result = EXIT_SUCCESS;
+                return entry;
+            }
+            log_message(LOG_INFO, "Bundle changed on disk, revalidating: %s", bundle_path);
+            bundle_probe_close(&entry->probe);
+            env_builder_free(&entry->env);
+            sandbox_release(&entry->sandbox);
+            entry->in_use = 0;
+            slot = entry;
+            break;
+        }
+    }
+    
+    bundle_probe_open(&probe, bundle_path);
+    trace_mark(TRACE_PROBE);
+    *result = validate_bundle(&probe);
+    if (*result != EXIT_SUCCESS) {
+        bundle_probe_close(&probe);
+        return NULL;
+    }
+    trace_mark(TRACE_VALIDATE);
+    inspect_optional_components(&probe);
+    trace_mark(TRACE_INSPECT);
+    
+    // Built once here and inherited by every child; nothing in it is per launch
+    *result = prepare_environment(&probe, &env);
+    if (*result != EXIT_SUCCESS) {
+        bundle_probe_close(&probe);
+        return NULL;
+    }
+    trace_mark(TRACE_LIBRARY);
+    
+    // The read-only trees are cloned once here and copied for every launch
+    *result = sandbox_features(&probe, &features);
+    if (*result == EXIT_SUCCESS && features != 0) {
+        *result = sandbox_prepare(&probe, &sandbox);
+    }
+    if (*result != EXIT_SUCCESS) {
+        env_builder_free(&env);
+        bundle_probe_close(&probe);
+        return NULL;
+    }
+    
+    // Reuse a free slot, otherwise evict the least recently used bundle
+    for (int i = 0; !slot && i < DAEMON_MAX_BUNDLES; i++) {
+        if (!resident_bundles[i].in_use) {
+            slot = &resident_bundles[i];
+        }
+    }
+    if (!slot) {
+        slot = &resident_bundles[0];
+        for (int i = 1; i < DAEMON_MAX_BUNDLES; i++) {
+            if (resident_bundles[i].last_used < slot->last_used) {
+                slot = &resident_bundles[i];
+            }
+        }
+        log_message(LOG_DEBUG, "Evicting resident bundle: %s", slot->probe.path);
+        bundle_probe_close(&slot->probe);
+        env_builder_free(&slot->env);
+        sandbox_release(&slot->sandbox);
+    }
+    
+    slot->probe = probe;
+    env_builder_move(&slot->env, &env);
+    slot->sandbox = sandbox;
+    slot->sandbox_features = features;
+    
+    // A toolkit host is already running outside any sandbox
+    slot->toolkit = features != 0 ? NULL : toolkit_for_bundle(&probe);
+    slot->in_use = 1;
+    slot->last_used = ++resident_clock;
+    return slot;
+}
+
+/**
+ * @brief Remember a launched application so its usage can be reported
+ * @param pid Application pid
+ * @param bundle_path Bundle it was launched from
+ */
+static void track_child(pid_t pid, const char *bundle_path) {
+    for (int i = 0; i < DAEMON_MAX_CHILDREN; i++) {
+        if (launched_children[i].pid == 0) {
+            launched_children[i].pid = pid;
+            clock_gettime(CLOCK_MONOTONIC, &launched_children[i].started);
+            snprintf(launched_children[i].path, sizeof(launched_children[i].path), "%s", bundle_path);
+            return;
+        }
+    }
+    log_message(LOG_DEBUG, "Not accounting pid %ld: too many running applications", (long)pid);
+}
+
+/**
+ * @brief Fork a child and exec the bundle in it
+ * @param bundle Validated resident bundle
+ * @param handoff Arguments and descriptors from the client
+ * @param pid_out Receives the child pid on success
+ * @return EXIT_SUCCESS once the child has exec'd, error code otherwise
+ */
+static int spawn_resident_bundle(resident_bundle_t *bundle, const launch_handoff_t *handoff, pid_t *pid_out) {
+    unsigned int features = bundle->sandbox_features;
+    sandbox_trees_t trees = { .count = 0 };
+    int status_pipe[2];
+    int child_result;
+    ssize_t n;
+    pid_t pid;
+    
+    if (features != 0 && sandbox_copy(&bundle->sandbox, &trees) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // The pipe is close-on-exec, so EOF without data means exec succeeded
+    if (pipe2(status_pipe, O_CLOEXEC) != 0) {
+        log_message(LOG_ERROR, "Failed to create status pipe: %s", strerror(errno));
+        sandbox_release(&trees);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_flush();
+    fflush(NULL);
+    pid = features != 0 ? sandbox_clone(features) : fork();
+    if (pid < 0) {
+        log_message(LOG_ERROR, "Failed to fork: %s", strerror(errno));
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        sandbox_release(&trees);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (pid == 0) {
+        sigset_t empty;
+        int status_fd;
+        
+        trace_mark(TRACE_FORK);
+        close(status_pipe[0]);
+        
+        // Handed descriptors must not land on the status pipe
+        status_fd = fcntl(status_pipe[1], F_DUPFD_CLOEXEC, HANDOFF_FIRST_FD + HANDOFF_MAX_FDS);
+        if (status_fd >= 0) {
+            close(status_pipe[1]);
+            status_pipe[1] = status_fd;
+        }
+        signal(SIGPIPE, SIG_DFL);
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, NULL);
+        if (host_socket >= 0) {
+            close(host_socket);
+        }
+        
+        // The child changes its own copy of the resident environment
+        child_result = features != 0 ? sandbox_enter(&bundle->probe, &trees, features) : EXIT_SUCCESS;
+        if (child_result == EXIT_SUCCESS) {
+            child_result = configure_placement(&bundle->probe);
+        }
+        if (child_result == EXIT_SUCCESS) {
+            trace_mark(TRACE_PLACEMENT);
+            child_result = lazy_resources_attach(&bundle->probe);
+        }
+        if (child_result == EXIT_SUCCESS) {
+            child_result = host_stack ? toolkit_enter(&bundle->probe, &bundle->env, handoff)
+                                      : exec_application(&bundle->probe, &bundle->env, handoff);
+        }
+        if (write(status_pipe[1], &child_result, sizeof(child_result)) < 0) {
+            // Nothing more we can report
+        }
+        _exit(child_result);
+    }
+    
+    close(status_pipe[1]);
+    sandbox_release(&trees);
+    do {
+        n = read(status_pipe[0], &child_result, sizeof(child_result));
+    } while (n < 0 && errno == EINTR);
+    close(status_pipe[0]);
+    
+    if (n == (ssize_t)sizeof(child_result)) {
+        waitpid(pid, NULL, 0);
+        return child_result;
+    }
+    
+    *pid_out = pid;
+    track_child(pid, bundle->probe.path);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Read a single newline-terminated request from a client
+ * @param fd Client socket
+ * @param buffer Destination buffer
+ * @param size Size of destination buffer
+ * @return Length of the line without newline, or -1 on error
+ */
+static ssize_t read_request_line(int fd, char *buffer, size_t size) {
+    size_t used = 0;
+    
+    while (used + 1 < size) {
+        ssize_t n = read(fd, buffer + used, size - used - 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        
+        char *newline = memchr(buffer + used, '\n', (size_t)n);
+        used += (size_t)n;
+        if (newline) {
+            *newline = '\0';
+            return newline - buffer;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * @brief Parse a request once it is complete
+ * @param buffer Bytes received so far, NUL-terminated after them
+ * @param used Number of bytes received
+ * @param fds Descriptors received with the bytes
+ * @param fd_count Number of descriptors
+ * @param handoff Receives the arguments and descriptors of a RUN request
+ * @param args Storage for the argument pointers
+ * @param bundle_path Receives the bundle path
+ * @return 1 if complete, 0 if more bytes are needed, -1 if malformed
+ */
+static int parse_request(char *buffer, size_t used, const int *fds, unsigned int fd_count,
+                         launch_handoff_t *handoff, char **args, const char **bundle_path) {
+    char *newline = memchr(buffer, '\n', used);
+    char *end = buffer + used;
+    char *cursor;
+    unsigned int arg_count;
+    unsigned int named;
+    unsigned int stdio;
+    
+    if (newline == NULL) {
+        return 0;
+    }
+    handoff_init(handoff);
+    
+    if (strncmp(buffer, "LAUNCH ", 7) == 0) {
+        *newline = '\0';
+        *bundle_path = buffer + 7;
+        return buffer[7] == '/' && fd_count == 0 && newline + 1 == end ? 1 : -1;
+    }
+    if (sscanf(buffer, "RUN %u %u %u", &arg_count, &named, &stdio) != 3 ||
+        arg_count > HANDOFF_MAX_ARGS || named > HANDOFF_MAX_FDS || stdio > 1) {
+        return -1;
+    }
+    
+    // Path, arguments and descriptor names follow as NUL-terminated strings
+    cursor = newline + 1;
+    for (unsigned int i = 0; i < 1 + arg_count + named; i++) {
+        char *terminator = memchr(cursor, '\0', (size_t)(end - cursor));
+        if (terminator == NULL) {
+            return 0;
+        }
+        if (i == 0) {
+            *bundle_path = cursor;
+        } else if (i <= arg_count) {
+            args[i - 1] = cursor;
+        } else if (handoff_add_fd(handoff, fds[(stdio ? 3 : 0) + i - 1 - arg_count], cursor, strlen(cursor)) != EXIT_SUCCESS) {
+            return -1;
+        }
+        cursor = terminator + 1;
+    }
+    
+    // Descriptors arrive with the first bytes of the request; relative paths would name the daemon's files
+    if (cursor != end || **bundle_path != '/' || fd_count != named + (stdio ? 3 : 0)) {
+        return -1;
+    }
+    handoff->args = args;
+    handoff->arg_count = arg_count;
+    for (unsigned int i = 0; stdio && i < 3; i++) {
+        handoff->stdio[i] = fds[i];
+    }
+    return 1;
+}
+
+/**
+ * @brief Receive a request and the descriptors that come with it
+ * @param fd Client socket
+ * @param buffer Destination buffer
+ * @param size Size of destination buffer
+ * @param handoff Receives the arguments and descriptors; the caller closes them
+ * @param args Storage for the argument pointers
+ * @param bundle_path Receives the bundle path
+ * @return 0 on success, -1 on a malformed or incomplete request
+ */
+static int receive_request(int fd, char *buffer, size_t size, launch_handoff_t *handoff, char **args,
+                           const char **bundle_path) {
+    union {
+        struct cmsghdr header;
+        char data[CMSG_SPACE(sizeof(int) * REQUEST_MAX_FDS)];
+    } control;
+    int fds[REQUEST_MAX_FDS];
+    unsigned int fd_count = 0;
+    size_t used = 0;
+    int status = 0;
+    
+    while (status == 0 && used + 1 < size) {
+        struct iovec iov = { buffer + used, size - used - 1 };
+        struct msghdr message;
+        ssize_t n;
+        
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data;
+        message.msg_controllen = sizeof(control.data);
+        
+        // Received descriptors stay out of children until a handoff puts them in place
+        n = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            const unsigned char *data = CMSG_DATA(cmsg);
+            size_t count;
+            
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++) {
+                int received;
+                memcpy(&received, data + i * sizeof(int), sizeof(int));
+                if (fd_count < REQUEST_MAX_FDS) {
+                    fds[fd_count++] = received;
+                } else {
+                    close(received);
+                    status = -1;
+                }
+            }
+        }
+        if (message.msg_flags & MSG_CTRUNC) {
+            status = -1;
+        }
+        
+        used += (size_t)n;
+        buffer[used] = '\0';
+        if (status == 0) {
+            status = parse_request(buffer, used, fds, fd_count, handoff, args, bundle_path);
+        }
+    }
+    
+    if (status != 1) {
+        for (unsigned int i = 0; i < fd_count; i++) {
+            close(fds[i]);
+        }
+        handoff_init(handoff);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Stop a toolkit host; it exits once its request socket closes
+ * @param host Running host
+ */
+static void stop_toolkit_host(toolkit_host_t *host) {
+    close(host->fd);
+    host->stack = NULL;
+    host->pid = 0;
+    host->fd = -1;
+}
+
+/**
+ * @brief Find the running host of a toolkit stack, starting it if there is none
+ * @param stack Toolkit stack
+ * @param client_fd Client socket being served, which the host must not keep
+ * @param handoff Descriptors of the request being served, which the host must not keep
+ * @return Running host, or NULL if none could be started
+ */
+static toolkit_host_t *acquire_toolkit_host(const toolkit_stack_t *stack, int client_fd,
+                                            const launch_handoff_t *handoff) {
+    toolkit_host_t *slot = NULL;
+    int sockets[2];
+    pid_t pid;
+    
+    for (int i = 0; i < TOOLKIT_MAX_HOSTS; i++) {
+        if (toolkit_hosts[i].stack == stack) {
+            return &toolkit_hosts[i];
+        }
+        if (!slot && toolkit_hosts[i].stack == NULL) {
+            slot = &toolkit_hosts[i];
+        }
+    }
+    if (!slot || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        return NULL;
+    }
+    
+    log_flush();
+    fflush(NULL);
+    pid = fork();
+    if (pid < 0) {
+        log_message(LOG_WARNING, "Failed to start %s host: %s", stack->name, strerror(errno));
+        close(sockets[0]);
+        close(sockets[1]);
+        return NULL;
+    }
+    
+    if (pid == 0) {
+        launch_handoff_t pending = *handoff;
+        int result;
+        
+        // Requests reach the host from the daemon only, with their own descriptors
+        close(sockets[0]);
+        close(client_fd);
+        close(listen_socket);
+        handoff_close(&pending);
+        memset(launched_children, 0, sizeof(launched_children));
+        for (int i = 0; i < TOOLKIT_MAX_HOSTS; i++) {
+            if (toolkit_hosts[i].stack) {
+                close(toolkit_hosts[i].fd);
+                toolkit_hosts[i].stack = NULL;
+            }
+        }
+        host_stack = stack;
+        host_socket = sockets[1];
+        
+        result = toolkit_preinit(stack);
+        while (result == EXIT_SUCCESS && daemon_running) {
+            struct pollfd pfd = { host_socket, POLLIN, 0 };
+            
+            log_flush();
+            int ready = poll(&pfd, 1, DAEMON_POLL_MS);
+            
+            // The daemon closing its end is the host's shutdown request
+            reap_children();
+            if (ready > 0 && ((pfd.revents & POLLHUP) || handle_client(host_socket) != 0)) {
+                break;
+            }
+        }
+        log_flush();
+        _exit(result);
+    }
+    
+    close(sockets[1]);
+    slot->stack = stack;
+    slot->pid = pid;
+    slot->fd = sockets[0];
+    log_message(LOG_INFO, "Started %s host as pid %ld", stack->name, (long)pid);
+    return slot;
+}
+
+/**
+ * @brief Have the toolkit host of a bundle start it
+ * @param bundle Validated resident bundle naming a toolkit stack
+ * @param bundle_path Path the client asked for
+ * @param handoff Arguments and descriptors from the client
+ * @param client_fd Client socket being served
+ * @param pid_out Receives the application pid on success
+ * @return EXIT_SUCCESS if the host started the bundle, error code otherwise
+ */
+static int spawn_hosted_bundle(resident_bundle_t *bundle, const char *bundle_path, const launch_handoff_t *handoff,
+                               int client_fd, pid_t *pid_out) {
+    struct timeval timeout = { DAEMON_IO_TIMEOUT, 0 };
+    toolkit_host_t *host = acquire_toolkit_host(bundle->toolkit, client_fd, handoff);
+    char reply[64];
+    long value;
+    
+    if (host == NULL) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    setsockopt(host->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    // A host that stops answering is replaced on the next request for its stack
+    if (send_request(host->fd, bundle_path, handoff, handoff->stdio[0] >= 0 ? handoff->stdio : NULL) != EXIT_SUCCESS ||
+        read_request_line(host->fd, reply, sizeof(reply)) < 0) {
+        log_message(LOG_WARNING, "%s host is not responding, stopping it", host->stack->name);
+        kill(host->pid, SIGTERM);
+        stop_toolkit_host(host);
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (sscanf(reply, "OK %ld", &value) == 1) {
+        *pid_out = (pid_t)value;
+        return EXIT_SUCCESS;
+    }
+    return sscanf(reply, "ERR %ld", &value) == 1 ? (int)value : EXIT_SYSTEM_ERROR;
+}
+
+/**
+ * @brief Check that a client runs as the daemon's user or as root
+ * @param client_fd Client socket
+ * @return Non-zero if the client may request launches
+ */
+static int peer_allowed(int client_fd) {
+    struct ucred cred;
+    socklen_t length = sizeof(cred);
+    
+    if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) != 0 || length != sizeof(cred)) {
+        log_message(LOG_WARNING, "Cannot read client credentials: %s", strerror(errno));
+        return 0;
+    }
+    if (cred.uid != getuid() && cred.uid != 0) {
+        log_message(LOG_WARNING, "Refused launch request from uid %lu (pid %ld)", (unsigned long)cred.uid,
+                    (long)cred.pid);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Serve one client connection
+ * @param client_fd Accepted client socket
+ * @return 0 once a request was answered, -1 if none could be read
+ */
+static int handle_client(int client_fd) {
+    static char request[DAEMON_REQUEST_SIZE];
+    static char *args[HANDOFF_MAX_ARGS];
+    static launch_handoff_t handoff;
+    char reply[64];
+    struct timeval timeout = { DAEMON_IO_TIMEOUT, 0 };
+    resident_bundle_t *bundle;
+    const char *bundle_path = NULL;
+    pid_t pid = 0;
+    int received = 0;
+    int result;
+    
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    
+    if (!peer_allowed(client_fd)) {
+        handoff_init(&handoff);
+        result = EXIT_INVALID_ARGS;
+        received = -1;
+    } else if (receive_request(client_fd, request, sizeof(request), &handoff, args, &bundle_path) != 0 ||
+        strlen(bundle_path) >= MAX_PATH_LENGTH) {
+        log_message(LOG_WARNING, "Malformed launch request ignored");
+        result = EXIT_INVALID_ARGS;
+        received = -1;
+    } else {
+        log_message(LOG_INFO, "Launch request: %s", bundle_path);
+        trace_reset(bundle_path);
+        
+        bundle = acquire_resident_bundle(bundle_path, &result);
+        if (bundle && bundle->toolkit && !host_stack) {
+            result = spawn_hosted_bundle(bundle, bundle_path, &handoff, client_fd, &pid);
+            if (result != EXIT_SUCCESS) {
+                log_message(LOG_INFO, "Toolkit host did not start %s, exec'ing it", bundle_path);
+                trace_reset(bundle_path);
+            }
+        }
+        if (bundle && (!bundle->toolkit || host_stack || result != EXIT_SUCCESS)) {
+            result = spawn_resident_bundle(bundle, &handoff, &pid);
+        } else if (!bundle) {
+            history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+            trace_emit(result);
+        }
+    }
+    handoff_close(&handoff);
+    
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Launched %s as pid %ld", bundle_path, (long)pid);
+        snprintf(reply, sizeof(reply), "OK %ld\n", (long)pid);
+    } else {
+        snprintf(reply, sizeof(reply), "ERR %d\n", result);
+    }
+    
+    if (write(client_fd, reply, strlen(reply)) < 0) {
+        log_message(LOG_WARNING, "Failed to send reply: %s", strerror(errno));
+    }
+    return received;
+}
+
+/**
+ * @brief Collect exit status of finished children
+ */
+static void reap_children(void) {
+    stats_usage_t usage;
+    siginfo_t info;
+    int status;
+    pid_t pid;
+    
+    // Peek first: the I/O counters of a child are only readable until it is reaped
+    for (;;) {
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid == 0) {
+            break;
+        }
+        pid = info.si_pid;
+        if (stats_reap(pid, &status, &usage) != 0) {
+            break;
+        }
+        
+        for (int i = 0; i < DAEMON_MAX_CHILDREN; i++) {
+            if (launched_children[i].pid == pid) {
+                struct timespec now;
+                
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                usage.wall_ms = (uint64_t)((now.tv_sec - launched_children[i].started.tv_sec) * 1000L +
+                                           (now.tv_nsec - launched_children[i].started.tv_nsec) / 1000000L);
+                stats_report(launched_children[i].path, pid, status, &usage);
+                launched_children[i].pid = 0;
+            }
+        }
+        for (int i = 0; i < TOOLKIT_MAX_HOSTS; i++) {
+            if (toolkit_hosts[i].stack && toolkit_hosts[i].pid == pid) {
+                log_message(LOG_WARNING, "%s host exited", toolkit_hosts[i].stack->name);
+                stop_toolkit_host(&toolkit_hosts[i]);
+            }
+        }
+        if (WIFEXITED(status)) {
+            log_message(LOG_DEBUG, "Child %ld exited with status %d", (long)pid, WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            log_message(LOG_DEBUG, "Child %ld killed by signal %d", (long)pid, WTERMSIG(status));
+        }
+    }
+}
+
+/**
+ * @brief Run the warm-start launch daemon until terminated
+ * @param socket_path Filesystem path of the listening Unix socket
+ * @return EXIT_SUCCESS on clean shutdown, error code on failure
+ */
+int run_daemon(const char *socket_path) {
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    mode_t mask;
+    int listen_fd;
+    
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        log_message(LOG_ERROR, "Socket path too long (max %zu characters)", sizeof(addr.sun_path) - 1);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_shutdown_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    
+    // poll() returns early on the signal; everything else is restarted
+    sa.sa_handler = handle_child_signal;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        log_message(LOG_ERROR, "Failed to create socket: %s", strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    listen_socket = listen_fd;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    unlink(socket_path);
+    
+    // The socket never exists with a wider mode than it ends up with
+    mask = umask(0777 & ~DAEMON_SOCKET_MODE);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        umask(mask);
+        log_message(LOG_ERROR, "Failed to bind %s: %s", socket_path, strerror(errno));
+        close(listen_fd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    umask(mask);
+    if (chmod(socket_path, DAEMON_SOCKET_MODE) != 0 || listen(listen_fd, DAEMON_BACKLOG) != 0) {
+        log_message(LOG_ERROR, "Failed to listen on %s: %s", socket_path, strerror(errno));
+        close(listen_fd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_message(LOG_INFO, "Launch daemon listening on %s", socket_path);
+    
+    while (daemon_running) {
+        struct pollfd pfd = { listen_fd, POLLIN, 0 };
+        
+        // Nothing is logged while idle, so emit what the last request produced
+        log_flush();
+        int ready = poll(&pfd, 1, DAEMON_POLL_MS);
+        
+        reap_children();
+        if (ready <= 0) {
+            continue;
+        }
+        
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno != EINTR && errno != EAGAIN) {
+                log_message(LOG_WARNING, "Failed to accept connection: %s", strerror(errno));
+            }
+            continue;
+        }
+        
+        handle_client(client_fd);
+        close(client_fd);
+    }
+    
+    log_message(LOG_INFO, "Launch daemon shutting down");
+    for (int i = 0; i < TOOLKIT_MAX_HOSTS; i++) {
+        if (toolkit_hosts[i].stack) {
+            stop_toolkit_host(&toolkit_hosts[i]);
+        }
+    }
+    close(listen_fd);
+    unlink(socket_path);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Send a RUN request with standard streams and handed descriptors
+ * @param fd Connected daemon or toolkit host socket
+ * @param bundle_path Path to application bundle
+ * @param handoff Arguments and descriptors for the application, or NULL
+ * @param stdio Standard streams for the application, or NULL to leave them
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+static int send_request(int fd, const char *bundle_path, const launch_handoff_t *handoff, const int *stdio) {
+    static char request[DAEMON_REQUEST_SIZE];
+    union {
+        struct cmsghdr header;
+        char data[CMSG_SPACE(sizeof(int) * REQUEST_MAX_FDS)];
+    } control;
+    int fds[REQUEST_MAX_FDS];
+    unsigned int fd_count = 0;
+    unsigned int arg_count = handoff ? handoff->arg_count : 0;
+    unsigned int named = handoff ? handoff->fd_count : 0;
+    size_t used;
+    size_t sent = 0;
+    
+    for (int i = 0; stdio && i < 3; i++) {
+        fds[fd_count++] = stdio[i];
+    }
+    for (unsigned int i = 0; i < named; i++) {
+        fds[fd_count++] = handoff->fds[i];
+    }
+    
+    used = (size_t)snprintf(request, sizeof(request), "RUN %u %u %d\n", arg_count, named, stdio != NULL);
+    for (unsigned int i = 0; i < 1 + arg_count + named; i++) {
+        const char *value = i == 0 ? bundle_path : i <= arg_count ? handoff->args[i - 1] : handoff->names[i - 1 - arg_count];
+        size_t length = strlen(value) + 1;
+        
+        if (used + length > sizeof(request)) {
+            log_message(LOG_ERROR, "Launch request too long (max %d bytes)", DAEMON_REQUEST_SIZE);
+            return EXIT_INVALID_ARGS;
+        }
+        memcpy(request + used, value, length);
+        used += length;
+    }
+    
+    while (sent < used) {
+        struct iovec iov = { request + sent, used - sent };
+        struct msghdr message;
+        ssize_t n;
+        
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        
+        // Descriptors go with the first bytes only
+        if (sent == 0 && fd_count > 0) {
+            struct cmsghdr *cmsg;
+            
+            memset(&control, 0, sizeof(control));
+            message.msg_control = control.data;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+            cmsg = CMSG_FIRSTHDR(&message);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+            memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+        }
+        
+        n = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            log_message(LOG_ERROR, "Failed to send launch request: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        sent += (size_t)n;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Ask a running launch daemon to start a bundle
+ * @param socket_path Filesystem path of the daemon socket
+ * @param bundle_path Path to application bundle
+ * @param handoff Arguments and descriptors for the application, or NULL
+ * @return EXIT_SUCCESS if the daemon launched the bundle, error code otherwise
+ */
+int daemon_request_launch(const char *socket_path, const char *bundle_path, const launch_handoff_t *handoff) {
+    static const int standard_streams[3] = { 0, 1, 2 };
+    const int *streams = standard_streams;
+    struct sockaddr_un addr;
+    char resolved[PATH_MAX];
+    char reply[64];
+    ssize_t n;
+    long value;
+    int result;
+    int fd;
+    
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        log_message(LOG_ERROR, "Socket path too long (max %zu characters)", sizeof(addr.sun_path) - 1);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    // The daemon has its own working directory, so it is sent the bundle's absolute path
+    if (realpath(bundle_path, resolved) == NULL) {
+        log_message(LOG_ERROR, "Cannot resolve bundle path %s: %s", bundle_path, strerror(errno));
+        return EXIT_BUNDLE_ERROR;
+    }
+    if (strlen(resolved) >= MAX_PATH_LENGTH) {
+        log_message(LOG_ERROR, "Bundle path too long (max %d characters)", MAX_PATH_LENGTH - 1);
+        return EXIT_INVALID_ARGS;
+    }
+    bundle_path = resolved;
+    
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Failed to create socket: %s", strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        log_message(LOG_ERROR, "Failed to connect to launch daemon %s: %s", socket_path, strerror(errno));
+        close(fd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // The application writes straight to the client's streams when all three are open
+    for (int i = 0; i < 3; i++) {
+        if (fcntl(i, F_GETFD) < 0) {
+            streams = NULL;
+        }
+    }
+    result = send_request(fd, bundle_path, handoff, streams);
+    if (result != EXIT_SUCCESS) {
+        close(fd);
+        return result;
+    }
+    
+    n = read_request_line(fd, reply, sizeof(reply));
+    close(fd);
+    
+    if (n > 3 && sscanf(reply, "OK %ld", &value) == 1) {
+        log_message(LOG_INFO, "Launch daemon started %s as pid %ld", bundle_path, value);
+        return EXIT_SUCCESS;
+    }
+    if (n > 4 && sscanf(reply, "ERR %ld", &value) == 1) {
+        log_message(LOG_ERROR, "Launch daemon failed to start %s (exit code %ld)", bundle_path, value);
+        return (int)value;
+    }
+    
+    log_message(LOG_ERROR, "Invalid reply from launch daemon");
+    return EXIT_SYSTEM_ERROR;
+}
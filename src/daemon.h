@@ -0,0 +1,75 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file daemon.h
+ * @brief Warm-start launch daemon
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Keeps validated bundle state resident and launches bundles on request
+ * received over a Unix domain socket, so that each launch costs a fork
+ * plus an exec instead of a full launcher cold start.
+ *
+ * A request is either "LAUNCH <path>\n", or "RUN <argc> <fds> <stdio>\n"
+ * followed by the path, the arguments and the descriptor names as
+ * NUL-terminated strings. The descriptors of a RUN request travel with it
+ * as SCM_RIGHTS, the client's standard streams first if <stdio> is 1.
+ * The reply is "OK <pid>\n" or "ERR <exit code>\n".
+ *
+ * Bundle paths in requests are absolute, since the daemon does not share
+ * the client's working directory. The socket is only accessible to the
+ * daemon's user, and peers with other credentials are refused except root.
+ *
+ * Bundles naming a toolkit stack in info.yaml are started from a host
+ * that has the stack loaded already, see toolkit.h.
+ */
+
+#ifndef VLAUNCH_DAEMON_H
+#define VLAUNCH_DAEMON_H
+
+#include "launcher.h"
+
+/* Daemon Configuration */
+#define DAEMON_MAX_BUNDLES  64
+#define DAEMON_MAX_CHILDREN 128
+#define DAEMON_BACKLOG      16
+#define DAEMON_POLL_MS      1000
+#define DAEMON_IO_TIMEOUT   5
+#define DAEMON_REQUEST_SIZE (64 * 1024)
+#define DAEMON_SOCKET_MODE  0600
+
+int run_daemon(const char *socket_path);
+int daemon_request_launch(const char *socket_path, const char *bundle_path, const launch_handoff_t *handoff);
+
+#endif /* VLAUNCH_DAEMON_H */
@@ -0,0 +1,199 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file elfinfo.c
+ * @brief Minimal ELF dynamic section reader
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The object is mapped read-only, PT_DYNAMIC is located through the
+ * program headers and the dynamic string table address is translated to
+ * a file offset through the PT_LOAD segments. Only objects matching the
+ * host byte order are understood; anything else is reported as not ELF.
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "elfinfo.h"
+
+/**
+ * @brief Generate a parser for one ELF class
+ * @param BITS 32 or 64
+ *
+ * Both classes share the same logic and only differ in the structure
+ * types, so the parser is stamped out once per class.
+ */
+#define DEFINE_ELF_PARSER(BITS) \
+static int parse_elf##BITS(elf_info_t *info) { \
+    const unsigned char *base = info->map; \
+    const Elf##BITS##_Ehdr *ehdr = info->map; \
+    const Elf##BITS##_Phdr *phdr; \
+    const Elf##BITS##_Dyn *dyn = NULL; \
+    size_t dyn_count = 0; \
+    uint64_t strtab_addr = 0, strtab_size = 0, strtab_offset = 0; \
+    uint64_t soname = (uint64_t)-1; \
+    int found_strtab = 0; \
+    \
+    if (sizeof(*ehdr) > info->size || ehdr->e_phentsize != sizeof(*phdr) || \
+        ehdr->e_phoff > info->size || \
+        (uint64_t)ehdr->e_phnum * sizeof(*phdr) > info->size - ehdr->e_phoff) { \
+        return -1; \
+    } \
+    phdr = (const Elf##BITS##_Phdr *)(base + ehdr->e_phoff); \
+    info->is_shared_object = ehdr->e_type == ET_DYN; \
+    \
+    for (int i = 0; i < ehdr->e_phnum; i++) { \
+        if (phdr[i].p_type == PT_DYNAMIC && phdr[i].p_offset < info->size && \
+            phdr[i].p_filesz <= info->size - phdr[i].p_offset) { \
+            dyn = (const Elf##BITS##_Dyn *)(base + phdr[i].p_offset); \
+            dyn_count = phdr[i].p_filesz / sizeof(*dyn); \
+        } \
+    } \
+    if (!dyn) { \
+        return 0; /* statically linked */ \
+    } \
+    \
+    for (size_t i = 0; i < dyn_count && dyn[i].d_tag != DT_NULL; i++) { \
+        if (dyn[i].d_tag == DT_STRTAB) { \
+            strtab_addr = dyn[i].d_un.d_ptr; \
+        } else if (dyn[i].d_tag == DT_STRSZ) { \
+            strtab_size = dyn[i].d_un.d_val; \
+        } else if (dyn[i].d_tag == DT_FLAGS_1) { \
+            info->is_pie = (dyn[i].d_un.d_val & DF_1_PIE) != 0; \
+        } \
+    } \
+    \
+    for (int i = 0; i < ehdr->e_phnum; i++) { \
+        if (phdr[i].p_type == PT_LOAD && strtab_addr >= phdr[i].p_vaddr && \
+            strtab_addr - phdr[i].p_vaddr < phdr[i].p_filesz) { \
+            strtab_offset = strtab_addr - phdr[i].p_vaddr + phdr[i].p_offset; \
+            found_strtab = 1; \
+            break; \
+        } \
+    } \
+    if (!found_strtab || strtab_offset >= info->size || strtab_size > info->size - strtab_offset) { \
+        return -1; \
+    } \
+    \
+    const char *strtab = (const char *)(base + strtab_offset); \
+    for (size_t i = 0; i < dyn_count && dyn[i].d_tag != DT_NULL; i++) { \
+        uint64_t value = dyn[i].d_un.d_val; \
+        if (value >= strtab_size || memchr(strtab + value, '\0', strtab_size - value) == NULL) { \
+            continue; \
+        } \
+        if (dyn[i].d_tag == DT_NEEDED && info->needed_count < ELF_MAX_NEEDED) { \
+            info->needed[info->needed_count++] = strtab + value; \
+        } else if (dyn[i].d_tag == DT_SONAME) { \
+            soname = value; \
+        } \
+    } \
+    if (soname != (uint64_t)-1) { \
+        info->soname = strtab + soname; \
+    } \
+    \
+    return 0; \
+}
+
+DEFINE_ELF_PARSER(32)
+DEFINE_ELF_PARSER(64)
+
+/**
+ * @brief Map an ELF object and read its dynamic linking information
+ * @param dirfd Directory descriptor that path is relative to (or AT_FDCWD)
+ * @param path Path of the object
+ * @param info Receives the parsed information; strings point into the mapping
+ * @return 0 on success, -1 if the file cannot be read or is not a native ELF object
+ */
+int elf_open(int dirfd, const char *path, elf_info_t *info) {
+    const unsigned char *ident;
+    struct stat st;
+    int result = -1;
+    int fd;
+    
+    memset(info, 0, sizeof(*info));
+    
+    fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < EI_NIDENT) {
+        close(fd);
+        return -1;
+    }
+    
+    info->size = (size_t)st.st_size;
+    info->map = mmap(NULL, info->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (info->map == MAP_FAILED) {
+        info->map = NULL;
+        return -1;
+    }
+    
+    ident = info->map;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const unsigned char native_data = ELFDATA2LSB;
+#else
+    const unsigned char native_data = ELFDATA2MSB;
+#endif
+    if (memcmp(ident, ELFMAG, SELFMAG) == 0 && ident[EI_DATA] == native_data) {
+        if (ident[EI_CLASS] == ELFCLASS64) {
+            result = parse_elf64(info);
+        } else if (ident[EI_CLASS] == ELFCLASS32) {
+            result = parse_elf32(info);
+        }
+    }
+    
+    if (result != 0) {
+        elf_close(info);
+    }
+    return result;
+}
+
+/**
+ * @brief Unmap an ELF object opened with elf_open()
+ * @param info Object to release
+ */
+void elf_close(elf_info_t *info) {
+    if (info->map) {
+        munmap(info->map, info->size);
+    }
+    memset(info, 0, sizeof(*info));
+}
@@ -0,0 +1,354 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file environment.c
+ * @brief Environment of the launched application
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Replacing a variable appends the new string and repoints its entry, so
+ * earlier values are not reused; an environment is built once per launch
+ * (or per resident bundle) and the waste is bounded by what was set.
+ *
+ * A builder holding inline storage points into itself, so it is moved
+ * with env_builder_move() rather than by assignment.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "environment.h"
+
+/**
+ * @brief Make room in the arena
+ * @param env Environment builder
+ * @param size Bytes about to be appended
+ * @return 0 on success, -1 if out of memory
+ */
+static int arena_reserve(env_builder_t *env, size_t size) {
+    size_t capacity = env->capacity ? env->capacity : ENV_ARENA_SLACK;
+    char *grown;
+    
+    if (env->used + size <= env->capacity) {
+        return 0;
+    }
+    while (capacity < env->used + size) {
+        capacity *= 2;
+    }
+    
+    // Leaving the inline arena copies it once; after that the heap copy grows in place
+    if (env->arena == env->inline_arena) {
+        grown = malloc(capacity);
+        if (grown != NULL) {
+            memcpy(grown, env->arena, env->used);
+        }
+    } else {
+        grown = realloc(env->arena, capacity);
+    }
+    if (grown == NULL) {
+        return -1;
+    }
+    env->arena = grown;
+    env->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Find the entry of a variable
+ * @param env Environment builder
+ * @param name Variable name, not necessarily terminated
+ * @param name_length Length of the name
+ * @return Entry index, or env->count if unset
+ */
+static size_t entry_find(const env_builder_t *env, const char *name, size_t name_length) {
+    for (size_t i = 0; i < env->count; i++) {
+        const char *entry = env->arena + env->entries[i];
+        if (strncmp(entry, name, name_length) == 0 && entry[name_length] == '=') {
+            return i;
+        }
+    }
+    return env->count;
+}
+
+/**
+ * @brief Point a variable at a string just written to the arena
+ * @param env Environment builder
+ * @param index Entry to replace, or env->count to append
+ * @param offset Arena offset of the "NAME=value" string
+ * @param size Size of the string including its terminator
+ * @return 0 on success, -1 if out of memory
+ */
+static int entry_commit(env_builder_t *env, size_t index, size_t offset, size_t size) {
+    if (index == env->count) {
+        if (env->count == env->entry_capacity) {
+            size_t capacity = env->entry_capacity ? env->entry_capacity * 2 : 64;
+            size_t *grown;
+            
+            if (env->entries == env->inline_entries) {
+                grown = malloc(capacity * sizeof(*grown));
+                if (grown != NULL) {
+                    memcpy(grown, env->entries, env->count * sizeof(*grown));
+                }
+            } else {
+                grown = realloc(env->entries, capacity * sizeof(*grown));
+            }
+            if (grown == NULL) {
+                return -1;
+            }
+            env->entries = grown;
+            env->entry_capacity = capacity;
+        }
+        env->count++;
+    }
+    env->entries[index] = offset;
+    env->used = offset + size;
+    return 0;
+}
+
+/**
+ * @brief Reset the header of a builder to its empty inline storage
+ * @param env Environment builder
+ */
+static void builder_reset(env_builder_t *env) {
+    // Only the header; clearing the storage would fault in pages nothing reads
+    env->arena = env->inline_arena;
+    env->used = 0;
+    env->capacity = ENV_INLINE_ARENA;
+    env->entries = env->inline_entries;
+    env->count = 0;
+    env->entry_capacity = ENV_INLINE_ENTRIES;
+    env->envp = NULL;
+}
+
+/**
+ * @brief Start an environment from an existing one
+ * @param env Environment builder to initialize
+ * @param base NULL-terminated "NAME=value" array, usually environ; may be NULL
+ * @return 0 on success, -1 if out of memory
+ */
+int env_builder_init(env_builder_t *env, char *const *base) {
+    size_t size = ENV_ARENA_SLACK;
+    
+    builder_reset(env);
+    for (char *const *entry = base; entry && *entry; entry++) {
+        size += strlen(*entry) + 1;
+    }
+    if (arena_reserve(env, size) != 0) {
+        return -1;
+    }
+    
+    for (char *const *entry = base; entry && *entry; entry++) {
+        size_t length = strlen(*entry) + 1;
+        
+        // Entries without a name are passed on as they are, but never matched
+        memcpy(env->arena + env->used, *entry, length);
+        if (entry_commit(env, env->count, env->used, length) != 0) {
+            env_builder_free(env);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Release an environment
+ * @param env Environment builder
+ */
+void env_builder_free(env_builder_t *env) {
+    if (env->arena != env->inline_arena) {
+        free(env->arena);
+    }
+    if (env->entries != env->inline_entries) {
+        free(env->entries);
+    }
+    if (env->envp != env->inline_envp) {
+        free(env->envp);
+    }
+    builder_reset(env);
+}
+
+/**
+ * @brief Move an environment into another builder
+ * @param target Builder to receive it, uninitialized or freed
+ * @param source Built environment; left empty, needing no env_builder_free()
+ */
+void env_builder_move(env_builder_t *target, env_builder_t *source) {
+    builder_reset(target);
+    target->used = source->used;
+    target->count = source->count;
+    
+    // Inline contents are copied, heap storage changes hands
+    if (source->arena == source->inline_arena) {
+        memcpy(target->inline_arena, source->arena, source->used);
+    } else {
+        target->arena = source->arena;
+        target->capacity = source->capacity;
+    }
+    if (source->entries == source->inline_entries) {
+        memcpy(target->inline_entries, source->entries, source->count * sizeof(*source->entries));
+    } else {
+        target->entries = source->entries;
+        target->entry_capacity = source->entry_capacity;
+    }
+    if (source->envp != source->inline_envp) {
+        target->envp = source->envp;
+    }
+    builder_reset(source);
+}
+
+/**
+ * @brief Look up a variable
+ * @param env Environment builder
+ * @param name Variable name
+ * @return Value, valid until the environment is next changed, or NULL if unset
+ */
+const char *env_builder_get(const env_builder_t *env, const char *name) {
+    size_t name_length = strlen(name);
+    size_t index = entry_find(env, name, name_length);
+    
+    return index < env->count ? env->arena + env->entries[index] + name_length + 1 : NULL;
+}
+
+/**
+ * @brief Set a variable from counted strings, such as metadata values
+ * @param env Environment builder
+ * @param name Variable name, without '=' or NUL
+ * @param name_length Length of the name
+ * @param value Value, without NUL
+ * @param value_length Length of the value
+ * @return 0 on success, -1 if the name or value is invalid or out of memory
+ */
+int env_builder_put(env_builder_t *env, const char *name, size_t name_length, const char *value, size_t value_length) {
+    size_t size = name_length + value_length + 2;
+    size_t offset;
+    
+    if (name_length == 0 || memchr(name, '=', name_length) || memchr(name, '\0', name_length) ||
+        memchr(value, '\0', value_length) || arena_reserve(env, size) != 0) {
+        return -1;
+    }
+    
+    offset = env->used;
+    memcpy(env->arena + offset, name, name_length);
+    env->arena[offset + name_length] = '=';
+    memcpy(env->arena + offset + name_length + 1, value, value_length);
+    env->arena[offset + size - 1] = '\0';
+    return entry_commit(env, entry_find(env, name, name_length), offset, size);
+}
+
+/**
+ * @brief Set a variable
+ * @param env Environment builder
+ * @param name Variable name
+ * @param value Value
+ * @return 0 on success, -1 if the name is invalid or out of memory
+ */
+int env_builder_set(env_builder_t *env, const char *name, const char *value) {
+    return env_builder_put(env, name, strlen(name), value, strlen(value));
+}
+
+/**
+ * @brief Put an entry in front of a colon-separated list variable
+ * @param env Environment builder
+ * @param name Variable name, such as LD_LIBRARY_PATH
+ * @param value Entry to put first
+ * @return 0 on success, -1 if the name is invalid or out of memory
+ */
+int env_builder_prepend(env_builder_t *env, const char *name, const char *value) {
+    size_t name_length = strlen(name);
+    size_t value_length = strlen(value);
+    size_t index = entry_find(env, name, name_length);
+    size_t current_offset = 0;
+    size_t current_length = 0;
+    size_t size;
+    size_t offset;
+    
+    if (index < env->count) {
+        current_offset = env->entries[index] + name_length + 1;
+        current_length = strlen(env->arena + current_offset);
+    }
+    if (current_length == 0) {
+        return env_builder_put(env, name, name_length, value, value_length);
+    }
+    
+    // The current value is read back after the arena may have moved
+    size = name_length + value_length + current_length + 3;
+    if (name_length == 0 || memchr(name, '=', name_length) || arena_reserve(env, size) != 0) {
+        return -1;
+    }
+    offset = env->used;
+    memcpy(env->arena + offset, name, name_length);
+    env->arena[offset + name_length] = '=';
+    memcpy(env->arena + offset + name_length + 1, value, value_length);
+    env->arena[offset + name_length + 1 + value_length] = ENV_PATH_SEPARATOR;
+    memcpy(env->arena + offset + name_length + value_length + 2, env->arena + current_offset, current_length + 1);
+    return entry_commit(env, index, offset, size);
+}
+
+/**
+ * @brief Remove a variable
+ * @param env Environment builder
+ * @param name Variable name
+ */
+void env_builder_unset(env_builder_t *env, const char *name) {
+    size_t index = entry_find(env, name, strlen(name));
+    
+    if (index < env->count) {
+        memmove(&env->entries[index], &env->entries[index + 1], (env->count - index - 1) * sizeof(*env->entries));
+        env->count--;
+    }
+}
+
+/**
+ * @brief Produce the array for execve()
+ * @param env Environment builder
+ * @return NULL-terminated array, valid until the environment is next changed, or NULL if out of memory
+ */
+char *const *env_builder_envp(env_builder_t *env) {
+    char **envp = env->inline_envp;
+    
+    if (env->count + 1 > sizeof(env->inline_envp) / sizeof(env->inline_envp[0])) {
+        envp = realloc(env->envp == env->inline_envp ? NULL : env->envp, (env->count + 1) * sizeof(*envp));
+        if (envp == NULL) {
+            return NULL;
+        }
+    } else if (env->envp != NULL && env->envp != env->inline_envp) {
+        free(env->envp);
+    }
+    for (size_t i = 0; i < env->count; i++) {
+        envp[i] = env->arena + env->entries[i];
+    }
+    envp[env->count] = NULL;
+    env->envp = envp;
+    return envp;
+}
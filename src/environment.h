@@ -0,0 +1,89 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file environment.h
+ * @brief Environment of the launched application
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The child's environment is assembled in one arena, starting from the
+ * launcher's own, and handed to execve() as a whole. The launcher's
+ * environ is never modified, so preparation may run on any thread and
+ * the daemon can keep a built environment with its resident bundles.
+ *
+ * The arena, the entry table and envp start out in the builder itself,
+ * so a launch with an environment of common size allocates nothing; only
+ * larger environments move to the heap.
+ */
+
+#ifndef VLAUNCH_ENVIRONMENT_H
+#define VLAUNCH_ENVIRONMENT_H
+
+#include <stddef.h>
+
+#include "launcher.h"
+
+/* Environment Configuration */
+#define ENV_ARENA_SLACK     4096
+#define ENV_PATH_SEPARATOR  ':'
+#define ENV_INLINE_ARENA    (16 * 1024)
+#define ENV_INLINE_ENTRIES  256
+
+/* "NAME=value" strings in an arena, referenced by offset so it can grow */
+struct env_builder {
+    char *arena;
+    size_t used;
+    size_t capacity;
+    size_t *entries;
+    size_t count;
+    size_t entry_capacity;
+    char **envp;
+    
+    // Storage used until the environment outgrows it; never touched beyond what is used
+    char inline_arena[ENV_INLINE_ARENA];
+    size_t inline_entries[ENV_INLINE_ENTRIES];
+    char *inline_envp[ENV_INLINE_ENTRIES + 1];
+};
+
+int env_builder_init(env_builder_t *env, char *const *base);
+void env_builder_free(env_builder_t *env);
+void env_builder_move(env_builder_t *target, env_builder_t *source);
+const char *env_builder_get(const env_builder_t *env, const char *name);
+int env_builder_put(env_builder_t *env, const char *name, size_t name_length, const char *value, size_t value_length);
+int env_builder_set(env_builder_t *env, const char *name, const char *value);
+int env_builder_prepend(env_builder_t *env, const char *name, const char *value);
+void env_builder_unset(env_builder_t *env, const char *name);
+char *const *env_builder_envp(env_builder_t *env);
+
+#endif /* VLAUNCH_ENVIRONMENT_H */
@@ -0,0 +1,327 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file handoff.c
+ * @brief Arguments and descriptors handed to the application
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * handoff_apply() runs in the process about to exec, which may be a
+ * CLONE_VM child of the supervisor, so it only makes system calls. The
+ * application's pid is not known while the environment is built;
+ * LISTEN_PID is written with HANDOFF_PID_WIDTH zeros and filled in by
+ * handoff_apply() once it is.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "handoff.h"
+#include "environment.h"
+
+/**
+ * @brief Start an empty handoff: no arguments, no descriptors, own stdio
+ * @param handoff Handoff to initialize
+ */
+void handoff_init(launch_handoff_t *handoff) {
+    handoff->args = NULL;
+    handoff->arg_count = 0;
+    handoff->fd_count = 0;
+    for (int i = 0; i < 3; i++) {
+        handoff->stdio[i] = -1;
+    }
+}
+
+/**
+ * @brief Hand a descriptor to the application as the next LISTEN_FDS entry
+ * @param handoff Handoff
+ * @param fd Open descriptor of the launcher
+ * @param name Name for LISTEN_FDNAMES, or NULL for HANDOFF_DEFAULT_NAME
+ * @param name_length Length of the name
+ * @return EXIT_SUCCESS on success, EXIT_INVALID_ARGS if the descriptor or name is unusable
+ */
+int handoff_add_fd(launch_handoff_t *handoff, int fd, const char *name, size_t name_length) {
+    if (name == NULL || name_length == 0) {
+        name = HANDOFF_DEFAULT_NAME;
+        name_length = strlen(HANDOFF_DEFAULT_NAME);
+    }
+    if (handoff->fd_count >= HANDOFF_MAX_FDS) {
+        log_message(LOG_ERROR, "Too many descriptors to pass (max %d)", HANDOFF_MAX_FDS);
+        return EXIT_INVALID_ARGS;
+    }
+    if (fd < 0 || fcntl(fd, F_GETFD) < 0) {
+        log_message(LOG_ERROR, "Descriptor %d is not open", fd);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    // Names are joined with ':' in LISTEN_FDNAMES
+    if (name_length >= HANDOFF_NAME_LENGTH || memchr(name, ':', name_length) || memchr(name, '\0', name_length)) {
+        log_message(LOG_ERROR, "Invalid descriptor name: %.*s", (int)name_length, name);
+        return EXIT_INVALID_ARGS;
+    }
+    for (size_t i = 0; i < name_length; i++) {
+        if ((unsigned char)name[i] < 0x20 || (unsigned char)name[i] == 0x7f) {
+            log_message(LOG_ERROR, "Invalid descriptor name: %.*s", (int)name_length, name);
+            return EXIT_INVALID_ARGS;
+        }
+    }
+    
+    handoff->fds[handoff->fd_count] = fd;
+    memcpy(handoff->names[handoff->fd_count], name, name_length);
+    handoff->names[handoff->fd_count][name_length] = '\0';
+    handoff->fd_count++;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Parse a --pass-fd value
+ * @param handoff Handoff
+ * @param value "<fd>" or "<fd>:<name>"
+ * @return EXIT_SUCCESS on success, EXIT_INVALID_ARGS on a bad value
+ */
+int handoff_parse_option(launch_handoff_t *handoff, const char *value) {
+    char *end;
+    long fd;
+    
+    errno = 0;
+    fd = strtol(value, &end, 10);
+    if (errno != 0 || end == value || fd < 0 || fd > INT_MAX || (*end != '\0' && *end != ':')) {
+        log_message(LOG_ERROR, "Invalid --pass-fd value: %s (expected <fd>[:<name>])", value);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    return handoff_add_fd(handoff, (int)fd, *end == ':' ? end + 1 : NULL, *end == ':' ? strlen(end + 1) : 0);
+}
+
+/**
+ * @brief Adopt the descriptors the launcher itself was socket-activated with
+ * @param handoff Handoff
+ * @return EXIT_SUCCESS on success, error code if they cannot all be passed on
+ */
+int handoff_inherit(launch_handoff_t *handoff) {
+    const char *listen_pid = getenv("LISTEN_PID");
+    const char *listen_fds = getenv("LISTEN_FDS");
+    const char *names = getenv("LISTEN_FDNAMES");
+    char *end;
+    long count;
+    
+    // Variables meant for another process are dropped by handoff_configure()
+    if (!listen_pid || !listen_fds || strtol(listen_pid, &end, 10) != (long)getpid() || *end != '\0') {
+        return EXIT_SUCCESS;
+    }
+    count = strtol(listen_fds, &end, 10);
+    if (*end != '\0' || count < 0 || count > HANDOFF_MAX_FDS) {
+        log_message(LOG_WARNING, "Ignoring invalid LISTEN_FDS: %s", listen_fds);
+        return EXIT_SUCCESS;
+    }
+    
+    for (long i = 0; i < count; i++) {
+        const char *separator = names ? strchr(names, ':') : NULL;
+        size_t length = names ? (separator ? (size_t)(separator - names) : strlen(names)) : 0;
+        int result = handoff_add_fd(handoff, HANDOFF_FIRST_FD + (int)i, names, length);
+        
+        if (result != EXIT_SUCCESS) {
+            return result;
+        }
+        names = separator ? separator + 1 : NULL;
+    }
+    
+    log_message(LOG_DEBUG, "Passing on %ld socket-activated descriptors", count);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Close descriptors received for a handoff
+ * @param handoff Handoff whose descriptors belong to the caller
+ */
+void handoff_close(launch_handoff_t *handoff) {
+    for (unsigned int i = 0; i < handoff->fd_count; i++) {
+        close(handoff->fds[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        if (handoff->stdio[i] >= 0) {
+            close(handoff->stdio[i]);
+        }
+    }
+    handoff_init(handoff);
+}
+
+/**
+ * @brief Build the application's argument vector
+ * @param handoff Handoff, or NULL for no arguments
+ * @param exec_path Path passed as argv[0]
+ * @param argv Storage for the vector; arguments are bounded, so it always fits
+ * @return argv, NULL-terminated
+ */
+char **handoff_argv(const launch_handoff_t *handoff, char *exec_path, char *argv[HANDOFF_ARGV_SIZE]) {
+    unsigned int count = handoff ? handoff->arg_count : 0;
+    
+    argv[0] = exec_path;
+    for (unsigned int i = 0; i < count; i++) {
+        argv[i + 1] = handoff->args[i];
+    }
+    argv[count + 1] = NULL;
+    return argv;
+}
+
+/**
+ * @brief Describe the handed descriptors in the application's environment
+ * @param handoff Handoff, or NULL to pass nothing
+ * @param env Environment of the application
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int handoff_configure(const launch_handoff_t *handoff, env_builder_t *env) {
+    char count[16];
+    char pid[HANDOFF_PID_WIDTH + 1];
+    size_t names_length = 0;
+    char *names;
+    int failed;
+    
+    // Inherited variables describe descriptors of some other process
+    env_builder_unset(env, "LISTEN_FDS");
+    env_builder_unset(env, "LISTEN_PID");
+    env_builder_unset(env, "LISTEN_FDNAMES");
+    if (handoff == NULL || handoff->fd_count == 0) {
+        return EXIT_SUCCESS;
+    }
+    
+    for (unsigned int i = 0; i < handoff->fd_count; i++) {
+        names_length += strlen(handoff->names[i]) + 1;
+    }
+    names = malloc(names_length);
+    if (names == NULL) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    names[0] = '\0';
+    for (unsigned int i = 0; i < handoff->fd_count; i++) {
+        if (i > 0) {
+            strcat(names, ":");
+        }
+        strcat(names, handoff->names[i]);
+    }
+    
+    snprintf(count, sizeof(count), "%u", handoff->fd_count);
+    memset(pid, '0', HANDOFF_PID_WIDTH);
+    pid[HANDOFF_PID_WIDTH] = '\0';
+    failed = env_builder_set(env, "LISTEN_FDS", count) != 0 ||
+             env_builder_set(env, "LISTEN_PID", pid) != 0 ||
+             env_builder_set(env, "LISTEN_FDNAMES", names) != 0;
+    free(names);
+    if (failed) {
+        log_message(LOG_ERROR, "Failed to set LISTEN_FDS: %s", strerror(ENOMEM));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_message(LOG_DEBUG, "Passing %u descriptors: %s", handoff->fd_count, env_builder_get(env, "LISTEN_FDNAMES"));
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Move the handed descriptors into place in the process about to exec
+ * @param handoff Handoff, or NULL to pass nothing
+ * @param pid_slot Value of LISTEN_PID in the final environment, or NULL
+ * @param keep_fd Descriptor still needed for the exec, moved out of the way if it is in the target range
+ * @return 0 on success, -1 with errno set on failure
+ */
+int handoff_apply(const launch_handoff_t *handoff, char *pid_slot, int *keep_fd) {
+    int moved[HANDOFF_MAX_FDS + 3];
+    unsigned int count;
+    unsigned int target = (unsigned int)HANDOFF_FIRST_FD;
+    unsigned int value;
+    
+    if (handoff == NULL) {
+        return 0;
+    }
+    count = handoff->fd_count;
+    
+    // Such as the probe's executable descriptor, which is close-on-exec itself
+    if (*keep_fd < HANDOFF_FIRST_FD + (int)count && (*keep_fd >= HANDOFF_FIRST_FD || handoff->stdio[*keep_fd] >= 0)) {
+        int kept = fcntl(*keep_fd, F_DUPFD_CLOEXEC, HANDOFF_FIRST_FD + (int)count);
+        if (kept < 0) {
+            return -1;
+        }
+        *keep_fd = kept;
+    }
+    
+    // Copy everything above the target range first, since sources may sit inside it;
+    // the copies are close-on-exec and dup2() clears the flag on the targets
+    for (unsigned int i = 0; i < count; i++) {
+        moved[i] = fcntl(handoff->fds[i], F_DUPFD_CLOEXEC, HANDOFF_FIRST_FD + (int)count);
+        if (moved[i] < 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        moved[count + (unsigned int)i] = handoff->stdio[i] < 0 ? -1
+            : fcntl(handoff->stdio[i], F_DUPFD_CLOEXEC, HANDOFF_FIRST_FD + (int)count);
+        if (handoff->stdio[i] >= 0 && moved[count + (unsigned int)i] < 0) {
+            return -1;
+        }
+    }
+    
+    for (unsigned int i = 0; i < count; i++, target++) {
+        if (dup2(moved[i], (int)target) < 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        if (moved[count + (unsigned int)i] >= 0 && dup2(moved[count + (unsigned int)i], i) < 0) {
+            return -1;
+        }
+    }
+    
+    // Otherwise the application would also inherit each source at its old number
+    for (unsigned int i = 0; i < count + 3; i++) {
+        int source = i < count ? handoff->fds[i] : handoff->stdio[i - count];
+        if (source >= HANDOFF_FIRST_FD + (int)count && source != *keep_fd) {
+            close(source);
+        }
+    }
+    
+    // Digits are written from the end; the leading zeros parse as decimal
+    if (pid_slot != NULL) {
+        value = (unsigned int)getpid();
+        for (int i = HANDOFF_PID_WIDTH - 1; i >= 0; i--) {
+            pid_slot[i] = (char)('0' + value % 10);
+            value /= 10;
+        }
+    }
+    return 0;
+}
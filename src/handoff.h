@@ -0,0 +1,83 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file handoff.h
+ * @brief Arguments and descriptors handed to the application
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Arguments after "--" on the command line are passed on to the
+ * application. Descriptors follow the socket activation convention: they
+ * appear at HANDOFF_FIRST_FD and up, described by LISTEN_FDS, LISTEN_PID
+ * and LISTEN_FDNAMES. The launcher passes on descriptors it was itself
+ * activated with, those named by --pass-fd, and those a client sent the
+ * daemon along with its standard streams.
+ */
+
+#ifndef VLAUNCH_HANDOFF_H
+#define VLAUNCH_HANDOFF_H
+
+#include <stddef.h>
+
+#include "launcher.h"
+
+/* Handoff Configuration */
+#define HANDOFF_FIRST_FD        3
+#define HANDOFF_MAX_FDS         64
+#define HANDOFF_MAX_ARGS        1024
+#define HANDOFF_ARGV_SIZE       (HANDOFF_MAX_ARGS + 2)
+#define HANDOFF_NAME_LENGTH     256
+#define HANDOFF_PID_WIDTH       10
+#define HANDOFF_DEFAULT_NAME    "unknown"
+
+/* What the caller hands to the application on top of the bundle */
+struct launch_handoff {
+    char *const *args;
+    unsigned int arg_count;
+    int fds[HANDOFF_MAX_FDS];
+    char names[HANDOFF_MAX_FDS][HANDOFF_NAME_LENGTH];
+    unsigned int fd_count;
+    int stdio[3];
+};
+
+void handoff_init(launch_handoff_t *handoff);
+int handoff_add_fd(launch_handoff_t *handoff, int fd, const char *name, size_t name_length);
+int handoff_parse_option(launch_handoff_t *handoff, const char *value);
+int handoff_inherit(launch_handoff_t *handoff);
+void handoff_close(launch_handoff_t *handoff);
+char **handoff_argv(const launch_handoff_t *handoff, char *exec_path, char *argv[HANDOFF_ARGV_SIZE]);
+int handoff_configure(const launch_handoff_t *handoff, env_builder_t *env);
+int handoff_apply(const launch_handoff_t *handoff, char *pid_slot, int *keep_fd);
+
+#endif /* VLAUNCH_HANDOFF_H */
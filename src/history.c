@@ -0,0 +1,516 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file history.c
+ * @brief Launch history log and the prewarm scheduler that learns from it
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Launch paths record themselves: exec_application() for direct, batch
+ * and daemon launches, the toolkit host, the supervisor and checkpoint
+ * restores, and the callers that report a launch failing before any of
+ * those is reached. Each launch is recorded once; exec_application()
+ * amends its record if the exec fails. Prewarming goes through prepare_application() and prefetch_warm(), which also
+ * brings the validation, digest and compiled manifest caches up to date
+ * for the bundle before it is launched for real.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/ioprio.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "prefetch.h"
+#include "history.h"
+
+#define HISTORY_MAP_SIZE (sizeof(history_header_t) + HISTORY_CAPACITY * sizeof(history_record_t))
+
+/* A bundle the scheduler expects to be launched soon */
+typedef struct {
+    char path[HISTORY_PATH_LENGTH];
+    double score;
+} history_candidate_t;
+
+/* A bundle the scheduler warmed, and when */
+typedef struct {
+    char path[HISTORY_PATH_LENGTH];
+    long long time_ms;
+} history_warmed_t;
+
+static history_header_t *history_header;
+
+/**
+ * @brief Get the records that follow the header in the mapping
+ * @param header Mapped history file
+ * @return First record slot
+ */
+static history_record_t *history_records(history_header_t *header) {
+    return (history_record_t *)(header + 1);
+}
+
+/**
+ * @brief Map the history file, creating and laying it out if needed
+ * @return Mapped header, or NULL if there is no usable history file
+ */
+static history_header_t *history_map(void) {
+    char directory[MAX_PATH_LENGTH];
+    char path[MAX_PATH_LENGTH];
+    history_header_t *header;
+    struct stat st;
+    int written;
+    int fd;
+    
+    if (history_header != NULL) {
+        return history_header;
+    }
+    if (cache_directory(HISTORY_CACHE_DIR, directory, sizeof(directory)) != EXIT_SUCCESS) {
+        return NULL;
+    }
+    written = snprintf(path, sizeof(path), "%s/%s", directory, HISTORY_FILE_NAME);
+    if (written < 0 || (size_t)written >= sizeof(path)) {
+        return NULL;
+    }
+    
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        log_message(LOG_DEBUG, "Cannot open launch history %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    
+    // Extending to the same size is idempotent, so racing creators need no lock for it
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < HISTORY_MAP_SIZE && ftruncate(fd, HISTORY_MAP_SIZE) != 0)) {
+        close(fd);
+        return NULL;
+    }
+    header = mmap(NULL, HISTORY_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    
+    // The first user lays out the header; others wait on the lock and see it done
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != HISTORY_MAGIC ||
+        header->version != HISTORY_VERSION || header->capacity != HISTORY_CAPACITY ||
+        header->record_size != sizeof(history_record_t)) {
+        flock(fd, LOCK_EX);
+        if (header->magic != HISTORY_MAGIC || header->version != HISTORY_VERSION ||
+            header->capacity != HISTORY_CAPACITY || header->record_size != sizeof(history_record_t)) {
+            memset(header, 0, HISTORY_MAP_SIZE);
+            header->version = HISTORY_VERSION;
+            header->capacity = HISTORY_CAPACITY;
+            header->record_size = sizeof(history_record_t);
+            __atomic_store_n(&header->magic, HISTORY_MAGIC, __ATOMIC_RELEASE);
+        }
+        flock(fd, LOCK_UN);
+    }
+    close(fd);
+    
+    history_header = header;
+    return header;
+}
+
+/**
+ * @brief Append a launch to the history
+ * @param bundle_path Bundle that was launched
+ * @param time_ms Wall clock time the launch started, in milliseconds
+ * @param result EXIT_* result of the launch
+ * @param latency_ns Time from start to exec or failure
+ * @return Entry to pass to history_amend(), or 0 if nothing was recorded
+ */
+uint64_t history_record(const char *bundle_path, long long time_ms, int result, long long latency_ns) {
+    char canonical[MAX_PATH_LENGTH];
+    history_header_t *header;
+    history_record_t *record;
+    uint64_t sequence;
+    size_t length;
+    
+    // Only bundles that can be found again are worth learning from
+    if (bundle_path[0] == '\0' || realpath(bundle_path, canonical) == NULL) {
+        return 0;
+    }
+    length = strlen(canonical);
+    if (length >= HISTORY_PATH_LENGTH) {
+        return 0;
+    }
+    header = history_map();
+    if (header == NULL) {
+        return 0;
+    }
+    
+    // Claim a slot, then publish it by writing its sequence number last
+    sequence = __atomic_fetch_add(&header->next, 1, __ATOMIC_RELAXED);
+    record = &history_records(header)[sequence % HISTORY_CAPACITY];
+    __atomic_store_n(&record->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    record->time_ms = (uint64_t)time_ms;
+    record->latency_ns = latency_ns > 0 ? (uint64_t)latency_ns : 0;
+    record->result = result;
+    record->reserved = 0;
+    memcpy(record->path, canonical, length + 1);
+    __atomic_store_n(&record->sequence, sequence + 1, __ATOMIC_RELEASE);
+    return sequence + 1;
+}
+
+/**
+ * @brief Replace the result of a launch recorded before its exec was attempted
+ * @param entry Entry returned by history_record(), or 0
+ * @param result EXIT_* result of the launch
+ *
+ * Nothing is left to record a successful exec, so exec_application()
+ * records success first and a failed exec amends that record rather
+ * than appending a second one.
+ */
+void history_amend(uint64_t entry, int result) {
+    history_record_t *record;
+    uint64_t expected = entry;
+    
+    if (entry == 0 || history_header == NULL) {
+        return;
+    }
+    
+    // Unpublish the slot as a writer would, unless the ring has reused it since
+    record = &history_records(history_header)[(entry - 1) % HISTORY_CAPACITY];
+    if (!__atomic_compare_exchange_n(&record->sequence, &expected, 0, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->result = result;
+    __atomic_store_n(&record->sequence, entry, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Copy the published records, oldest first
+ * @param header Mapped history file
+ * @param out Receives up to HISTORY_CAPACITY records
+ * @return Number of records copied
+ */
+static unsigned int snapshot_records(history_header_t *header, history_record_t *out) {
+    uint64_t next = __atomic_load_n(&header->next, __ATOMIC_ACQUIRE);
+    uint64_t first = next > HISTORY_CAPACITY ? next - HISTORY_CAPACITY : 0;
+    unsigned int count = 0;
+    
+    for (uint64_t sequence = first; sequence < next; sequence++) {
+        history_record_t *slot = &history_records(header)[sequence % HISTORY_CAPACITY];
+        uint64_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        
+        // Skip slots being written or already reused by a newer launch
+        if (before != sequence + 1) {
+            continue;
+        }
+        memcpy(&out[count], slot, sizeof(*slot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != before) {
+            continue;
+        }
+        out[count].path[HISTORY_PATH_LENGTH - 1] = '\0';
+        count++;
+    }
+    
+    return count;
+}
+
+/**
+ * @brief Add weight to a candidate bundle
+ * @param candidates Candidate table
+ * @param count Number of candidates, updated when one is added
+ * @param path Bundle path
+ * @param weight Weight to add
+ */
+static void add_candidate(history_candidate_t *candidates, unsigned int *count, const char *path, double weight) {
+    for (unsigned int i = 0; i < *count; i++) {
+        if (strcmp(candidates[i].path, path) == 0) {
+            candidates[i].score += weight;
+            return;
+        }
+    }
+    if (*count < HISTORY_MAX_CANDIDATES) {
+        snprintf(candidates[*count].path, sizeof(candidates[*count].path), "%s", path);
+        candidates[*count].score = weight;
+        (*count)++;
+    }
+}
+
+/**
+ * @brief Credit the first distinct bundles launched after an anchor launch
+ * @param records Records, oldest first
+ * @param count Number of records
+ * @param anchor Index of the anchor launch
+ * @param include_anchor Non-zero if the anchor itself is credited first
+ * @param weight Weight of the first bundle credited; later ones get less
+ * @param candidates Candidate table
+ * @param candidate_count Number of candidates
+ */
+static void credit_followers(const history_record_t *records, unsigned int count, unsigned int anchor,
+                             int include_anchor, double weight,
+                             history_candidate_t *candidates, unsigned int *candidate_count) {
+    const char *seen[HISTORY_PREWARM_COUNT + 1];
+    unsigned int seen_count = 0;
+    unsigned int rank = 0;
+    
+    seen[seen_count++] = records[anchor].path;
+    if (include_anchor) {
+        add_candidate(candidates, candidate_count, records[anchor].path, weight);
+        rank++;
+    }
+    
+    for (unsigned int j = anchor + 1; j < count && rank < HISTORY_PREWARM_COUNT; j++) {
+        int repeated = 0;
+        
+        if ((long long)(records[j].time_ms - records[anchor].time_ms) >= HISTORY_FOLLOW_MS) {
+            break;
+        }
+        if (records[j].result != EXIT_SUCCESS) {
+            continue;
+        }
+        for (unsigned int k = 0; k < seen_count; k++) {
+            repeated |= strcmp(seen[k], records[j].path) == 0;
+        }
+        if (repeated) {
+            continue;
+        }
+        
+        seen[seen_count++] = records[j].path;
+        add_candidate(candidates, candidate_count, records[j].path, weight / (rank + 1));
+        rank++;
+    }
+}
+
+/**
+ * @brief Order candidates by descending score
+ * @param a First candidate
+ * @param b Second candidate
+ * @return Comparison result
+ */
+static int compare_candidates(const void *a, const void *b) {
+    double x = ((const history_candidate_t *)a)->score;
+    double y = ((const history_candidate_t *)b)->score;
+    
+    return (x < y) - (x > y);
+}
+
+/**
+ * @brief Rank the bundles likely to be launched next
+ * @param records Records, oldest first
+ * @param count Number of records
+ * @param now_ms Current wall clock time in milliseconds
+ * @param candidates Receives the candidates, best first
+ * @return Number of candidates
+ */
+static unsigned int rank_candidates(const history_record_t *records, unsigned int count, long long now_ms,
+                                    history_candidate_t *candidates) {
+    const history_record_t *last = count > 0 ? &records[count - 1] : NULL;
+    int following = last && now_ms - (long long)last->time_ms < HISTORY_FOLLOW_MS;
+    unsigned int candidate_count = 0;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        long long age = now_ms - (long long)records[i].time_ms;
+        double weight = 1.0 / (1.0 + (double)(age > 0 ? age : 0) / HISTORY_HALF_LIFE_MS);
+        
+        if (records[i].result != EXIT_SUCCESS) {
+            continue;
+        }
+        
+        // Right after a launch, predict what followed it before; otherwise
+        // predict what sessions (launches after a long gap) opened with
+        if (following) {
+            if (&records[i] != last && strcmp(records[i].path, last->path) == 0) {
+                credit_followers(records, count, i, 0, weight, candidates, &candidate_count);
+            }
+        } else if (i == 0 || (long long)(records[i].time_ms - records[i - 1].time_ms) >= HISTORY_SESSION_GAP_MS) {
+            credit_followers(records, count, i, 1, weight, candidates, &candidate_count);
+        }
+    }
+    
+    qsort(candidates, candidate_count, sizeof(*candidates), compare_candidates);
+    return candidate_count;
+}
+
+/**
+ * @brief Check whether warming now would compete with other work
+ * @return Non-zero if the load and available memory allow warming
+ */
+static int system_idle(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long total = 0;
+    unsigned long long available = 0;
+    char line[128];
+    double load;
+    FILE *file;
+    
+    file = fopen("/proc/loadavg", "re");
+    if (file != NULL) {
+        int parsed = fscanf(file, "%lf", &load) == 1;
+        fclose(file);
+        if (parsed && load > HISTORY_IDLE_LOAD * (double)(cpus > 0 ? cpus : 1)) {
+            return 0;
+        }
+    }
+    
+    // Warming under memory pressure would only evict what is in use
+    file = fopen("/proc/meminfo", "re");
+    if (file != NULL) {
+        while (fgets(line, sizeof(line), file) != NULL) {
+            sscanf(line, "MemTotal: %llu", &total);
+            sscanf(line, "MemAvailable: %llu", &available);
+        }
+        fclose(file);
+        if (total > 0 && available < total / HISTORY_MIN_AVAILABLE) {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+/**
+ * @brief Validate a bundle and warm it into the page cache
+ * @param path Bundle path
+ */
+static void warm_bundle(const char *path) {
+    bundle_probe_t probe;
+    
+    if (prepare_application(&probe, path) == EXIT_SUCCESS) {
+        prefetch_warm(&probe);
+        log_message(LOG_INFO, "Prewarmed %s", path);
+    } else {
+        log_message(LOG_DEBUG, "Not prewarming %s: it does not validate", path);
+    }
+    bundle_probe_close(&probe);
+}
+
+/**
+ * @brief Check and note that a bundle is warmed now
+ * @param warmed Recently warmed bundles
+ * @param path Bundle path
+ * @param now_ms Current wall clock time in milliseconds
+ * @return Non-zero if the bundle was warmed within HISTORY_REWARM_MS
+ */
+static int warmed_recently(history_warmed_t *warmed, const char *path, long long now_ms) {
+    history_warmed_t *oldest = &warmed[0];
+    
+    for (unsigned int i = 0; i < HISTORY_MAX_CANDIDATES; i++) {
+        if (strcmp(warmed[i].path, path) == 0) {
+            if (now_ms - warmed[i].time_ms < HISTORY_REWARM_MS) {
+                return 1;
+            }
+            oldest = &warmed[i];
+            break;
+        }
+        if (warmed[i].time_ms < oldest->time_ms) {
+            oldest = &warmed[i];
+        }
+    }
+    
+    // Paths come from the history, so one that does not fit is never warmed
+    if ((size_t)snprintf(oldest->path, sizeof(oldest->path), "%s", path) >= sizeof(oldest->path)) {
+        oldest->path[0] = '\0';
+        return 1;
+    }
+    oldest->time_ms = now_ms;
+    return 0;
+}
+
+/**
+ * @brief Warm the bundles launch history predicts, until the process is stopped
+ * @return EXIT_SYSTEM_ERROR if there is no usable history; does not return otherwise
+ */
+int history_prewarm(void) {
+    static history_candidate_t candidates[HISTORY_MAX_CANDIDATES];
+    static history_warmed_t warmed[HISTORY_MAX_CANDIDATES];
+    history_header_t *header = history_map();
+    history_record_t *records;
+    uint64_t seen = UINT64_MAX;
+    
+    records = malloc(HISTORY_CAPACITY * sizeof(*records));
+    if (header == NULL || records == NULL) {
+        log_message(LOG_ERROR, "Cannot open the launch history");
+        free(records);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Warming is opportunistic and must never slow down what the user is doing
+    if (setpriority(PRIO_PROCESS, 0, 19) != 0 ||
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0)) != 0) {
+        log_message(LOG_DEBUG, "Cannot lower prewarm priority: %s", strerror(errno));
+    }
+    log_message(LOG_INFO, "Prewarming bundles from launch history");
+    
+    for (;;) {
+        uint64_t next = __atomic_load_n(&header->next, __ATOMIC_ACQUIRE);
+        
+        // Predictions are made once per new launch, as soon as the system is idle
+        if (next != seen && system_idle()) {
+            struct timespec now;
+            long long now_ms;
+            unsigned int count;
+            unsigned int warming = 0;
+            
+            clock_gettime(CLOCK_REALTIME, &now);
+            now_ms = (long long)now.tv_sec * 1000LL + now.tv_nsec / 1000000LL;
+            count = rank_candidates(records, snapshot_records(header, records), now_ms, candidates);
+            
+            for (unsigned int i = 0; i < count && warming < HISTORY_PREWARM_COUNT; i++) {
+                if (candidates[i].score < HISTORY_MIN_SCORE) {
+                    break;
+                }
+                warming++;
+                if (!warmed_recently(warmed, candidates[i].path, now_ms)) {
+                    log_message(LOG_DEBUG, "Predicted %s (score %.2f)", candidates[i].path, candidates[i].score);
+                    warm_bundle(candidates[i].path);
+                }
+            }
+            seen = next;
+        }
+        
+        log_flush();
+        poll(NULL, 0, HISTORY_POLL_MS);
+    }
+}
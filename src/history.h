@@ -0,0 +1,104 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file history.h
+ * @brief Launch history log and the prewarm scheduler that learns from it
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Every launch appends a fixed-size record (bundle path, wall time,
+ * latency, result) to a ring of HISTORY_CAPACITY records in a shared
+ * mapping under $XDG_CACHE_HOME/vlaunch/history. Writers claim a slot
+ * with an atomic counter and publish it by storing its sequence number
+ * last, so concurrent launchers never take a lock.
+ *
+ * --prewarm reads the ring at idle priority. After each launch it ranks
+ * the bundles that followed the launched one within HISTORY_FOLLOW_MS,
+ * weighting recent days higher; when the last launch is older than that,
+ * it ranks the bundles that opened sessions instead. The top few are
+ * validated and warmed into the page cache while the machine is idle.
+ */
+
+#ifndef VLAUNCH_HISTORY_H
+#define VLAUNCH_HISTORY_H
+
+#include <stdint.h>
+
+#include "launcher.h"
+
+/* History Configuration */
+#define HISTORY_CACHE_DIR       "history"
+#define HISTORY_FILE_NAME       "launches"
+#define HISTORY_MAGIC           0x48484c56u /* "VLHH" */
+#define HISTORY_VERSION         1
+#define HISTORY_CAPACITY        4096
+#define HISTORY_PATH_LENGTH     256
+
+/* Prewarm Configuration */
+#define HISTORY_POLL_MS         1000
+#define HISTORY_FOLLOW_MS       (10 * 60 * 1000LL)
+#define HISTORY_SESSION_GAP_MS  (30 * 60 * 1000LL)
+#define HISTORY_HALF_LIFE_MS    (7 * 24 * 60 * 60 * 1000LL)
+#define HISTORY_REWARM_MS       (5 * 60 * 1000LL)
+#define HISTORY_MAX_CANDIDATES  64
+#define HISTORY_PREWARM_COUNT   3
+#define HISTORY_MIN_SCORE       0.5
+#define HISTORY_IDLE_LOAD       0.5
+#define HISTORY_MIN_AVAILABLE   8 /* warm only while 1/8 of memory is available */
+
+/* Launch history file header */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t record_size;
+    uint64_t next;                      // Sequence number of the next launch
+} history_header_t;
+
+/* One recorded launch */
+typedef struct {
+    uint64_t sequence;                  // 1 + slot claim order; 0 while being written
+    uint64_t time_ms;                   // Wall clock when the launch started
+    uint64_t latency_ns;                // Start to exec (or failure)
+    int32_t result;                     // EXIT_* code of the launch
+    uint32_t reserved;
+    char path[HISTORY_PATH_LENGTH];     // Canonical bundle path
+} history_record_t;
+
+uint64_t history_record(const char *bundle_path, long long time_ms, int result, long long latency_ns);
+void history_amend(uint64_t entry, int result);
+int history_prewarm(void);
+
+#endif /* VLAUNCH_HISTORY_H */
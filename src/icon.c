@@ -0,0 +1,555 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file icon.c
+ * @brief Shared icon atlas builder
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Each run rewrites the whole atlas: icons of the listed bundles are
+ * rendered again unless their stat still matches the existing entry, and
+ * entries of other bundles are carried over while the bundle exists. The
+ * new atlas replaces the old one by rename, so readers holding a mapping
+ * keep a consistent view.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "png.h"
+#include "icon.h"
+
+/* Largest icon.png that is decoded */
+#define ICON_MAX_FILE_SIZE  (16 * 1024 * 1024)
+
+/* Sizes every icon is rendered at, smallest first */
+static const uint32_t icon_sizes[] = { 16, 24, 32, 48, 64, 128 };
+#define ICON_SIZE_COUNT     (sizeof(icon_sizes) / sizeof(icon_sizes[0]))
+
+/* An icon going into the new atlas */
+typedef struct {
+    char *path;
+    icon_atlas_entry_t entry;
+    uint8_t *bitmaps;
+} icon_build_entry_t;
+
+/* Growable list of icons */
+typedef struct {
+    icon_build_entry_t *entries;
+    size_t count;
+    size_t capacity;
+} icon_build_t;
+
+/**
+ * @brief Get the offset of one size in an icon's bitmap buffer
+ * @param index Size index; ICON_SIZE_COUNT gives the size of the whole buffer
+ * @return Byte offset
+ */
+static size_t bitmap_offset(size_t index) {
+    size_t offset = 0;
+    
+    for (size_t i = 0; i < index; i++) {
+        offset += (size_t)icon_sizes[i] * icon_sizes[i] * 4;
+    }
+    return offset;
+}
+
+/**
+ * @brief Find an icon in the build list
+ * @param build Icon list
+ * @param path Canonical bundle path
+ * @return 1 if the bundle is already listed, 0 otherwise
+ */
+static int build_contains(const icon_build_t *build, const char *path) {
+    for (size_t i = 0; i < build->count; i++) {
+        if (strcmp(build->entries[i].path, path) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Add an icon to the build list, taking ownership of its bitmaps
+ * @param build Icon list
+ * @param path Canonical bundle path
+ * @param entry Dimensions and source stat
+ * @param bitmaps Bitmaps of all sizes
+ * @return 0 on success, -1 on allocation failure
+ */
+static int build_add(icon_build_t *build, const char *path, const icon_atlas_entry_t *entry, uint8_t *bitmaps) {
+    if (build->count == build->capacity) {
+        size_t capacity = build->capacity ? build->capacity * 2 : 32;
+        icon_build_entry_t *grown = realloc(build->entries, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        build->entries = grown;
+        build->capacity = capacity;
+    }
+    
+    build->entries[build->count].path = strdup(path);
+    if (build->entries[build->count].path == NULL) {
+        return -1;
+    }
+    build->entries[build->count].entry = *entry;
+    build->entries[build->count].bitmaps = bitmaps;
+    build->count++;
+    return 0;
+}
+
+/**
+ * @brief Release an icon list
+ * @param build Icon list
+ */
+static void build_free(icon_build_t *build) {
+    for (size_t i = 0; i < build->count; i++) {
+        free(build->entries[i].path);
+        free(build->entries[i].bitmaps);
+    }
+    free(build->entries);
+}
+
+/**
+ * @brief Order icons by path
+ * @param a First entry
+ * @param b Second entry
+ * @return Comparison result for qsort()
+ */
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const icon_build_entry_t *)a)->path, ((const icon_build_entry_t *)b)->path);
+}
+
+/**
+ * @brief Render an image into a square premultiplied bitmap
+ * @param image Decoded icon, straight alpha
+ * @param side Width and height of the bitmap
+ * @param out Receives side * side RGBA pixels
+ * @return 0 on success, -1 on allocation failure
+ *
+ * Box filter over the covered source area, which is exact for integer
+ * downscales and degrades to pixel replication when enlarging.
+ */
+static int render_size(const png_image_t *image, uint32_t side, uint8_t *out) {
+    uint32_t width = image->width;
+    uint32_t height = image->height;
+    uint32_t fit_width = side;
+    uint32_t fit_height = side;
+    double scale_x;
+    double scale_y;
+    float *rows;
+    
+    // Keep the aspect ratio and centre the icon
+    if (width > height) {
+        fit_height = (uint32_t)(((uint64_t)height * side + width / 2) / width);
+        fit_height = fit_height ? fit_height : 1;
+    } else if (height > width) {
+        fit_width = (uint32_t)(((uint64_t)width * side + height / 2) / height);
+        fit_width = fit_width ? fit_width : 1;
+    }
+    scale_x = (double)width / fit_width;
+    scale_y = (double)height / fit_height;
+    
+    rows = malloc((size_t)height * fit_width * 4 * sizeof(float));
+    if (rows == NULL) {
+        return -1;
+    }
+    
+    // Horizontal pass, premultiplying while sampling
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *source = image->pixels + (size_t)y * width * 4;
+        
+        for (uint32_t dx = 0; dx < fit_width; dx++) {
+            double start = dx * scale_x;
+            double end = start + scale_x;
+            float sum[4] = { 0, 0, 0, 0 };
+            
+            for (uint32_t sx = (uint32_t)start; sx < width && sx < end; sx++) {
+                const uint8_t *pixel = source + (size_t)sx * 4;
+                double weight = (end < sx + 1 ? end : sx + 1) - (start > sx ? start : sx);
+                float alpha = (float)(weight * pixel[3] / 255.0);
+                
+                sum[0] += alpha * pixel[0] / 255.0f;
+                sum[1] += alpha * pixel[1] / 255.0f;
+                sum[2] += alpha * pixel[2] / 255.0f;
+                sum[3] += alpha;
+            }
+            for (size_t c = 0; c < 4; c++) {
+                rows[((size_t)y * fit_width + dx) * 4 + c] = (float)(sum[c] / scale_x);
+            }
+        }
+    }
+    
+    // Vertical pass into the centred square
+    memset(out, 0, (size_t)side * side * 4);
+    for (uint32_t dy = 0; dy < fit_height; dy++) {
+        double start = dy * scale_y;
+        double end = start + scale_y;
+        uint8_t *target = out + ((size_t)(dy + (side - fit_height) / 2) * side + (side - fit_width) / 2) * 4;
+        
+        for (uint32_t dx = 0; dx < fit_width; dx++) {
+            float sum[4] = { 0, 0, 0, 0 };
+            
+            for (uint32_t sy = (uint32_t)start; sy < height && sy < end; sy++) {
+                const float *sample = rows + ((size_t)sy * fit_width + dx) * 4;
+                float weight = (float)((end < sy + 1 ? end : sy + 1) - (start > sy ? start : sy));
+                
+                for (int c = 0; c < 4; c++) {
+                    sum[c] += weight * sample[c];
+                }
+            }
+            for (uint32_t c = 0; c < 4; c++) {
+                float value = (float)(sum[c] / scale_y) * 255.0f + 0.5f;
+                target[dx * 4 + c] = (uint8_t)(value > 255.0f ? 255.0f : value);
+            }
+        }
+    }
+    
+    free(rows);
+    return 0;
+}
+
+/**
+ * @brief Decode a bundle's icon.png and render it at every atlas size
+ * @param probe Opened bundle probe with an icon
+ * @param entry Receives the image dimensions
+ * @return Bitmaps of all sizes, or NULL on failure
+ */
+static uint8_t *render_icon(const bundle_probe_t *probe, icon_atlas_entry_t *entry) {
+    png_image_t image;
+    uint8_t *data;
+    uint8_t *bitmaps = NULL;
+    struct stat st;
+    size_t done = 0;
+    int fd;
+    
+    fd = openat(probe->dirfd, bundle_component_paths[COMPONENT_ICON], O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > ICON_MAX_FILE_SIZE ||
+        (data = malloc((size_t)st.st_size)) == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    while (done < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + done, (size_t)st.st_size - done);
+        if (n <= 0) {
+            break;
+        }
+        done += (size_t)n;
+    }
+    close(fd);
+    
+    if (done != (size_t)st.st_size || png_decode(data, done, &image) != 0) {
+        free(data);
+        return NULL;
+    }
+    free(data);
+    
+    bitmaps = malloc(bitmap_offset(ICON_SIZE_COUNT));
+    for (size_t i = 0; bitmaps && i < ICON_SIZE_COUNT; i++) {
+        if (render_size(&image, icon_sizes[i], bitmaps + bitmap_offset(i)) != 0) {
+            free(bitmaps);
+            bitmaps = NULL;
+        }
+    }
+    
+    entry->width = image.width;
+    entry->height = image.height;
+    png_image_free(&image);
+    return bitmaps;
+}
+
+/**
+ * @brief Copy an icon's bitmaps out of the previous atlas
+ * @param map Previous atlas, rendered at the same sizes
+ * @param entry Entry in the previous atlas
+ * @return Bitmaps of all sizes, or NULL on allocation failure
+ */
+static uint8_t *copy_icon(const void *map, const icon_atlas_entry_t *entry) {
+    uint8_t *bitmaps = malloc(bitmap_offset(ICON_SIZE_COUNT));
+    
+    for (size_t i = 0; bitmaps && i < ICON_SIZE_COUNT; i++) {
+        memcpy(bitmaps + bitmap_offset(i), icon_atlas_bitmap(map, entry, icon_sizes[i], NULL),
+               (size_t)icon_sizes[i] * icon_sizes[i] * 4);
+    }
+    return bitmaps;
+}
+
+/**
+ * @brief Map the previous atlas if it was rendered at the current sizes
+ * @param path Atlas path
+ * @param size Receives the mapping size
+ * @return Mapping, or NULL if there is no usable atlas
+ */
+static void *map_atlas(const char *path, size_t *size) {
+    const icon_atlas_header_t *header;
+    struct stat st;
+    void *map;
+    int fd;
+    
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+        (map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    
+    header = map;
+    if (!icon_atlas_valid(map, (size_t)st.st_size) || header->size_count != ICON_SIZE_COUNT ||
+        memcmp(header->sizes, icon_sizes, sizeof(icon_sizes)) != 0) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return map;
+}
+
+/**
+ * @brief Write the atlas atomically
+ * @param path Atlas path
+ * @param build Sorted icon list
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int write_atlas(const char *path, const icon_build_t *build) {
+    char temp_path[MAX_PATH_LENGTH + 16];
+    icon_atlas_header_t header;
+    icon_atlas_entry_t *entries;
+    char *strings;
+    size_t strings_size = 0;
+    size_t used = 0;
+    uint64_t offset;
+    int failed;
+    int fd;
+    
+    for (size_t i = 0; i < build->count; i++) {
+        strings_size += strlen(build->entries[i].path) + 1;
+    }
+    if (strings_size > UINT32_MAX || build->count > UINT32_MAX / sizeof(*entries)) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    entries = calloc(build->count ? build->count : 1, sizeof(*entries));
+    strings = malloc(strings_size ? strings_size : 1);
+    if (!entries || !strings) {
+        free(entries);
+        free(strings);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = ICON_ATLAS_MAGIC;
+    header.version = ICON_ATLAS_VERSION;
+    header.entry_count = (uint32_t)build->count;
+    header.size_count = ICON_SIZE_COUNT;
+    header.strings_offset = (uint32_t)(sizeof(header) + build->count * sizeof(*entries));
+    header.strings_size = (uint32_t)strings_size;
+    for (size_t i = 0; i < build->count; i++) {
+        size_t length = strlen(build->entries[i].path);
+        
+        entries[i] = build->entries[i].entry;
+        entries[i].path_offset = (uint32_t)used;
+        entries[i].path_length = (uint32_t)length;
+        memcpy(strings + used, build->entries[i].path, length + 1);
+        used += length + 1;
+    }
+    
+    // One page-aligned section per size
+    offset = header.strings_offset + strings_size;
+    for (size_t i = 0; i < ICON_SIZE_COUNT; i++) {
+        offset = (offset + 4095) & ~(uint64_t)4095;
+        header.sizes[i] = icon_sizes[i];
+        header.section_offset[i] = offset;
+        offset += (uint64_t)build->count * icon_sizes[i] * icon_sizes[i] * 4;
+    }
+    header.size = offset;
+    
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long)getpid());
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(entries);
+        free(strings);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    failed = ftruncate(fd, (off_t)header.size) != 0 ||
+             pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+             pwrite(fd, entries, build->count * sizeof(*entries), sizeof(header)) != (ssize_t)(build->count * sizeof(*entries)) ||
+             pwrite(fd, strings, strings_size, header.strings_offset) != (ssize_t)strings_size;
+    for (size_t i = 0; !failed && i < ICON_SIZE_COUNT; i++) {
+        size_t bytes = (size_t)icon_sizes[i] * icon_sizes[i] * 4;
+        
+        for (size_t j = 0; !failed && j < build->count; j++) {
+            failed = pwrite(fd, build->entries[j].bitmaps + bitmap_offset(i), bytes,
+                            (off_t)(header.section_offset[i] + j * bytes)) != (ssize_t)bytes;
+        }
+    }
+    
+    free(entries);
+    free(strings);
+    if (close(fd) == 0 && !failed && rename(temp_path, path) == 0) {
+        return EXIT_SUCCESS;
+    }
+    unlink(temp_path);
+    return EXIT_SYSTEM_ERROR;
+}
+
+/**
+ * @brief Render the icons of bundles into the shared atlas
+ * @param bundle_paths Bundles to (re)index
+ * @param count Number of bundles
+ * @return EXIT_SUCCESS on success, EXIT_BUNDLE_ERROR if a bundle or its icon
+ *         could not be read, EXIT_SYSTEM_ERROR if the atlas cannot be written
+ */
+int icon_index(char *const *bundle_paths, unsigned int count) {
+    char atlas_path[MAX_PATH_LENGTH];
+    char canonical[MAX_PATH_LENGTH];
+    icon_build_t build = { NULL, 0, 0 };
+    icon_build_t seen = { NULL, 0, 0 };
+    unsigned int rendered = 0;
+    size_t map_size = 0;
+    void *map;
+    int result = EXIT_SUCCESS;
+    
+    if (cache_directory(NULL, atlas_path, sizeof(atlas_path)) != EXIT_SUCCESS ||
+        strlen(atlas_path) + sizeof(ICON_ATLAS_FILE) + 1 > sizeof(atlas_path)) {
+        log_message(LOG_ERROR, "Cannot locate the launcher cache directory");
+        return EXIT_SYSTEM_ERROR;
+    }
+    strcat(atlas_path, "/" ICON_ATLAS_FILE);
+    map = map_atlas(atlas_path, &map_size);
+    
+    for (unsigned int i = 0; i < count; i++) {
+        const struct statx *icon;
+        const icon_atlas_entry_t *previous;
+        icon_atlas_entry_t entry;
+        bundle_probe_t probe;
+        uint8_t *bitmaps;
+        
+        memset(&entry, 0, sizeof(entry));
+        if (!realpath(bundle_paths[i], canonical) || bundle_probe_open(&probe, canonical) != EXIT_SUCCESS) {
+            log_message(LOG_ERROR, "Cannot open bundle: %s", bundle_paths[i]);
+            result = EXIT_BUNDLE_ERROR;
+            continue;
+        }
+        if (build_contains(&seen, canonical) || build_add(&seen, canonical, &entry, NULL) != 0 ||
+            !bundle_probe_is_file(&probe, COMPONENT_ICON)) {
+            log_message(LOG_DEBUG, "No icon to index for %s", canonical);
+            bundle_probe_close(&probe);
+            continue;
+        }
+        
+        icon = &probe.components[COMPONENT_ICON];
+        entry.mtime_sec = icon->stx_mtime.tv_sec;
+        entry.mtime_nsec = icon->stx_mtime.tv_nsec;
+        entry.ino = icon->stx_ino;
+        entry.file_size = icon->stx_size;
+        
+        // Unchanged icons are copied, not decoded again
+        previous = map ? icon_atlas_find(map, canonical) : NULL;
+        if (previous && previous->mtime_sec == entry.mtime_sec && previous->mtime_nsec == entry.mtime_nsec &&
+            previous->ino == entry.ino && previous->file_size == entry.file_size) {
+            entry.width = previous->width;
+            entry.height = previous->height;
+            bitmaps = copy_icon(map, previous);
+        } else {
+            bitmaps = render_icon(&probe, &entry);
+            if (bitmaps == NULL) {
+                log_message(LOG_ERROR, "Cannot decode icon of %s", canonical);
+                result = EXIT_BUNDLE_ERROR;
+            }
+            rendered += bitmaps != NULL;
+        }
+        bundle_probe_close(&probe);
+        
+        if (bitmaps && build_add(&build, canonical, &entry, bitmaps) != 0) {
+            free(bitmaps);
+            result = EXIT_SYSTEM_ERROR;
+        }
+    }
+    
+    // Keep other bundles' icons for as long as the bundle exists; listed ones were just decided
+    if (map) {
+        const icon_atlas_header_t *header = map;
+        const char *strings = (const char *)map + header->strings_offset;
+        
+        for (uint32_t i = 0; i < header->entry_count; i++) {
+            const icon_atlas_entry_t *previous = &icon_atlas_entries(map)[i];
+            uint8_t *bitmaps;
+            
+            if (previous->path_length >= sizeof(canonical) ||
+                previous->path_offset > header->strings_size ||
+                previous->path_length > header->strings_size - previous->path_offset) {
+                continue;
+            }
+            memcpy(canonical, strings + previous->path_offset, previous->path_length);
+            canonical[previous->path_length] = '\0';
+            if (build_contains(&seen, canonical) || access(canonical, F_OK) != 0) {
+                continue;
+            }
+            bitmaps = copy_icon(map, previous);
+            if (bitmaps && build_add(&build, canonical, previous, bitmaps) != 0) {
+                free(bitmaps);
+            }
+        }
+        munmap(map, map_size);
+    }
+    
+    qsort(build.entries, build.count, sizeof(*build.entries), compare_entries);
+    if (write_atlas(atlas_path, &build) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "Cannot write icon atlas %s: %s", atlas_path, strerror(errno));
+        result = EXIT_SYSTEM_ERROR;
+    } else {
+        log_message(LOG_INFO, "Icon atlas %s: %zu icons, %u rendered", atlas_path, build.count, rendered);
+    }
+    
+    build_free(&build);
+    build_free(&seen);
+    return result;
+}
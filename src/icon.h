@@ -0,0 +1,223 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file icon.h
+ * @brief Shared icon atlas
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * launcher --index decodes each bundle's icon.png once and renders it at
+ * a fixed set of sizes into $XDG_CACHE_HOME/vlaunch/icons.atlas. Bitmaps
+ * are premultiplied RGBA, square, with the icon centred and its aspect
+ * ratio kept. All bitmaps of one size form a contiguous section, so a
+ * shell drawing an app grid touches one run of pages and copies each
+ * icon straight out of the mapping.
+ *
+ * Entries are keyed by canonical bundle path and carry the stat of the
+ * icon they were rendered from; the shell compares that with its own
+ * stat of icon.png and re-runs --index for bundles that changed. Like
+ * resource.h, this header is usable on its own with ICON_FORMAT_ONLY.
+ */
+
+#ifndef VLAUNCH_ICON_H
+#define VLAUNCH_ICON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Atlas Format */
+#define ICON_ATLAS_MAGIC    0x41494c56u /* "VLIA" */
+#define ICON_ATLAS_VERSION  1
+#define ICON_ATLAS_FILE     "icons.atlas"
+#define ICON_MAX_SIZES      8
+#define ICON_MAX_PIXELS     512
+
+/* Atlas header; entries and the path table follow, bitmaps start at section_offset */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t size_count;
+    uint32_t sizes[ICON_MAX_SIZES];
+    uint64_t section_offset[ICON_MAX_SIZES];
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint64_t size;
+} icon_atlas_header_t;
+
+/* One bundle, sorted by path; the stat fields describe the source icon.png */
+typedef struct {
+    uint32_t path_offset;
+    uint32_t path_length;
+    uint32_t width;
+    uint32_t height;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t ino;
+    uint64_t file_size;
+} icon_atlas_entry_t;
+
+/**
+ * @brief Get the entry table of an atlas
+ * @param map Start of the mapped atlas
+ * @return First entry
+ */
+static inline const icon_atlas_entry_t *icon_atlas_entries(const void *map) {
+    return (const icon_atlas_entry_t *)((const icon_atlas_header_t *)map + 1);
+}
+
+/**
+ * @brief Check that a mapped atlas is structurally sound
+ * @param map Start of the mapped atlas
+ * @param size Size of the mapping
+ * @return 1 if the atlas can be used, 0 otherwise
+ */
+static inline int icon_atlas_valid(const void *map, size_t size) {
+    const icon_atlas_header_t *header = map;
+    
+    if (size < sizeof(*header) || header->magic != ICON_ATLAS_MAGIC || header->version != ICON_ATLAS_VERSION ||
+        header->size != size || header->size_count == 0 || header->size_count > ICON_MAX_SIZES ||
+        (size - sizeof(*header)) / sizeof(icon_atlas_entry_t) < header->entry_count ||
+        header->strings_offset > size || header->strings_size > size - header->strings_offset) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < header->size_count; i++) {
+        uint64_t pixels = header->sizes[i];
+        
+        if (pixels == 0 || pixels > ICON_MAX_PIXELS || header->section_offset[i] > size ||
+            (size - header->section_offset[i]) / (pixels * pixels * 4) < header->entry_count) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Find the entry of a bundle
+ * @param map Start of a validated atlas mapping
+ * @param path Canonical absolute bundle path
+ * @return Entry, or NULL if the bundle has no icon in the atlas
+ */
+static inline const icon_atlas_entry_t *icon_atlas_find(const void *map, const char *path) {
+    const icon_atlas_header_t *header = map;
+    const icon_atlas_entry_t *entries = icon_atlas_entries(map);
+    const char *strings = (const char *)map + header->strings_offset;
+    size_t length = strlen(path);
+    uint32_t low = 0;
+    uint32_t high = header->entry_count;
+    
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const icon_atlas_entry_t *entry = &entries[mid];
+        int cmp;
+        
+        if (entry->path_offset > header->strings_size ||
+            entry->path_length > header->strings_size - entry->path_offset) {
+            return NULL;
+        }
+        
+        cmp = memcmp(path, strings + entry->path_offset,
+                     length < entry->path_length ? length : entry->path_length);
+        if (cmp == 0 && length != entry->path_length) {
+            cmp = length < entry->path_length ? -1 : 1;
+        }
+        if (cmp == 0) {
+            return entry;
+        }
+        if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Get the bitmap of an entry closest to a requested size
+ * @param map Start of a validated atlas mapping
+ * @param entry Entry returned by icon_atlas_find()
+ * @param pixels Requested width and height
+ * @param actual Receives the width and height of the returned bitmap; may be NULL
+ * @return Premultiplied RGBA bitmap: the smallest size not below the request,
+ *         or the largest size if the request exceeds all of them
+ */
+static inline const uint8_t *icon_atlas_bitmap(const void *map, const icon_atlas_entry_t *entry,
+                                               uint32_t pixels, uint32_t *actual) {
+    const icon_atlas_header_t *header = map;
+    uint32_t chosen = 0;
+    int fits = 0;
+    uint64_t side;
+    
+    for (uint32_t i = 0; i < header->size_count; i++) {
+        if (header->sizes[i] >= pixels && (!fits || header->sizes[i] < header->sizes[chosen])) {
+            chosen = i;
+            fits = 1;
+        }
+    }
+    for (uint32_t i = 0; !fits && i < header->size_count; i++) {
+        if (header->sizes[i] > header->sizes[chosen]) {
+            chosen = i;
+        }
+    }
+    
+    side = header->sizes[chosen];
+    if (actual) {
+        *actual = (uint32_t)side;
+    }
+    return (const uint8_t *)map + header->section_offset[chosen] +
+           (uint64_t)(entry - icon_atlas_entries(map)) * side * side * 4;
+}
+
+/**
+ * @brief Check whether an entry was rendered from the current icon.png
+ * @param entry Atlas entry
+ * @param icon stat() result of the bundle's icon.png
+ * @return 1 if the entry is current, 0 otherwise
+ */
+static inline int icon_atlas_entry_current(const icon_atlas_entry_t *entry, const struct stat *icon) {
+    return entry->mtime_sec == (int64_t)icon->st_mtim.tv_sec &&
+           entry->mtime_nsec == (int64_t)icon->st_mtim.tv_nsec &&
+           entry->ino == (uint64_t)icon->st_ino &&
+           entry->file_size == (uint64_t)icon->st_size;
+}
+
+#ifndef ICON_FORMAT_ONLY
+int icon_index(char *const *bundle_paths, unsigned int count);
+#endif
+
+#endif /* VLAUNCH_ICON_H */
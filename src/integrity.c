@@ -0,0 +1,823 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file integrity.c
+ * @brief Bundle integrity verification against a digest manifest
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Verification stats every listed file and every file the bundle has
+ * below library/, then hashes only those the cache does not vouch for,
+ * spread over up to INTEGRITY_THREADS threads. The executable must be
+ * the file the probe pinned, since that is the one exec'd; libraries
+ * are opened by the dynamic loader later, by path.
+ *
+ * A manifest is only trusted if neither it nor the bundle directory is
+ * writable by anyone but its owner, and that owner is root or the user
+ * launching the bundle.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fsverity.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "sha256.h"
+#include "integrity.h"
+
+/* One file listed in the digest manifest */
+typedef struct {
+    const char *path;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    int verity;
+    int result;
+    component_state_t state;
+} integrity_entry_t;
+
+/* A parsed manifest and the hashing work shared by the threads */
+typedef struct {
+    int dirfd;
+    char *text;
+    integrity_entry_t *entries;
+    unsigned int count;
+    unsigned int *pending;
+    unsigned int pending_count;
+    unsigned int next;
+} integrity_set_t;
+
+/* Paths found in a bundle, for sealing */
+typedef struct {
+    char **paths;
+    unsigned int count;
+} integrity_list_t;
+
+/* Cache entry header, followed by the bundle path and the records */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t path_length;
+    uint32_t count;
+} integrity_header_t;
+
+/* A file that matched a digest, as it was when it matched */
+typedef struct {
+    component_state_t state;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t verity;
+    uint32_t reserved;
+} integrity_record_t;
+
+/* Called for each file below a directory; non-zero stops the walk */
+typedef int (*integrity_visit_t)(void *context, const char *path);
+
+static int integrity_required;
+static int integrity_cache_enabled = 1;
+
+/**
+ * @brief Require every launched bundle to carry a digest manifest
+ * @param required Non-zero to refuse bundles without one
+ */
+void integrity_set_required(int required) {
+    integrity_required = required;
+}
+
+/**
+ * @brief Enable or disable the cache of verified files
+ * @param enabled Non-zero to skip rehashing files verified before
+ */
+void integrity_cache_set_enabled(int enabled) {
+    integrity_cache_enabled = enabled;
+}
+
+/**
+ * @brief Parse a hex digest
+ * @param hex Exactly SHA256_DIGEST_SIZE * 2 hex digits
+ * @param digest Receives the digest
+ * @return 0 on success, -1 if hex is not a digest
+ */
+static int parse_digest(const char *hex, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    for (int i = 0; i < SHA256_DIGEST_SIZE * 2; i++) {
+        char c = hex[i];
+        int value = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                    c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        
+        if (value < 0) {
+            return -1;
+        }
+        digest[i / 2] = (uint8_t)(i % 2 ? (digest[i / 2] << 4) | value : value);
+    }
+    return 0;
+}
+
+/**
+ * @brief Check that a listed path is a plain path inside the bundle
+ * @param path Path relative to the bundle root
+ * @return Non-zero if usable
+ */
+static int path_valid(const char *path) {
+    const char *component = path;
+    
+    if (path[0] == '\0' || path[0] == '/') {
+        return 0;
+    }
+    while (component != NULL) {
+        const char *end = strchr(component, '/');
+        size_t length = end ? (size_t)(end - component) : strlen(component);
+        
+        if (length == 0 || (length == 1 && component[0] == '.') ||
+            (length == 2 && component[0] == '.' && component[1] == '.')) {
+            return 0;
+        }
+        component = end ? end + 1 : NULL;
+    }
+    return 1;
+}
+
+/**
+ * @brief Order manifest entries by path
+ * @param a First entry
+ * @param b Second entry
+ * @return strcmp() order of the paths
+ */
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const integrity_entry_t *)a)->path, ((const integrity_entry_t *)b)->path);
+}
+
+/**
+ * @brief Order strings
+ * @param a Pointer to the first string
+ * @param b Pointer to the second string
+ * @return strcmp() order
+ */
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Order cache records by file identity
+ * @param a First record
+ * @param b Second record
+ * @return Order of device, then inode
+ */
+static int compare_records(const void *a, const void *b) {
+    const component_state_t *x = &((const integrity_record_t *)a)->state;
+    const component_state_t *y = &((const integrity_record_t *)b)->state;
+    
+    if (x->dev != y->dev) {
+        return x->dev < y->dev ? -1 : 1;
+    }
+    return x->ino < y->ino ? -1 : x->ino > y->ino;
+}
+
+/**
+ * @brief Release a parsed manifest
+ * @param set Manifest to release
+ */
+static void integrity_set_free(integrity_set_t *set) {
+    free(set->text);
+    free(set->entries);
+    free(set->pending);
+    memset(set, 0, sizeof(*set));
+}
+
+/**
+ * @brief Check that only root or the launching user could have written a file
+ * @param st Status of the file
+ * @return 1 if it is owned by either and writable by its owner only, 0 otherwise
+ */
+static int owner_only(const struct stat *st) {
+    return (st->st_uid == 0 || st->st_uid == geteuid()) && (st->st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+/**
+ * @brief Read and parse the digest manifest of a bundle
+ * @param dirfd Bundle root directory descriptor
+ * @param set Receives the entries, sorted by path
+ * @param missing Set to 1 if the bundle has no manifest
+ * @return EXIT_SUCCESS on success or if missing, error code on failure
+ */
+static int load_manifest(int dirfd, integrity_set_t *set, int *missing) {
+    struct stat st;
+    struct stat dir;
+    unsigned int lines = 0;
+    unsigned int number = 0;
+    char *cursor;
+    ssize_t got;
+    int fd;
+    
+    memset(set, 0, sizeof(*set));
+    set->dirfd = dirfd;
+    *missing = 0;
+    
+    fd = openat(dirfd, INTEGRITY_FILE_NAME, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        *missing = errno == ENOENT;
+        if (!*missing) {
+            log_message(LOG_ERROR, "Cannot read %s: %s", INTEGRITY_FILE_NAME, strerror(errno));
+        }
+        return *missing ? EXIT_SUCCESS : EXIT_BUNDLE_ERROR;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > INTEGRITY_MAX_SIZE) {
+        log_message(LOG_ERROR, "%s is not a regular file of at most %d bytes", INTEGRITY_FILE_NAME, INTEGRITY_MAX_SIZE);
+        close(fd);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    // Another manifest could be renamed in through a directory others can write
+    if (!owner_only(&st) || fstat(dirfd, &dir) != 0 || !owner_only(&dir)) {
+        log_message(LOG_ERROR, "%s and its bundle must be owned by root or the launching user and writable only by the owner",
+                    INTEGRITY_FILE_NAME);
+        close(fd);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    set->text = malloc((size_t)st.st_size + 1);
+    if (set->text == NULL) {
+        close(fd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    got = read(fd, set->text, (size_t)st.st_size);
+    close(fd);
+    if (got != (ssize_t)st.st_size) {
+        log_message(LOG_ERROR, "Cannot read %s: %s", INTEGRITY_FILE_NAME, got < 0 ? strerror(errno) : "short read");
+        integrity_set_free(set);
+        return EXIT_BUNDLE_ERROR;
+    }
+    set->text[got] = '\0';
+    
+    for (const char *p = set->text; *p; p++) {
+        lines += *p == '\n';
+    }
+    set->entries = calloc(lines + 1, sizeof(*set->entries));
+    if (set->entries == NULL) {
+        integrity_set_free(set);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Lines are "<hex>  <path>" as sha256sum writes them, or with the verity prefix
+    for (cursor = set->text; *cursor; ) {
+        char *line = cursor;
+        char *end = strchr(line, '\n');
+        integrity_entry_t *entry = &set->entries[set->count];
+        const char *hex = line;
+        
+        cursor = end ? end + 1 : line + strlen(line);
+        if (end) {
+            *end = '\0';
+        }
+        number++;
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        
+        if (strncmp(hex, INTEGRITY_VERITY_PREFIX, strlen(INTEGRITY_VERITY_PREFIX)) == 0) {
+            hex += strlen(INTEGRITY_VERITY_PREFIX);
+            entry->verity = 1;
+        }
+        if (strlen(hex) < SHA256_DIGEST_SIZE * 2 + 2 || parse_digest(hex, entry->digest) != 0 ||
+            hex[SHA256_DIGEST_SIZE * 2] != ' ' || (hex[SHA256_DIGEST_SIZE * 2 + 1] != ' ' && hex[SHA256_DIGEST_SIZE * 2 + 1] != '*') ||
+            !path_valid(hex + SHA256_DIGEST_SIZE * 2 + 2) || set->count >= INTEGRITY_MAX_FILES) {
+            log_message(LOG_ERROR, "%s:%u: malformed digest line", INTEGRITY_FILE_NAME, number);
+            integrity_set_free(set);
+            return EXIT_BUNDLE_ERROR;
+        }
+        entry->path = hex + SHA256_DIGEST_SIZE * 2 + 2;
+        set->count++;
+    }
+    
+    qsort(set->entries, set->count, sizeof(*set->entries), compare_entries);
+    for (unsigned int i = 1; i < set->count; i++) {
+        if (strcmp(set->entries[i - 1].path, set->entries[i].path) == 0) {
+            log_message(LOG_ERROR, "%s lists %s twice", INTEGRITY_FILE_NAME, set->entries[i].path);
+            integrity_set_free(set);
+            return EXIT_BUNDLE_ERROR;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Visit every file below a bundle directory
+ * @param dirfd Bundle root directory descriptor
+ * @param path Directory relative to the root
+ * @param depth Current recursion depth
+ * @param visit Called with the path of each non-directory
+ * @param context Passed to visit
+ * @return 0 on success, the non-zero result of visit, or -1 if too deep
+ */
+static int walk_directory(int dirfd, const char *path, unsigned int depth, integrity_visit_t visit, void *context) {
+    char child[MAX_PATH_LENGTH];
+    struct dirent *entry;
+    DIR *dir;
+    int result = 0;
+    int fd;
+    
+    if (depth > INTEGRITY_MAX_DEPTH) {
+        log_message(LOG_ERROR, "%s nests deeper than %d directories", path, INTEGRITY_MAX_DEPTH);
+        return -1;
+    }
+    fd = openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (dir == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return errno == ENOENT ? 0 : -1;
+    }
+    
+    while (result == 0 && (entry = readdir(dir)) != NULL) {
+        unsigned char type = entry->d_type;
+        struct stat st;
+        
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if ((size_t)snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= sizeof(child)) {
+            result = -1;
+            break;
+        }
+        if (type == DT_UNKNOWN) {
+            type = fstatat(dirfd, child, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+        }
+        
+        // Symbolic links are checked as the file they lead to, as the loader opens them
+        result = type == DT_DIR ? walk_directory(dirfd, child, depth + 1, visit, context) : visit(context, child);
+    }
+    closedir(dir);
+    return result;
+}
+
+/**
+ * @brief Find the manifest entry of a path
+ * @param set Parsed manifest
+ * @param path Path relative to the bundle root
+ * @return Entry, or NULL if the path is not listed
+ */
+static integrity_entry_t *find_entry(integrity_set_t *set, const char *path) {
+    integrity_entry_t key;
+    
+    key.path = path;
+    return bsearch(&key, set->entries, set->count, sizeof(*set->entries), compare_entries);
+}
+
+/**
+ * @brief Reject a bundle file the manifest does not list
+ * @param context integrity_set_t
+ * @param path Path relative to the bundle root
+ * @return 0 if listed, -1 otherwise
+ */
+static int require_listed(void *context, const char *path) {
+    if (find_entry(context, path) == NULL) {
+        log_message(LOG_ERROR, "Integrity check failed: %s is not listed in %s", path, INTEGRITY_FILE_NAME);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Compute the digest of a file the way its manifest entry records it
+ * @param fd Open file
+ * @param verity Non-zero for the fs-verity digest, zero for the content digest
+ * @param digest Receives the digest
+ * @return 0 on success, -1 with errno set if the file cannot be measured
+ */
+static int measure_file(int fd, int verity, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    union {
+        struct fsverity_digest header;
+        uint8_t storage[sizeof(struct fsverity_digest) + 64];
+    } measured;
+    
+    if (!verity) {
+        return sha256_fd(fd, digest);
+    }
+    
+    // The kernel checks every page it reads against this Merkle tree root
+    memset(&measured, 0, sizeof(measured));
+    measured.header.digest_size = sizeof(measured.storage) - sizeof(measured.header);
+    if (ioctl(fd, FS_IOC_MEASURE_VERITY, &measured) != 0) {
+        return -1;
+    }
+    if (measured.header.digest_algorithm != FS_VERITY_HASH_ALG_SHA256 ||
+        measured.header.digest_size != SHA256_DIGEST_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(digest, measured.header.digest, SHA256_DIGEST_SIZE);
+    return 0;
+}
+
+/**
+ * @brief Hash one listed file and compare it with its digest
+ * @param set Parsed manifest
+ * @param entry Entry to verify; receives the result and the state that was hashed
+ */
+static void verify_entry(integrity_set_t *set, integrity_entry_t *entry) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    struct statx stx;
+    int fd;
+    
+    fd = openat(set->dirfd, entry->path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0 || statx(fd, "", AT_EMPTY_PATH, STATX_BASIC_STATS, &stx) != 0 ||
+        measure_file(fd, entry->verity, digest) != 0) {
+        log_message(LOG_ERROR, "Integrity check failed: cannot measure %s: %s", entry->path, strerror(errno));
+        entry->result = -1;
+    } else if (memcmp(digest, entry->digest, sizeof(digest)) != 0) {
+        log_message(LOG_ERROR, "Integrity check failed: %s does not match its digest", entry->path);
+        entry->result = -1;
+    } else {
+        component_state_take(&stx, &entry->state);
+        entry->result = 1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Hashing threads take files off the shared list until it is empty
+ * @param arg Shared integrity_set_t
+ * @return Always NULL
+ */
+static void *integrity_worker(void *arg) {
+    integrity_set_t *set = arg;
+    unsigned int index;
+    
+    while ((index = __atomic_fetch_add(&set->next, 1, __ATOMIC_RELAXED)) < set->pending_count) {
+        verify_entry(set, &set->entries[set->pending[index]]);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Load the records of files verified before
+ * @param bundle_path Bundle the records are for
+ * @param count Receives the number of records
+ * @return Records sorted by file identity, or NULL if there are none
+ */
+static integrity_record_t *load_records(const char *bundle_path, unsigned int *count) {
+    char entry_path[MAX_PATH_LENGTH];
+    char stored_path[MAX_PATH_LENGTH];
+    integrity_header_t header;
+    integrity_record_t *records = NULL;
+    size_t path_length = strlen(bundle_path);
+    int fd;
+    
+    *count = 0;
+    if (!integrity_cache_enabled ||
+        cache_entry_path(INTEGRITY_CACHE_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return NULL;
+    }
+    fd = open(entry_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    if (read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        header.magic == INTEGRITY_MAGIC &&
+        header.version == INTEGRITY_FORMAT_VERSION &&
+        header.path_length == path_length &&
+        header.count <= INTEGRITY_MAX_FILES &&
+        read(fd, stored_path, path_length) == (ssize_t)path_length &&
+        memcmp(stored_path, bundle_path, path_length) == 0 &&
+        (records = malloc((header.count + 1) * sizeof(*records))) != NULL) {
+        size_t size = header.count * sizeof(*records);
+        if (read(fd, records, size) == (ssize_t)size) {
+            *count = header.count;
+        }
+    }
+    close(fd);
+    
+    if (*count == 0) {
+        free(records);
+        return NULL;
+    }
+    qsort(records, *count, sizeof(*records), compare_records);
+    return records;
+}
+
+/**
+ * @brief Remember the files of a bundle that matched their digests
+ * @param bundle_path Bundle the records are for
+ * @param set Verified manifest
+ */
+static void store_records(const char *bundle_path, const integrity_set_t *set) {
+    char entry_path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH + 16];
+    integrity_header_t header;
+    integrity_record_t record;
+    size_t path_length = strlen(bundle_path);
+    int failed;
+    int fd;
+    
+    if (!integrity_cache_enabled ||
+        cache_entry_path(INTEGRITY_CACHE_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return;
+    }
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", entry_path, (long)getpid());
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        log_message(LOG_DEBUG, "Cannot write integrity cache: %s", strerror(errno));
+        return;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = INTEGRITY_MAGIC;
+    header.version = INTEGRITY_FORMAT_VERSION;
+    header.path_length = (uint32_t)path_length;
+    header.count = set->count;
+    
+    // Write to a private file and rename so readers never see partial entries
+    failed = write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+             write(fd, bundle_path, path_length) != (ssize_t)path_length;
+    for (unsigned int i = 0; !failed && i < set->count; i++) {
+        memset(&record, 0, sizeof(record));
+        record.state = set->entries[i].state;
+        memcpy(record.digest, set->entries[i].digest, sizeof(record.digest));
+        record.verity = (uint32_t)set->entries[i].verity;
+        failed = write(fd, &record, sizeof(record)) != (ssize_t)sizeof(record);
+    }
+    if (close(fd) != 0 || failed || rename(temp_path, entry_path) != 0) {
+        log_message(LOG_DEBUG, "Cannot write integrity cache: %s", strerror(errno));
+        unlink(temp_path);
+    }
+}
+
+/**
+ * @brief Check whether a file matched the same digest in the same state before
+ * @param records Records sorted by file identity
+ * @param count Number of records
+ * @param entry Entry with the current state of its file
+ * @return Non-zero if the file need not be hashed
+ */
+static int record_matches(const integrity_record_t *records, unsigned int count, const integrity_entry_t *entry) {
+    integrity_record_t key;
+    const integrity_record_t *record;
+    
+    key.state = entry->state;
+    record = bsearch(&key, records, count, sizeof(*records), compare_records);
+    return record != NULL &&
+           memcmp(&record->state, &entry->state, sizeof(entry->state)) == 0 &&
+           memcmp(record->digest, entry->digest, sizeof(entry->digest)) == 0 &&
+           record->verity == (uint32_t)entry->verity;
+}
+
+/**
+ * @brief Stat the listed files and hash those the cache does not vouch for
+ * @param probe Opened bundle probe
+ * @param set Parsed manifest
+ * @return Number of files hashed, or -1 if a file is missing or does not match
+ */
+static int verify_entries(const bundle_probe_t *probe, integrity_set_t *set) {
+    pthread_t threads[INTEGRITY_THREADS];
+    unsigned int thread_count = 0;
+    unsigned int record_count;
+    integrity_record_t *records = load_records(probe->path, &record_count);
+    int failed = 0;
+    
+    set->pending = malloc((set->count + 1) * sizeof(*set->pending));
+    if (set->pending == NULL) {
+        free(records);
+        return -1;
+    }
+    
+    for (unsigned int i = 0; i < set->count; i++) {
+        integrity_entry_t *entry = &set->entries[i];
+        struct statx stx;
+        
+        if (statx(set->dirfd, entry->path, AT_STATX_SYNC_AS_STAT, STATX_BASIC_STATS, &stx) != 0) {
+            log_message(LOG_ERROR, "Integrity check failed: %s: %s", entry->path, strerror(errno));
+            failed = 1;
+            continue;
+        }
+        component_state_take(&stx, &entry->state);
+        if (records && record_matches(records, record_count, entry)) {
+            entry->result = 1;
+        } else {
+            set->pending[set->pending_count++] = i;
+        }
+    }
+    free(records);
+    if (failed) {
+        return -1;
+    }
+    
+    // The calling thread hashes too, so small sets start no threads at all
+    while (thread_count + 1 < INTEGRITY_THREADS && thread_count + 1 < set->pending_count &&
+           pthread_create(&threads[thread_count], NULL, integrity_worker, set) == 0) {
+        thread_count++;
+    }
+    integrity_worker(set);
+    for (unsigned int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    for (unsigned int i = 0; i < set->count; i++) {
+        failed |= set->entries[i].result != 1;
+    }
+    return failed ? -1 : (int)set->pending_count;
+}
+
+/**
+ * @brief Verify a bundle against its digest manifest
+ * @param probe Opened bundle probe
+ * @return EXIT_SUCCESS if the bundle matches or has no manifest, EXIT_BUNDLE_ERROR otherwise
+ */
+int integrity_verify(const bundle_probe_t *probe) {
+    const struct statx *exec = &probe->components[COMPONENT_EXEC];
+    integrity_entry_t *exec_entry;
+    integrity_set_t set;
+    int missing;
+    int hashed;
+    int result;
+    
+    result = load_manifest(probe->dirfd, &set, &missing);
+    if (result != EXIT_SUCCESS) {
+        return result;
+    }
+    if (missing) {
+        if (integrity_required) {
+            log_message(LOG_ERROR, "Integrity check failed: %s has no %s", probe->path, INTEGRITY_FILE_NAME);
+            return EXIT_BUNDLE_ERROR;
+        }
+        return EXIT_SUCCESS;
+    }
+    
+    // Every file the application is built from must be listed
+    if (require_listed(&set, probe->exec_path) != 0 ||
+        walk_directory(probe->dirfd, bundle_component_paths[COMPONENT_LIBRARY], 0, require_listed, &set) != 0) {
+        integrity_set_free(&set);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    hashed = verify_entries(probe, &set);
+    exec_entry = find_entry(&set, probe->exec_path);
+    if (hashed >= 0 &&
+        (exec_entry->state.dev != (((uint64_t)exec->stx_dev_major << 32) | exec->stx_dev_minor) ||
+         exec_entry->state.ino != exec->stx_ino)) {
+        log_message(LOG_ERROR, "Integrity check failed: %s was replaced during the launch", probe->exec_path);
+        hashed = -1;
+    }
+    if (hashed < 0) {
+        integrity_set_free(&set);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    if (hashed > 0) {
+        store_records(probe->path, &set);
+    }
+    log_message(LOG_INFO, "Bundle integrity verified: %u files, %d hashed", set.count, hashed);
+    integrity_set_free(&set);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Add a bundle file to the list being sealed
+ * @param context integrity_list_t
+ * @param path Path relative to the bundle root
+ * @return 0 on success, -1 if out of memory or over INTEGRITY_MAX_FILES
+ */
+static int collect_path(void *context, const char *path) {
+    integrity_list_t *list = context;
+    
+    if (list->count >= INTEGRITY_MAX_FILES) {
+        log_message(LOG_ERROR, "More than %d files to seal", INTEGRITY_MAX_FILES);
+        return -1;
+    }
+    list->paths[list->count] = strdup(path);
+    if (list->paths[list->count] == NULL) {
+        return -1;
+    }
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Write the digest manifest for the current contents of a bundle
+ * @param bundle_path Path to the bundle directory
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int integrity_seal(const char *bundle_path) {
+    char temp_name[sizeof(INTEGRITY_FILE_NAME) + 16];
+    integrity_list_t list;
+    bundle_probe_t probe;
+    unsigned int verity = 0;
+    int result = EXIT_SUCCESS;
+    FILE *out = NULL;
+    int fd = -1;
+    
+    bundle_probe_open(&probe, bundle_path);
+    if (probe.image_path[0] != '\0') {
+        log_message(LOG_ERROR, "Seal the bundle directory before packing it: %s", bundle_path);
+        bundle_probe_close(&probe);
+        return EXIT_INVALID_ARGS;
+    }
+    if (!bundle_probe_is_directory(&probe, COMPONENT_ROOT) || !bundle_probe_is_file(&probe, COMPONENT_EXEC)) {
+        log_message(LOG_ERROR, "Not a bundle with an executable: %s", bundle_path);
+        bundle_probe_close(&probe);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    list.count = 0;
+    list.paths = calloc(INTEGRITY_MAX_FILES, sizeof(*list.paths));
+    if (list.paths == NULL || collect_path(&list, probe.exec_path) != 0 ||
+        walk_directory(probe.dirfd, bundle_component_paths[COMPONENT_LIBRARY], 0, collect_path, &list) != 0) {
+        result = EXIT_SYSTEM_ERROR;
+    }
+    
+    snprintf(temp_name, sizeof(temp_name), "%s.%ld", INTEGRITY_FILE_NAME, (long)getpid());
+    if (result == EXIT_SUCCESS) {
+        fd = openat(probe.dirfd, temp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        out = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (out == NULL) {
+            log_message(LOG_ERROR, "Cannot write %s/%s: %s", bundle_path, INTEGRITY_FILE_NAME, strerror(errno));
+            if (fd >= 0) {
+                close(fd);
+            }
+            result = EXIT_SYSTEM_ERROR;
+        }
+    }
+    
+    // Files with fs-verity enabled are sealed with the digest the kernel enforces
+    qsort(list.paths, list.count, sizeof(*list.paths), compare_paths);
+    for (unsigned int i = 0; result == EXIT_SUCCESS && i < list.count; i++) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        char hex[SHA256_HEX_SIZE];
+        int file = openat(probe.dirfd, list.paths[i], O_RDONLY | O_CLOEXEC | O_NOCTTY);
+        int measured_verity = file >= 0 && measure_file(file, 1, digest) == 0;
+        
+        if (file < 0 || (!measured_verity && measure_file(file, 0, digest) != 0)) {
+            log_message(LOG_ERROR, "Cannot read %s: %s", list.paths[i], strerror(errno));
+            result = EXIT_BUNDLE_ERROR;
+        } else {
+            sha256_hex(digest, hex);
+            fprintf(out, "%s%s  %s\n", measured_verity ? INTEGRITY_VERITY_PREFIX : "", hex, list.paths[i]);
+            verity += (unsigned int)measured_verity;
+        }
+        if (file >= 0) {
+            close(file);
+        }
+    }
+    
+    if (out != NULL && (fclose(out) != 0 || result != EXIT_SUCCESS ||
+                        renameat(probe.dirfd, temp_name, probe.dirfd, INTEGRITY_FILE_NAME) != 0)) {
+        if (result == EXIT_SUCCESS) {
+            log_message(LOG_ERROR, "Cannot write %s/%s: %s", bundle_path, INTEGRITY_FILE_NAME, strerror(errno));
+            result = EXIT_SYSTEM_ERROR;
+        }
+        unlinkat(probe.dirfd, temp_name, 0);
+    }
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Sealed %u files of %s (%u with fs-verity)", list.count, bundle_path, verity);
+    }
+    
+    for (unsigned int i = 0; list.paths && i < list.count; i++) {
+        free(list.paths[i]);
+    }
+    free(list.paths);
+    bundle_probe_close(&probe);
+    return result;
+}
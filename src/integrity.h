@@ -0,0 +1,79 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file integrity.h
+ * @brief Bundle integrity verification against a digest manifest
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A bundle may carry INTEGRITY_FILE_NAME next to info.yaml, listing a
+ * digest for exec/base and every file below library/ in sha256sum(1)
+ * format. The launcher refuses a bundle whose files do not match it,
+ * or that has files it does not list. For files with fs-verity enabled
+ * the manifest may hold the fs-verity digest instead, prefixed with
+ * INTEGRITY_VERITY_PREFIX, which the kernel measures without reading
+ * the file.
+ *
+ * The manifest carries no signature: a bundle that is writable only by
+ * root or the launching user is protected from corruption and from
+ * other users, not from its owner.
+ *
+ * Files verified once are remembered by inode, size, mtime and ctime
+ * together with the digest they matched, so a warm launch stats the
+ * files instead of hashing them.
+ */
+
+#ifndef VLAUNCH_INTEGRITY_H
+#define VLAUNCH_INTEGRITY_H
+
+#include "launcher.h"
+
+/* Integrity Configuration */
+#define INTEGRITY_FILE_NAME         "digests.sha256"
+#define INTEGRITY_CACHE_DIR         "integrity"
+#define INTEGRITY_VERITY_PREFIX     "verity:"
+#define INTEGRITY_MAGIC             0x49564c56u /* "VLVI" */
+#define INTEGRITY_FORMAT_VERSION    1
+#define INTEGRITY_MAX_SIZE          (1024 * 1024)
+#define INTEGRITY_MAX_FILES         4096
+#define INTEGRITY_MAX_DEPTH         8
+#define INTEGRITY_THREADS           4
+
+int integrity_verify(const bundle_probe_t *probe);
+int integrity_seal(const char *bundle_path);
+void integrity_set_required(int required);
+void integrity_cache_set_enabled(int enabled);
+
+#endif /* VLAUNCH_INTEGRITY_H */
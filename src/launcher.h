@@ -0,0 +1,91 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file launcher.h
+ * @brief Shared definitions for the Application Bundle Launcher
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Configuration constants, bundle layout, exit codes and the core
+ * bundle handling routines shared between the launcher front-end and
+ * its long-running modes.
+ */
+
+#ifndef VLAUNCH_LAUNCHER_H
+#define VLAUNCH_LAUNCHER_H
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include "log.h"
+
+/* Application Configuration */
+#define APP_NAME            "Application Launcher"
+#define APP_VERSION         "1.0.0"
+#define MAX_PATH_LENGTH     PATH_MAX
+#define MAX_BUFFER_SIZE     2048
+
+/* Bundle Structure Definitions */
+#define EXEC_PATH           "/exec/base"
+#define LIB_PATH            "/library"
+#define RES_PATH            "/resources"
+#define METADATA_PATH       "/info.yaml"
+#define ICON_PATH           "/icon.png"
+
+/* Exit Codes */
+#define EXIT_SUCCESS        0
+#define EXIT_INVALID_ARGS   1
+#define EXIT_BUNDLE_ERROR   2
+#define EXIT_EXEC_ERROR     3
+#define EXIT_SYSTEM_ERROR   4
+
+/* Opened bundle, see probe.h */
+typedef struct bundle_probe bundle_probe_t;
+
+/* Environment of the launched application, see environment.h */
+typedef struct env_builder env_builder_t;
+
+/* Arguments and descriptors for the application, see handoff.h */
+typedef struct launch_handoff launch_handoff_t;
+
+int validate_bundle(const bundle_probe_t *probe);
+int configure_environment(const bundle_probe_t *probe, env_builder_t *env);
+int configure_library_path(const bundle_probe_t *probe, env_builder_t *env);
+int prepare_environment(const bundle_probe_t *probe, env_builder_t *env);
+void inspect_optional_components(const bundle_probe_t *probe);
+int exec_application(const bundle_probe_t *probe, env_builder_t *env, const launch_handoff_t *handoff);
+int prepare_application(bundle_probe_t *probe, const char *bundle_path);
+int launch_application(const char *bundle_path, const launch_handoff_t *handoff);
+
+#endif /* VLAUNCH_LAUNCHER_H */
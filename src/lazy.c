@@ -0,0 +1,1553 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file lazy.c
+ * @brief Lazily fetched bundle resources
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The server speaks the FUSE protocol on /dev/fuse directly. The index
+ * is immutable, so inode numbers are positions in the node table and
+ * nothing is reference counted; lookups go through a hash of parent
+ * inode and name. All replies carry long timeouts, which lets the
+ * kernel cache names, attributes and file pages for the life of the
+ * mount.
+ *
+ * Each open file is a descriptor of the cached object, so reads are one
+ * pread(). An object is fetched by the first thread that opens it while
+ * the others wait for it; ranges are written in place into a sparse
+ * temporary file that is renamed into the cache once its digest matches.
+ */
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/fuse.h>
+#include <linux/sched.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "sha256.h"
+#include "sandbox.h"
+#include "lazy.h"
+
+/* A file or directory of the index; its inode number is its position plus one */
+typedef struct {
+    const char *name;
+    uint64_t size;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t parent;        // Inode of the directory holding it
+    uint32_t bucket_next;   // Next inode in the same lookup bucket, 0 for none
+    uint32_t child_start;   // Directories: first entry in lazy_tree_t.children
+    uint32_t child_count;
+    int directory;
+    int fetching;           // Set while a thread downloads the object
+} lazy_node_t;
+
+/* The mounted index and everything the server needs to fill it in */
+typedef struct {
+    char *text;
+    lazy_node_t *nodes;
+    uint32_t count;
+    uint32_t *buckets;
+    uint32_t bucket_mask;
+    uint32_t *children;
+    uint64_t total_size;
+    struct timespec mtime;
+    uid_t uid;
+    gid_t gid;
+    
+    // Backend, as parsed from the resource URL
+    int remote;
+    char host[256];
+    char port[8];
+    char prefix[MAX_PATH_LENGTH];
+#ifdef VLAUNCH_STATIC
+    struct sockaddr_storage address;    // A static binary has no NSS, so hosts are numeric
+    socklen_t address_length;
+#else
+    struct addrinfo *address;
+#endif
+    
+    char cache[MAX_PATH_LENGTH];
+    uint64_t cache_limit;
+    int fuse_fd;
+    pthread_mutex_t lock;
+    pthread_cond_t fetched;
+} lazy_tree_t;
+
+/* One object download, shared by its fetching threads */
+typedef struct {
+    lazy_tree_t *tree;
+    const lazy_node_t *node;
+    char hex[SHA256_HEX_SIZE];
+    int fd;
+    uint32_t ranges;
+    uint32_t next;
+    int failed;
+} lazy_fetch_t;
+
+/* A cached object, for eviction */
+typedef struct {
+    char name[SHA256_HEX_SIZE];
+    struct timespec mtime;
+    uint64_t size;
+} lazy_object_t;
+
+/* Publishing state */
+typedef struct {
+    const char *object_dir;
+    FILE *index;
+    unsigned int files;
+    unsigned int stored;
+    uint64_t bytes;
+} lazy_publish_t;
+
+static lazy_tree_t lazy_tree;
+static pthread_mutex_t evict_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Parse a hex SHA-256 digest
+ * @param hex 64 hex digits
+ * @param digest Receives the digest
+ * @return 0 on success, -1 on a non-hex character
+ */
+static int parse_digest(const char *hex, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    for (int i = 0; i < SHA256_DIGEST_SIZE * 2; i++) {
+        char c = hex[i];
+        int value = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                    c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        
+        if (value < 0) {
+            return -1;
+        }
+        digest[i / 2] = (uint8_t)(i % 2 ? (digest[i / 2] << 4) | value : value);
+    }
+    return 0;
+}
+
+/**
+ * @brief Hash a name within its directory
+ * @param parent Inode of the directory
+ * @param name Name, not necessarily NUL-terminated
+ * @param length Length of name
+ * @return FNV-1a hash
+ */
+static uint32_t name_hash(uint32_t parent, const char *name, size_t length) {
+    uint32_t hash = 2166136261u ^ parent;
+    
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Find an entry of a directory
+ * @param tree Loaded index
+ * @param parent Inode of the directory
+ * @param name Name, not necessarily NUL-terminated
+ * @param length Length of name
+ * @return Inode of the entry, or 0 if there is none
+ */
+static uint32_t find_child(const lazy_tree_t *tree, uint32_t parent, const char *name, size_t length) {
+    uint32_t ino = tree->buckets[name_hash(parent, name, length) & tree->bucket_mask];
+    
+    while (ino != 0) {
+        const lazy_node_t *node = &tree->nodes[ino - 1];
+        
+        if (node->parent == parent && strncmp(node->name, name, length) == 0 && node->name[length] == '\0') {
+            return ino;
+        }
+        ino = node->bucket_next;
+    }
+    return 0;
+}
+
+/**
+ * @brief Add an entry to a directory
+ * @param tree Index being loaded, with room for the node
+ * @param parent Inode of the directory
+ * @param name NUL-terminated name, kept by reference
+ * @return Inode of the new entry
+ */
+static uint32_t add_node(lazy_tree_t *tree, uint32_t parent, const char *name) {
+    uint32_t *bucket = &tree->buckets[name_hash(parent, name, strlen(name)) & tree->bucket_mask];
+    uint32_t ino = ++tree->count;
+    lazy_node_t *node = &tree->nodes[ino - 1];
+    
+    memset(node, 0, sizeof(*node));
+    node->name = name;
+    node->parent = parent;
+    node->bucket_next = *bucket;
+    *bucket = ino;
+    return ino;
+}
+
+/**
+ * @brief Add a listed file and the directories leading to it
+ * @param tree Index being loaded
+ * @param path Path below resources/, split in place into its components
+ * @return Inode of the file, or 0 if the path is not usable
+ */
+static uint32_t add_path(lazy_tree_t *tree, char *path) {
+    uint32_t parent = FUSE_ROOT_ID;
+    unsigned int depth = 0;
+    char *component = path;
+    
+    if (path[0] == '\0' || path[0] == '/') {
+        return 0;
+    }
+    for (;;) {
+        char *end = strchr(component, '/');
+        uint32_t ino;
+        
+        if (end) {
+            *end = '\0';
+        }
+        if (component[0] == '\0' || strcmp(component, ".") == 0 || strcmp(component, "..") == 0 ||
+            ++depth > LAZY_MAX_DEPTH) {
+            return 0;
+        }
+        
+        // A name is either a file or a directory, and a file is listed once
+        ino = find_child(tree, parent, component, strlen(component));
+        if (end == NULL) {
+            return ino == 0 ? add_node(tree, parent, component) : 0;
+        }
+        if (ino == 0) {
+            ino = add_node(tree, parent, component);
+            tree->nodes[ino - 1].directory = 1;
+        } else if (!tree->nodes[ino - 1].directory) {
+            return 0;
+        }
+        parent = ino;
+        component = end + 1;
+    }
+}
+
+/**
+ * @brief Lay out the entries of each directory contiguously for readdir
+ * @param tree Loaded index
+ * @return 0 on success, -1 if out of memory
+ */
+static int index_children(lazy_tree_t *tree) {
+    uint32_t start = 0;
+    
+    tree->children = malloc((tree->count > 1 ? tree->count - 1 : 1) * sizeof(*tree->children));
+    if (tree->children == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 1; i < tree->count; i++) {
+        tree->nodes[tree->nodes[i].parent - 1].child_count++;
+    }
+    for (uint32_t i = 0; i < tree->count; i++) {
+        tree->nodes[i].child_start = start;
+        start += tree->nodes[i].child_count;
+        tree->nodes[i].child_count = 0;
+    }
+    for (uint32_t i = 1; i < tree->count; i++) {
+        lazy_node_t *parent = &tree->nodes[tree->nodes[i].parent - 1];
+        tree->children[parent->child_start + parent->child_count++] = i + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Release a loaded index
+ * @param tree Index
+ */
+static void lazy_tree_free(lazy_tree_t *tree) {
+    free(tree->text);
+    free(tree->nodes);
+    free(tree->buckets);
+    free(tree->children);
+    tree->text = NULL;
+    tree->nodes = NULL;
+    tree->buckets = NULL;
+    tree->children = NULL;
+    tree->count = 0;
+}
+
+/**
+ * @brief Read a bundle's resource index
+ * @param probe Opened bundle probe
+ * @param tree Receives the index
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+static int load_index(const bundle_probe_t *probe, lazy_tree_t *tree) {
+    unsigned int number = 0;
+    uint64_t capacity = 1;
+    uint32_t buckets = 1;
+    struct stat st;
+    char *cursor;
+    ssize_t got;
+    int fd;
+    
+    memset(tree, 0, sizeof(*tree));
+    fd = openat(probe->dirfd, LAZY_INDEX_FILE, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > LAZY_INDEX_MAX_SIZE) {
+        log_message(LOG_ERROR, "%s is not a regular file of at most %d bytes", LAZY_INDEX_FILE, LAZY_INDEX_MAX_SIZE);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return EXIT_BUNDLE_ERROR;
+    }
+    tree->mtime = st.st_mtim;
+    
+    tree->text = malloc((size_t)st.st_size + 1);
+    if (tree->text == NULL) {
+        close(fd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    got = read(fd, tree->text, (size_t)st.st_size);
+    close(fd);
+    if (got != (ssize_t)st.st_size) {
+        log_message(LOG_ERROR, "Cannot read %s: %s", LAZY_INDEX_FILE, got < 0 ? strerror(errno) : "short read");
+        lazy_tree_free(tree);
+        return EXIT_BUNDLE_ERROR;
+    }
+    tree->text[got] = '\0';
+    
+    // Every line and every slash adds at most one node
+    for (const char *p = tree->text; *p; p++) {
+        capacity += *p == '\n' || *p == '/';
+    }
+    capacity++;
+    while (buckets < capacity * 2) {
+        buckets <<= 1;
+    }
+    tree->nodes = calloc((size_t)capacity, sizeof(*tree->nodes));
+    tree->buckets = calloc(buckets, sizeof(*tree->buckets));
+    if (tree->nodes == NULL || tree->buckets == NULL) {
+        lazy_tree_free(tree);
+        return EXIT_SYSTEM_ERROR;
+    }
+    tree->bucket_mask = buckets - 1;
+    tree->count = 1;
+    tree->nodes[0].name = "";
+    tree->nodes[0].parent = FUSE_ROOT_ID;
+    tree->nodes[0].directory = 1;
+    
+    // Lines are "<hex> <size> <path>"; the path runs to the end of the line
+    for (cursor = tree->text; *cursor; ) {
+        char *line = cursor;
+        char *end = strchr(line, '\n');
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        unsigned long long size;
+        char *path;
+        uint32_t ino;
+        
+        cursor = end ? end + 1 : line + strlen(line);
+        if (end) {
+            *end = '\0';
+        }
+        number++;
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        
+        errno = 0;
+        if (strlen(line) < SHA256_DIGEST_SIZE * 2 + 4 || parse_digest(line, digest) != 0 ||
+            line[SHA256_DIGEST_SIZE * 2] != ' ' || line[SHA256_DIGEST_SIZE * 2 + 1] < '0' ||
+            line[SHA256_DIGEST_SIZE * 2 + 1] > '9' ||
+            (size = strtoull(line + SHA256_DIGEST_SIZE * 2 + 1, &path, 10), errno != 0) || *path != ' ' ||
+            tree->count > LAZY_MAX_FILES || (ino = add_path(tree, path + 1)) == 0) {
+            log_message(LOG_ERROR, "%s:%u: malformed or repeated entry", LAZY_INDEX_FILE, number);
+            lazy_tree_free(tree);
+            return EXIT_BUNDLE_ERROR;
+        }
+        memcpy(tree->nodes[ino - 1].digest, digest, sizeof(digest));
+        tree->nodes[ino - 1].size = size;
+        tree->total_size += size;
+    }
+    
+    if (index_children(tree) != 0) {
+        lazy_tree_free(tree);
+        return EXIT_SYSTEM_ERROR;
+    }
+    return EXIT_SUCCESS;
+}
+
+#ifdef VLAUNCH_STATIC
+/**
+ * @brief Parse a numeric backend host into its socket address
+ * @param tree Index with host and port set; receives the address
+ * @return 0 on success, -1 if the host is not an IPv4 or IPv6 address
+ */
+static int numeric_backend(lazy_tree_t *tree) {
+    struct sockaddr_in *ipv4 = (struct sockaddr_in *)&tree->address;
+    struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)&tree->address;
+    uint16_t port = htons((uint16_t)strtoul(tree->port, NULL, 10));
+    
+    memset(&tree->address, 0, sizeof(tree->address));
+    if (inet_pton(AF_INET, tree->host, &ipv4->sin_addr) == 1) {
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = port;
+        tree->address_length = sizeof(*ipv4);
+        return 0;
+    }
+    if (inet_pton(AF_INET6, tree->host, &ipv6->sin6_addr) == 1) {
+        ipv6->sin6_family = AF_INET6;
+        ipv6->sin6_port = port;
+        tree->address_length = sizeof(*ipv6);
+        return 0;
+    }
+    return -1;
+}
+#endif
+
+/**
+ * @brief Work out where objects are fetched from
+ * @param probe Opened bundle probe
+ * @param tree Loaded index; receives the backend
+ * @return EXIT_SUCCESS on success, EXIT_BUNDLE_ERROR on an unusable URL
+ */
+static int configure_backend(const bundle_probe_t *probe, lazy_tree_t *tree) {
+    const char *variable = getenv(LAZY_URL_ENV);
+    char url[MAX_PATH_LENGTH];
+    const char *host;
+    const char *end;
+    size_t length;
+    
+    if (variable && variable[0]) {
+        if ((size_t)snprintf(url, sizeof(url), "%s", variable) >= sizeof(url)) {
+            log_message(LOG_ERROR, "%s value too long", LAZY_URL_ENV);
+            return EXIT_INVALID_ARGS;
+        }
+    } else if (metadata_copy(&probe->metadata.resources_url, url, sizeof(url)) != 0) {
+        log_message(LOG_ERROR, "info.yaml resources-url value too long");
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    // Without a backend whatever is in the cache is still served
+    if (url[0] == '\0') {
+        log_message(LOG_WARNING, "No resource URL set; %s reads cached resources only", probe->path);
+        tree->remote = 0;
+        return EXIT_SUCCESS;
+    }
+    if (strncmp(url, "http://", 7) != 0) {
+        log_message(LOG_ERROR, "Only http:// resource URLs are supported: %s", url);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    // http://host[:port][/prefix], with IPv6 hosts in brackets
+    host = url + 7;
+    if (host[0] == '[') {
+        end = strchr(host, ']');
+        if (end == NULL) {
+            log_message(LOG_ERROR, "Malformed resource URL: %s", url);
+            return EXIT_BUNDLE_ERROR;
+        }
+        length = (size_t)(end - host - 1);
+        host++;
+        end++;
+    } else {
+        end = host + strcspn(host, ":/");
+        length = (size_t)(end - host);
+    }
+    if (length == 0 || length >= sizeof(tree->host)) {
+        log_message(LOG_ERROR, "Malformed resource URL: %s", url);
+        return EXIT_BUNDLE_ERROR;
+    }
+    memcpy(tree->host, host, length);
+    tree->host[length] = '\0';
+    
+    snprintf(tree->port, sizeof(tree->port), "80");
+    if (*end == ':') {
+        length = strcspn(end + 1, "/");
+        if (length == 0 || length >= sizeof(tree->port) || strspn(end + 1, "0123456789") < length ||
+            strtoul(end + 1, NULL, 10) == 0 || strtoul(end + 1, NULL, 10) > 65535) {
+            log_message(LOG_ERROR, "Malformed resource URL: %s", url);
+            return EXIT_BUNDLE_ERROR;
+        }
+        memcpy(tree->port, end + 1, length);
+        tree->port[length] = '\0';
+        end += 1 + length;
+    }
+#ifdef VLAUNCH_STATIC
+    if (numeric_backend(tree) != 0) {
+        log_message(LOG_ERROR, "A statically linked launcher needs a numeric resource host: %s", url);
+        return EXIT_BUNDLE_ERROR;
+    }
+#endif
+    
+    snprintf(tree->prefix, sizeof(tree->prefix), "%s", end);
+    length = strlen(tree->prefix);
+    while (length > 0 && tree->prefix[length - 1] == '/') {
+        tree->prefix[--length] = '\0';
+    }
+    tree->remote = 1;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Connect to the resource backend
+ * @param tree Index with a remote backend
+ * @return Connected socket, or -1 on failure
+ */
+static int connect_backend(lazy_tree_t *tree) {
+    struct timeval timeout = { LAZY_IO_TIMEOUT, 0 };
+#ifdef VLAUNCH_STATIC
+    int fd = socket(tree->address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, (const struct sockaddr *)&tree->address, tree->address_length) == 0) {
+            return fd;
+        }
+        close(fd);
+    }
+#else
+    struct addrinfo hints;
+    int error = 0;
+    
+    // Resolved on first use, so a launch never waits for DNS
+    pthread_mutex_lock(&tree->lock);
+    if (tree->address == NULL) {
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        error = getaddrinfo(tree->host, tree->port, &hints, &tree->address);
+        if (error != 0) {
+            tree->address = NULL;
+        }
+    }
+    pthread_mutex_unlock(&tree->lock);
+    if (error != 0) {
+        log_message(LOG_WARNING, "Cannot resolve %s: %s", tree->host, gai_strerror(error));
+        return -1;
+    }
+    
+    for (const struct addrinfo *entry = tree->address; entry; entry = entry->ai_next) {
+        int fd = socket(entry->ai_family, entry->ai_socktype | SOCK_CLOEXEC, entry->ai_protocol);
+        
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, entry->ai_addr, entry->ai_addrlen) == 0) {
+            return fd;
+        }
+        close(fd);
+    }
+#endif
+    log_message(LOG_WARNING, "Cannot connect to %s:%s: %s", tree->host, tree->port, strerror(errno));
+    return -1;
+}
+
+/**
+ * @brief Write a whole buffer at an offset
+ * @param fd Destination file
+ * @param data Data to write
+ * @param size Size of data
+ * @param offset File offset
+ * @return 0 on success, -1 on failure
+ */
+static int write_at(int fd, const char *data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, (off_t)offset);
+        
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+        data += written;
+        size -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief Download one byte range of an object into its temporary file
+ * @param fetch Download in progress
+ * @param start First byte
+ * @param end Byte after the last one
+ * @return 0 on success, -1 on failure
+ */
+static int fetch_range(lazy_fetch_t *fetch, uint64_t start, uint64_t end) {
+    lazy_tree_t *tree = fetch->tree;
+    char buffer[64 * 1024];
+    char request[MAX_PATH_LENGTH + 512];
+    const char *range;
+    uint64_t position = start;
+    char *body;
+    size_t have = 0;
+    size_t length;
+    long status;
+    int result = -1;
+    int fd;
+    
+    fd = connect_backend(tree);
+    if (fd < 0) {
+        return -1;
+    }
+    length = (size_t)snprintf(request, sizeof(request),
+                              "GET %s/%s HTTP/1.1\r\nHost: %s%s%s\r\nRange: bytes=%llu-%llu\r\n"
+                              "User-Agent: vlaunch/%s\r\nConnection: close\r\n\r\n",
+                              tree->prefix, fetch->hex, tree->host, strcmp(tree->port, "80") ? ":" : "",
+                              strcmp(tree->port, "80") ? tree->port : "", (unsigned long long)start,
+                              (unsigned long long)end - 1, APP_VERSION);
+    if (length >= sizeof(request) || send(fd, request, length, MSG_NOSIGNAL) != (ssize_t)length) {
+        close(fd);
+        return -1;
+    }
+    
+    // Headers first; the part of the body read with them is written below
+    while ((body = memmem(buffer, have, "\r\n\r\n", 4)) == NULL) {
+        ssize_t got = have < sizeof(buffer) - 1 ? recv(fd, buffer + have, sizeof(buffer) - 1 - have, 0) : -1;
+        
+        if (got <= 0) {
+            close(fd);
+            return -1;
+        }
+        have += (size_t)got;
+    }
+    *body = '\0';
+    body += 4;
+    
+    range = strcasestr(buffer, "\r\nContent-Range: bytes ");
+    if (sscanf(buffer, "HTTP/%*u.%*u %ld", &status) != 1 || strcasestr(buffer, "\r\nTransfer-Encoding:") ||
+        (status == 206 ? range == NULL || strtoull(range + 23, NULL, 10) != start
+                       : status != 200 || start != 0 || end != fetch->node->size)) {
+        log_message(LOG_WARNING, "Unexpected reply to %s%s/%s: %.40s", tree->host, tree->prefix, fetch->hex, buffer);
+        close(fd);
+        return -1;
+    }
+    
+    length = have - (size_t)(body - buffer);
+    if (length > end - position) {
+        length = (size_t)(end - position);
+    }
+    if (write_at(fetch->fd, body, length, position) == 0) {
+        position += length;
+        while (position < end) {
+            ssize_t got = recv(fd, buffer, end - position < sizeof(buffer) ? (size_t)(end - position) : sizeof(buffer), 0);
+            
+            if (got <= 0 || write_at(fetch->fd, buffer, (size_t)got, position) != 0) {
+                break;
+            }
+            position += (uint64_t)got;
+        }
+        result = position == end ? 0 : -1;
+    }
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Fetch ranges of an object until none are left
+ * @param arg Shared lazy_fetch_t
+ * @return Always NULL
+ */
+static void *fetch_worker(void *arg) {
+    lazy_fetch_t *fetch = arg;
+    uint32_t range;
+    
+    while (!__atomic_load_n(&fetch->failed, __ATOMIC_RELAXED) &&
+           (range = __atomic_fetch_add(&fetch->next, 1, __ATOMIC_RELAXED)) < fetch->ranges) {
+        uint64_t start = (uint64_t)range * LAZY_RANGE_SIZE;
+        uint64_t end = start + LAZY_RANGE_SIZE < fetch->node->size ? start + LAZY_RANGE_SIZE : fetch->node->size;
+        int attempt = 0;
+        
+        while (attempt < LAZY_RETRIES && fetch_range(fetch, start, end) != 0) {
+            attempt++;
+        }
+        if (attempt == LAZY_RETRIES) {
+            __atomic_store_n(&fetch->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Download an object into the cache and check its digest
+ * @param tree Loaded index
+ * @param node File whose object is fetched
+ * @param hex Hex digest of the object
+ * @param path Cache path of the object
+ * @return 0 once the object is in the cache, -1 on failure
+ */
+static int fetch_object(lazy_tree_t *tree, const lazy_node_t *node, const char *hex, const char *path) {
+    pthread_t threads[LAZY_CONNECTIONS - 1];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    char temp[MAX_PATH_LENGTH + 32];
+    unsigned int started = 0;
+    lazy_fetch_t fetch;
+    
+    if (!tree->remote) {
+        log_message(LOG_WARNING, "%s is not cached and there is no resource URL", node->name);
+        return -1;
+    }
+    
+    memset(&fetch, 0, sizeof(fetch));
+    fetch.tree = tree;
+    fetch.node = node;
+    memcpy(fetch.hex, hex, SHA256_HEX_SIZE);
+    fetch.ranges = (uint32_t)((node->size + LAZY_RANGE_SIZE - 1) / LAZY_RANGE_SIZE);
+    if ((size_t)snprintf(temp, sizeof(temp), "%s.%ld.part", path, (long)getpid()) >= sizeof(temp)) {
+        log_message(LOG_WARNING, "Cache path too long for %s", node->name);
+        return -1;
+    }
+    fetch.fd = open(temp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fetch.fd < 0 || ftruncate(fetch.fd, (off_t)node->size) != 0) {
+        log_message(LOG_WARNING, "Cannot create %s: %s", temp, strerror(errno));
+        if (fetch.fd >= 0) {
+            close(fetch.fd);
+            unlink(temp);
+        }
+        return -1;
+    }
+    
+    // Large objects are split across several connections
+    while (started + 1 < LAZY_CONNECTIONS && started + 1 < fetch.ranges &&
+           pthread_create(&threads[started], NULL, fetch_worker, &fetch) == 0) {
+        started++;
+    }
+    fetch_worker(&fetch);
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    if (!fetch.failed && (lseek(fetch.fd, 0, SEEK_SET) != 0 || sha256_fd(fetch.fd, digest) != 0 ||
+                          memcmp(digest, node->digest, sizeof(digest)) != 0)) {
+        log_message(LOG_ERROR, "Fetched %s does not match its digest", node->name);
+        fetch.failed = 1;
+    }
+    close(fetch.fd);
+    if (fetch.failed || rename(temp, path) != 0) {
+        unlink(temp);
+        log_flush();
+        return -1;
+    }
+    log_message(LOG_DEBUG, "Fetched %s: %llu bytes in %u ranges", node->name, (unsigned long long)node->size,
+                fetch.ranges);
+    log_flush();
+    return 0;
+}
+
+/**
+ * @brief Order cached objects, least recently opened first
+ * @param a First object
+ * @param b Second object
+ * @return Negative, zero or positive
+ */
+static int compare_objects(const void *a, const void *b) {
+    const lazy_object_t *x = a;
+    const lazy_object_t *y = b;
+    
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+    }
+    return (x->mtime.tv_nsec > y->mtime.tv_nsec) - (x->mtime.tv_nsec < y->mtime.tv_nsec);
+}
+
+/**
+ * @brief Drop the objects opened longest ago until the cache fits its limit
+ * @param tree Loaded index
+ * @param keep Hex digest of an object to keep whatever its age
+ */
+static void evict_objects(const lazy_tree_t *tree, const char *keep) {
+    lazy_object_t *objects = NULL;
+    struct dirent *entry;
+    size_t capacity = 0;
+    size_t count = 0;
+    uint64_t total = 0;
+    unsigned int dropped = 0;
+    DIR *dir;
+    
+    // One pass at a time is enough; another thread's pass sees the same files
+    if (pthread_mutex_trylock(&evict_lock) != 0) {
+        return;
+    }
+    dir = opendir(tree->cache);
+    while (dir && (entry = readdir(dir)) != NULL) {
+        struct stat st;
+        
+        if (strlen(entry->d_name) != SHA256_HEX_SIZE - 1 ||
+            fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (count == capacity) {
+            lazy_object_t *grown = realloc(objects, (capacity ? capacity * 2 : 256) * sizeof(*objects));
+            if (grown == NULL) {
+                break;
+            }
+            objects = grown;
+            capacity = capacity ? capacity * 2 : 256;
+        }
+        memcpy(objects[count].name, entry->d_name, SHA256_HEX_SIZE);
+        objects[count].mtime = st.st_mtim;
+        objects[count].size = (uint64_t)st.st_size;
+        total += (uint64_t)st.st_size;
+        count++;
+    }
+    
+    if (total > tree->cache_limit) {
+        qsort(objects, count, sizeof(*objects), compare_objects);
+        for (size_t i = 0; i < count && total > tree->cache_limit; i++) {
+            if (strcmp(objects[i].name, keep) != 0 && unlinkat(dirfd(dir), objects[i].name, 0) == 0) {
+                total -= objects[i].size;
+                dropped++;
+            }
+        }
+        log_message(LOG_DEBUG, "Dropped %u cached resource objects", dropped);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    free(objects);
+    pthread_mutex_unlock(&evict_lock);
+}
+
+/**
+ * @brief Open the cached object of a file, fetching it first if needed
+ * @param tree Loaded index
+ * @param node File to open
+ * @return Descriptor of the object, or -1 on failure
+ */
+static int open_object(lazy_tree_t *tree, lazy_node_t *node) {
+    char hex[SHA256_HEX_SIZE];
+    char path[MAX_PATH_LENGTH];
+    int result;
+    int fd;
+    
+    sha256_hex(node->digest, hex);
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", tree->cache, hex) >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    for (;;) {
+        fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd >= 0) {
+            // The modification time orders the cache for eviction
+            futimens(fd, NULL);
+            return fd;
+        }
+        if (errno != ENOENT) {
+            return -1;
+        }
+        
+        // Whoever sees the object missing first fetches it; the others wait
+        pthread_mutex_lock(&tree->lock);
+        if (node->fetching) {
+            while (node->fetching) {
+                pthread_cond_wait(&tree->fetched, &tree->lock);
+            }
+            pthread_mutex_unlock(&tree->lock);
+            continue;
+        }
+        node->fetching = 1;
+        pthread_mutex_unlock(&tree->lock);
+        
+        result = fetch_object(tree, node, hex, path);
+        
+        pthread_mutex_lock(&tree->lock);
+        node->fetching = 0;
+        pthread_cond_broadcast(&tree->fetched);
+        pthread_mutex_unlock(&tree->lock);
+        if (result != 0) {
+            return -1;
+        }
+        evict_objects(tree, hex);
+    }
+}
+
+/**
+ * @brief Send a reply to the kernel
+ * @param tree Mounted index
+ * @param unique Request being answered
+ * @param error Positive errno, or 0 for success
+ * @param data Reply payload
+ * @param size Size of payload
+ */
+static void reply(const lazy_tree_t *tree, uint64_t unique, int error, const void *data, size_t size) {
+    struct fuse_out_header header;
+    struct iovec iov[2];
+    
+    header.len = (uint32_t)(sizeof(header) + (error ? 0 : size));
+    header.error = -error;
+    header.unique = unique;
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void *)data;
+    iov[1].iov_len = size;
+    
+    // ENOENT means the request was interrupted meanwhile, which needs nothing more
+    if (writev(tree->fuse_fd, iov, error || size == 0 ? 1 : 2) < 0 && errno != ENOENT) {
+        log_message(LOG_DEBUG, "FUSE reply failed: %s", strerror(errno));
+    }
+}
+
+/**
+ * @brief Fill in the attributes of an inode
+ * @param tree Mounted index
+ * @param ino Inode number
+ * @param attr Receives the attributes
+ */
+static void fill_attr(const lazy_tree_t *tree, uint64_t ino, struct fuse_attr *attr) {
+    const lazy_node_t *node = &tree->nodes[ino - 1];
+    
+    memset(attr, 0, sizeof(*attr));
+    attr->ino = ino;
+    attr->size = node->directory ? 0 : node->size;
+    attr->blocks = (attr->size + 511) / 512;
+    attr->atime = attr->mtime = attr->ctime = (uint64_t)tree->mtime.tv_sec;
+    attr->atimensec = attr->mtimensec = attr->ctimensec = (uint32_t)tree->mtime.tv_nsec;
+    attr->mode = node->directory ? S_IFDIR | 0555 : S_IFREG | 0444;
+    attr->nlink = node->directory ? 2 : 1;
+    attr->uid = (uint32_t)tree->uid;
+    attr->gid = (uint32_t)tree->gid;
+    attr->blksize = 4096;
+}
+
+/**
+ * @brief Answer a FUSE_INIT request
+ * @param tree Mounted index
+ * @param unique Request id
+ * @param in Request arguments
+ */
+static void handle_init(const lazy_tree_t *tree, uint64_t unique, const struct fuse_init_in *in) {
+    struct fuse_init_out out;
+    
+    memset(&out, 0, sizeof(out));
+    out.major = FUSE_KERNEL_VERSION;
+    out.minor = FUSE_KERNEL_MINOR_VERSION;
+    if (in->major != FUSE_KERNEL_VERSION) {
+        // A newer major version is offered again as ours once it sees this reply
+        reply(tree, unique, in->major < FUSE_KERNEL_VERSION ? EPROTO : 0, &out, 8);
+        return;
+    }
+    out.max_readahead = in->max_readahead;
+    out.flags = in->flags & (FUSE_ASYNC_READ | FUSE_PARALLEL_DIROPS);
+    out.max_background = 16;
+    out.congestion_threshold = 12;
+    out.max_write = 4096;
+    out.time_gran = 1;
+    reply(tree, unique, 0, &out, in->minor < 23 ? FUSE_COMPAT_22_INIT_OUT_SIZE : sizeof(out));
+}
+
+/**
+ * @brief Answer a FUSE_READDIR request
+ * @param tree Mounted index
+ * @param unique Request id
+ * @param ino Directory inode
+ * @param in Request arguments
+ * @param data Scratch buffer of LAZY_MAX_READ bytes
+ */
+static void handle_readdir(const lazy_tree_t *tree, uint64_t unique, uint64_t ino, const struct fuse_read_in *in,
+                           char *data) {
+    const lazy_node_t *dir = &tree->nodes[ino - 1];
+    size_t limit = in->size < LAZY_MAX_READ ? in->size : LAZY_MAX_READ;
+    size_t used = 0;
+    
+    // Offsets count ".", ".." and then the entries in index order
+    for (uint64_t offset = in->offset; offset < (uint64_t)dir->child_count + 2; offset++) {
+        uint64_t child = offset == 0 ? ino : offset == 1 ? dir->parent : tree->children[dir->child_start + offset - 2];
+        const char *name = offset == 0 ? "." : offset == 1 ? ".." : tree->nodes[child - 1].name;
+        size_t namelen = strlen(name);
+        size_t entry = FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + namelen);
+        struct fuse_dirent *dirent = (struct fuse_dirent *)(void *)(data + used);
+        
+        if (used + entry > limit) {
+            break;
+        }
+        dirent->ino = child;
+        dirent->off = offset + 1;
+        dirent->namelen = (uint32_t)namelen;
+        dirent->type = tree->nodes[child - 1].directory ? DT_DIR : DT_REG;
+        memcpy(dirent->name, name, namelen);
+        memset(dirent->name + namelen, 0, entry - FUSE_NAME_OFFSET - namelen);
+        used += entry;
+    }
+    reply(tree, unique, 0, data, used);
+}
+
+/**
+ * @brief Give the size of the request arguments that are read for an opcode
+ * @param opcode Request opcode
+ * @return Minimum argument size in bytes
+ */
+static size_t argument_size(uint32_t opcode) {
+    switch (opcode) {
+        case FUSE_INIT:
+            // Every protocol version sends at least major, minor, max_readahead and flags
+            return offsetof(struct fuse_init_in, flags) + sizeof(uint32_t);
+        case FUSE_LOOKUP:
+            return 1;
+        case FUSE_OPEN:
+            return offsetof(struct fuse_open_in, flags) + sizeof(uint32_t);
+        case FUSE_READ:
+        case FUSE_READDIR:
+            return offsetof(struct fuse_read_in, size) + sizeof(uint32_t);
+        case FUSE_RELEASE:
+            return offsetof(struct fuse_release_in, fh) + sizeof(uint64_t);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Answer one request from the kernel
+ * @param tree Mounted index
+ * @param request Request as read from the device
+ * @param length Length of the request
+ * @param data Scratch buffer of LAZY_MAX_READ bytes
+ */
+static void handle_request(lazy_tree_t *tree, const char *request, size_t length, char *data) {
+    const struct fuse_in_header *header = (const void *)request;
+    const void *arg = request + sizeof(*header);
+    uint64_t ino;
+    lazy_node_t *node;
+    
+    if (length < sizeof(*header) || header->len != length) {
+        return;
+    }
+    ino = header->nodeid;
+    if (length - sizeof(*header) < argument_size(header->opcode) ||
+        (header->opcode == FUSE_LOOKUP && memchr(arg, '\0', length - sizeof(*header)) == NULL)) {
+        reply(tree, header->unique, EINVAL, NULL, 0);
+        return;
+    }
+    switch (header->opcode) {
+        case FUSE_FORGET:
+        case FUSE_BATCH_FORGET:
+        case FUSE_INTERRUPT:
+            // Nothing is reference counted or cancellable, and these get no reply
+            return;
+        case FUSE_INIT:
+            handle_init(tree, header->unique, arg);
+            return;
+        case FUSE_DESTROY:
+            reply(tree, header->unique, 0, NULL, 0);
+            return;
+        default:
+            break;
+    }
+    
+    if (ino == 0 || ino > tree->count) {
+        reply(tree, header->unique, ESTALE, NULL, 0);
+        return;
+    }
+    node = &tree->nodes[ino - 1];
+    
+    switch (header->opcode) {
+        case FUSE_LOOKUP: {
+            struct fuse_entry_out out;
+            const char *name = arg;
+            
+            // A miss is cached as well, as a zero node id
+            memset(&out, 0, sizeof(out));
+            out.nodeid = node->directory ? find_child(tree, (uint32_t)ino, name, strlen(name)) : 0;
+            out.generation = 1;
+            out.entry_valid = LAZY_ATTR_TIMEOUT;
+            out.attr_valid = LAZY_ATTR_TIMEOUT;
+            if (out.nodeid != 0) {
+                fill_attr(tree, out.nodeid, &out.attr);
+            }
+            reply(tree, header->unique, 0, &out, sizeof(out));
+            return;
+        }
+        case FUSE_GETATTR: {
+            struct fuse_attr_out out;
+            
+            memset(&out, 0, sizeof(out));
+            out.attr_valid = LAZY_ATTR_TIMEOUT;
+            fill_attr(tree, ino, &out.attr);
+            reply(tree, header->unique, 0, &out, sizeof(out));
+            return;
+        }
+        case FUSE_OPEN: {
+            const struct fuse_open_in *in = arg;
+            struct fuse_open_out out;
+            int fd;
+            
+            if (node->directory || (in->flags & O_ACCMODE) != O_RDONLY) {
+                reply(tree, header->unique, node->directory ? EISDIR : EROFS, NULL, 0);
+                return;
+            }
+            fd = open_object(tree, node);
+            if (fd < 0) {
+                reply(tree, header->unique, EIO, NULL, 0);
+                return;
+            }
+            memset(&out, 0, sizeof(out));
+            out.fh = (uint64_t)fd;
+            out.open_flags = FOPEN_KEEP_CACHE;
+            reply(tree, header->unique, 0, &out, sizeof(out));
+            return;
+        }
+        case FUSE_READ: {
+            const struct fuse_read_in *in = arg;
+            ssize_t got = pread((int)in->fh, data, in->size < LAZY_MAX_READ ? in->size : LAZY_MAX_READ, (off_t)in->offset);
+            
+            reply(tree, header->unique, got < 0 ? errno : 0, data, got < 0 ? 0 : (size_t)got);
+            return;
+        }
+        case FUSE_RELEASE: {
+            const struct fuse_release_in *in = arg;
+            
+            close((int)in->fh);
+            reply(tree, header->unique, 0, NULL, 0);
+            return;
+        }
+        case FUSE_OPENDIR: {
+            struct fuse_open_out out;
+            
+            if (!node->directory) {
+                reply(tree, header->unique, ENOTDIR, NULL, 0);
+                return;
+            }
+            memset(&out, 0, sizeof(out));
+            out.open_flags = FOPEN_KEEP_CACHE | FOPEN_CACHE_DIR;
+            reply(tree, header->unique, 0, &out, sizeof(out));
+            return;
+        }
+        case FUSE_READDIR:
+            handle_readdir(tree, header->unique, ino, arg, data);
+            return;
+        case FUSE_FLUSH:
+        case FUSE_RELEASEDIR:
+            reply(tree, header->unique, 0, NULL, 0);
+            return;
+        case FUSE_STATFS: {
+            struct fuse_statfs_out out;
+            
+            memset(&out, 0, sizeof(out));
+            out.st.blocks = (tree->total_size + 4095) / 4096;
+            out.st.files = tree->count;
+            out.st.bsize = 4096;
+            out.st.frsize = 4096;
+            out.st.namelen = 255;
+            reply(tree, header->unique, 0, &out, sizeof(out));
+            return;
+        }
+        default:
+            reply(tree, header->unique, ENOSYS, NULL, 0);
+            return;
+    }
+}
+
+/**
+ * @brief Serve requests from the FUSE device until the file system goes away
+ * @param arg Mounted lazy_tree_t
+ * @return Never returns
+ */
+static void *server_worker(void *arg) {
+    lazy_tree_t *tree = arg;
+    char *request = malloc(LAZY_REQUEST_SIZE);
+    char *data = malloc(LAZY_MAX_READ);
+    
+    if (request == NULL || data == NULL) {
+        _exit(EXIT_SYSTEM_ERROR);
+    }
+    for (;;) {
+        ssize_t got = read(tree->fuse_fd, request, LAZY_REQUEST_SIZE);
+        
+        if (got < 0) {
+            // ENOENT is an interrupted request; ENODEV is the file system unmounted
+            if (errno == EINTR || errno == EAGAIN || errno == ENOENT) {
+                continue;
+            }
+            _exit(errno == ENODEV ? EXIT_SUCCESS : EXIT_SYSTEM_ERROR);
+        }
+        handle_request(tree, request, (size_t)got, data);
+    }
+}
+
+/**
+ * @brief Run the FUSE server in the child made for it
+ * @param tree Mounted index
+ * @param parent Pid of the application
+ */
+static void serve(lazy_tree_t *tree, pid_t parent) {
+    static const int ignored[] = { SIGINT, SIGQUIT, SIGHUP, SIGTSTP, SIGTTIN, SIGTTOU, SIGPIPE };
+    pthread_t thread;
+    sigset_t empty;
+    int null;
+    
+    // The server lives exactly as long as the application
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != parent) {
+        _exit(EXIT_SUCCESS);
+    }
+    for (size_t i = 0; i < sizeof(ignored) / sizeof(ignored[0]); i++) {
+        signal(ignored[i], SIG_IGN);
+    }
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, NULL);
+    
+    // Only the device and standard error stay open, so no pipe waits on the server
+    if (dup2(tree->fuse_fd, 3) < 0) {
+        _exit(EXIT_SYSTEM_ERROR);
+    }
+    tree->fuse_fd = 3;
+    syscall(SYS_close_range, 4u, ~0u, 0u);
+    null = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (null >= 0) {
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+    
+    for (int i = 1; i < LAZY_SERVER_THREADS; i++) {
+        if (pthread_create(&thread, NULL, server_worker, tree) == 0) {
+            pthread_detach(thread);
+        }
+    }
+    server_worker(tree);
+}
+
+/**
+ * @brief Check whether a bundle ships its resources as an index
+ * @param probe Opened bundle probe
+ * @return Non-zero if LAZY_INDEX_FILE is present
+ */
+int lazy_resources_active(const bundle_probe_t *probe) {
+    return faccessat(probe->dirfd, LAZY_INDEX_FILE, F_OK, 0) == 0;
+}
+
+/**
+ * @brief Mount a bundle's lazy resources for the process about to exec it
+ * @param probe Validated bundle probe
+ * @return EXIT_SUCCESS on success or if the bundle has no index, error code otherwise
+ */
+int lazy_resources_attach(const bundle_probe_t *probe) {
+    lazy_tree_t *tree = &lazy_tree;
+    struct clone_args args;
+    char target[MAX_PATH_LENGTH];
+    char options[192];
+    const char *limit;
+    pid_t parent;
+    pid_t pid;
+    int result;
+    
+    if (!lazy_resources_active(probe)) {
+        return EXIT_SUCCESS;
+    }
+    if (!bundle_probe_is_directory(probe, COMPONENT_RESOURCES) ||
+        bundle_probe_component_path(probe, COMPONENT_RESOURCES, target, sizeof(target)) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "%s needs a resources/ directory to mount %s on", probe->path, LAZY_INDEX_FILE);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    result = load_index(probe, tree);
+    if (result == EXIT_SUCCESS) {
+        result = configure_backend(probe, tree);
+    }
+    if (result == EXIT_SUCCESS && cache_directory(LAZY_CACHE_DIR, tree->cache, sizeof(tree->cache)) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "No cache directory for lazy resources");
+        result = EXIT_SYSTEM_ERROR;
+    }
+    limit = getenv(LAZY_CACHE_ENV);
+    tree->cache_limit = (limit && limit[0] ? strtoull(limit, NULL, 10) : LAZY_CACHE_DEFAULT_MB) * 1024 * 1024;
+    
+    // The mount is the application's alone and goes away with its namespace
+    if (result == EXIT_SUCCESS) {
+        result = sandbox_private_mounts();
+    }
+    if (result != EXIT_SUCCESS) {
+        lazy_tree_free(tree);
+        return result;
+    }
+    
+    tree->uid = getuid();
+    tree->gid = getgid();
+    tree->fuse_fd = open("/dev/fuse", O_RDWR | O_CLOEXEC);
+    snprintf(options, sizeof(options), "fd=%d,rootmode=40000,user_id=%lu,group_id=%lu,default_permissions,max_read=%d",
+             tree->fuse_fd, (unsigned long)tree->uid, (unsigned long)tree->gid, LAZY_MAX_READ);
+    if (tree->fuse_fd < 0 ||
+        mount("vlaunch", target, "fuse.vlaunch", MS_RDONLY | MS_NOSUID | MS_NODEV, options) != 0) {
+        log_message(LOG_ERROR, "Failed to mount lazy resources on %s: %s", target, strerror(errno));
+        if (tree->fuse_fd >= 0) {
+            close(tree->fuse_fd);
+        }
+        lazy_tree_free(tree);
+        return EXIT_SYSTEM_ERROR;
+    }
+    pthread_mutex_init(&tree->lock, NULL);
+    pthread_cond_init(&tree->fetched, NULL);
+    
+    // The server is no SIGCHLD child, so the application's wait() never sees it
+    memset(&args, 0, sizeof(args));
+    parent = getpid();
+    log_flush();
+    fflush(NULL);
+    pid = (pid_t)syscall(SYS_clone3, &args, sizeof(args));
+    if (pid == 0) {
+        serve(tree, parent);
+    }
+    close(tree->fuse_fd);
+    if (pid < 0) {
+        log_message(LOG_ERROR, "Failed to start the resource server: %s", strerror(errno));
+        umount2(target, MNT_DETACH);
+        lazy_tree_free(tree);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_message(LOG_INFO, "Serving %u resource entries (%llu bytes) of %s on demand", tree->count - 1,
+                (unsigned long long)tree->total_size, probe->path);
+    lazy_tree_free(tree);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Copy a file into the object directory under its digest
+ * @param fd Source file, read from the start
+ * @param object Object path
+ * @return 0 on success, -1 on failure
+ */
+static int store_object(int fd, const char *object) {
+    char temp[MAX_PATH_LENGTH + 32];
+    char buffer[64 * 1024];
+    uint64_t offset = 0;
+    ssize_t got;
+    int out;
+    
+    if ((size_t)snprintf(temp, sizeof(temp), "%s.%ld.part", object, (long)getpid()) >= sizeof(temp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    out = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0 || lseek(fd, 0, SEEK_SET) != 0) {
+        if (out >= 0) {
+            close(out);
+            unlink(temp);
+        }
+        return -1;
+    }
+    while ((got = read(fd, buffer, sizeof(buffer))) > 0) {
+        if (write_at(out, buffer, (size_t)got, offset) != 0) {
+            got = -1;
+            break;
+        }
+        offset += (uint64_t)got;
+    }
+    if (close(out) != 0 || got < 0 || rename(temp, object) != 0) {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Publish one resource file
+ * @param publish Publishing state
+ * @param path Path of the file
+ * @param relative Path below resources/
+ * @param st Status of the file
+ * @return 0 on success, -1 on failure
+ */
+static int publish_file(lazy_publish_t *publish, const char *path, const char *relative, const struct stat *st) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    char hex[SHA256_HEX_SIZE];
+    char object[MAX_PATH_LENGTH];
+    int fd;
+    
+    fd = open(path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0 || sha256_fd(fd, digest) != 0) {
+        log_message(LOG_ERROR, "Cannot read %s: %s", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    sha256_hex(digest, hex);
+    
+    // Objects are immutable, so one already stored is left alone
+    if ((size_t)snprintf(object, sizeof(object), "%s/%s", publish->object_dir, hex) >= sizeof(object)) {
+        log_message(LOG_ERROR, "Object directory path too long: %s", publish->object_dir);
+        close(fd);
+        return -1;
+    }
+    if (access(object, F_OK) != 0) {
+        if (store_object(fd, object) != 0) {
+            log_message(LOG_ERROR, "Cannot write %s: %s", object, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        publish->stored++;
+    }
+    close(fd);
+    
+    fprintf(publish->index, "%s %llu %s\n", hex, (unsigned long long)st->st_size, relative);
+    publish->files++;
+    publish->bytes += (uint64_t)st->st_size;
+    return 0;
+}
+
+/**
+ * @brief Publish every file below a resource directory, in name order
+ * @param publish Publishing state
+ * @param root Path of resources/
+ * @param relative Directory below resources/, "" for resources/ itself
+ * @param depth Current recursion depth
+ * @return 0 on success, -1 on failure
+ */
+static int publish_directory(lazy_publish_t *publish, const char *root, const char *relative, unsigned int depth) {
+    char path[MAX_PATH_LENGTH];
+    struct dirent **entries;
+    int result = 0;
+    int count;
+    
+    if (depth >= LAZY_MAX_DEPTH) {
+        log_message(LOG_ERROR, "%s/%s nests deeper than %d directories", root, relative, LAZY_MAX_DEPTH);
+        return -1;
+    }
+    if ((size_t)snprintf(path, sizeof(path), "%s%s%s", root, relative[0] ? "/" : "", relative) >= sizeof(path)) {
+        log_message(LOG_ERROR, "Path too long: %s/%s", root, relative);
+        return -1;
+    }
+    count = scandir(path, &entries, NULL, alphasort);
+    if (count < 0) {
+        log_message(LOG_ERROR, "Cannot list %s: %s", path, strerror(errno));
+        return -1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        const char *name = entries[i]->d_name;
+        char child[MAX_PATH_LENGTH];
+        char full[MAX_PATH_LENGTH];
+        struct stat st;
+        
+        if (result != 0 || strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        if (strchr(name, '\n') ||
+            (size_t)snprintf(child, sizeof(child), "%s%s%s", relative, relative[0] ? "/" : "", name) >= sizeof(child) ||
+            (size_t)snprintf(full, sizeof(full), "%s/%s", root, child) >= sizeof(full) || lstat(full, &st) != 0) {
+            log_message(LOG_ERROR, "Cannot publish %s/%s", path, name);
+            result = -1;
+        } else if (S_ISDIR(st.st_mode)) {
+            result = publish_directory(publish, root, child, depth + 1);
+        } else if (S_ISREG(st.st_mode)) {
+            result = publish_file(publish, full, child, &st);
+        } else {
+            log_message(LOG_WARNING, "Skipping %s: not a regular file", full);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        free(entries[i]);
+    }
+    free(entries);
+    return result;
+}
+
+/**
+ * @brief Write the resource index of a bundle and store its objects
+ * @param bundle_path Bundle directory with a complete resources/
+ * @param object_dir Directory to store the objects in, served as the resource URL
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int lazy_resources_publish(const char *bundle_path, const char *object_dir) {
+    char temp_name[sizeof(LAZY_INDEX_FILE) + 16];
+    char root[MAX_PATH_LENGTH];
+    lazy_publish_t publish;
+    bundle_probe_t probe;
+    int result = EXIT_SUCCESS;
+    int fd;
+    
+    bundle_probe_open(&probe, bundle_path);
+    if (probe.image_path[0] != '\0' || !bundle_probe_is_directory(&probe, COMPONENT_RESOURCES) ||
+        bundle_probe_component_path(&probe, COMPONENT_RESOURCES, root, sizeof(root)) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "Not a bundle directory with resources/: %s", bundle_path);
+        bundle_probe_close(&probe);
+        return EXIT_BUNDLE_ERROR;
+    }
+    if (mkdir(object_dir, 0755) != 0 && errno != EEXIST) {
+        log_message(LOG_ERROR, "Cannot create %s: %s", object_dir, strerror(errno));
+        bundle_probe_close(&probe);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    memset(&publish, 0, sizeof(publish));
+    publish.object_dir = object_dir;
+    snprintf(temp_name, sizeof(temp_name), "%s.%ld", LAZY_INDEX_FILE, (long)getpid());
+    fd = openat(probe.dirfd, temp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    publish.index = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (publish.index == NULL) {
+        log_message(LOG_ERROR, "Cannot write %s/%s: %s", bundle_path, LAZY_INDEX_FILE, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        bundle_probe_close(&probe);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (publish_directory(&publish, root, "", 0) != 0) {
+        result = EXIT_BUNDLE_ERROR;
+    }
+    if (fclose(publish.index) != 0 || result != EXIT_SUCCESS ||
+        renameat(probe.dirfd, temp_name, probe.dirfd, LAZY_INDEX_FILE) != 0) {
+        if (result == EXIT_SUCCESS) {
+            log_message(LOG_ERROR, "Cannot write %s/%s: %s", bundle_path, LAZY_INDEX_FILE, strerror(errno));
+            result = EXIT_SYSTEM_ERROR;
+        }
+        unlinkat(probe.dirfd, temp_name, 0);
+    }
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Published %u resources (%llu bytes, %u new objects) of %s to %s", publish.files,
+                    (unsigned long long)publish.bytes, publish.stored, bundle_path, object_dir);
+    }
+    bundle_probe_close(&probe);
+    return result;
+}
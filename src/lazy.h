@@ -0,0 +1,96 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file lazy.h
+ * @brief Lazily fetched bundle resources
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A bundle may ship LAZY_INDEX_FILE instead of the contents of its
+ * resources/ directory. Each line of the index is
+ *
+ *   <sha256> <size> <path below resources/>
+ *
+ * and the contents are objects named by their SHA-256 below an HTTP
+ * base URL, taken from LAZY_URL_ENV or the "resources-url" key of
+ * info.yaml. --publish writes the index and the objects for a bundle
+ * whose resources/ is still complete.
+ *
+ * At launch the index is mounted over the (empty) resources/ directory
+ * with FUSE, in a mount namespace of the application's own. Listing
+ * and stat() are answered from the index. The first open() of a file
+ * downloads its object with up to LAZY_CONNECTIONS parallel range
+ * requests into a local cache shared by every bundle, where it is
+ * checked against its digest; later opens read the cached copy. The
+ * cache is kept below LAZY_CACHE_ENV megabytes by dropping the objects
+ * opened longest ago.
+ *
+ * The FUSE server is a child of the application that dies with it and
+ * is invisible to its wait() calls. Only plain http:// is spoken; in a
+ * sandbox with a network namespace, only cached objects can be read.
+ */
+
+#ifndef VLAUNCH_LAZY_H
+#define VLAUNCH_LAZY_H
+
+#include "launcher.h"
+
+/* Lazy Resource Configuration */
+#define LAZY_INDEX_FILE         "resources.index"
+#define LAZY_URL_ENV            "VLAUNCH_RESOURCE_URL"
+#define LAZY_CACHE_ENV          "VLAUNCH_RESOURCE_CACHE_MB"
+#define LAZY_CACHE_DIR          "objects"
+#define LAZY_CACHE_DEFAULT_MB   2048
+#define LAZY_INDEX_MAX_SIZE     (16 * 1024 * 1024)
+#define LAZY_MAX_FILES          65536
+#define LAZY_MAX_DEPTH          16
+
+/* Fetching */
+#define LAZY_RANGE_SIZE         (4 * 1024 * 1024)
+#define LAZY_CONNECTIONS        4
+#define LAZY_RETRIES            3
+#define LAZY_IO_TIMEOUT         30
+
+/* FUSE Server */
+#define LAZY_SERVER_THREADS     4
+#define LAZY_MAX_READ           (128 * 1024)
+#define LAZY_REQUEST_SIZE       (LAZY_MAX_READ + 4096)
+#define LAZY_ATTR_TIMEOUT       3600
+
+int lazy_resources_active(const bundle_probe_t *probe);
+int lazy_resources_attach(const bundle_probe_t *probe);
+int lazy_resources_publish(const char *bundle_path, const char *object_dir);
+
+#endif /* VLAUNCH_LAZY_H */
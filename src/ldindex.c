@@ -0,0 +1,471 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ldindex.c
+ * @brief Per-bundle shared library index
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The index is stored as .ld-index in the bundle directory, or under
+ * $XDG_CACHE_HOME/vlaunch/ldindex when the bundle is read-only. It
+ * records the identity and mtime of every layer libpath_bundle_layers()
+ * reports and is rebuilt whenever they change or the bundle moves. At
+ * launch the launcher points the LD_AUDIT module at the index instead of
+ * prepending the layers to LD_LIBRARY_PATH.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "elfinfo.h"
+#include "ldindex.h"
+#include "libpath.h"
+#include "environment.h"
+
+/* Library discovered while building the index */
+typedef struct {
+    char *name;
+    char *path;
+    int canonical;
+    int layer;
+} ldindex_build_entry_t;
+
+/* Growable list of discovered libraries */
+typedef struct {
+    ldindex_build_entry_t *entries;
+    size_t count;
+    size_t capacity;
+} ldindex_build_t;
+
+static int ldindex_mode;
+
+/**
+ * @brief Enable or disable index-based library resolution
+ * @param enabled Non-zero to resolve bundle libraries through the index
+ */
+void ldindex_set_enabled(int enabled) {
+    ldindex_mode = enabled;
+}
+
+/**
+ * @brief Check whether index-based library resolution is enabled
+ * @return 1 if enabled, 0 otherwise
+ */
+int ldindex_enabled(void) {
+    return ldindex_mode;
+}
+
+/**
+ * @brief Record the identity of the layers an index is built from
+ * @param layers Layers in search order
+ * @param count Number of layers
+ * @param out Receives the identities, zero-filled past count
+ */
+static void take_layers(const libpath_layer_t *layers, int count, ldindex_layer_t out[LDINDEX_MAX_LAYERS]) {
+    memset(out, 0, LDINDEX_MAX_LAYERS * sizeof(*out));
+    for (int i = 0; i < count && i < LDINDEX_MAX_LAYERS; i++) {
+        out[i].dev = makedev(layers[i].stx.stx_dev_major, layers[i].stx.stx_dev_minor);
+        out[i].ino = layers[i].stx.stx_ino;
+        out[i].mtime_sec = layers[i].stx.stx_mtime.tv_sec;
+        out[i].mtime_nsec = layers[i].stx.stx_mtime.tv_nsec;
+    }
+}
+
+/**
+ * @brief Check whether an index file still describes the library layers
+ * @param dirfd Directory the index path is relative to
+ * @param path Index file path
+ * @param layers Current identities of the layers
+ * @param root Current absolute path of library/
+ * @return 1 if the index is current, 0 otherwise
+ */
+static int index_is_current(int dirfd, const char *path, const ldindex_layer_t layers[LDINDEX_MAX_LAYERS],
+                            const char *root) {
+    char stored_root[MAX_PATH_LENGTH];
+    ldindex_header_t header;
+    size_t root_length = strlen(root) + 1;
+    int current = 0;
+    int fd;
+    
+    fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    
+    if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        header.magic == LDINDEX_MAGIC &&
+        header.version == LDINDEX_VERSION &&
+        memcmp(header.layers, layers, sizeof(header.layers)) == 0 &&
+        header.root_offset < header.strings_size &&
+        root_length <= header.strings_size - header.root_offset &&
+        pread(fd, stored_root, root_length, (off_t)header.strings_offset + header.root_offset) == (ssize_t)root_length) {
+        current = memcmp(stored_root, root, root_length) == 0;
+    }
+    
+    close(fd);
+    return current;
+}
+
+/**
+ * @brief Record a library under a lookup name
+ * @param build Entry list
+ * @param name Name the loader will ask for
+ * @param path Absolute path of the library
+ * @param canonical Non-zero if the file name equals the name
+ * @param layer Search order of the layer the library is in
+ * @return 0 on success, -1 on allocation failure
+ */
+static int build_add(ldindex_build_t *build, const char *name, const char *path, int canonical, int layer) {
+    if (build->count == build->capacity) {
+        size_t capacity = build->capacity ? build->capacity * 2 : 64;
+        ldindex_build_entry_t *entries = realloc(build->entries, capacity * sizeof(*entries));
+        if (!entries) {
+            return -1;
+        }
+        build->entries = entries;
+        build->capacity = capacity;
+    }
+    
+    ldindex_build_entry_t *entry = &build->entries[build->count];
+    entry->name = strdup(name);
+    entry->path = strdup(path);
+    entry->canonical = canonical;
+    entry->layer = layer;
+    if (!entry->name || !entry->path) {
+        free(entry->name);
+        free(entry->path);
+        return -1;
+    }
+    
+    build->count++;
+    return 0;
+}
+
+/**
+ * @brief Release a build entry list
+ * @param build Entry list
+ */
+static void build_free(ldindex_build_t *build) {
+    for (size_t i = 0; i < build->count; i++) {
+        free(build->entries[i].name);
+        free(build->entries[i].path);
+    }
+    free(build->entries);
+}
+
+/**
+ * @brief Order entries by name, preferring a file named after the soname, then the earlier layer
+ * @param a First entry
+ * @param b Second entry
+ * @return Comparison result for qsort
+ */
+static int compare_build_entries(const void *a, const void *b) {
+    const ldindex_build_entry_t *left = a;
+    const ldindex_build_entry_t *right = b;
+    int cmp = strcmp(left->name, right->name);
+    
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (left->canonical != right->canonical) {
+        return right->canonical - left->canonical;
+    }
+    return left->layer - right->layer;
+}
+
+/**
+ * @brief Scan a library layer and collect every shared object by soname and file name
+ * @param probe Opened bundle probe
+ * @param layer Layer path relative to the bundle
+ * @param order Search order of the layer
+ * @param root Absolute path of the layer
+ * @param build Receives the discovered libraries
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+static int scan_library_directory(const bundle_probe_t *probe, const char *layer, int order, const char *root,
+                                  ldindex_build_t *build) {
+    char path[MAX_PATH_LENGTH];
+    struct dirent *entry;
+    int libfd;
+    DIR *dir;
+    
+    libfd = openat(probe->dirfd, layer, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (libfd < 0 || !(dir = fdopendir(libfd))) {
+        if (libfd >= 0) {
+            close(libfd);
+        }
+        log_message(LOG_WARNING, "Cannot scan library directory %s: %s", root, strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        elf_info_t elf;
+        
+        if (entry->d_name[0] == '.' ||
+            (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)) {
+            continue;
+        }
+        if (elf_open(libfd, entry->d_name, &elf) != 0) {
+            continue;
+        }
+        if (!elf.is_shared_object ||
+            snprintf(path, sizeof(path), "%s/%s", root, entry->d_name) >= (int)sizeof(path)) {
+            elf_close(&elf);
+            continue;
+        }
+        
+        const char *soname = elf.soname ? elf.soname : entry->d_name;
+        int failed = build_add(build, soname, path, strcmp(soname, entry->d_name) == 0, order) != 0;
+        if (!failed && strcmp(soname, entry->d_name) != 0) {
+            failed = build_add(build, entry->d_name, path, 1, order) != 0;
+        }
+        elf_close(&elf);
+        
+        if (failed) {
+            closedir(dir);
+            log_message(LOG_ERROR, "Out of memory while indexing %s", root);
+            return EXIT_SYSTEM_ERROR;
+        }
+    }
+    
+    closedir(dir);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Serialize the collected libraries into an index file
+ * @param dirfd Directory the index path is relative to
+ * @param path Index file path
+ * @param build Sorted, de-duplicated entry list
+ * @param layers Identities of the layers at scan time
+ * @param root Absolute path of library/
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int write_index(int dirfd, const char *path, const ldindex_build_t *build,
+                       const ldindex_layer_t layers[LDINDEX_MAX_LAYERS], const char *root) {
+    char temp_path[MAX_PATH_LENGTH + 16];
+    ldindex_header_t header;
+    ldindex_entry_t *entries;
+    char *strings;
+    size_t strings_size = strlen(root) + 1;
+    size_t used = 0;
+    int result = EXIT_SYSTEM_ERROR;
+    int fd;
+    
+    for (size_t i = 0; i < build->count; i++) {
+        strings_size += strlen(build->entries[i].name) + strlen(build->entries[i].path) + 2;
+    }
+    if (strings_size > UINT32_MAX) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    entries = calloc(build->count ? build->count : 1, sizeof(*entries));
+    strings = malloc(strings_size);
+    if (!entries || !strings) {
+        free(entries);
+        free(strings);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = LDINDEX_MAGIC;
+    header.version = LDINDEX_VERSION;
+    header.entry_count = (uint32_t)build->count;
+    memcpy(header.layers, layers, sizeof(header.layers));
+    header.strings_offset = (uint32_t)(sizeof(header) + build->count * sizeof(*entries));
+    header.strings_size = (uint32_t)strings_size;
+    
+    header.root_offset = 0;
+    memcpy(strings, root, strlen(root) + 1);
+    used = strlen(root) + 1;
+    for (size_t i = 0; i < build->count; i++) {
+        size_t name_length = strlen(build->entries[i].name) + 1;
+        size_t path_length = strlen(build->entries[i].path) + 1;
+        
+        entries[i].name_offset = (uint32_t)used;
+        memcpy(strings + used, build->entries[i].name, name_length);
+        used += name_length;
+        entries[i].path_offset = (uint32_t)used;
+        memcpy(strings + used, build->entries[i].path, path_length);
+        used += path_length;
+    }
+    
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long)getpid());
+    fd = openat(dirfd, temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        int failed = write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+                     write(fd, entries, build->count * sizeof(*entries)) != (ssize_t)(build->count * sizeof(*entries)) ||
+                     write(fd, strings, strings_size) != (ssize_t)strings_size;
+        if (close(fd) == 0 && !failed && renameat(dirfd, temp_path, dirfd, path) == 0) {
+            result = EXIT_SUCCESS;
+        } else {
+            unlinkat(dirfd, temp_path, 0);
+        }
+    }
+    
+    free(entries);
+    free(strings);
+    return result;
+}
+
+/**
+ * @brief Find a current library index for a bundle, rebuilding it if needed
+ * @param probe Opened bundle probe with an existing library/ directory
+ * @param index_path Receives the absolute path of the index
+ * @param size Size of index_path
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int ldindex_prepare(const bundle_probe_t *probe, char *index_path, size_t size) {
+    libpath_layer_t layers[LIBPATH_LAYER_COUNT];
+    ldindex_layer_t identities[LDINDEX_MAX_LAYERS];
+    char root[MAX_PATH_LENGTH];
+    char cache_path[MAX_PATH_LENGTH];
+    ldindex_build_t build = { NULL, 0, 0 };
+    size_t unique = 0;
+    int layer_count = libpath_bundle_layers(probe, layers);
+    int have_cache_path;
+    int result = EXIT_SUCCESS;
+    
+    // The application may chdir() before the loader reads the index, so every path in it is absolute
+    if (layer_count > LDINDEX_MAX_LAYERS ||
+        bundle_probe_resolved_path(probe, COMPONENT_LIBRARY, root, sizeof(root)) != EXIT_SUCCESS ||
+        bundle_probe_resolved_path(probe, COMPONENT_ROOT, index_path, size) != EXIT_SUCCESS ||
+        strlen(index_path) + sizeof(LDINDEX_FILE_NAME) + 1 > size) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    strcat(index_path, "/" LDINDEX_FILE_NAME);
+    take_layers(layers, layer_count, identities);
+    have_cache_path = cache_entry_path(LDINDEX_CACHE_DIR, root, cache_path, sizeof(cache_path)) == EXIT_SUCCESS;
+    
+    // Fast path: an index next to the bundle, then one in the user cache
+    if (index_is_current(probe->dirfd, LDINDEX_FILE_NAME, identities, root)) {
+        return EXIT_SUCCESS;
+    }
+    if (have_cache_path && index_is_current(AT_FDCWD, cache_path, identities, root)) {
+        snprintf(index_path, size, "%s", cache_path);
+        return EXIT_SUCCESS;
+    }
+    
+    log_message(LOG_INFO, "Building library index for %s", root);
+    for (int i = 0; i < layer_count && result == EXIT_SUCCESS; i++) {
+        char layer_root[MAX_PATH_LENGTH];
+        
+        // Layer paths all start with library/, so the rest extends root
+        if ((size_t)snprintf(layer_root, sizeof(layer_root), "%s%s", root,
+                             layers[i].path + strlen(bundle_component_paths[COMPONENT_LIBRARY])) >= sizeof(layer_root)) {
+            result = EXIT_SYSTEM_ERROR;
+            break;
+        }
+        result = scan_library_directory(probe, layers[i].path, i, layer_root, &build);
+    }
+    if (result != EXIT_SUCCESS) {
+        build_free(&build);
+        return result;
+    }
+    
+    // Sort by name and keep the preferred path for each name
+    qsort(build.entries, build.count, sizeof(*build.entries), compare_build_entries);
+    for (size_t i = 0; i < build.count; i++) {
+        if (unique > 0 && strcmp(build.entries[unique - 1].name, build.entries[i].name) == 0) {
+            free(build.entries[i].name);
+            free(build.entries[i].path);
+            continue;
+        }
+        build.entries[unique++] = build.entries[i];
+    }
+    build.count = unique;
+    
+    result = write_index(probe->dirfd, LDINDEX_FILE_NAME, &build, identities, root);
+    if (result != EXIT_SUCCESS && have_cache_path) {
+        log_message(LOG_DEBUG, "Bundle not writable, storing library index in cache");
+        result = write_index(AT_FDCWD, cache_path, &build, identities, root);
+        if (result == EXIT_SUCCESS) {
+            snprintf(index_path, size, "%s", cache_path);
+        }
+    }
+    
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Indexed %zu shared libraries in %s", build.count, root);
+    } else {
+        log_message(LOG_WARNING, "Failed to write library index for %s", root);
+    }
+    build_free(&build);
+    return result;
+}
+
+/**
+ * @brief Point the dynamic loader at the bundle's library index
+ * @param probe Opened bundle probe with an existing library/ directory
+ * @param env Environment of the application
+ * @return EXIT_SUCCESS on success, error code if the caller should fall back to LD_LIBRARY_PATH
+ */
+int configure_library_index(const bundle_probe_t *probe, env_builder_t *env) {
+    char index_path[MAX_PATH_LENGTH];
+    char audit_path[MAX_PATH_LENGTH];
+    const char *audit_override = env_builder_get(env, LDINDEX_AUDIT_ENV);
+    
+    if (audit_override && audit_override[0] != '\0') {
+        snprintf(audit_path, sizeof(audit_path), "%s", audit_override);
+    } else {
+        snprintf(audit_path, sizeof(audit_path), "%s/%s", VLAUNCH_LIBDIR, LDINDEX_AUDIT_NAME);
+    }
+    if (access(audit_path, R_OK) != 0) {
+        log_message(LOG_WARNING, "Library audit module not found: %s", audit_path);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (ldindex_prepare(probe, index_path, sizeof(index_path)) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (env_builder_set(env, LDINDEX_ENV, index_path) != 0 || env_builder_prepend(env, "LD_AUDIT", audit_path) != 0) {
+        log_message(LOG_ERROR, "Failed to configure library index: %s", strerror(ENOMEM));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_message(LOG_INFO, "Library index configured: %s", index_path);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file ldindex.h
+ * @brief Per-bundle shared library index
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * An ld.so.cache-style map from soname to absolute path of every shared
+ * object in a bundle's library/<arch> and library/ directories, resolved
+ * in that order as LD_LIBRARY_PATH would. The launcher builds it and
+ * the LD_AUDIT module (audit.c) consults it, so the dynamic loader finds
+ * bundle libraries without probing LD_LIBRARY_PATH directories.
+ *
+ * The on-disk format below is shared by both sides and must stay free of
+ * launcher dependencies.
+ */
+
+#ifndef VLAUNCH_LDINDEX_H
+#define VLAUNCH_LDINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Index Format */
+#define LDINDEX_MAGIC       0x43444c56u /* "VLDC" */
+#define LDINDEX_VERSION     2
+#define LDINDEX_MAX_LAYERS  2
+#define LDINDEX_FILE_NAME   ".ld-index"
+#define LDINDEX_CACHE_DIR   "ldindex"
+#define LDINDEX_ENV         "VLAUNCH_LD_INDEX"
+#define LDINDEX_AUDIT_ENV   "VLAUNCH_AUDIT_LIB"
+#define LDINDEX_AUDIT_NAME  "vlaunch-audit.so"
+
+#ifndef VLAUNCH_LIBDIR
+#define VLAUNCH_LIBDIR      "/usr/local/lib/launcher"
+#endif
+
+/* Identity of an indexed library directory; all zero past the last layer */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+} ldindex_layer_t;
+
+/* Index file header; entries and the string table follow */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t root_offset;
+    ldindex_layer_t layers[LDINDEX_MAX_LAYERS];
+    uint32_t strings_offset;
+    uint32_t strings_size;
+} ldindex_header_t;
+
+/* One soname, sorted by name; offsets point into the string table */
+typedef struct {
+    uint32_t name_offset;
+    uint32_t path_offset;
+} ldindex_entry_t;
+
+/**
+ * @brief Check that a mapped index is structurally sound
+ * @param map Start of the mapped index
+ * @param size Size of the mapping
+ * @return 1 if the index can be searched, 0 otherwise
+ */
+static inline int ldindex_valid(const void *map, size_t size) {
+    const ldindex_header_t *header = map;
+    
+    return size >= sizeof(*header) &&
+           header->magic == LDINDEX_MAGIC &&
+           header->version == LDINDEX_VERSION &&
+           header->strings_offset <= size &&
+           header->strings_size <= size - header->strings_offset &&
+           header->strings_size > 0 &&
+           ((const char *)map)[header->strings_offset + header->strings_size - 1] == '\0' &&
+           (size - sizeof(*header)) / sizeof(ldindex_entry_t) >= header->entry_count;
+}
+
+/**
+ * @brief Look up the absolute path of a library by soname
+ * @param map Start of a validated index mapping
+ * @param name Soname requested by the loader
+ * @return Absolute path inside the mapping, or NULL if the name is unknown
+ */
+static inline const char *ldindex_lookup(const void *map, const char *name) {
+    const ldindex_header_t *header = map;
+    const ldindex_entry_t *entries = (const ldindex_entry_t *)(header + 1);
+    const char *strings = (const char *)map + header->strings_offset;
+    uint32_t low = 0;
+    uint32_t high = header->entry_count;
+    
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const ldindex_entry_t *entry = &entries[mid];
+        
+        if (entry->name_offset >= header->strings_size || entry->path_offset >= header->strings_size) {
+            return NULL;
+        }
+        
+        int cmp = strcmp(name, strings + entry->name_offset);
+        if (cmp == 0) {
+            return strings + entry->path_offset;
+        }
+        if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    return NULL;
+}
+
+#ifndef LDINDEX_FORMAT_ONLY
+#include "launcher.h"
+
+void ldindex_set_enabled(int enabled);
+int ldindex_enabled(void);
+int ldindex_prepare(const bundle_probe_t *probe, char *index_path, size_t size);
+int configure_library_index(const bundle_probe_t *probe, env_builder_t *env);
+#endif
+
+#endif /* VLAUNCH_LDINDEX_H */
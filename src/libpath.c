@@ -0,0 +1,367 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file libpath.c
+ * @brief Layered, deduplicated LD_LIBRARY_PATH for launched bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Lists are built as colon-separated strings that are compared entry by
+ * entry; they are short, so a linear scan beats anything fancier.
+ * Trailing slashes are dropped before comparing, and empty entries,
+ * which the loader would take as the current directory, are dropped.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "environment.h"
+#include "libpath.h"
+
+/* A colon-separated directory list being built, on the heap only once it outgrows storage */
+typedef struct {
+    char *text;
+    size_t length;
+    size_t capacity;
+    char storage[LIBPATH_INLINE_SIZE];
+} libpath_list_t;
+
+/**
+ * @brief Find a directory in a list
+ * @param list Colon-separated list, may be NULL
+ * @param entry Directory
+ * @param length Length of entry
+ * @return Non-zero if the list has the directory
+ */
+static int list_contains(const char *list, const char *entry, size_t length) {
+    while (list != NULL && *list) {
+        const char *end = strchr(list, ENV_PATH_SEPARATOR);
+        size_t current = end ? (size_t)(end - list) : strlen(list);
+        
+        while (current > 1 && list[current - 1] == '/') {
+            current--;
+        }
+        if (current == length && memcmp(list, entry, length) == 0) {
+            return 1;
+        }
+        list = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+/**
+ * @brief Append a directory unless the list already has it
+ * @param list List to extend
+ * @param entry Directory
+ * @param length Length of entry
+ * @return 0 on success, -1 if out of memory
+ */
+static int list_add(libpath_list_t *list, const char *entry, size_t length) {
+    while (length > 1 && entry[length - 1] == '/') {
+        length--;
+    }
+    if (length == 0 || list_contains(list->text, entry, length)) {
+        return 0;
+    }
+    
+    if (list->length + length + 2 > list->capacity) {
+        size_t capacity = (list->length + length + 2) * 2;
+        char *text = list->text == list->storage ? malloc(capacity) : realloc(list->text, capacity);
+        if (text == NULL) {
+            return -1;
+        }
+        if (list->text == list->storage) {
+            memcpy(text, list->storage, list->length + 1);
+        }
+        list->text = text;
+        list->capacity = capacity;
+    }
+    if (list->length > 0) {
+        list->text[list->length++] = ENV_PATH_SEPARATOR;
+    }
+    memcpy(list->text + list->length, entry, length);
+    list->length += length;
+    list->text[list->length] = '\0';
+    return 0;
+}
+
+/* Layers below a bundle or runtime directory; architecture-specific objects shadow the generic ones */
+static const char *const layer_paths[LIBPATH_LAYER_COUNT] = {
+    (LIB_PATH "/" VLAUNCH_ARCH) + 1,
+    LIB_PATH + 1
+};
+
+/**
+ * @brief Find the library directories of a bundle, in search order
+ * @param probe Opened bundle probe
+ * @param layers Receives the directories that exist and their stat results
+ * @return Number of directories found
+ */
+int libpath_bundle_layers(const bundle_probe_t *probe, libpath_layer_t layers[LIBPATH_LAYER_COUNT]) {
+    int found = 0;
+    
+    // library/<arch> can only exist inside library/, whose state the probe already has
+    if (!bundle_probe_is_directory(probe, COMPONENT_LIBRARY)) {
+        return 0;
+    }
+    for (int i = 0; i < LIBPATH_LAYER_COUNT; i++) {
+        if (strcmp(layer_paths[i], bundle_component_paths[COMPONENT_LIBRARY]) == 0) {
+            layers[found].stx = probe->components[COMPONENT_LIBRARY];
+        } else if (statx(probe->dirfd, layer_paths[i], 0, PROBE_STATX_MASK, &layers[found].stx) != 0 ||
+                   !S_ISDIR(layers[found].stx.stx_mode)) {
+            continue;
+        }
+        layers[found++].path = layer_paths[i];
+    }
+    
+    return found;
+}
+
+/**
+ * @brief Append the library directories of a bundle
+ * @param probe Opened bundle probe
+ * @param list List to extend
+ * @return 0 on success, -1 if out of memory
+ */
+static int add_bundle_layers(const bundle_probe_t *probe, libpath_list_t *list) {
+    libpath_layer_t layers[LIBPATH_LAYER_COUNT];
+    char path[MAX_PATH_LENGTH];
+    int count = libpath_bundle_layers(probe, layers);
+    
+    for (int i = 0; i < count; i++) {
+        if ((size_t)snprintf(path, sizeof(path), "%s/%s", probe->path, layers[i].path) < sizeof(path) &&
+            list_add(list, path, strlen(path)) != 0) {
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Append the library directories below a runtime
+ * @param list List to extend
+ * @param root Runtime directory
+ * @return Number of directories found, or -1 if out of memory
+ */
+static int add_runtime_layers(libpath_list_t *list, const char *root) {
+    char path[MAX_PATH_LENGTH];
+    struct stat st;
+    int found = 0;
+    int fd = open(root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    
+    for (int i = 0; fd >= 0 && i < LIBPATH_LAYER_COUNT; i++) {
+        if (fstatat(fd, layer_paths[i], &st, 0) != 0 || !S_ISDIR(st.st_mode) ||
+            (size_t)snprintf(path, sizeof(path), "%s/%s", root, layer_paths[i]) >= sizeof(path)) {
+            continue;
+        }
+        if (list_add(list, path, strlen(path)) != 0) {
+            close(fd);
+            return -1;
+        }
+        found++;
+    }
+    
+    if (fd >= 0) {
+        close(fd);
+    }
+    return found;
+}
+
+/**
+ * @brief Find the directory of a shared runtime
+ * @param env Environment of the application, for LIBPATH_RUNTIME_ENV
+ * @param name Runtime name or absolute path
+ * @param length Length of name
+ * @param out Receives the runtime directory
+ * @param size Size of out
+ * @return 0 if found, -1 otherwise
+ */
+static int find_runtime(const env_builder_t *env, const char *name, size_t length, char *out, size_t size) {
+    const char *search = env_builder_get(env, LIBPATH_RUNTIME_ENV);
+    struct stat st;
+    
+    if (name[0] == '/') {
+        return (size_t)snprintf(out, size, "%.*s", (int)length, name) < size &&
+               stat(out, &st) == 0 && S_ISDIR(st.st_mode) ? 0 : -1;
+    }
+    
+    // Bare names cannot climb out of the runtime directories
+    if (memchr(name, '/', length) || (length == 1 && name[0] == '.') ||
+        (length == 2 && name[0] == '.' && name[1] == '.')) {
+        return -1;
+    }
+    if (search == NULL || search[0] == '\0') {
+        search = LIBPATH_RUNTIME_DIRS;
+    }
+    
+    while (search != NULL && *search) {
+        const char *end = strchr(search, ENV_PATH_SEPARATOR);
+        int directory_length = end ? (int)(end - search) : (int)strlen(search);
+        
+        if (directory_length > 0 &&
+            (size_t)snprintf(out, size, "%.*s/%.*s", directory_length, search, (int)length, name) < size &&
+            stat(out, &st) == 0 && S_ISDIR(st.st_mode)) {
+            return 0;
+        }
+        search = end ? end + 1 : NULL;
+    }
+    return -1;
+}
+
+/**
+ * @brief Append the layers of every runtime the bundle declares
+ * @param probe Opened bundle probe
+ * @param env Environment of the application
+ * @param list List to extend
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+static int add_runtimes(const bundle_probe_t *probe, const env_builder_t *env, libpath_list_t *list) {
+    const metadata_value_t *runtimes = &probe->metadata.runtimes;
+    size_t position = 0;
+    
+    // Names are separated by commas or blanks, e.g. "runtimes: gtk3-3.24, /opt/qt6"
+    while (position < runtimes->length) {
+        const char *name = runtimes->data + position;
+        char root[MAX_PATH_LENGTH];
+        size_t length = 0;
+        int found;
+        
+        while (position + length < runtimes->length && !strchr(", \t", name[length])) {
+            length++;
+        }
+        position += length + 1;
+        if (length == 0) {
+            continue;
+        }
+        
+        if (find_runtime(env, name, length, root, sizeof(root)) != 0) {
+            log_message(LOG_ERROR, "Runtime not found: %.*s", (int)length, name);
+            return EXIT_BUNDLE_ERROR;
+        }
+        found = add_runtime_layers(list, root);
+        if (found < 0) {
+            return EXIT_SYSTEM_ERROR;
+        }
+        if (found == 0) {
+            log_message(LOG_WARNING, "Runtime has no library directory: %s", root);
+        }
+        log_message(LOG_DEBUG, "Runtime %.*s: %s", (int)length, name, root);
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Set LD_LIBRARY_PATH to the layered search list of a bundle
+ * @param probe Opened bundle probe
+ * @param env Environment of the application
+ * @param bundle_indexed Non-zero if the bundle's layers are served by the library index
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int libpath_configure(const bundle_probe_t *probe, env_builder_t *env, int bundle_indexed) {
+    libpath_list_t search;
+    const char *inherited = env_builder_get(env, LIBPATH_ENV);
+    const char *stale = env_builder_get(env, LIBPATH_LAYERS_ENV);
+    size_t layer_length;
+    int result = EXIT_SUCCESS;
+    int failed = 0;
+    
+    search.text = search.storage;
+    search.text[0] = '\0';
+    search.length = 0;
+    search.capacity = sizeof(search.storage);
+    // The library index resolves names across all of the bundle's layers
+    if (!bundle_indexed) {
+        failed = add_bundle_layers(probe, &search) != 0;
+    }
+    if (!failed) {
+        result = add_runtimes(probe, env, &search);
+    }
+    layer_length = search.length;
+    
+    // Layers of the bundle that launched this one are not needed by it
+    for (const char *entry = inherited; !failed && result == EXIT_SUCCESS && entry != NULL && *entry; ) {
+        const char *end = strchr(entry, ENV_PATH_SEPARATOR);
+        size_t length = end ? (size_t)(end - entry) : strlen(entry);
+        size_t trimmed = length;
+        
+        while (trimmed > 1 && entry[trimmed - 1] == '/') {
+            trimmed--;
+        }
+        if (!list_contains(stale, entry, trimmed) && list_add(&search, entry, length) != 0) {
+            failed = 1;
+        }
+        entry = end ? end + 1 : NULL;
+    }
+    
+    if (!failed && result == EXIT_SUCCESS) {
+        if (search.length > 0) {
+            failed = env_builder_set(env, LIBPATH_ENV, search.text) != 0;
+        } else {
+            env_builder_unset(env, LIBPATH_ENV);
+        }
+        
+        // The layers are the head of the list; note them for nested launches
+        if (!failed && layer_length > 0) {
+            search.text[layer_length] = '\0';
+            failed = env_builder_set(env, LIBPATH_LAYERS_ENV, search.text) != 0;
+        } else {
+            env_builder_unset(env, LIBPATH_LAYERS_ENV);
+        }
+    }
+    
+    if (failed) {
+        log_message(LOG_ERROR, "Failed to set %s: %s", LIBPATH_ENV, strerror(ENOMEM));
+        result = EXIT_SYSTEM_ERROR;
+    } else if (result == EXIT_SUCCESS && layer_length > 0) {
+        log_message(LOG_INFO, "Library path configured: %s", search.text);
+        log_message(LOG_DEBUG, "Full %s: %s", LIBPATH_ENV, env_builder_get(env, LIBPATH_ENV));
+    }
+    
+    if (search.text != search.storage) {
+        free(search.text);
+    }
+    return result;
+}
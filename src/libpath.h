@@ -0,0 +1,102 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file libpath.h
+ * @brief Layered, deduplicated LD_LIBRARY_PATH for launched bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The search list of an application is, in order: library/<arch> and
+ * library/ of the bundle, the same two directories of every runtime
+ * named in the "runtimes" key of info.yaml, then whatever the launcher
+ * inherited. Only directories that exist are added, and no directory
+ * appears twice.
+ *
+ * libpath_bundle_layers() gives the bundle's own layers in that order,
+ * so the library index and the prefetcher resolve names the way the
+ * loader would with this list.
+ *
+ * The launcher notes the layers it added in LIBPATH_LAYERS_ENV. When a
+ * launched application starts another bundle, those layers are removed
+ * from the inherited list first, so nesting does not grow the list.
+ */
+
+#ifndef VLAUNCH_LIBPATH_H
+#define VLAUNCH_LIBPATH_H
+
+#include <sys/stat.h>
+
+#include "launcher.h"
+
+/* Library Path Configuration */
+#define LIBPATH_ENV             "LD_LIBRARY_PATH"
+#define LIBPATH_LAYERS_ENV      "VLAUNCH_LIBRARY_LAYERS"
+#define LIBPATH_RUNTIME_ENV     "VLAUNCH_RUNTIME_PATH"
+#ifndef VLAUNCH_LIBDIR
+#define VLAUNCH_LIBDIR          "/usr/local/lib/launcher"
+#endif
+#define LIBPATH_RUNTIME_DIRS    VLAUNCH_LIBDIR "/runtimes"
+#define LIBPATH_INLINE_SIZE     4096
+#define LIBPATH_LAYER_COUNT     2
+
+/* Subdirectory of library/ for this machine; the MakeFile passes uname -m */
+#ifndef VLAUNCH_ARCH
+#if defined(__x86_64__)
+#define VLAUNCH_ARCH            "x86_64"
+#elif defined(__aarch64__)
+#define VLAUNCH_ARCH            "aarch64"
+#elif defined(__i386__)
+#define VLAUNCH_ARCH            "i686"
+#elif defined(__arm__)
+#define VLAUNCH_ARCH            "armv7l"
+#elif defined(__riscv) && __riscv_xlen == 64
+#define VLAUNCH_ARCH            "riscv64"
+#elif defined(__powerpc64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define VLAUNCH_ARCH            "ppc64le"
+#else
+#define VLAUNCH_ARCH            "unknown"
+#endif
+#endif
+
+/* A library directory of a bundle, in search order */
+typedef struct {
+    const char *path;                   // Relative to the bundle directory
+    struct statx stx;
+} libpath_layer_t;
+
+int libpath_bundle_layers(const bundle_probe_t *probe, libpath_layer_t layers[LIBPATH_LAYER_COUNT]);
+int libpath_configure(const bundle_probe_t *probe, env_builder_t *env, int bundle_indexed);
+
+#endif /* VLAUNCH_LIBPATH_H */
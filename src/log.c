@@ -0,0 +1,279 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file log.c
+ * @brief Buffered logging backend
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Records are formatted in place into a static ring buffer together with
+ * a timestamp prefix that is only re-rendered when the second changes.
+ * Pending records are emitted with one writev() per output stream when
+ * the buffer fills up, when an error is logged, and before the launcher
+ * execs, forks or exits.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "log.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX             1024
+#endif
+
+/* A formatted record waiting in the ring buffer */
+typedef struct {
+    unsigned offset;
+    unsigned length;
+    int fd;
+} log_record_t;
+
+log_level_t log_threshold = LOG_INFO;
+
+static char log_ring[LOG_RING_SIZE];
+static size_t log_ring_used;
+static log_record_t log_pending[LOG_MAX_PENDING];
+static int log_pending_count;
+static int log_flush_registered;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static time_t log_prefix_second = (time_t)-1;
+static char log_prefix[32];
+static size_t log_prefix_length;
+
+/**
+ * @brief Set the runtime log threshold
+ * @param level Most verbose level that is still emitted
+ */
+void log_set_level(log_level_t level) {
+    log_threshold = level;
+}
+
+/**
+ * @brief Parse a log level name
+ * @param name Level name (error, warning, info or debug)
+ * @param level Receives the parsed level
+ * @return 0 on success, -1 if the name is unknown
+ */
+int log_parse_level(const char *name, log_level_t *level) {
+    static const struct {
+        const char *name;
+        log_level_t level;
+    } levels[] = {
+        { "error",   LOG_ERROR   },
+        { "warning", LOG_WARNING },
+        { "warn",    LOG_WARNING },
+        { "info",    LOG_INFO    },
+        { "debug",   LOG_DEBUG   }
+    };
+    
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (strcasecmp(name, levels[i].name) == 0) {
+            *level = levels[i].level;
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * @brief Write a run of iovecs completely, resuming after partial writes
+ * @param fd Destination descriptor
+ * @param iov Vector to write (modified in place)
+ * @param count Number of entries
+ */
+static void write_iov_fully(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+}
+
+/**
+ * @brief Emit all pending records and reset the ring buffer; caller holds log_lock
+ */
+static void flush_pending(void) {
+    struct iovec iov[LOG_MAX_PENDING];
+    int start = 0;
+    int saved_errno = errno;
+    
+    // Preserve ordering across streams by writing runs of records per fd
+    while (start < log_pending_count) {
+        int fd = log_pending[start].fd;
+        int count = 0;
+        
+        while (start + count < log_pending_count &&
+               log_pending[start + count].fd == fd && count < IOV_MAX) {
+            const log_record_t *record = &log_pending[start + count];
+            iov[count].iov_base = log_ring + record->offset;
+            iov[count].iov_len = record->length;
+            count++;
+        }
+        
+        write_iov_fully(fd, iov, count);
+        start += count;
+    }
+    
+    log_pending_count = 0;
+    log_ring_used = 0;
+    errno = saved_errno;
+}
+
+/**
+ * @brief Emit all pending records and reset the ring buffer
+ */
+void log_flush(void) {
+    pthread_mutex_lock(&log_lock);
+    flush_pending();
+    pthread_mutex_unlock(&log_lock);
+}
+
+/**
+ * @brief Refresh the cached timestamp prefix if the second has changed
+ */
+static void update_timestamp_prefix(void) {
+    time_t now = time(NULL);
+    struct tm timeinfo;
+    
+    if (now == log_prefix_second) {
+        return;
+    }
+    
+    localtime_r(&now, &timeinfo);
+    log_prefix_length = strftime(log_prefix, sizeof(log_prefix), "[%Y-%m-%d %H:%M:%S] ", &timeinfo);
+    log_prefix_second = now;
+}
+
+/**
+ * @brief Format a log record into the ring buffer
+ * @param level Log level
+ * @param format Printf-style format string
+ * @param ... Variable arguments
+ */
+void log_write(log_level_t level, const char *format, ...) {
+    const char *level_tag;
+    size_t length;
+    char *record;
+    int saved_errno = errno;
+    int written;
+    
+    switch (level) {
+        case LOG_INFO:
+            level_tag = "ℹ️ INFO: ";
+            break;
+        case LOG_WARNING:
+            level_tag = "⚠️ WARN: ";
+            break;
+        case LOG_ERROR:
+            level_tag = "❌ ERROR: ";
+            break;
+        case LOG_DEBUG:
+            level_tag = "🔍 DEBUG: ";
+            break;
+        default:
+            level_tag = "❓ UNKNOWN: ";
+    }
+    
+    // Worker threads log concurrently, so the ring and the prefix are shared state
+    pthread_mutex_lock(&log_lock);
+    if (!log_flush_registered) {
+        atexit(log_flush);
+        log_flush_registered = 1;
+    }
+    
+    if (log_pending_count == LOG_MAX_PENDING || LOG_RING_SIZE - log_ring_used < LOG_MAX_RECORD) {
+        flush_pending();
+    }
+    
+    update_timestamp_prefix();
+    
+    record = log_ring + log_ring_used;
+    length = strlen(level_tag);
+    memcpy(record, log_prefix, log_prefix_length);
+    memcpy(record + log_prefix_length, level_tag, length);
+    length += log_prefix_length;
+    
+    // Restore errno so %m reports the caller's error
+    errno = saved_errno;
+    va_list args;
+    va_start(args, format);
+    written = vsnprintf(record + length, LOG_MAX_RECORD - length - 1, format, args);
+    va_end(args);
+    
+    if (written > 0) {
+        length += (size_t)written < LOG_MAX_RECORD - length - 1 ? (size_t)written : LOG_MAX_RECORD - length - 2;
+    }
+    record[length++] = '\n';
+    
+    log_pending[log_pending_count].offset = (unsigned)log_ring_used;
+    log_pending[log_pending_count].length = (unsigned)length;
+    log_pending[log_pending_count].fd = level == LOG_ERROR ? STDERR_FILENO : STDOUT_FILENO;
+    log_pending_count++;
+    log_ring_used += length;
+    
+    // Errors are emitted right away so they are never lost or reordered
+    if (level == LOG_ERROR) {
+        flush_pending();
+    }
+    pthread_mutex_unlock(&log_lock);
+    errno = saved_errno;
+}
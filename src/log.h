@@ -0,0 +1,85 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file log.h
+ * @brief Buffered logging backend
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Log records are formatted into a preallocated ring buffer and written
+ * out in batches. Messages above the compile-time level VLAUNCH_LOG_LEVEL
+ * are compiled out; messages above the runtime threshold are skipped
+ * before their arguments are evaluated.
+ */
+
+#ifndef VLAUNCH_LOG_H
+#define VLAUNCH_LOG_H
+
+/* Log Levels, ordered from most to least severe */
+typedef enum {
+    LOG_ERROR,
+    LOG_WARNING,
+    LOG_INFO,
+    LOG_DEBUG
+} log_level_t;
+
+/* Logging Configuration */
+#ifndef VLAUNCH_LOG_LEVEL
+#define VLAUNCH_LOG_LEVEL   LOG_DEBUG
+#endif
+#define LOG_RING_SIZE       16384
+#define LOG_MAX_PENDING     64
+#define LOG_MAX_RECORD      2048
+
+extern log_level_t log_threshold;
+
+/**
+ * @brief Log a message if its level is enabled
+ * @param level Log level
+ * @param ... Printf-style format string and arguments
+ */
+#define log_message(level, ...) \
+    do { \
+        if ((level) <= VLAUNCH_LOG_LEVEL && (level) <= log_threshold) { \
+            log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+void log_write(log_level_t level, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+void log_flush(void);
+void log_set_level(log_level_t level);
+int log_parse_level(const char *name, log_level_t *level);
+
+#endif /* VLAUNCH_LOG_H */
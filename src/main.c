@@ -42,230 +42,207 @@
  * logging capabilities.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
 #include <errno.h>
 #include <time.h>
 #include <limits.h>
 #include <libgen.h>
 #include <stdarg.h>
+#include <getopt.h>
 
-/* Application Configuration */
-#define APP_NAME            "Application Launcher"
-#define APP_VERSION         "1.0.0"
-#define MAX_PATH_LENGTH     PATH_MAX
-#define MAX_ENV_LENGTH      4096
-#define MAX_BUFFER_SIZE     2048
-
-/* Bundle Structure Definitions */
-#define EXEC_PATH           "/exec/base"
-#define LIB_PATH            "/library"
-#define RES_PATH            "/resources"
-#define METADATA_PATH       "/info.yaml"
-#define ICON_PATH           "/icon.png"
-
-/* Exit Codes */
-#define EXIT_SUCCESS        0
-#define EXIT_INVALID_ARGS   1
-#define EXIT_BUNDLE_ERROR   2
-#define EXIT_EXEC_ERROR     3
-#define EXIT_SYSTEM_ERROR   4
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "ldindex.h"
+#include "daemon.h"
+#include "trace.h"
+#include "prefetch.h"
+#include "manifest.h"
+#include "batch.h"
+#include "placement.h"
+#include "pack.h"
+#include "resource.h"
+#include "icon.h"
+#include "catalog.h"
+#include "environment.h"
+#include "supervisor.h"
+#include "handoff.h"
+#include "checkpoint.h"
+#include "integrity.h"
+#include "history.h"
+#include "libpath.h"
+#include "stats.h"
+#include "sandbox.h"
+#include "lazy.h"
 
-/* Log Levels */
-typedef enum {
-    LOG_INFO,
-    LOG_WARNING,
-    LOG_ERROR,
-    LOG_DEBUG
-} log_level_t;
-
-/**
- * @brief Print formatted log message with timestamp
- * @param level Log level
- * @param format Printf-style format string
- * @param ... Variable arguments
- */
-void log_message(log_level_t level, const char *format, ...) {
-    time_t now;
-    struct tm *timeinfo;
-    char timestamp[64];
-    const char *level_str;
-    const char *level_icon;
-    
-    time(&now);
-    timeinfo = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
-    
-    switch (level) {
-        case LOG_INFO:
-            level_str = "INFO";
-            level_icon = "ℹ️";
-            break;
-        case LOG_WARNING:
-            level_str = "WARN";
-            level_icon = "⚠️";
-            break;
-        case LOG_ERROR:
-            level_str = "ERROR";
-            level_icon = "❌";
-            break;
-        case LOG_DEBUG:
-            level_str = "DEBUG";
-            level_icon = "🔍";
-            break;
-        default:
-            level_str = "UNKNOWN";
-            level_icon = "❓";
-    }
-    
-    fprintf(level == LOG_ERROR ? stderr : stdout, 
-            "[%s] %s %s: ", timestamp, level_icon, level_str);
-    
-    va_list args;
-    va_start(args, format);
-    vfprintf(level == LOG_ERROR ? stderr : stdout, format, args);
-    va_end(args);
-    
-    fprintf(level == LOG_ERROR ? stderr : stdout, "\n");
-}
+#ifdef VLAUNCH_PGO
+// Training builds write their profile before exec, which never runs the exit handlers;
+// both PGO phases compile the call, so the control flow matches the profile
+void __gcov_dump(void) __attribute__((weak, visibility("hidden")));
+#endif
 
-/**
- * @brief Check if file exists and is accessible
- * @param path File path to check
- * @return 1 if file exists, 0 otherwise
- */
-int file_exists(const char *path) {
-    if (!path || strlen(path) == 0) {
-        return 0;
-    }
-    
-    struct stat st;
-    if (stat(path, &st) != 0) {
-        return 0;
-    }
-    
-    return S_ISREG(st.st_mode) || S_ISLNK(st.st_mode);
-}
-
-/**
- * @brief Check if directory exists and is accessible
- * @param path Directory path to check
- * @return 1 if directory exists, 0 otherwise
- */
-int directory_exists(const char *path) {
-    if (!path || strlen(path) == 0) {
-        return 0;
-    }
-    
-    struct stat st;
-    if (stat(path, &st) != 0) {
-        return 0;
-    }
-    
-    return S_ISDIR(st.st_mode);
-}
+/* Long options without a short form; one per placement control */
+#define OPTION_PLACEMENT        0x100
+#define OPTION_PASS_FD          0x200
+#define OPTION_SEAL             0x201
+#define OPTION_REQUIRE_DIGESTS  0x202
+#define OPTION_PREWARM          0x203
+#define OPTION_STATS            0x204
+#define OPTION_SANDBOX          0x205
+#define OPTION_PUBLISH          0x206
 
 /**
  * @brief Validate bundle structure
- * @param bundle_path Path to application bundle
+ * @param probe Opened bundle probe
  * @return EXIT_SUCCESS on success, error code on failure
  */
-int validate_bundle(const char *bundle_path) {
+int validate_bundle(const bundle_probe_t *probe) {
     char full_path[MAX_PATH_LENGTH];
     
-    if (!directory_exists(bundle_path)) {
-        log_message(LOG_ERROR, "Bundle directory not found: %s", bundle_path);
+    if (!bundle_probe_is_directory(probe, COMPONENT_ROOT)) {
+        log_message(LOG_ERROR, "Bundle directory not found: %s", probe->path);
         return EXIT_BUNDLE_ERROR;
     }
     
     // Check for required executable
-    snprintf(full_path, sizeof(full_path), "%s%s", bundle_path, EXEC_PATH);
-    if (!file_exists(full_path)) {
+    if (!bundle_probe_is_file(probe, COMPONENT_EXEC)) {
+        bundle_probe_component_path(probe, COMPONENT_EXEC, full_path, sizeof(full_path));
         log_message(LOG_ERROR, "Required executable not found: %s", full_path);
         return EXIT_BUNDLE_ERROR;
     }
     
     // Check if executable is actually executable
-    if (access(full_path, X_OK) != 0) {
+    if (faccessat(probe->dirfd, probe->exec_path, X_OK, 0) != 0) {
+        bundle_probe_component_path(probe, COMPONENT_EXEC, full_path, sizeof(full_path));
         log_message(LOG_ERROR, "Executable lacks execute permissions: %s", full_path);
         return EXIT_BUNDLE_ERROR;
     }
     
-    log_message(LOG_INFO, "Bundle validation successful: %s", bundle_path);
+    // A bundle that lists digests must match them
+    if (integrity_verify(probe) != EXIT_SUCCESS) {
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    log_message(LOG_INFO, "Bundle validation successful: %s", probe->path);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Apply the bundle metadata environment overrides
+ * @param probe Opened bundle probe
+ * @param env Environment of the application
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int configure_environment(const bundle_probe_t *probe, env_builder_t *env) {
+    const bundle_metadata_t *metadata = &probe->metadata;
+    
+    for (unsigned int i = 0; i < metadata->env_count; i++) {
+        const metadata_value_t *name = &metadata->env[i].name;
+        const metadata_value_t *value = &metadata->env[i].value;
+        
+        // XDG_* and every other variable are taken as written, without a length cap
+        if (env_builder_put(env, name->data, name->length, value->data, value->length) != 0) {
+            log_message(LOG_WARNING, "Ignoring invalid environment override: %.*s", (int)name->length, name->data);
+            continue;
+        }
+        log_message(LOG_DEBUG, "Environment override: %.*s=%.*s",
+                    (int)name->length, name->data, (int)value->length, value->data);
+    }
+    
     return EXIT_SUCCESS;
 }
 
 /**
  * @brief Configure library path environment
- * @param bundle_path Path to application bundle
+ * @param probe Opened bundle probe
+ * @param env Environment of the application
  * @return EXIT_SUCCESS on success, error code on failure
  */
-int configure_library_path(const char *bundle_path) {
+int configure_library_path(const bundle_probe_t *probe, env_builder_t *env) {
     char lib_full_path[MAX_PATH_LENGTH];
-    char new_ld_path[MAX_ENV_LENGTH];
-    const char *current_ld_path;
+    int indexed;
     
-    snprintf(lib_full_path, sizeof(lib_full_path), "%s%s", bundle_path, LIB_PATH);
+    if (bundle_probe_component_path(probe, COMPONENT_LIBRARY, lib_full_path, sizeof(lib_full_path)) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "Library path too long: %s", probe->path);
+        return EXIT_SYSTEM_ERROR;
+    }
     
-    // Check if library directory exists
-    if (!directory_exists(lib_full_path)) {
+    // Check if library directory exists; runtimes and the inherited list still apply
+    if (!bundle_probe_is_directory(probe, COMPONENT_LIBRARY)) {
         log_message(LOG_WARNING, "Library directory not found: %s", lib_full_path);
-        return EXIT_SUCCESS; // Not critical, continue execution
     }
     
-    current_ld_path = getenv("LD_LIBRARY_PATH");
+    // Resolve bundle libraries through the index instead of LD_LIBRARY_PATH
+    indexed = bundle_probe_is_directory(probe, COMPONENT_LIBRARY) &&
+              (ldindex_enabled() || probe->metadata.ld_index) && configure_library_index(probe, env) == EXIT_SUCCESS;
     
-    if (current_ld_path && strlen(current_ld_path) > 0) {
-        if (strlen(lib_full_path) + strlen(current_ld_path) + 2 > MAX_ENV_LENGTH) {
-            log_message(LOG_ERROR, "LD_LIBRARY_PATH would exceed maximum length");
-            return EXIT_SYSTEM_ERROR;
-        }
-        snprintf(new_ld_path, sizeof(new_ld_path), "%s:%s", lib_full_path, current_ld_path);
-    } else {
-        snprintf(new_ld_path, sizeof(new_ld_path), "%s", lib_full_path);
-    }
+    return libpath_configure(probe, env, indexed);
+}
+
+/**
+ * @brief Build the environment of a bundle from the launcher's own
+ * @param probe Opened bundle probe
+ * @param env Receives the environment; the caller frees it with env_builder_free()
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int prepare_environment(const bundle_probe_t *probe, env_builder_t *env) {
+    int result;
     
-    if (setenv("LD_LIBRARY_PATH", new_ld_path, 1) != 0) {
-        log_message(LOG_ERROR, "Failed to set LD_LIBRARY_PATH: %s", strerror(errno));
+    if (env_builder_init(env, environ) != 0) {
+        log_message(LOG_ERROR, "Failed to build environment: %s", strerror(ENOMEM));
         return EXIT_SYSTEM_ERROR;
     }
     
-    log_message(LOG_INFO, "Library path configured: %s", lib_full_path);
-    log_message(LOG_DEBUG, "Full LD_LIBRARY_PATH: %s", new_ld_path);
-    
-    return EXIT_SUCCESS;
+    result = configure_environment(probe, env);
+    if (result == EXIT_SUCCESS) {
+        result = configure_library_path(probe, env);
+    }
+    if (result != EXIT_SUCCESS) {
+        env_builder_free(env);
+    }
+    return result;
 }
 
 /**
  * @brief Inspect optional bundle components
- * @param bundle_path Path to application bundle
+ * @param probe Opened bundle probe
  */
-void inspect_optional_components(const char *bundle_path) {
+void inspect_optional_components(const bundle_probe_t *probe) {
     char component_path[MAX_PATH_LENGTH];
     
     // Check metadata file
-    snprintf(component_path, sizeof(component_path), "%s%s", bundle_path, METADATA_PATH);
-    if (file_exists(component_path)) {
+    if (bundle_probe_is_file(probe, COMPONENT_METADATA)) {
+        bundle_probe_component_path(probe, COMPONENT_METADATA, component_path, sizeof(component_path));
         log_message(LOG_INFO, "Metadata file found: %s", component_path);
+        if (probe->metadata.name.length > 0) {
+            log_message(LOG_INFO, "Application: %.*s %.*s",
+                        (int)probe->metadata.name.length, probe->metadata.name.data,
+                        (int)probe->metadata.version.length, probe->metadata.version.data);
+        }
     } else {
         log_message(LOG_DEBUG, "Metadata file not present");
     }
     
     // Check icon file
-    snprintf(component_path, sizeof(component_path), "%s%s", bundle_path, ICON_PATH);
-    if (file_exists(component_path)) {
+    if (bundle_probe_is_file(probe, COMPONENT_ICON)) {
+        bundle_probe_component_path(probe, COMPONENT_ICON, component_path, sizeof(component_path));
         log_message(LOG_INFO, "Icon file found: %s", component_path);
     } else {
         log_message(LOG_DEBUG, "Icon file not present");
     }
     
     // Check resources directory
-    snprintf(component_path, sizeof(component_path), "%s%s", bundle_path, RES_PATH);
-    if (directory_exists(component_path)) {
+    if (bundle_probe_is_directory(probe, COMPONENT_RESOURCES)) {
+        bundle_probe_component_path(probe, COMPONENT_RESOURCES, component_path, sizeof(component_path));
         log_message(LOG_INFO, "Resources directory found: %s", component_path);
     } else {
         log_message(LOG_DEBUG, "Resources directory not present");
@@ -273,44 +250,158 @@ void inspect_optional_components(const char *bundle_path) {
 }
 
 /**
- * @brief Launch the application
+ * @brief Replace the current process with the bundle executable
+ * @param probe Probe of an already validated application bundle
+ * @param env Environment built by prepare_environment()
+ * @param handoff Arguments and descriptors for the application, or NULL
+ * @return EXIT_EXEC_ERROR if exec fails (does not return on success)
+ */
+int exec_application(const bundle_probe_t *probe, env_builder_t *env, const launch_handoff_t *handoff) {
+    char exec_path[MAX_PATH_LENGTH];
+    char cwd[MAX_PATH_LENGTH];
+    char *const *envp;
+    char *argv_storage[HANDOFF_ARGV_SIZE];
+    char **argv;
+    int exec_fd = probe->exec_fd;
+    uint64_t entry;
+    int watcher;
+    
+    // The resource descriptor is opened per launch, so a resident environment stays reusable
+    if (configure_resources(probe, env) != EXIT_SUCCESS || handoff_configure(handoff, env) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    bundle_probe_component_path(probe, COMPONENT_EXEC, exec_path, sizeof(exec_path));
+    envp = env_builder_envp(env);
+    argv = handoff_argv(handoff, exec_path, argv_storage);
+    if (envp == NULL) {
+        log_message(LOG_ERROR, "Failed to build environment: %s", strerror(ENOMEM));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Queue the reads the dynamic loader is about to fault on
+    if (prefetch_enabled() || probe->metadata.prefetch) {
+        prefetch_bundle(probe);
+        trace_mark(TRACE_PREFETCH);
+    }
+    
+    log_message(LOG_INFO, "Launching application: %s", exec_path);
+    log_message(LOG_DEBUG, "Working directory: %s", getcwd(cwd, sizeof(cwd)) ? cwd : "(unreachable)");
+    
+    log_flush();
+    trace_mark(TRACE_EXEC);
+    entry = history_record(probe->path, trace_started_ms(), EXIT_SUCCESS, trace_elapsed_ns());
+    
+    // Last, since the standard streams may now be a client's
+    if (handoff_apply(handoff, (char *)env_builder_get(env, "LISTEN_PID"), &exec_fd) != 0) {
+        log_message(LOG_ERROR, "Failed to pass descriptors: %s", strerror(errno));
+        history_amend(entry, EXIT_EXEC_ERROR);
+        trace_emit(EXIT_EXEC_ERROR);
+        return EXIT_EXEC_ERROR;
+    }
+    
+    // Only the exec itself can fail from here, which decides the one record written
+    watcher = trace_emit_after_exec();
+    
+#ifdef VLAUNCH_PGO
+    if (__gcov_dump) {
+        __gcov_dump();
+    }
+#endif
+    
+    // Run the file the probe validated rather than whatever the path names now
+    syscall(SYS_execveat, exec_fd, "", argv, envp, AT_EMPTY_PATH);
+    
+    // Interpreters cannot reopen a script through a close-on-exec descriptor
+    if (errno == ENOENT) {
+        execve(exec_path, argv, envp);
+    }
+    
+    // If we reach here, exec failed
+    log_message(LOG_ERROR, "Failed to execute application: %s", strerror(errno));
+    history_amend(entry, EXIT_EXEC_ERROR);
+    trace_exec_failed(watcher, EXIT_EXEC_ERROR);
+    return EXIT_EXEC_ERROR;
+}
+
+/**
+ * @brief Probe and validate a bundle, skipping checks the cache vouches for
+ * @param probe Receives the opened bundle; the caller closes it
  * @param bundle_path Path to application bundle
  * @return EXIT_SUCCESS on success, error code on failure
  */
-int launch_application(const char *bundle_path) {
-    char exec_path[MAX_PATH_LENGTH];
+int prepare_application(bundle_probe_t *probe, const char *bundle_path) {
+    bundle_snapshot_t snapshot;
+    int cached;
     int result;
     
-    // Validate bundle structure
-    result = validate_bundle(bundle_path);
-    if (result != EXIT_SUCCESS) {
-        return result;
+    // Open the bundle once and stat every component relative to it
+    bundle_probe_open(probe, bundle_path);
+    
+    // A current compiled manifest was validated when it was compiled, and
+    // the cache skips all per-component checks if nothing changed since
+    cached = probe->manifest || validation_cache_lookup(probe, &snapshot);
+    trace_mark(TRACE_PROBE);
+    if (cached) {
+        log_message(LOG_INFO, "Bundle validation cached: %s", bundle_path);
+        
+        // The validation cache covers the layout, not the contents of every library
+        return integrity_verify(probe);
     }
     
-    // Configure environment
-    result = configure_library_path(bundle_path);
+    // Validate bundle structure
+    result = validate_bundle(probe);
     if (result != EXIT_SUCCESS) {
         return result;
     }
+    validation_cache_store(probe, &snapshot);
+    trace_mark(TRACE_VALIDATE);
     
     // Inspect optional components
-    inspect_optional_components(bundle_path);
-    
-    // Prepare execution
-    snprintf(exec_path, sizeof(exec_path), "%s%s", bundle_path, EXEC_PATH);
-    
-    log_message(LOG_INFO, "Launching application: %s", exec_path);
-    log_message(LOG_DEBUG, "Working directory: %s", getcwd(NULL, 0));
-    
-    // Execute application
-    char *const argv[] = { exec_path, NULL };
-    char *const envp[] = { NULL }; // Use current environment
+    inspect_optional_components(probe);
+    trace_mark(TRACE_INSPECT);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Launch the application
+ * @param bundle_path Path to application bundle
+ * @param handoff Arguments and descriptors for the application, or NULL
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int launch_application(const char *bundle_path, const launch_handoff_t *handoff) {
+    bundle_probe_t probe;
+    env_builder_t env;
+    int result;
     
-    execv(exec_path, argv);
+    result = prepare_application(&probe, bundle_path);
     
-    // If we reach here, execv failed
-    log_message(LOG_ERROR, "Failed to execute application: %s", strerror(errno));
-    return EXIT_EXEC_ERROR;
+    // Configure environment
+    if (result == EXIT_SUCCESS) {
+        result = prepare_environment(&probe, &env);
+        if (result != EXIT_SUCCESS) {
+            bundle_probe_close(&probe);
+            return result;
+        }
+        trace_mark(TRACE_LIBRARY);
+        
+        // The launcher is replaced by the app, so it takes the placement itself
+        result = configure_placement(&probe);
+        if (result == EXIT_SUCCESS) {
+            trace_mark(TRACE_PLACEMENT);
+            result = sandbox_apply(&probe);
+        }
+        if (result == EXIT_SUCCESS) {
+            result = lazy_resources_attach(&probe);
+        }
+        
+        // Prepare execution
+        if (result == EXIT_SUCCESS) {
+            result = exec_application(&probe, &env, handoff);
+        }
+        env_builder_free(&env);
+    }
+    bundle_probe_close(&probe);
+    return result;
 }
 
 /**
@@ -320,9 +411,58 @@ int launch_application(const char *bundle_path) {
 void print_usage(const char *program_name) {
     printf("%s v%s\n", APP_NAME, APP_VERSION);
     printf("A professional application bundle launcher for Linux systems.\n\n");
-    printf("Usage: %s <bundle_path>\n\n", program_name);
+    printf("Usage: %s <bundle_path> [<bundle_path>...]\n", program_name);
+    printf("       %s [--pass-fd <fd>[:<name>]]... <bundle_path> -- <arg>...\n", program_name);
+    printf("       %s --list <file>\n", program_name);
+    printf("       %s --serve <socket_path>\n", program_name);
+    printf("       %s --connect <socket_path> <bundle_path>\n", program_name);
+    printf("       %s --compile <bundle_path>\n", program_name);
+    printf("       %s --pack <bundle_path> <image.vapp>\n", program_name);
+    printf("       %s --seal <bundle_path>\n", program_name);
+    printf("       %s --prewarm\n", program_name);
+    printf("       %s --stats [bundle_path...]\n", program_name);
+    printf("       %s --index <bundle_path>...\n", program_name);
+    printf("       %s --catalog [--watch] <root>...\n\n", program_name);
     printf("Arguments:\n");
-    printf("  bundle_path    Path to the application bundle directory\n\n");
+    printf("  bundle_path    Path to the application bundle directory; several paths\n");
+    printf("                 are validated concurrently and launched as child processes;\n");
+    printf("                 a .vapp image made with --pack is accepted like a directory\n\n");
+    printf("Options:\n");
+    printf("  -s, --serve <socket>     Run as a warm-start launch daemon on a Unix socket\n");
+    printf("  -c, --connect <socket>   Ask a running launch daemon to start the bundle\n");
+    printf("  -f, --list <file>        Launch every bundle listed in a file, one path per line\n");
+    printf("  -m, --compile <bundle>   Compile info.yaml and the bundle layout into info.bin and\n");
+    printf("                           share library/ with identical files of other bundles\n");
+    printf("  -k, --pack <bundle>      Pack a bundle directory into a single .vapp image\n");
+    printf("  --seal <bundle>          Write digests.sha256 for exec/base and library/\n");
+    printf("  --publish <bundle> <dir> Write resources.index and store resources/ in dir to serve\n");
+    printf("  --require-digests        Refuse bundles without digests.sha256\n");
+    printf("  --sandbox <features>     Run in new namespaces: mount, net and/or pid, or none;\n");
+    printf("                           with pid the launcher stays as the application's parent\n");
+    printf("  --stats                  Show resource use of supervised and daemon-launched bundles\n");
+    printf("  --prewarm                Warm the bundles launch history predicts while the system is idle\n");
+    printf("  -x, --index              Render bundle icons into the shared icon atlas\n");
+    printf("  -g, --catalog            Catalog the bundles found below directories into the cache\n");
+    printf("  -w, --watch              Keep the catalog current as bundles change (with --catalog)\n");
+    printf("  -r, --supervise          Stay as the application's parent and restart it when it fails\n");
+    printf("  -z, --checkpoint         Resume the application from a criu snapshot taken once it is ready\n");
+    printf("  -n, --no-cache           Always validate the bundle, ignoring the cache and info.bin\n");
+    printf("  -l, --log-level <level>  Log verbosity: error, warning, info (default) or debug\n");
+    printf("  -t, --trace <target>     Write launch-phase timings as JSON to a file or fd:<n>\n");
+    printf("  -i, --ld-index           Resolve bundle libraries through a soname index (LD_AUDIT)\n");
+    printf("  -p, --prefetch           Warm the executable and bundle libraries into the page cache\n");
+    printf("  --pass-fd <fd>[:<name>]  Hand a descriptor to the application as in socket activation\n");
+    printf("  -h, --help               Show this help message\n\n");
+    printf("Placement (override the same keys in info.yaml):\n");
+    printf("  --cpus <list>            Pin to CPUs, e.g. 2-5,8\n");
+    printf("  --numa-node <node>       Run on the CPUs of a NUMA node and prefer its memory\n");
+    printf("  --sched-policy <policy>  Scheduling policy: other, batch, idle, fifo or rr\n");
+    printf("  --sched-priority <prio>  Real-time priority for fifo and rr (1-99)\n");
+    printf("  --nice <value>           Nice value (-20 to 19)\n");
+    printf("  --cgroup <path>          Join a cgroup v2, relative to the launcher's or absolute\n");
+    printf("  --cpu-max <quota>        cpu.max of the cgroup, e.g. \"50000 100000\"\n");
+    printf("  --memory-high <bytes>    memory.high of the cgroup, e.g. 512M\n");
+    printf("  --io-priority <class>    idle, best-effort[:0-7] or realtime[:0-7]\n\n");
     printf("Expected Bundle Structure:\n");
     printf("  bundle_path/\n");
     printf("  ├── exec/base          (Required executable)\n");
@@ -345,18 +485,326 @@ void print_usage(const char *program_name) {
  * @return Exit code
  */
 int main(int argc, char *argv[]) {
-    // Validate command line arguments
-    if (argc != 2) {
-        if (argc > 2) {
-            log_message(LOG_ERROR, "Too many arguments provided");
-        } else {
-            log_message(LOG_ERROR, "Missing required bundle path argument");
+    static const struct option long_options[] = {
+        { "serve",          required_argument, NULL, 's'                                        },
+        { "connect",        required_argument, NULL, 'c'                                        },
+        { "list",           required_argument, NULL, 'f'                                        },
+        { "compile",        required_argument, NULL, 'm'                                        },
+        { "pack",           required_argument, NULL, 'k'                                        },
+        { "index",          no_argument,       NULL, 'x'                                        },
+        { "catalog",        no_argument,       NULL, 'g'                                        },
+        { "watch",          no_argument,       NULL, 'w'                                        },
+        { "supervise",      no_argument,       NULL, 'r'                                        },
+        { "checkpoint",     no_argument,       NULL, 'z'                                        },
+        { "no-cache",       no_argument,       NULL, 'n'                                        },
+        { "log-level",      required_argument, NULL, 'l'                                        },
+        { "trace",          required_argument, NULL, 't'                                        },
+        { "ld-index",       no_argument,       NULL, 'i'                                        },
+        { "prefetch",       no_argument,       NULL, 'p'                                        },
+        { "cpus",           required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_CPUS          },
+        { "numa-node",      required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_NUMA_NODE     },
+        { "sched-policy",   required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_SCHED_POLICY  },
+        { "sched-priority", required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_SCHED_PRIORITY },
+        { "nice",           required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_NICE          },
+        { "cgroup",         required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_CGROUP        },
+        { "cpu-max",        required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_CPU_MAX       },
+        { "memory-high",    required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_MEMORY_HIGH   },
+        { "io-priority",    required_argument, NULL, OPTION_PLACEMENT + PLACEMENT_IO_PRIORITY   },
+        { "pass-fd",        required_argument, NULL, OPTION_PASS_FD                             },
+        { "seal",           required_argument, NULL, OPTION_SEAL                                },
+        { "require-digests", no_argument,      NULL, OPTION_REQUIRE_DIGESTS                     },
+        { "prewarm",        no_argument,       NULL, OPTION_PREWARM                             },
+        { "stats",          no_argument,       NULL, OPTION_STATS                               },
+        { "sandbox",        required_argument, NULL, OPTION_SANDBOX                             },
+        { "publish",        required_argument, NULL, OPTION_PUBLISH                             },
+        { "help",           no_argument,       NULL, 'h'                                        },
+        { NULL,             0,                 NULL, 0                                          }
+    };
+    const char *serve_socket = NULL;
+    const char *connect_socket = NULL;
+    const char *compile_bundle = NULL;
+    const char *pack_source = NULL;
+    const char *list_file = NULL;
+    const char *seal_bundle = NULL;
+    const char *publish_bundle = NULL;
+    int index_icons = 0;
+    int catalog = 0;
+    int watch = 0;
+    int supervised = 0;
+    int checkpoint = 0;
+    int sandboxed = 0;
+    int passthrough = 0;
+    int prewarm = 0;
+    int stats = 0;
+    static launch_handoff_t handoff;
+    log_level_t level;
+    int opt;
+    
+    trace_reset(NULL);
+    handoff_init(&handoff);
+    
+    // Parse options; stop at the first non-option so bundle paths are left alone
+    while ((opt = getopt_long(argc, argv, "+s:c:f:m:k:xgwrznl:t:iph", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                serve_socket = optarg;
+                break;
+            case 'c':
+                connect_socket = optarg;
+                break;
+            case 'f':
+                list_file = optarg;
+                break;
+            case 'm':
+                compile_bundle = optarg;
+                break;
+            case 'k':
+                pack_source = optarg;
+                break;
+            case 'x':
+                index_icons = 1;
+                break;
+            case 'g':
+                catalog = 1;
+                break;
+            case 'w':
+                watch = 1;
+                break;
+            case 'r':
+                supervised = 1;
+                break;
+            case 'z':
+                checkpoint = 1;
+                break;
+            case 'n':
+                validation_cache_set_enabled(0);
+                manifest_set_enabled(0);
+                integrity_cache_set_enabled(0);
+                break;
+            case 'l':
+                if (log_parse_level(optarg, &level) != 0) {
+                    log_message(LOG_ERROR, "Unknown log level: %s", optarg);
+                    return EXIT_INVALID_ARGS;
+                }
+                log_set_level(level);
+                break;
+            case 't':
+                if (trace_open(optarg) != EXIT_SUCCESS) {
+                    return EXIT_INVALID_ARGS;
+                }
+                break;
+            case 'i':
+                ldindex_set_enabled(1);
+                break;
+            case 'p':
+                prefetch_set_enabled(1);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            case OPTION_PASS_FD:
+                if (handoff_parse_option(&handoff, optarg) != EXIT_SUCCESS) {
+                    return EXIT_INVALID_ARGS;
+                }
+                break;
+            case OPTION_SEAL:
+                seal_bundle = optarg;
+                break;
+            case OPTION_REQUIRE_DIGESTS:
+                integrity_set_required(1);
+                break;
+            case OPTION_PREWARM:
+                prewarm = 1;
+                break;
+            case OPTION_STATS:
+                stats = 1;
+                break;
+            case OPTION_SANDBOX:
+                if (sandbox_set_option(optarg) != EXIT_SUCCESS) {
+                    return EXIT_INVALID_ARGS;
+                }
+                sandboxed = 1;
+                break;
+            case OPTION_PUBLISH:
+                publish_bundle = optarg;
+                break;
+            default:
+                if (opt >= OPTION_PLACEMENT && opt < OPTION_PLACEMENT + PLACEMENT_COUNT) {
+                    if (placement_set_option((placement_key_t)(opt - OPTION_PLACEMENT), optarg) != EXIT_SUCCESS) {
+                        return EXIT_INVALID_ARGS;
+                    }
+                    break;
+                }
+                print_usage(argv[0]);
+                return EXIT_INVALID_ARGS;
         }
+    }
+    
+    // Arguments after "--" following the bundle path belong to the application
+    for (int i = optind + 1; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            handoff.args = argv + i + 1;
+            handoff.arg_count = (unsigned int)(argc - i - 1);
+            passthrough = 1;
+            argc = i;
+            break;
+        }
+    }
+    if ((passthrough || handoff.fd_count > 0) &&
+        (serve_socket || compile_bundle || pack_source || seal_bundle || publish_bundle || prewarm || stats || index_icons || catalog || list_file || argc - optind != 1)) {
+        log_message(LOG_ERROR, "Application arguments and --pass-fd take exactly one bundle path");
         print_usage(argv[0]);
         return EXIT_INVALID_ARGS;
     }
+    if (handoff.arg_count > HANDOFF_MAX_ARGS) {
+        log_message(LOG_ERROR, "Too many application arguments (max %d)", HANDOFF_MAX_ARGS);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    if (serve_socket) {
+        if (connect_socket || optind != argc) {
+            log_message(LOG_ERROR, "--serve does not take a bundle path");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        log_message(LOG_INFO, "Starting %s v%s", APP_NAME, APP_VERSION);
+        return run_daemon(serve_socket);
+    }
     
-    const char *bundle_path = argv[1];
+    if (prewarm) {
+        if (connect_socket || list_file || optind != argc) {
+            log_message(LOG_ERROR, "--prewarm does not take a bundle path");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        log_message(LOG_INFO, "Starting %s v%s", APP_NAME, APP_VERSION);
+        return history_prewarm();
+    }
+    
+    if (stats) {
+        if (serve_socket || connect_socket || list_file) {
+            log_message(LOG_ERROR, "--stats takes only bundle paths");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        return stats_print(optind < argc ? argv + optind : NULL, (unsigned int)(argc - optind));
+    }
+    
+    if (compile_bundle) {
+        if (serve_socket || connect_socket || optind != argc) {
+            log_message(LOG_ERROR, "--compile takes exactly one bundle path");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        if (strlen(compile_bundle) >= MAX_PATH_LENGTH) {
+            log_message(LOG_ERROR, "Bundle path too long (max %d characters)", MAX_PATH_LENGTH - 1);
+            return EXIT_INVALID_ARGS;
+        }
+        return manifest_compile(compile_bundle);
+    }
+    
+    if (seal_bundle) {
+        if (serve_socket || connect_socket || compile_bundle || optind != argc) {
+            log_message(LOG_ERROR, "--seal takes exactly one bundle path");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        if (strlen(seal_bundle) >= MAX_PATH_LENGTH) {
+            log_message(LOG_ERROR, "Bundle path too long (max %d characters)", MAX_PATH_LENGTH - 1);
+            return EXIT_INVALID_ARGS;
+        }
+        return integrity_seal(seal_bundle);
+    }
+    
+    if (pack_source) {
+        if (serve_socket || connect_socket || compile_bundle || argc - optind != 1) {
+            log_message(LOG_ERROR, "--pack takes a bundle directory and an image path");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        if (strlen(pack_source) >= MAX_PATH_LENGTH || strlen(argv[optind]) >= MAX_PATH_LENGTH) {
+            log_message(LOG_ERROR, "Bundle path too long (max %d characters)", MAX_PATH_LENGTH - 1);
+            return EXIT_INVALID_ARGS;
+        }
+        return pack_bundle(pack_source, argv[optind]);
+    }
+    
+    if (publish_bundle) {
+        if (serve_socket || connect_socket || compile_bundle || pack_source || argc - optind != 1) {
+            log_message(LOG_ERROR, "--publish takes a bundle directory and an object directory");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        if (strlen(publish_bundle) >= MAX_PATH_LENGTH || strlen(argv[optind]) >= MAX_PATH_LENGTH) {
+            log_message(LOG_ERROR, "Bundle path too long (max %d characters)", MAX_PATH_LENGTH - 1);
+            return EXIT_INVALID_ARGS;
+        }
+        return lazy_resources_publish(publish_bundle, argv[optind]);
+    }
+    
+    if (index_icons) {
+        if (serve_socket || connect_socket || list_file || argc - optind < 1) {
+            log_message(LOG_ERROR, "--index takes one or more bundle paths");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        return icon_index(argv + optind, (unsigned int)(argc - optind));
+    }
+    
+    if (catalog) {
+        if (serve_socket || connect_socket || list_file || argc - optind < 1) {
+            log_message(LOG_ERROR, "--catalog takes one or more bundle root directories");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        return catalog_build(argv + optind, (unsigned int)(argc - optind), watch);
+    }
+    if (watch) {
+        log_message(LOG_ERROR, "--watch requires --catalog");
+        return EXIT_INVALID_ARGS;
+    }
+    
+    if (list_file) {
+        if (connect_socket || optind != argc) {
+            log_message(LOG_ERROR, "--list does not take bundle path arguments");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        log_message(LOG_INFO, "Starting %s v%s", APP_NAME, APP_VERSION);
+        return launch_batch_list(list_file);
+    }
+    
+    // Validate command line arguments
+    if (argc - optind < 1) {
+        log_message(LOG_ERROR, "Missing required bundle path argument");
+        print_usage(argv[0]);
+        return EXIT_INVALID_ARGS;
+    }
+    if (supervised && (serve_socket || connect_socket || list_file || argc - optind != 1)) {
+        log_message(LOG_ERROR, "--supervise takes exactly one bundle path");
+        print_usage(argv[0]);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    // A snapshot holds the arguments and descriptors of the run it was taken from
+    if (checkpoint && (supervised || serve_socket || connect_socket || passthrough || handoff.fd_count > 0 ||
+                       argc - optind != 1)) {
+        log_message(LOG_ERROR, "--checkpoint takes exactly one bundle path and no application arguments");
+        print_usage(argv[0]);
+        return EXIT_INVALID_ARGS;
+    }
+    
+    if (argc - optind > 1) {
+        if (connect_socket) {
+            log_message(LOG_ERROR, "--connect takes exactly one bundle path");
+            print_usage(argv[0]);
+            return EXIT_INVALID_ARGS;
+        }
+        log_message(LOG_INFO, "Starting %s v%s", APP_NAME, APP_VERSION);
+        return launch_batch(argv + optind, (unsigned int)(argc - optind));
+    }
+    
+    const char *bundle_path = argv[optind];
     
     // Validate bundle path length
     if (strlen(bundle_path) >= MAX_PATH_LENGTH) {
@@ -364,14 +812,44 @@ int main(int argc, char *argv[]) {
         return EXIT_INVALID_ARGS;
     }
     
+    // Descriptors the launcher was socket-activated with go on to the application
+    if (handoff_inherit(&handoff) != EXIT_SUCCESS) {
+        return EXIT_INVALID_ARGS;
+    }
+    
+    if (connect_socket) {
+        if (sandboxed) {
+            log_message(LOG_ERROR, "--sandbox is not passed to a launch daemon; use the bundle's info.yaml");
+            return EXIT_INVALID_ARGS;
+        }
+        return daemon_request_launch(connect_socket, bundle_path, &handoff);
+    }
+    
+    trace_set_bundle(bundle_path);
+    trace_mark(TRACE_ARGS);
+    
     // Initialize logging
     log_message(LOG_INFO, "Starting %s v%s", APP_NAME, APP_VERSION);
     log_message(LOG_INFO, "Target bundle: %s", bundle_path);
     
+    // The supervisor returns once the application is done for good
+    if (supervised) {
+        return supervise_application(bundle_path, &handoff);
+    }
+    
+    // Checkpoint mode waits for the application, which may be a restored one
+    if (checkpoint) {
+        return checkpoint_application(bundle_path);
+    }
+    
     // Launch application
-    int result = launch_application(bundle_path);
+    int result = launch_application(bundle_path, &handoff);
     
     // This should never be reached if execv succeeds
     log_message(LOG_ERROR, "Application launcher terminated unexpectedly");
+    if (result != EXIT_EXEC_ERROR) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+    }
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,651 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file manifest.c
+ * @brief Compiled binary bundle manifest (info.bin)
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A current manifest replaces both the statx batch and the info.yaml
+ * parse: the probe stats the bundle root, info.yaml and the pinned
+ * executable, and takes everything else from the mapping. Metadata
+ * values point straight into it, so the mapping is owned by the probe
+ * metadata and released with it.
+ *
+ * Compiling validates the bundle and builds the library index first,
+ * because creating .ld-index changes the bundle root the manifest is
+ * checked against.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "ldindex.h"
+#include "store.h"
+#include "resource.h"
+#include "manifest.h"
+
+/* Growable image of a manifest being compiled */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} manifest_buffer_t;
+
+static int manifest_active = 1;
+
+/**
+ * @brief Enable or disable reading compiled manifests
+ * @param enabled Non-zero to use info.bin when it is current
+ */
+void manifest_set_enabled(int enabled) {
+    manifest_active = enabled;
+}
+
+/**
+ * @brief FNV-1a over a byte range
+ * @param hash Running hash value
+ * @param data Bytes to add
+ * @param size Number of bytes
+ * @return Updated hash value
+ */
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Checksum a manifest image, hashing the checksum field as zero
+ * @param data Start of the manifest
+ * @param size Size of the manifest
+ * @return Checksum value
+ */
+static uint32_t manifest_checksum(const void *data, size_t size) {
+    static const uint32_t zero = 0;
+    const size_t field = offsetof(manifest_header_t, checksum);
+    const size_t rest = field + sizeof(zero);
+    uint32_t hash = 0x811c9dc5u;
+    
+    hash = fnv1a(hash, data, field);
+    hash = fnv1a(hash, &zero, sizeof(zero));
+    return fnv1a(hash, (const char *)data + rest, size - rest);
+}
+
+/**
+ * @brief Check that a string reference stays inside the manifest
+ * @param map Start of the manifest
+ * @param size Size of the manifest
+ * @param string String reference
+ * @return Non-zero if the string is usable
+ */
+static int string_valid(const void *map, size_t size, const manifest_string_t *string) {
+    return string->offset < size && string->length < size - string->offset &&
+           ((const char *)map)[string->offset + string->length] == '\0';
+}
+
+/**
+ * @brief Check that an array stays inside the manifest
+ * @param size Size of the manifest
+ * @param offset Offset of the array
+ * @param count Number of elements
+ * @param element Size of one element
+ * @return Non-zero if the array is usable
+ */
+static int array_valid(size_t size, uint32_t offset, uint32_t count, size_t element) {
+    return offset % sizeof(uint32_t) == 0 && offset <= size && count <= (size - offset) / element;
+}
+
+/**
+ * @brief Check that a mapped manifest is intact and structurally sound
+ * @param map Start of the manifest
+ * @param size Size of the manifest
+ * @return Non-zero if every field can be read in place
+ */
+static int manifest_valid(const void *map, size_t size) {
+    const manifest_header_t *header = map;
+    const manifest_env_t *env;
+    const manifest_string_t *resources;
+    
+    if (size < sizeof(*header) ||
+        header->magic != MANIFEST_MAGIC ||
+        header->version != MANIFEST_VERSION ||
+        header->size != size ||
+        header->checksum != manifest_checksum(map, size) ||
+        !array_valid(size, header->env_offset, header->env_count, sizeof(manifest_env_t)) ||
+        !array_valid(size, header->resource_offset, header->resource_count, sizeof(manifest_string_t)) ||
+        !string_valid(map, size, &header->name) ||
+        !string_valid(map, size, &header->version_string) ||
+        !string_valid(map, size, &header->entry) ||
+        !string_valid(map, size, &header->icon) ||
+        !string_valid(map, size, &header->toolkit) ||
+        !string_valid(map, size, &header->runtimes) ||
+        !string_valid(map, size, &header->sandbox) ||
+        !string_valid(map, size, &header->resources_url)) {
+        return 0;
+    }
+    
+    for (int i = 0; i < PLACEMENT_COUNT; i++) {
+        if (!string_valid(map, size, &header->placement[i])) {
+            return 0;
+        }
+    }
+    
+    env = (const manifest_env_t *)((const char *)map + header->env_offset);
+    for (uint32_t i = 0; i < header->env_count; i++) {
+        if (!string_valid(map, size, &env[i].name) || !string_valid(map, size, &env[i].value)) {
+            return 0;
+        }
+    }
+    
+    resources = (const manifest_string_t *)((const char *)map + header->resource_offset);
+    for (uint32_t i = 0; i < header->resource_count; i++) {
+        if (!string_valid(map, size, &resources[i])) {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+/**
+ * @brief Stat a component and compare it with its recorded state
+ * @param dirfd Directory or file descriptor
+ * @param path Path relative to dirfd, or "" for dirfd itself
+ * @param recorded State recorded at compile time
+ * @param stx Receives the stat result
+ * @return Non-zero if the component is unchanged
+ */
+static int component_current(int dirfd, const char *path, const component_state_t *recorded, struct statx *stx) {
+    int flags = AT_STATX_SYNC_AS_STAT | (path[0] == '\0' ? AT_EMPTY_PATH : 0);
+    component_state_t state;
+    
+    if (statx(dirfd, path, flags, PROBE_STATX_MASK, stx) != 0) {
+        return !recorded->present;
+    }
+    component_state_take(stx, &state);
+    return memcmp(&state, recorded, sizeof(state)) == 0;
+}
+
+/**
+ * @brief Turn a recorded component state back into a stat result
+ * @param state Recorded state
+ * @param stx Receives the stat result
+ */
+static void component_state_restore(const component_state_t *state, struct statx *stx) {
+    memset(stx, 0, sizeof(*stx));
+    stx->stx_mask = PROBE_STATX_MASK;
+    stx->stx_dev_major = (uint32_t)(state->dev >> 32);
+    stx->stx_dev_minor = (uint32_t)state->dev;
+    stx->stx_ino = state->ino;
+    stx->stx_size = state->size;
+    stx->stx_mtime.tv_sec = state->mtime_sec;
+    stx->stx_mtime.tv_nsec = (uint32_t)state->mtime_nsec;
+    stx->stx_ctime.tv_sec = state->ctime_sec;
+    stx->stx_ctime.tv_nsec = (uint32_t)state->ctime_nsec;
+    stx->stx_mode = (uint16_t)state->mode;
+}
+
+/**
+ * @brief Point a metadata value at a manifest string
+ * @param map Start of the manifest
+ * @param string String reference
+ * @return Value inside the mapping
+ */
+static metadata_value_t manifest_value(const void *map, const manifest_string_t *string) {
+    metadata_value_t value;
+    
+    value.data = manifest_string(map, string);
+    value.length = string->length;
+    return value;
+}
+
+/**
+ * @brief Fill a probe from the compiled manifest if it is current
+ * @param probe Probe with an open bundle directory and nothing else
+ * @return EXIT_SUCCESS if the probe was filled, EXIT_BUNDLE_ERROR to probe normally
+ */
+int manifest_load(bundle_probe_t *probe) {
+    const manifest_header_t *header;
+    const component_state_t *recorded;
+    bundle_metadata_t *metadata = &probe->metadata;
+    struct stat st;
+    size_t size;
+    void *map;
+    int fd;
+    
+    if (!manifest_active) {
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    fd = openat(probe->dirfd, MANIFEST_FILE_NAME, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return EXIT_BUNDLE_ERROR;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size < (off_t)sizeof(manifest_header_t) || st.st_size > MANIFEST_MAX_SIZE) {
+        close(fd);
+        return EXIT_BUNDLE_ERROR;
+    }
+    size = (size_t)st.st_size;
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    if (!manifest_valid(map, size)) {
+        log_message(LOG_WARNING, "Ignoring damaged manifest: %s/%s", probe->path, MANIFEST_FILE_NAME);
+        munmap(map, size);
+        return EXIT_BUNDLE_ERROR;
+    }
+    header = map;
+    recorded = header->snapshot.components;
+    
+    // Layout changes show up in the root directory, metadata edits in info.yaml
+    snprintf(probe->exec_path, sizeof(probe->exec_path), "%s", manifest_string(map, &header->entry));
+    probe->exec_fd = openat(probe->dirfd, probe->exec_path, O_PATH | O_CLOEXEC);
+    if (!component_current(probe->dirfd, "", &recorded[COMPONENT_ROOT], &probe->components[COMPONENT_ROOT]) ||
+        !component_current(probe->dirfd, bundle_component_paths[COMPONENT_METADATA],
+                           &recorded[COMPONENT_METADATA], &probe->components[COMPONENT_METADATA]) ||
+        probe->exec_fd < 0 ||
+        !component_current(probe->exec_fd, "", &recorded[COMPONENT_EXEC], &probe->components[COMPONENT_EXEC])) {
+        log_message(LOG_DEBUG, "Manifest is stale: %s/%s", probe->path, MANIFEST_FILE_NAME);
+        if (probe->exec_fd >= 0) {
+            close(probe->exec_fd);
+            probe->exec_fd = -1;
+        }
+        memset(probe->components, 0, sizeof(probe->components));
+        munmap(map, size);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        probe->present[i] = recorded[i].present != 0;
+        if (i != COMPONENT_ROOT && i != COMPONENT_METADATA && i != COMPONENT_EXEC) {
+            component_state_restore(&recorded[i], &probe->components[i]);
+        }
+    }
+    
+    // Metadata values point into the manifest, which the metadata now owns
+    memset(metadata, 0, sizeof(*metadata));
+    metadata->map = map;
+    metadata->size = size;
+    metadata->name = manifest_value(map, &header->name);
+    metadata->version = manifest_value(map, &header->version_string);
+    metadata->entry = manifest_value(map, &header->entry);
+    metadata->toolkit = manifest_value(map, &header->toolkit);
+    metadata->runtimes = manifest_value(map, &header->runtimes);
+    metadata->sandbox = manifest_value(map, &header->sandbox);
+    metadata->resources_url = manifest_value(map, &header->resources_url);
+    metadata->prefetch = (header->hints & MANIFEST_HINT_PREFETCH) != 0;
+    metadata->ld_index = (header->hints & MANIFEST_HINT_LD_INDEX) != 0;
+    for (int i = 0; i < PLACEMENT_COUNT; i++) {
+        metadata->placement[i] = manifest_value(map, &header->placement[i]);
+    }
+    
+    const manifest_env_t *env = (const manifest_env_t *)((const char *)map + header->env_offset);
+    for (uint32_t i = 0; i < header->env_count && i < METADATA_MAX_ENV; i++) {
+        metadata->env[i].name = manifest_value(map, &env[i].name);
+        metadata->env[i].value = manifest_value(map, &env[i].value);
+        metadata->env_count++;
+    }
+    
+    probe->manifest = 1;
+    log_message(LOG_DEBUG, "Using compiled manifest: %s/%s", probe->path, MANIFEST_FILE_NAME);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Append zeroed, 4-byte aligned space to a manifest image
+ * @param buffer Manifest image
+ * @param size Number of bytes to append
+ * @param offset Receives the offset of the new space
+ * @return 0 on success, -1 on allocation failure or overflow
+ */
+static int buffer_append(manifest_buffer_t *buffer, size_t size, uint32_t *offset) {
+    size_t start = (buffer->size + 3) & ~(size_t)3;
+    
+    if (start + size > MANIFEST_MAX_SIZE) {
+        return -1;
+    }
+    if (start + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        char *data;
+        
+        while (capacity < start + size) {
+            capacity *= 2;
+        }
+        data = realloc(buffer->data, capacity);
+        if (data == NULL) {
+            return -1;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    
+    memset(buffer->data + buffer->size, 0, start + size - buffer->size);
+    buffer->size = start + size;
+    *offset = (uint32_t)start;
+    return 0;
+}
+
+/**
+ * @brief Append a NUL-terminated copy of a string to a manifest image
+ * @param buffer Manifest image
+ * @param data String bytes
+ * @param length Number of bytes
+ * @param offset Offset of the string reference to fill inside the image
+ * @return 0 on success, -1 on failure
+ */
+static int buffer_string(manifest_buffer_t *buffer, const char *data, size_t length, uint32_t offset) {
+    manifest_string_t string;
+    
+    if (buffer_append(buffer, length + 1, &string.offset) != 0) {
+        return -1;
+    }
+    if (length > 0) {
+        memcpy(buffer->data + string.offset, data, length);
+    }
+    string.length = (uint32_t)length;
+    memcpy(buffer->data + offset, &string, sizeof(string));
+    return 0;
+}
+
+/**
+ * @brief Order entry names
+ * @param a First name
+ * @param b Second name
+ * @return Negative, zero or positive like strcmp
+ */
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Append the sorted entries of resources/ to a manifest image
+ * @param buffer Manifest image
+ * @param probe Probed bundle
+ * @return 0 on success, -1 on failure
+ */
+static int add_resources(manifest_buffer_t *buffer, const bundle_probe_t *probe) {
+    char **names = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    struct dirent *entry;
+    uint32_t offset;
+    int failed = 0;
+    DIR *dir;
+    int fd;
+    
+    if (!bundle_probe_is_directory(probe, COMPONENT_RESOURCES)) {
+        return 0;
+    }
+    fd = openat(probe->dirfd, bundle_component_paths[COMPONENT_RESOURCES], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || (dir = fdopendir(fd)) == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        log_message(LOG_ERROR, "Cannot list resources of %s: %s", probe->path, strerror(errno));
+        return -1;
+    }
+    
+    while (!failed && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (count == capacity) {
+            char **grown = realloc(names, (capacity ? capacity * 2 : 32) * sizeof(*names));
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            names = grown;
+            capacity = capacity ? capacity * 2 : 32;
+        }
+        names[count] = strdup(entry->d_name);
+        failed = names[count] == NULL;
+        count += !failed;
+    }
+    closedir(dir);
+    
+    if (!failed && count > 0) {
+        qsort(names, count, sizeof(*names), compare_names);
+        failed = buffer_append(buffer, count * sizeof(manifest_string_t), &offset) != 0;
+        for (size_t i = 0; !failed && i < count; i++) {
+            failed = buffer_string(buffer, names[i], strlen(names[i]),
+                                   offset + (uint32_t)(i * sizeof(manifest_string_t))) != 0;
+        }
+        if (!failed) {
+            manifest_header_t *header = (manifest_header_t *)buffer->data;
+            header->resource_count = (uint32_t)count;
+            header->resource_offset = offset;
+        }
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    free(names);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Build the manifest image of a validated bundle
+ * @param buffer Receives the manifest image
+ * @param probe Probed bundle
+ * @return 0 on success, -1 on failure
+ */
+static int build_manifest(manifest_buffer_t *buffer, const bundle_probe_t *probe) {
+    const bundle_metadata_t *metadata = &probe->metadata;
+    const char *icon = probe->present[COMPONENT_ICON] ? bundle_component_paths[COMPONENT_ICON] : "";
+    manifest_header_t *header;
+    uint32_t offset;
+    uint32_t env_offset = 0;
+    
+    if (buffer_append(buffer, sizeof(manifest_header_t), &offset) != 0 ||
+        (metadata->env_count > 0 &&
+         buffer_append(buffer, metadata->env_count * sizeof(manifest_env_t), &env_offset) != 0) ||
+        buffer_string(buffer, metadata->name.data, metadata->name.length,
+                      offsetof(manifest_header_t, name)) != 0 ||
+        buffer_string(buffer, metadata->version.data, metadata->version.length,
+                      offsetof(manifest_header_t, version_string)) != 0 ||
+        buffer_string(buffer, probe->exec_path, strlen(probe->exec_path),
+                      offsetof(manifest_header_t, entry)) != 0 ||
+        buffer_string(buffer, icon, strlen(icon), offsetof(manifest_header_t, icon)) != 0 ||
+        buffer_string(buffer, metadata->toolkit.data, metadata->toolkit.length,
+                      offsetof(manifest_header_t, toolkit)) != 0 ||
+        buffer_string(buffer, metadata->runtimes.data, metadata->runtimes.length,
+                      offsetof(manifest_header_t, runtimes)) != 0 ||
+        buffer_string(buffer, metadata->sandbox.data, metadata->sandbox.length,
+                      offsetof(manifest_header_t, sandbox)) != 0 ||
+        buffer_string(buffer, metadata->resources_url.data, metadata->resources_url.length,
+                      offsetof(manifest_header_t, resources_url)) != 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < PLACEMENT_COUNT; i++) {
+        if (buffer_string(buffer, metadata->placement[i].data, metadata->placement[i].length,
+                          (uint32_t)(offsetof(manifest_header_t, placement) +
+                                     (size_t)i * sizeof(manifest_string_t))) != 0) {
+            return -1;
+        }
+    }
+    
+    for (unsigned int i = 0; i < metadata->env_count; i++) {
+        uint32_t entry = env_offset + (uint32_t)(i * sizeof(manifest_env_t));
+        
+        if (buffer_string(buffer, metadata->env[i].name.data, metadata->env[i].name.length,
+                          entry + (uint32_t)offsetof(manifest_env_t, name)) != 0 ||
+            buffer_string(buffer, metadata->env[i].value.data, metadata->env[i].value.length,
+                          entry + (uint32_t)offsetof(manifest_env_t, value)) != 0) {
+            return -1;
+        }
+    }
+    
+    if (add_resources(buffer, probe) != 0) {
+        return -1;
+    }
+    
+    header = (manifest_header_t *)buffer->data;
+    header->magic = MANIFEST_MAGIC;
+    header->version = MANIFEST_VERSION;
+    header->size = (uint32_t)buffer->size;
+    header->hints = (metadata->prefetch ? MANIFEST_HINT_PREFETCH : 0) |
+                    (metadata->ld_index ? MANIFEST_HINT_LD_INDEX : 0);
+    header->env_count = metadata->env_count;
+    header->env_offset = env_offset;
+    bundle_snapshot_take(probe, &header->snapshot);
+    return 0;
+}
+
+/**
+ * @brief Write a manifest image into the bundle atomically
+ * @param buffer Manifest image
+ * @param probe Probed bundle
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int write_manifest(manifest_buffer_t *buffer, const bundle_probe_t *probe) {
+    manifest_header_t *header = (manifest_header_t *)buffer->data;
+    char temp_name[64];
+    struct statx root;
+    int fd;
+    
+    snprintf(temp_name, sizeof(temp_name), ".%s.%ld", MANIFEST_FILE_NAME, (long)getpid());
+    fd = openat(probe->dirfd, temp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Cannot write manifest into %s: %s", probe->path, strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    int failed = write(fd, buffer->data, buffer->size) != (ssize_t)buffer->size;
+    if (close(fd) != 0 || failed || renameat(probe->dirfd, temp_name, probe->dirfd, MANIFEST_FILE_NAME) != 0) {
+        log_message(LOG_ERROR, "Cannot write manifest into %s: %s", probe->path, strerror(errno));
+        unlinkat(probe->dirfd, temp_name, 0);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Creating the manifest changed the bundle root, so record its final state in place
+    if (statx(probe->dirfd, "", AT_EMPTY_PATH | AT_STATX_SYNC_AS_STAT, PROBE_STATX_MASK, &root) != 0) {
+        log_message(LOG_ERROR, "Cannot stat bundle %s: %s", probe->path, strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    component_state_take(&root, &header->snapshot.components[COMPONENT_ROOT]);
+    header->checksum = manifest_checksum(buffer->data, buffer->size);
+    
+    fd = openat(probe->dirfd, MANIFEST_FILE_NAME, O_WRONLY | O_CLOEXEC);
+    failed = fd < 0 || pwrite(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header);
+    if (fd >= 0 && close(fd) != 0) {
+        failed = 1;
+    }
+    if (failed) {
+        log_message(LOG_ERROR, "Cannot write manifest into %s: %s", probe->path, strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Compile info.yaml and the bundle layout into info.bin
+ * @param bundle_path Path to application bundle
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int manifest_compile(const char *bundle_path) {
+    manifest_buffer_t buffer = { NULL, 0, 0 };
+    char index_path[MAX_PATH_LENGTH];
+    bundle_probe_t probe;
+    int result;
+    
+    // Always start from the bundle itself, never from the manifest being replaced
+    manifest_active = 0;
+    bundle_probe_open(&probe, bundle_path);
+    result = validate_bundle(&probe);
+    if (result != EXIT_SUCCESS) {
+        bundle_probe_close(&probe);
+        return result;
+    }
+    
+    // Sharing relinks library/, so the bundle is probed again before anything is stamped
+    if (bundle_probe_is_directory(&probe, COMPONENT_LIBRARY) &&
+        bundle_probe_component_path(&probe, COMPONENT_LIBRARY, index_path, sizeof(index_path)) == EXIT_SUCCESS &&
+        store_share_libraries(index_path) == EXIT_SUCCESS) {
+        bundle_probe_close(&probe);
+        bundle_probe_open(&probe, bundle_path);
+    }
+    
+    // The indexes are part of the layout the manifest is checked against
+    if (bundle_probe_is_directory(&probe, COMPONENT_LIBRARY) &&
+        ldindex_prepare(&probe, index_path, sizeof(index_path)) == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Library index: %s", index_path);
+    }
+    if (bundle_probe_is_directory(&probe, COMPONENT_RESOURCES)) {
+        resource_index_build(&probe);
+    }
+    if (bundle_probe_is_directory(&probe, COMPONENT_LIBRARY) || bundle_probe_is_directory(&probe, COMPONENT_RESOURCES)) {
+        bundle_probe_close(&probe);
+        bundle_probe_open(&probe, bundle_path);
+    }
+    
+    if (build_manifest(&buffer, &probe) != 0) {
+        log_message(LOG_ERROR, "Cannot build manifest for %s", bundle_path);
+        result = EXIT_SYSTEM_ERROR;
+    } else {
+        result = write_manifest(&buffer, &probe);
+    }
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Compiled manifest: %s/%s (%zu bytes)", bundle_path, MANIFEST_FILE_NAME, buffer.size);
+    }
+    
+    free(buffer.data);
+    bundle_probe_close(&probe);
+    return result;
+}
@@ -0,0 +1,128 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file manifest.h
+ * @brief Compiled binary bundle manifest (info.bin)
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * "launcher --compile" folds info.yaml and the validated bundle layout
+ * into a fixed-layout, checksummed file that later launches map and read
+ * in place. The manifest records the state of every component at compile
+ * time and is ignored as soon as the bundle root, info.yaml or the
+ * executable no longer match it.
+ */
+
+#ifndef VLAUNCH_MANIFEST_H
+#define VLAUNCH_MANIFEST_H
+
+#include <stdint.h>
+
+#include "launcher.h"
+#include "cache.h"
+
+/* Manifest Format */
+#define MANIFEST_FILE_NAME      "info.bin"
+#define MANIFEST_MAGIC          0x4d424c56u /* "VLBM" */
+#define MANIFEST_VERSION        6
+#define MANIFEST_MAX_SIZE       (1024 * 1024)
+
+/* Launch hints */
+#define MANIFEST_HINT_PREFETCH  0x1u
+#define MANIFEST_HINT_LD_INDEX  0x2u
+
+/* String in the string table; always NUL-terminated, length excludes the NUL */
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} manifest_string_t;
+
+/* Environment override */
+typedef struct {
+    manifest_string_t name;
+    manifest_string_t value;
+} manifest_env_t;
+
+/* File header; offsets are relative to the start of the file */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t checksum;
+    bundle_snapshot_t snapshot;
+    manifest_string_t name;
+    manifest_string_t version_string;
+    manifest_string_t entry;
+    manifest_string_t icon;
+    manifest_string_t toolkit;
+    manifest_string_t runtimes;
+    manifest_string_t sandbox;
+    manifest_string_t resources_url;
+    uint32_t hints;
+    uint32_t env_count;
+    uint32_t env_offset;
+    uint32_t resource_count;
+    uint32_t resource_offset;
+    manifest_string_t placement[PLACEMENT_COUNT];
+    uint32_t reserved;
+} manifest_header_t;
+
+/**
+ * @brief Get a string stored in a validated manifest
+ * @param map Start of the mapped manifest
+ * @param string String reference
+ * @return NUL-terminated string inside the mapping
+ */
+static inline const char *manifest_string(const void *map, const manifest_string_t *string) {
+    return (const char *)map + string->offset;
+}
+
+/**
+ * @brief Get the name of an entry of resources/, sorted by name
+ * @param map Start of the mapped manifest
+ * @param index Index below resource_count
+ * @return NUL-terminated entry name inside the mapping
+ */
+static inline const char *manifest_resource(const void *map, uint32_t index) {
+    const manifest_header_t *header = map;
+    const manifest_string_t *resources = (const manifest_string_t *)((const char *)map + header->resource_offset);
+    
+    return manifest_string(map, &resources[index]);
+}
+
+void manifest_set_enabled(int enabled);
+int manifest_load(bundle_probe_t *probe);
+int manifest_compile(const char *bundle_path);
+
+#endif /* VLAUNCH_MANIFEST_H */
@@ -0,0 +1,323 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file metadata.c
+ * @brief Zero-copy reader for bundle info.yaml
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Supported subset: top-level "key: value" lines, one nested level for
+ * the env: block, "#" comments, and values in single or double quotes.
+ * Escapes inside quotes are not interpreted. Unknown keys are ignored so
+ * bundles can carry descriptive fields the launcher does not use.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "launcher.h"
+#include "metadata.h"
+
+/* How a known key is stored */
+typedef enum {
+    METADATA_STRING,
+    METADATA_BOOL
+} metadata_type_t;
+
+/* Top-level keys the launcher understands */
+static const struct {
+    const char *key;
+    metadata_type_t type;
+    size_t offset;
+} metadata_keys[] = {
+    { "name",           METADATA_STRING, offsetof(bundle_metadata_t, name)                               },
+    { "version",        METADATA_STRING, offsetof(bundle_metadata_t, version)                            },
+    { "entry",          METADATA_STRING, offsetof(bundle_metadata_t, entry)                              },
+    { "toolkit",        METADATA_STRING, offsetof(bundle_metadata_t, toolkit)                            },
+    { "runtimes",       METADATA_STRING, offsetof(bundle_metadata_t, runtimes)                           },
+    { "sandbox",        METADATA_STRING, offsetof(bundle_metadata_t, sandbox)                            },
+    { "resources-url",  METADATA_STRING, offsetof(bundle_metadata_t, resources_url)                      },
+    { "prefetch",       METADATA_BOOL,   offsetof(bundle_metadata_t, prefetch)                           },
+    { "ld-index",       METADATA_BOOL,   offsetof(bundle_metadata_t, ld_index)                           },
+    
+    // Scheduling controls, validated by placement.c
+    { "cpus",           METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_CPUS])          },
+    { "numa-node",      METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_NUMA_NODE])     },
+    { "sched-policy",   METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_SCHED_POLICY])  },
+    { "sched-priority", METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_SCHED_PRIORITY]) },
+    { "nice",           METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_NICE])          },
+    { "cgroup",         METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_CGROUP])        },
+    { "cpu-max",        METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_CPU_MAX])       },
+    { "memory-high",    METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_MEMORY_HIGH])   },
+    { "io-priority",    METADATA_STRING, offsetof(bundle_metadata_t, placement[PLACEMENT_IO_PRIORITY])   }
+};
+
+/**
+ * @brief Compare a mapped value with a string literal
+ * @param value Value to compare
+ * @param literal NUL-terminated string
+ * @return Non-zero if both are equal
+ */
+static int value_is(const metadata_value_t *value, const char *literal) {
+    return strlen(literal) == value->length && memcmp(value->data, literal, value->length) == 0;
+}
+
+/**
+ * @brief Parse a boolean value
+ * @param value Value to parse
+ * @param out Receives 0 or 1
+ * @return 0 on success, -1 if the value is not a boolean
+ */
+static int parse_bool(const metadata_value_t *value, int *out) {
+    static const char *const truthy[] = { "true", "yes", "on" };
+    static const char *const falsy[] = { "false", "no", "off" };
+    
+    for (size_t i = 0; i < sizeof(truthy) / sizeof(truthy[0]); i++) {
+        if (strlen(truthy[i]) == value->length && strncasecmp(value->data, truthy[i], value->length) == 0) {
+            *out = 1;
+            return 0;
+        }
+        if (strlen(falsy[i]) == value->length && strncasecmp(value->data, falsy[i], value->length) == 0) {
+            *out = 0;
+            return 0;
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * @brief Trim blanks from both ends of a span
+ * @param start Start of the span
+ * @param end End of the span
+ * @return Trimmed span
+ */
+static metadata_value_t trim(const char *start, const char *end) {
+    metadata_value_t span;
+    
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+    
+    span.data = start;
+    span.length = (size_t)(end - start);
+    return span;
+}
+
+/**
+ * @brief Extract the value after a key, removing quotes and comments
+ * @param start First character after the colon
+ * @param end End of the line
+ * @param value Receives the value
+ * @return 0 on success, -1 if a quote is not closed
+ */
+static int parse_value(const char *start, const char *end, metadata_value_t *value) {
+    *value = trim(start, end);
+    
+    if (value->length > 0 && (value->data[0] == '"' || value->data[0] == '\'')) {
+        const char *close = memchr(value->data + 1, value->data[0], value->length - 1);
+        if (close == NULL) {
+            return -1;
+        }
+        value->length = (size_t)(close - value->data - 1);
+        value->data++;
+        return 0;
+    }
+    
+    // A comment starts at a '#' that follows a blank
+    for (size_t i = 1; i < value->length; i++) {
+        if (value->data[i] == '#' && (value->data[i - 1] == ' ' || value->data[i - 1] == '\t')) {
+            *value = trim(value->data, value->data + i);
+            break;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Store a top-level key
+ * @param metadata Metadata being filled
+ * @param key Key name
+ * @param value Key value
+ * @param line Line number for diagnostics
+ */
+static void store_key(bundle_metadata_t *metadata, const metadata_value_t *key,
+                      const metadata_value_t *value, unsigned int line) {
+    for (size_t i = 0; i < sizeof(metadata_keys) / sizeof(metadata_keys[0]); i++) {
+        char *field = (char *)metadata + metadata_keys[i].offset;
+        
+        if (!value_is(key, metadata_keys[i].key)) {
+            continue;
+        }
+        
+        if (metadata_keys[i].type == METADATA_STRING) {
+            *(metadata_value_t *)field = *value;
+        } else if (parse_bool(value, (int *)field) != 0) {
+            log_message(LOG_WARNING, "info.yaml:%u: %s expects true or false", line, metadata_keys[i].key);
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Parse the mapped file in one pass
+ * @param metadata Metadata with map and size set
+ */
+static void parse_metadata(bundle_metadata_t *metadata) {
+    const char *cursor = metadata->map;
+    const char *end = cursor + metadata->size;
+    unsigned int line = 0;
+    int in_env = 0;
+    
+    while (cursor < end) {
+        const char *line_start = cursor;
+        const char *line_end = memchr(cursor, '\n', (size_t)(end - cursor));
+        metadata_value_t key;
+        metadata_value_t value;
+        const char *colon;
+        const char *text;
+        
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        cursor = line_end < end ? line_end + 1 : end;
+        line++;
+        
+        if (line_end > line_start && line_end[-1] == '\r') {
+            line_end--;
+        }
+        text = line_start;
+        while (text < line_end && (*text == ' ' || *text == '\t')) {
+            text++;
+        }
+        if (text == line_end || *text == '#' ||
+            (line_end - text >= 3 && memcmp(text, "---", 3) == 0)) {
+            continue;
+        }
+        
+        // Anything at column zero closes the env: block
+        int indented = text > line_start;
+        if (!indented) {
+            in_env = 0;
+        }
+        
+        colon = memchr(text, ':', (size_t)(line_end - text));
+        if (colon == NULL || parse_value(colon + 1, line_end, &value) != 0) {
+            log_message(LOG_WARNING, "info.yaml:%u: ignoring malformed line", line);
+            continue;
+        }
+        key = trim(text, colon);
+        
+        if (indented) {
+            if (!in_env) {
+                log_message(LOG_DEBUG, "info.yaml:%u: ignoring nested key", line);
+            } else if (metadata->env_count >= METADATA_MAX_ENV) {
+                log_message(LOG_WARNING, "info.yaml:%u: more than %d env entries", line, METADATA_MAX_ENV);
+            } else if (key.length > 0) {
+                metadata->env[metadata->env_count].name = key;
+                metadata->env[metadata->env_count].value = value;
+                metadata->env_count++;
+            }
+            continue;
+        }
+        
+        if (value.length == 0 && value_is(&key, "env")) {
+            in_env = 1;
+            continue;
+        }
+        store_key(metadata, &key, &value, line);
+    }
+}
+
+/**
+ * @brief Map and parse info.yaml
+ * @param metadata Receives the parsed metadata
+ * @param fd Open descriptor of info.yaml
+ * @param size File size
+ * @return EXIT_SUCCESS on success, EXIT_BUNDLE_ERROR if the file cannot be mapped
+ */
+int metadata_load(bundle_metadata_t *metadata, int fd, size_t size) {
+    memset(metadata, 0, sizeof(*metadata));
+    
+    if (size == 0) {
+        return EXIT_SUCCESS;
+    }
+    
+    metadata->map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (metadata->map == MAP_FAILED) {
+        metadata->map = NULL;
+        return EXIT_BUNDLE_ERROR;
+    }
+    metadata->size = size;
+    
+    parse_metadata(metadata);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Unmap info.yaml; values become invalid
+ * @param metadata Metadata to release
+ */
+void metadata_release(bundle_metadata_t *metadata) {
+    if (metadata->map != NULL) {
+        munmap(metadata->map, metadata->size);
+    }
+    memset(metadata, 0, sizeof(*metadata));
+}
+
+/**
+ * @brief Copy a value into a NUL-terminated buffer
+ * @param value Value to copy
+ * @param out Output buffer
+ * @param size Size of the output buffer
+ * @return 0 on success, -1 if the value does not fit
+ */
+int metadata_copy(const metadata_value_t *value, char *out, size_t size) {
+    if (value->length >= size) {
+        return -1;
+    }
+    memcpy(out, value->data, value->length);
+    out[value->length] = '\0';
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file metadata.h
+ * @brief Zero-copy reader for bundle info.yaml
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Maps info.yaml and parses the flat "key: value" subset bundles use in
+ * a single pass. Values point into the mapping instead of being copied,
+ * so reading metadata never allocates.
+ */
+
+#ifndef VLAUNCH_METADATA_H
+#define VLAUNCH_METADATA_H
+
+#include <stddef.h>
+
+/* Metadata Configuration */
+#define METADATA_MAX_ENV    32
+
+/* Scheduling controls; kept as text and parsed when they are applied */
+typedef enum {
+    PLACEMENT_CPUS,
+    PLACEMENT_NUMA_NODE,
+    PLACEMENT_SCHED_POLICY,
+    PLACEMENT_SCHED_PRIORITY,
+    PLACEMENT_NICE,
+    PLACEMENT_CGROUP,
+    PLACEMENT_CPU_MAX,
+    PLACEMENT_MEMORY_HIGH,
+    PLACEMENT_IO_PRIORITY,
+    PLACEMENT_COUNT
+} placement_key_t;
+
+/* A value inside the mapped file; not NUL-terminated */
+typedef struct {
+    const char *data;
+    size_t length;
+} metadata_value_t;
+
+/* One entry of the env: block */
+typedef struct {
+    metadata_value_t name;
+    metadata_value_t value;
+} metadata_env_t;
+
+/* Parsed info.yaml; empty if the bundle has none */
+typedef struct {
+    void *map;
+    size_t size;
+    
+    metadata_value_t name;
+    metadata_value_t version;
+    metadata_value_t entry;
+    
+    // Toolkit host the daemon loads the application into, see toolkit.h
+    metadata_value_t toolkit;
+    
+    // Shared runtimes whose libraries are searched after the bundle's, see libpath.h
+    metadata_value_t runtimes;
+    
+    // Namespaces the application runs in, see sandbox.h
+    metadata_value_t sandbox;
+    
+    // Where lazily fetched resources come from, see lazy.h
+    metadata_value_t resources_url;
+    
+    // Launch tuning hints
+    int prefetch;
+    int ld_index;
+    
+    // Where and how the application runs; empty values are left alone
+    metadata_value_t placement[PLACEMENT_COUNT];
+    
+    metadata_env_t env[METADATA_MAX_ENV];
+    unsigned int env_count;
+} bundle_metadata_t;
+
+int metadata_load(bundle_metadata_t *metadata, int fd, size_t size);
+void metadata_release(bundle_metadata_t *metadata);
+int metadata_copy(const metadata_value_t *value, char *out, size_t size);
+
+#endif /* VLAUNCH_METADATA_H */
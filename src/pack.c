@@ -0,0 +1,1018 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file pack.c
+ * @brief Packed single-file bundles (.vapp)
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Opening an image validates its index completely before anything is
+ * written: names are plain relative paths, sorted and unique, and the
+ * parent of every entry is a directory entry, so unpacking never
+ * follows a symlink out of the target tree. Each image version unpacks
+ * into its own cache directory through a temporary name and a rename,
+ * so concurrent launches either see a finished tree or unpack their own.
+ *
+ * Every launch takes a shared flock() on the tree it runs from and the
+ * application inherits it, so a version stays until nothing uses it.
+ * Versions replaced by a newer image are removed once their lock can be
+ * taken exclusively, after renaming them out of the way so a launch
+ * that locks one too late sees it gone. Unpacking holds an exclusive
+ * lock on its temporary tree, so one that is left unlocked belonged to
+ * a launch that died and is removed as well.
+ *
+ * Contents are stored uncompressed; the image is meant to be shipped
+ * through a compressing transport. Launches run from the unpacked files,
+ * so the image itself is only read while unpacking.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "ldindex.h"
+#include "manifest.h"
+#include "resource.h"
+#include "pack.h"
+#include "store.h"
+#include "handoff.h"
+
+/* Buffer size for copies that cannot use copy_file_range() */
+#define PACK_COPY_CHUNK     (64 * 1024)
+
+/* Seconds an unlocked temporary tree is left alone, covering the moment between its mkdir() and its lock */
+#define PACK_ORPHAN_AGE     60
+
+/* Suffix of trees being unpacked or removed, followed by the owner's pid */
+#define PACK_TEMP_SUFFIX    ".tmp."
+
+/* Mapped image being opened */
+typedef struct {
+    const char *map;
+    size_t size;
+    const pack_header_t *header;
+    const pack_entry_t *entries;
+    const char *index;
+} pack_image_t;
+
+/* Entry of a bundle tree being packed */
+typedef struct {
+    char *name;
+    uint32_t mode;
+    uint64_t size;
+    uint64_t offset;
+    int rank;
+} pack_source_t;
+
+/* Growable list of entries being packed */
+typedef struct {
+    pack_source_t *entries;
+    size_t count;
+    size_t capacity;
+} pack_list_t;
+
+/**
+ * @brief FNV-1a over a byte range
+ * @param hash Running hash
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @return Updated hash
+ */
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x01000193u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Round an offset up to the data alignment
+ * @param offset Offset to round
+ * @return Aligned offset
+ */
+static uint64_t pack_align(uint64_t offset) {
+    return (offset + PACK_ALIGNMENT - 1) & ~(uint64_t)(PACK_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Copy a byte range between files, in the kernel when possible
+ * @param in_fd Source file
+ * @param in_offset Offset in the source
+ * @param out_fd Destination file
+ * @param out_offset Offset in the destination
+ * @param size Number of bytes
+ * @return 0 on success, -1 on failure with errno set
+ */
+static int copy_range(int in_fd, off_t in_offset, int out_fd, off_t out_offset, uint64_t size) {
+    char buffer[PACK_COPY_CHUNK];
+    
+    while (size > 0) {
+        ssize_t copied = copy_file_range(in_fd, &in_offset, out_fd, &out_offset, size, 0);
+        if (copied > 0) {
+            size -= (uint64_t)copied;
+            continue;
+        }
+        if (copied == 0) {
+            errno = EIO;
+            return -1;
+        }
+        if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP) {
+            return -1;
+        }
+        break;
+    }
+    
+    // Older kernels and some filesystems only support plain reads and writes
+    while (size > 0) {
+        size_t chunk = size < sizeof(buffer) ? (size_t)size : sizeof(buffer);
+        ssize_t n = pread(in_fd, buffer, chunk, in_offset);
+        
+        if (n <= 0) {
+            if (n == 0) {
+                errno = EIO;
+            }
+            return -1;
+        }
+        if (pwrite(out_fd, buffer, (size_t)n, out_offset) != n) {
+            return -1;
+        }
+        in_offset += n;
+        out_offset += n;
+        size -= (uint64_t)n;
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Check that an entry name is a plain relative path
+ * @param name Name to check
+ * @param length Length of the name
+ * @return Non-zero if every component is a real name
+ */
+static int name_valid(const char *name, size_t length) {
+    size_t start = 0;
+    
+    if (length == 0 || memchr(name, '\0', length) != NULL) {
+        return 0;
+    }
+    
+    while (start <= length) {
+        const char *slash = memchr(name + start, '/', length - start);
+        size_t end = slash ? (size_t)(slash - name) : length;
+        size_t component = end - start;
+        
+        if (component == 0 ||
+            (component == 1 && name[start] == '.') ||
+            (component == 2 && name[start] == '.' && name[start + 1] == '.')) {
+            return 0;
+        }
+        start = end + 1;
+    }
+    
+    return 1;
+}
+
+/**
+ * @brief Find an index entry by name
+ * @param image Validated image
+ * @param name Name to look up, not necessarily NUL-terminated
+ * @param length Length of the name
+ * @return Entry, or NULL if the image has none by that name
+ */
+static const pack_entry_t *find_entry(const pack_image_t *image, const char *name, size_t length) {
+    uint32_t low = 0;
+    uint32_t high = image->header->entry_count;
+    
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        const pack_entry_t *entry = &image->entries[middle];
+        size_t common = entry->name_length < length ? entry->name_length : length;
+        int order = memcmp(image->index + entry->name_offset, name, common);
+        
+        if (order == 0) {
+            order = (entry->name_length > length) - (entry->name_length < length);
+        }
+        if (order == 0) {
+            return entry;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Check that a mapped image is intact and its index is safe to unpack
+ * @param image Image with map and size set; the other fields are filled in
+ * @return Non-zero if the image is valid
+ */
+static int image_valid(pack_image_t *image) {
+    const pack_header_t *header = (const pack_header_t *)image->map;
+    uint64_t data_start;
+    uint64_t entries_size;
+    
+    if (image->size < sizeof(*header) ||
+        header->magic != PACK_MAGIC ||
+        header->version != PACK_VERSION ||
+        header->size != image->size ||
+        header->index_size > PACK_MAX_INDEX ||
+        header->index_size > image->size - sizeof(*header) ||
+        header->entry_count > PACK_MAX_ENTRIES) {
+        return 0;
+    }
+    
+    entries_size = (uint64_t)header->entry_count * sizeof(pack_entry_t);
+    data_start = sizeof(*header) + header->index_size;
+    image->header = header;
+    image->index = image->map + sizeof(*header);
+    image->entries = (const pack_entry_t *)image->index;
+    if (entries_size > header->index_size ||
+        fnv1a(0x811c9dc5u, image->index, header->index_size) != header->checksum) {
+        return 0;
+    }
+    
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const pack_entry_t *entry = &image->entries[i];
+        const char *name = image->index + entry->name_offset;
+        const char *slash;
+        
+        if (entry->name_offset < entries_size || entry->name_offset >= header->index_size ||
+            entry->name_length >= header->index_size - entry->name_offset ||
+            name[entry->name_length] != '\0' ||
+            !name_valid(name, entry->name_length)) {
+            return 0;
+        }
+        
+        // Strict order keeps names unique and lookups logarithmic
+        if (i > 0 && strcmp(image->index + image->entries[i - 1].name_offset, name) >= 0) {
+            return 0;
+        }
+        
+        if (S_ISDIR(entry->mode)) {
+            if (entry->size != 0) {
+                return 0;
+            }
+        } else if (S_ISREG(entry->mode) || S_ISLNK(entry->mode)) {
+            if (entry->offset % PACK_ALIGNMENT != 0 || entry->offset < data_start ||
+                entry->offset > image->size || entry->size > image->size - entry->offset ||
+                (S_ISLNK(entry->mode) && (entry->size == 0 || entry->size >= MAX_PATH_LENGTH))) {
+                return 0;
+            }
+        } else {
+            return 0;
+        }
+        
+        // Parents sort before their children and must be real directories
+        slash = memrchr(name, '/', entry->name_length);
+        if (slash != NULL) {
+            const pack_entry_t *parent = find_entry(image, name, (size_t)(slash - name));
+            if (parent == NULL || parent >= entry || !S_ISDIR(parent->mode)) {
+                return 0;
+            }
+        }
+    }
+    
+    return 1;
+}
+
+/**
+ * @brief Remove a directory tree
+ * @param dirfd Directory containing the tree
+ * @param name Name of the tree
+ */
+static void remove_tree(int dirfd, const char *name) {
+    struct dirent *entry;
+    DIR *dir;
+    int fd;
+    
+    fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        unlinkat(dirfd, name, 0);
+        return;
+    }
+    dir = fdopendir(fd);
+    if (dir == NULL) {
+        close(fd);
+        return;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (entry->d_type == DT_DIR) {
+            remove_tree(fd, entry->d_name);
+        } else if (unlinkat(fd, entry->d_name, 0) != 0 && errno == EISDIR) {
+            remove_tree(fd, entry->d_name);
+        }
+    }
+    
+    closedir(dir);
+    unlinkat(dirfd, name, AT_REMOVEDIR);
+}
+
+/**
+ * @brief Remove an earlier version's tree unless a launch still holds its lock
+ * @param dirfd Cache directory holding unpacked trees
+ * @param name Name of the tree
+ */
+static void remove_unused_tree(int dirfd, const char *name) {
+    char retired[MAX_PATH_LENGTH];
+    int fd;
+    
+    fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    
+    // Renamed while locked, so lock_tree() in a launch that raced this one finds the name gone
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0 &&
+        (size_t)snprintf(retired, sizeof(retired), "%s%s%ld", name, PACK_TEMP_SUFFIX, (long)getpid()) < sizeof(retired) &&
+        renameat(dirfd, name, dirfd, retired) == 0) {
+        log_message(LOG_DEBUG, "Removing stale unpacked bundle: %s", name);
+        remove_tree(dirfd, retired);
+    }
+    close(fd);
+}
+
+/**
+ * @brief Remove a temporary tree whose unpacking or removal was cut short
+ * @param dirfd Cache directory holding unpacked trees
+ * @param name Name of the tree
+ */
+static void remove_orphaned_tree(int dirfd, const char *name) {
+    struct stat st;
+    int fd;
+    
+    fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    if (fstat(fd, &st) == 0 && st.st_mtime + PACK_ORPHAN_AGE < time(NULL) && flock(fd, LOCK_EX | LOCK_NB) == 0) {
+        log_message(LOG_DEBUG, "Removing orphaned unpacked tree: %s", name);
+        remove_tree(dirfd, name);
+    }
+    close(fd);
+}
+
+/**
+ * @brief Remove unused trees of earlier versions of an image and orphaned temporary trees
+ * @param directory Cache directory holding unpacked trees
+ * @param prefix Name prefix shared by every version of the image
+ * @param current Name of the version to keep
+ */
+static void remove_stale_versions(const char *directory, const char *prefix, const char *current) {
+    size_t prefix_length = strlen(prefix);
+    struct dirent *entry;
+    DIR *dir;
+    
+    dir = opendir(directory);
+    if (dir == NULL) {
+        return;
+    }
+    
+    while ((entry = readdir(dir)) != NULL) {
+        if (strstr(entry->d_name, PACK_TEMP_SUFFIX) != NULL) {
+            remove_orphaned_tree(dirfd(dir), entry->d_name);
+        } else if (strncmp(entry->d_name, prefix, prefix_length) == 0 && strcmp(entry->d_name, current) != 0 &&
+                   strchr(entry->d_name, '.') == NULL) {
+            remove_unused_tree(dirfd(dir), entry->d_name);
+        }
+    }
+    
+    closedir(dir);
+}
+
+/**
+ * @brief Take the shared lock a launch holds on the tree it runs from
+ * @param probe Probe with path naming an unpacked tree; dirfd and image_lock are set
+ * @return 0 if the tree is locked and still installed, -1 if it is missing or was removed
+ */
+static int lock_tree(bundle_probe_t *probe) {
+    struct stat locked;
+    struct stat named;
+    int fd;
+    
+    fd = open(probe->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    // Waits out a removal in progress, after which the name is gone or another tree's
+    if (flock(fd, LOCK_SH) != 0 || fstat(fd, &locked) != 0 || stat(probe->path, &named) != 0 ||
+        locked.st_dev != named.st_dev || locked.st_ino != named.st_ino) {
+        close(fd);
+        return -1;
+    }
+    
+    // Inherited across exec, above the range descriptors are handed to the application in
+    probe->image_lock = fcntl(fd, F_DUPFD, HANDOFF_FIRST_FD + HANDOFF_MAX_FDS);
+    probe->dirfd = openat(fd, ".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    close(fd);
+    if (probe->image_lock < 0 || probe->dirfd < 0) {
+        if (probe->image_lock >= 0) {
+            close(probe->image_lock);
+        }
+        if (probe->dirfd >= 0) {
+            close(probe->dirfd);
+        }
+        probe->image_lock = -1;
+        probe->dirfd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Write every entry of an image below a new directory
+ * @param image Validated image
+ * @param image_fd Descriptor of the image
+ * @param rootfd Empty target directory
+ * @return 0 on success, -1 on failure
+ */
+static int unpack_entries(const pack_image_t *image, int image_fd, int rootfd) {
+    char target[MAX_PATH_LENGTH];
+    
+    for (uint32_t i = 0; i < image->header->entry_count; i++) {
+        const pack_entry_t *entry = &image->entries[i];
+        const char *name = image->index + entry->name_offset;
+        mode_t mode = (mode_t)(entry->mode & 07777);
+        int fd;
+        
+        if (S_ISDIR(entry->mode)) {
+            if (mkdirat(rootfd, name, mode | S_IRWXU) != 0) {
+                log_message(LOG_ERROR, "Cannot create %s: %s", name, strerror(errno));
+                return -1;
+            }
+        } else if (S_ISLNK(entry->mode)) {
+            memcpy(target, image->map + entry->offset, entry->size);
+            target[entry->size] = '\0';
+            if (symlinkat(target, rootfd, name) != 0) {
+                log_message(LOG_ERROR, "Cannot create %s: %s", name, strerror(errno));
+                return -1;
+            }
+        } else {
+            fd = openat(rootfd, name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+            if (fd < 0 ||
+                copy_range(image_fd, (off_t)entry->offset, fd, 0, entry->size) != 0 ||
+                fchmod(fd, mode) != 0) {
+                log_message(LOG_ERROR, "Cannot unpack %s: %s", name, strerror(errno));
+                if (fd >= 0) {
+                    close(fd);
+                }
+                return -1;
+            }
+            close(fd);
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Unpack an image into the cache unless this version already is
+ * @param image Validated image
+ * @param image_fd Descriptor of the image
+ * @param probe Probe with image_path and the image stat result set
+ * @return EXIT_SUCCESS with probe->path naming the tree, error code on failure
+ */
+static int unpack_image(const pack_image_t *image, int image_fd, bundle_probe_t *probe) {
+    char key[MAX_PATH_LENGTH * 2];
+    char base[MAX_PATH_LENGTH];
+    char temp[MAX_PATH_LENGTH + 32];
+    char library[MAX_PATH_LENGTH + 64];
+    const struct statx *stx = &probe->image;
+    uint64_t identity[7];
+    uint32_t version;
+    char *name;
+    int rootfd = -1;
+    int failed;
+    
+    // Key the cache by absolute image path; each version gets its own tree
+    if (probe->image_path[0] == '/' || getcwd(key, MAX_PATH_LENGTH) == NULL) {
+        snprintf(key, sizeof(key), "%s", probe->image_path);
+    } else {
+        size_t used = strlen(key);
+        snprintf(key + used, sizeof(key) - used, "/%s", probe->image_path);
+    }
+    if (cache_entry_path(PACK_CACHE_DIR, key, base, sizeof(base)) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "No cache directory to unpack %s into", probe->image_path);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    identity[0] = ((uint64_t)stx->stx_dev_major << 32) | stx->stx_dev_minor;
+    identity[1] = stx->stx_ino;
+    identity[2] = stx->stx_size;
+    identity[3] = (uint64_t)stx->stx_mtime.tv_sec;
+    identity[4] = stx->stx_mtime.tv_nsec;
+    identity[5] = (uint64_t)stx->stx_ctime.tv_sec;
+    identity[6] = stx->stx_ctime.tv_nsec;
+    version = fnv1a(image->header->checksum, identity, sizeof(identity));
+    
+    if (snprintf(probe->path, sizeof(probe->path), "%s-%08x", base, version) >= (int)sizeof(probe->path)) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (lock_tree(probe) == 0) {
+        return EXIT_SUCCESS;
+    }
+    
+    log_message(LOG_INFO, "Unpacking %s into %s", probe->image_path, probe->path);
+    snprintf(temp, sizeof(temp), "%s%s%ld", probe->path, PACK_TEMP_SUFFIX, (long)getpid());
+    remove_tree(AT_FDCWD, temp);
+    if (mkdir(temp, 0755) != 0 || (rootfd = open(temp, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0 ||
+        flock(rootfd, LOCK_EX) != 0) {
+        log_message(LOG_ERROR, "Cannot create %s: %s", temp, strerror(errno));
+        if (rootfd >= 0) {
+            close(rootfd);
+        }
+        return EXIT_SYSTEM_ERROR;
+    }
+    failed = unpack_entries(image, image_fd, rootfd) != 0;
+    
+    // Unpacked trees live in the cache, next to the default store
+    if (!failed) {
+        snprintf(library, sizeof(library), "%s/%s", temp, bundle_component_paths[COMPONENT_LIBRARY]);
+        store_share_libraries(library);
+    }
+    
+    // Another launch may have finished the same version first
+    if (failed || (rename(temp, probe->path) != 0 && errno != EEXIST && errno != ENOTEMPTY)) {
+        if (!failed) {
+            log_message(LOG_ERROR, "Cannot install %s: %s", probe->path, strerror(errno));
+        }
+        remove_tree(AT_FDCWD, temp);
+        close(rootfd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    remove_tree(AT_FDCWD, temp);
+    close(rootfd);
+    
+    if (lock_tree(probe) != 0) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    name = strrchr(base, '/');
+    *name++ = '\0';
+    strcat(name, "-");
+    remove_stale_versions(base, name, strrchr(probe->path, '/') + 1);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Describe an index entry as a stat result of the unpacked tree
+ * @param image Validated image
+ * @param image_stx Stat result of the image file
+ * @param entry Entry to describe
+ * @param stx Receives the stat result
+ */
+static void entry_statx(const pack_image_t *image, const struct statx *image_stx,
+                        const pack_entry_t *entry, struct statx *stx) {
+    // Every entry changes whenever the image does, which is what the caches key on
+    *stx = *image_stx;
+    stx->stx_ino = (uint64_t)(entry - image->entries) + 1;
+    stx->stx_mode = (uint16_t)entry->mode;
+    stx->stx_size = entry->size;
+}
+
+/**
+ * @brief Open a packed bundle, answering component checks from its index
+ * @param probe Probe to fill in; probe->path is set to the unpacked tree
+ * @param image_path Path to the .vapp image
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int pack_probe_open(bundle_probe_t *probe, const char *image_path) {
+    pack_image_t image;
+    int result;
+    int fd;
+    
+    snprintf(probe->image_path, sizeof(probe->image_path), "%s", image_path);
+    fd = open(image_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return EXIT_BUNDLE_ERROR;
+    }
+    if (statx(fd, "", AT_EMPTY_PATH | AT_STATX_SYNC_AS_STAT, PROBE_STATX_MASK, &probe->image) != 0 ||
+        !S_ISREG(probe->image.stx_mode) || probe->image.stx_size < sizeof(pack_header_t)) {
+        close(fd);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    image.size = (size_t)probe->image.stx_size;
+    image.map = mmap(NULL, image.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (image.map == MAP_FAILED) {
+        close(fd);
+        return EXIT_BUNDLE_ERROR;
+    }
+    if (!image_valid(&image)) {
+        log_message(LOG_ERROR, "Not a valid bundle image: %s", image_path);
+        munmap((void *)image.map, image.size);
+        close(fd);
+        return EXIT_BUNDLE_ERROR;
+    }
+    
+    result = unpack_image(&image, fd, probe);
+    if (result == EXIT_SUCCESS) {
+        bundle_probe_load_entry(probe);
+        
+        for (int i = 0; i < COMPONENT_COUNT; i++) {
+            const char *name = bundle_component_paths[i];
+            const pack_entry_t *entry;
+            
+            if (i == COMPONENT_ROOT) {
+                probe->components[i] = probe->image;
+                probe->components[i].stx_mode = S_IFDIR | 0755;
+                probe->present[i] = 1;
+            } else if (i == COMPONENT_EXEC) {
+                // The pinned file is what gets exec'd, so it answers for itself
+                probe->present[i] = probe->exec_fd >= 0 &&
+                    statx(probe->exec_fd, "", AT_EMPTY_PATH | AT_STATX_SYNC_AS_STAT,
+                          PROBE_STATX_MASK, &probe->components[i]) == 0;
+            } else if (i != COMPONENT_METADATA && (entry = find_entry(&image, name, strlen(name))) != NULL) {
+                entry_statx(&image, &probe->image, entry, &probe->components[i]);
+                probe->present[i] = 1;
+            }
+        }
+    }
+    
+    munmap((void *)image.map, image.size);
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Check whether the image a probe was unpacked from is unchanged
+ * @param probe Probe opened from an image
+ * @return Non-zero if the image file is the one that was unpacked
+ */
+int pack_image_current(const bundle_probe_t *probe) {
+    struct statx stx;
+    
+    if (statx(AT_FDCWD, probe->image_path, AT_STATX_SYNC_AS_STAT, PROBE_STATX_MASK, &stx) != 0) {
+        return 0;
+    }
+    return stx.stx_dev_major == probe->image.stx_dev_major &&
+           stx.stx_dev_minor == probe->image.stx_dev_minor &&
+           stx.stx_ino == probe->image.stx_ino &&
+           stx.stx_size == probe->image.stx_size &&
+           stx.stx_mtime.tv_sec == probe->image.stx_mtime.tv_sec &&
+           stx.stx_mtime.tv_nsec == probe->image.stx_mtime.tv_nsec &&
+           stx.stx_ctime.tv_sec == probe->image.stx_ctime.tv_sec &&
+           stx.stx_ctime.tv_nsec == probe->image.stx_ctime.tv_nsec;
+}
+
+/**
+ * @brief Add an entry to the list of entries being packed
+ * @param list Entry list
+ * @param name Path relative to the bundle root
+ * @param st Status of the entry
+ * @return 0 on success, -1 on failure
+ */
+static int list_add(pack_list_t *list, const char *name, const struct stat *st) {
+    pack_source_t *entry;
+    
+    if (list->count == PACK_MAX_ENTRIES) {
+        log_message(LOG_ERROR, "Bundle has more than %u entries", PACK_MAX_ENTRIES);
+        return -1;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        pack_source_t *grown = realloc(list->entries, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        list->entries = grown;
+        list->capacity = capacity;
+    }
+    
+    entry = &list->entries[list->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->name = strdup(name);
+    entry->mode = (uint32_t)st->st_mode;
+    entry->size = S_ISDIR(st->st_mode) ? 0 : (uint64_t)st->st_size;
+    if (entry->name == NULL) {
+        return -1;
+    }
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Collect every entry below a directory of the bundle
+ * @param list Entry list
+ * @param dirfd Directory to walk; closed on return
+ * @param prefix Path of the directory relative to the bundle root, "" for the root
+ * @return 0 on success, -1 on failure
+ */
+static int collect_entries(pack_list_t *list, int dirfd, const char *prefix) {
+    char name[MAX_PATH_LENGTH];
+    struct dirent *entry;
+    struct stat st;
+    int failed = 0;
+    DIR *dir;
+    
+    dir = fdopendir(dirfd);
+    if (dir == NULL) {
+        close(dirfd);
+        return -1;
+    }
+    
+    while (!failed && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        
+        // The manifest and the indexes describe one location on disk
+        if (prefix[0] == '\0' && (strcmp(entry->d_name, MANIFEST_FILE_NAME) == 0 ||
+                                  strcmp(entry->d_name, LDINDEX_FILE_NAME) == 0 ||
+                                  strcmp(entry->d_name, RESOURCE_FILE_NAME) == 0)) {
+            continue;
+        }
+        
+        if (snprintf(name, sizeof(name), "%s%s%s", prefix, prefix[0] ? "/" : "", entry->d_name) >= (int)sizeof(name) ||
+            fstatat(dirfd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            log_message(LOG_ERROR, "Cannot pack %s/%s", prefix, entry->d_name);
+            failed = 1;
+            break;
+        }
+        if (!S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode) && !S_ISLNK(st.st_mode)) {
+            log_message(LOG_WARNING, "Skipping special file: %s", name);
+            continue;
+        }
+        
+        failed = list_add(list, name, &st) != 0;
+        if (!failed && S_ISDIR(st.st_mode)) {
+            int childfd = openat(dirfd, entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            failed = childfd < 0 || collect_entries(list, childfd, name) != 0;
+        }
+    }
+    
+    closedir(dir);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Order packed entries by name
+ * @param a First entry
+ * @param b Second entry
+ * @return Negative, zero or positive like strcmp
+ */
+static int compare_sources(const void *a, const void *b) {
+    return strcmp(((const pack_source_t *)a)->name, ((const pack_source_t *)b)->name);
+}
+
+/**
+ * @brief Order packed entries by where their data goes in the image
+ * @param a First entry
+ * @param b Second entry
+ * @return Negative, zero or positive like strcmp
+ */
+static int compare_placement(const void *a, const void *b) {
+    const pack_source_t *left = *(pack_source_t *const *)a;
+    const pack_source_t *right = *(pack_source_t *const *)b;
+    
+    if (left->rank != right->rank) {
+        return left->rank - right->rank;
+    }
+    return strcmp(left->name, right->name);
+}
+
+/**
+ * @brief Rank an entry by how early a launch reads it
+ * @param name Path relative to the bundle root
+ * @param exec_path Entry point of the bundle
+ * @return Lower ranks are placed first
+ */
+static int placement_rank(const char *name, const char *exec_path) {
+    static const char *const order[] = { LIB_PATH + 1, "exec", METADATA_PATH + 1, ICON_PATH + 1 };
+    
+    if (strcmp(name, exec_path) == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        size_t length = strlen(order[i]);
+        if (strncmp(name, order[i], length) == 0 && (name[length] == '/' || name[length] == '\0')) {
+            return (int)i + 1;
+        }
+    }
+    return (int)(sizeof(order) / sizeof(order[0])) + 1;
+}
+
+/**
+ * @brief Write the image of a collected bundle tree
+ * @param list Entries, sorted by name
+ * @param rootfd Bundle directory
+ * @param fd Image file
+ * @return 0 on success, -1 on failure
+ */
+static int write_image(pack_list_t *list, int rootfd, int fd) {
+    char target[MAX_PATH_LENGTH];
+    pack_source_t **placement;
+    pack_header_t header;
+    uint64_t names_size = 0;
+    uint64_t index_size;
+    uint64_t cursor;
+    char *index;
+    int failed = 0;
+    
+    for (size_t i = 0; i < list->count; i++) {
+        names_size += strlen(list->entries[i].name) + 1;
+    }
+    index_size = (list->count * sizeof(pack_entry_t) + names_size + 7) & ~(uint64_t)7;
+    if (index_size > PACK_MAX_INDEX) {
+        log_message(LOG_ERROR, "Bundle index too large (%llu bytes)", (unsigned long long)index_size);
+        return -1;
+    }
+    
+    index = calloc(1, index_size);
+    placement = calloc(list->count ? list->count : 1, sizeof(*placement));
+    if (index == NULL || placement == NULL) {
+        free(index);
+        free(placement);
+        return -1;
+    }
+    
+    // Data is laid out in launch order, each file on its own pages
+    cursor = pack_align(sizeof(header) + index_size);
+    for (size_t i = 0; i < list->count; i++) {
+        placement[i] = &list->entries[i];
+    }
+    qsort(placement, list->count, sizeof(*placement), compare_placement);
+    for (size_t i = 0; i < list->count; i++) {
+        if (!S_ISDIR(placement[i]->mode)) {
+            placement[i]->offset = cursor;
+            cursor = pack_align(cursor + placement[i]->size);
+        }
+    }
+    
+    uint32_t name_offset = (uint32_t)(list->count * sizeof(pack_entry_t));
+    for (size_t i = 0; i < list->count; i++) {
+        pack_entry_t *entry = (pack_entry_t *)index + i;
+        size_t length = strlen(list->entries[i].name);
+        
+        entry->name_offset = name_offset;
+        entry->name_length = (uint32_t)length;
+        entry->mode = list->entries[i].mode;
+        entry->offset = list->entries[i].offset;
+        entry->size = list->entries[i].size;
+        memcpy(index + name_offset, list->entries[i].name, length + 1);
+        name_offset += (uint32_t)length + 1;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.entry_count = (uint32_t)list->count;
+    header.checksum = fnv1a(0x811c9dc5u, index, index_size);
+    header.index_size = index_size;
+    header.size = cursor;
+    
+    if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        pwrite(fd, index, index_size, sizeof(header)) != (ssize_t)index_size ||
+        ftruncate(fd, (off_t)cursor) != 0) {
+        failed = 1;
+    }
+    
+    for (size_t i = 0; !failed && i < list->count; i++) {
+        const pack_source_t *entry = placement[i];
+        struct stat st;
+        ssize_t length;
+        int source;
+        
+        if (S_ISLNK(entry->mode)) {
+            length = readlinkat(rootfd, entry->name, target, sizeof(target));
+            failed = length < 0 || (uint64_t)length != entry->size ||
+                     pwrite(fd, target, (size_t)length, (off_t)entry->offset) != length;
+        } else if (S_ISREG(entry->mode)) {
+            source = openat(rootfd, entry->name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+            failed = source < 0 || fstat(source, &st) != 0 || (uint64_t)st.st_size != entry->size ||
+                     copy_range(source, 0, fd, (off_t)entry->offset, entry->size) != 0;
+            if (source >= 0) {
+                close(source);
+            }
+        }
+        if (failed) {
+            log_message(LOG_ERROR, "Cannot pack %s (changed while packing?)", entry->name);
+        }
+    }
+    
+    free(index);
+    free(placement);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Pack a bundle directory into a single .vapp image
+ * @param bundle_path Path to application bundle
+ * @param image_path Image to create or atomically replace
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int pack_bundle(const char *bundle_path, const char *image_path) {
+    char temp[MAX_PATH_LENGTH + 32];
+    pack_list_t list = { NULL, 0, 0 };
+    bundle_probe_t probe;
+    int result;
+    int rootfd;
+    int fd;
+    
+    // Only bundles that would launch are worth packing
+    bundle_probe_open(&probe, bundle_path);
+    result = validate_bundle(&probe);
+    if (result != EXIT_SUCCESS) {
+        bundle_probe_close(&probe);
+        return result;
+    }
+    
+    rootfd = open(bundle_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rootfd < 0 || collect_entries(&list, dup(rootfd), "") != 0) {
+        log_message(LOG_ERROR, "Cannot read bundle %s", bundle_path);
+        result = EXIT_SYSTEM_ERROR;
+    }
+    
+    if (result == EXIT_SUCCESS) {
+        qsort(list.entries, list.count, sizeof(*list.entries), compare_sources);
+        for (size_t i = 0; i < list.count; i++) {
+            list.entries[i].rank = placement_rank(list.entries[i].name, probe.exec_path);
+        }
+        
+        snprintf(temp, sizeof(temp), "%s.tmp.%ld", image_path, (long)getpid());
+        fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            log_message(LOG_ERROR, "Cannot create %s: %s", temp, strerror(errno));
+            result = EXIT_SYSTEM_ERROR;
+        } else {
+            int failed = write_image(&list, rootfd, fd) != 0;
+            
+            if (close(fd) != 0 || failed || rename(temp, image_path) != 0) {
+                log_message(LOG_ERROR, "Cannot write %s", image_path);
+                unlink(temp);
+                result = EXIT_SYSTEM_ERROR;
+            }
+        }
+    }
+    
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Packed %s into %s (%zu entries)", bundle_path, image_path, list.count);
+    }
+    
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.entries[i].name);
+    }
+    free(list.entries);
+    if (rootfd >= 0) {
+        close(rootfd);
+    }
+    bundle_probe_close(&probe);
+    return result;
+}
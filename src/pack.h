@@ -0,0 +1,89 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file pack.h
+ * @brief Packed single-file bundles (.vapp)
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A .vapp image holds a whole bundle tree in one file: a header, a
+ * sorted index of every entry, and the file contents, each starting on
+ * a page boundary, with exec/ and library/ first. The launcher answers
+ * layout checks from the index and unpacks the tree once per image
+ * version into the cache, which is what the application is exec'd from;
+ * the ordering only makes that unpacking read the image front to back.
+ * Launches read the unpacked copies, laid out however the filesystem
+ * placed them.
+ */
+
+#ifndef VLAUNCH_PACK_H
+#define VLAUNCH_PACK_H
+
+#include <stdint.h>
+
+#include "launcher.h"
+
+/* Image Format */
+#define PACK_MAGIC          0x4b504c56u /* "VLPK" */
+#define PACK_VERSION        1
+#define PACK_ALIGNMENT      4096
+#define PACK_MAX_ENTRIES    (1u << 20)
+#define PACK_MAX_INDEX      (64u * 1024 * 1024)
+#define PACK_CACHE_DIR      "unpacked"
+
+/* Image header; the index follows it directly */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t checksum;
+    uint64_t index_size;
+    uint64_t size;
+} pack_header_t;
+
+/* Index entry; names are relative to the bundle root and sorted */
+typedef struct {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t mode;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+} pack_entry_t;
+
+int pack_probe_open(bundle_probe_t *probe, const char *image_path);
+int pack_image_current(const bundle_probe_t *probe);
+int pack_bundle(const char *bundle_path, const char *image_path);
+
+#endif /* VLAUNCH_PACK_H */
@@ -0,0 +1,729 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file placement.c
+ * @brief Per-bundle CPU, memory and I/O placement
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Controls are resolved from the command line first and info.yaml
+ * second, parsed into a placement_t and applied in one go by the process
+ * that execs the bundle: the forked child in the daemon and batch modes,
+ * the launcher itself for a direct launch. The cgroup is joined first so
+ * that everything after it, including the page faults of exec, is
+ * charged to it.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/magic.h>
+#include <linux/ioprio.h>
+#include <linux/mempolicy.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "placement.h"
+
+/* Resolved placement; unset fields leave the inherited setting alone */
+typedef struct {
+    int has_cpus;
+    cpu_set_t cpus;
+    int numa_node;
+    int policy;
+    int has_priority;
+    int priority;
+    int has_nice;
+    int nice;
+    char cgroup[MAX_PATH_LENGTH];
+    char cpu_max[64];
+    char memory_high[32];
+    int io_priority;
+} placement_t;
+
+/* Names shared by info.yaml keys and command line options */
+static const char *const placement_key_names[PLACEMENT_COUNT] = {
+    [PLACEMENT_CPUS]           = "cpus",
+    [PLACEMENT_NUMA_NODE]      = "numa-node",
+    [PLACEMENT_SCHED_POLICY]   = "sched-policy",
+    [PLACEMENT_SCHED_PRIORITY] = "sched-priority",
+    [PLACEMENT_NICE]           = "nice",
+    [PLACEMENT_CGROUP]         = "cgroup",
+    [PLACEMENT_CPU_MAX]        = "cpu-max",
+    [PLACEMENT_MEMORY_HIGH]    = "memory-high",
+    [PLACEMENT_IO_PRIORITY]    = "io-priority"
+};
+
+/* Scheduling policies by name */
+static const struct {
+    const char *name;
+    int policy;
+} placement_policies[] = {
+    { "other", SCHED_OTHER },
+    { "batch", SCHED_BATCH },
+    { "idle",  SCHED_IDLE  },
+    { "fifo",  SCHED_FIFO  },
+    { "rr",    SCHED_RR    }
+};
+
+/* I/O scheduling classes by name */
+static const struct {
+    const char *name;
+    int io_class;
+} placement_io_classes[] = {
+    { "realtime",    IOPRIO_CLASS_RT   },
+    { "rt",          IOPRIO_CLASS_RT   },
+    { "best-effort", IOPRIO_CLASS_BE   },
+    { "be",          IOPRIO_CLASS_BE   },
+    { "idle",        IOPRIO_CLASS_IDLE }
+};
+
+/* Mount points a cgroup2 hierarchy is found at, unified first */
+static const char *const placement_cgroup_roots[] = {
+    PLACEMENT_CGROUP_ROOT,
+    PLACEMENT_CGROUP_ROOT "/unified"
+};
+
+// Command line values; they take precedence over info.yaml
+static const char *placement_options[PLACEMENT_COUNT];
+
+/**
+ * @brief Reset a placement to inherit everything
+ * @param placement Placement to reset
+ */
+static void placement_init(placement_t *placement) {
+    memset(placement, 0, sizeof(*placement));
+    placement->numa_node = -1;
+    placement->policy = -1;
+    placement->io_priority = -1;
+}
+
+/**
+ * @brief Parse a decimal integer within bounds
+ * @param text Text to parse
+ * @param min Smallest accepted value
+ * @param max Largest accepted value
+ * @param out Receives the value
+ * @return 0 on success, -1 if the text is not a number in range
+ */
+static int parse_integer(const char *text, long min, long max, int *out) {
+    char *end;
+    long value;
+    
+    errno = 0;
+    value = strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || value < min || value > max) {
+        return -1;
+    }
+    *out = (int)value;
+    return 0;
+}
+
+/**
+ * @brief Parse a CPU list such as "0-3,8,10-11"
+ * @param text Text to parse
+ * @param cpus Receives the CPUs
+ * @return 0 on success, -1 if the list is malformed or empty
+ */
+static int parse_cpu_list(const char *text, cpu_set_t *cpus) {
+    const char *cursor = text;
+    
+    CPU_ZERO(cpus);
+    while (*cursor != '\0') {
+        unsigned long first;
+        unsigned long last;
+        char *end;
+        
+        while (*cursor == ' ' || *cursor == '\t') {
+            cursor++;
+        }
+        if (*cursor < '0' || *cursor > '9') {
+            return -1;
+        }
+        first = strtoul(cursor, &end, 10);
+        last = first;
+        if (*end == '-') {
+            cursor = end + 1;
+            if (*cursor < '0' || *cursor > '9') {
+                return -1;
+            }
+            last = strtoul(cursor, &end, 10);
+        }
+        if (first > last || last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (unsigned long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, cpus);
+        }
+        
+        cursor = end;
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == '\n') {
+            cursor++;
+        }
+        if (*cursor == ',') {
+            cursor++;
+        } else if (*cursor != '\0') {
+            return -1;
+        }
+    }
+    
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+/**
+ * @brief Parse a cgroup path, relative to the cgroup of the launcher or absolute
+ * @param text Text to parse
+ * @param out Receives the path
+ * @param size Size of the output buffer
+ * @return 0 on success, -1 if the path is empty or leaves the hierarchy
+ */
+static int parse_cgroup(const char *text, char *out, size_t size) {
+    const char *component = text[0] == '/' ? text + 1 : text;
+    
+    if (*component == '\0' || strlen(text) >= size) {
+        return -1;
+    }
+    
+    // Components are created one at a time, so each must be a plain name
+    while (*component != '\0') {
+        size_t length = strcspn(component, "/");
+        
+        if (length == 0 ||
+            (length == 1 && component[0] == '.') ||
+            (length == 2 && component[0] == '.' && component[1] == '.')) {
+            return -1;
+        }
+        component += length;
+        if (*component == '/') {
+            component++;
+        }
+    }
+    
+    snprintf(out, size, "%s", text);
+    return 0;
+}
+
+/**
+ * @brief Parse a cpu.max value: "max" or a quota, optionally followed by a period
+ * @param text Text to parse
+ * @param out Receives the value as written to cpu.max
+ * @param size Size of the output buffer
+ * @return 0 on success, -1 if the value is malformed
+ */
+static int parse_cpu_max(const char *text, char *out, size_t size) {
+    unsigned long period = 0;
+    const char *cursor = text;
+    char quota[24];
+    char *end;
+    
+    if (strncmp(cursor, "max", 3) == 0) {
+        snprintf(quota, sizeof(quota), "max");
+        cursor += 3;
+    } else {
+        if (*cursor < '0' || *cursor > '9') {
+            return -1;
+        }
+        snprintf(quota, sizeof(quota), "%lu", strtoul(cursor, &end, 10));
+        cursor = end;
+    }
+    
+    if (*cursor == ' ') {
+        cursor++;
+        if (*cursor < '0' || *cursor > '9') {
+            return -1;
+        }
+        period = strtoul(cursor, &end, 10);
+        cursor = end;
+    }
+    if (*cursor != '\0') {
+        return -1;
+    }
+    
+    if (period > 0) {
+        snprintf(out, size, "%s %lu", quota, period);
+    } else {
+        snprintf(out, size, "%s", quota);
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse a memory.high value: "max" or bytes with an optional K, M, G or T suffix
+ * @param text Text to parse
+ * @param out Receives the value in bytes as written to memory.high
+ * @param size Size of the output buffer
+ * @return 0 on success, -1 if the value is malformed
+ */
+static int parse_memory_size(const char *text, char *out, size_t size) {
+    static const char suffixes[] = "KMGT";
+    unsigned long long bytes;
+    const char *unit;
+    char *end;
+    
+    if (strcmp(text, "max") == 0) {
+        snprintf(out, size, "max");
+        return 0;
+    }
+    if (*text < '0' || *text > '9') {
+        return -1;
+    }
+    
+    errno = 0;
+    bytes = strtoull(text, &end, 10);
+    if (errno != 0) {
+        return -1;
+    }
+    if (*end != '\0') {
+        unit = strchr(suffixes, *end & ~0x20);
+        if (unit == NULL || end[1] != '\0') {
+            return -1;
+        }
+        for (const char *scale = suffixes; scale <= unit; scale++) {
+            if (bytes > (~0ULL >> 10)) {
+                return -1;
+            }
+            bytes <<= 10;
+        }
+    }
+    
+    snprintf(out, size, "%llu", bytes);
+    return 0;
+}
+
+/**
+ * @brief Parse an I/O priority: "idle", or "best-effort" or "realtime" with an optional ":level"
+ * @param text Text to parse
+ * @param out Receives the ioprio value
+ * @return 0 on success, -1 if the value is malformed
+ */
+static int parse_io_priority(const char *text, int *out) {
+    size_t name_length = strcspn(text, ":");
+    int level = 4;
+    
+    for (size_t i = 0; i < sizeof(placement_io_classes) / sizeof(placement_io_classes[0]); i++) {
+        int io_class = placement_io_classes[i].io_class;
+        
+        if (strlen(placement_io_classes[i].name) != name_length ||
+            strncasecmp(text, placement_io_classes[i].name, name_length) != 0) {
+            continue;
+        }
+        if (text[name_length] == ':') {
+            if (io_class == IOPRIO_CLASS_IDLE || parse_integer(text + name_length + 1, 0, 7, &level) != 0) {
+                return -1;
+            }
+        }
+        *out = (int)IOPRIO_PRIO_VALUE((unsigned int)io_class, io_class == IOPRIO_CLASS_IDLE ? 0u : (unsigned int)level);
+        return 0;
+    }
+    
+    return -1;
+}
+
+/**
+ * @brief Parse one control into a placement
+ * @param key Control to parse
+ * @param text Value of the control
+ * @param placement Placement to update
+ * @return 0 on success, -1 if the value is invalid
+ */
+static int parse_placement_value(placement_key_t key, const char *text, placement_t *placement) {
+    switch (key) {
+        case PLACEMENT_CPUS:
+            placement->has_cpus = 1;
+            return parse_cpu_list(text, &placement->cpus);
+        case PLACEMENT_NUMA_NODE:
+            return parse_integer(text, 0, 1023, &placement->numa_node);
+        case PLACEMENT_SCHED_POLICY:
+            for (size_t i = 0; i < sizeof(placement_policies) / sizeof(placement_policies[0]); i++) {
+                if (strcasecmp(text, placement_policies[i].name) == 0) {
+                    placement->policy = placement_policies[i].policy;
+                    return 0;
+                }
+            }
+            return -1;
+        case PLACEMENT_SCHED_PRIORITY:
+            placement->has_priority = 1;
+            return parse_integer(text, 1, 99, &placement->priority);
+        case PLACEMENT_NICE:
+            placement->has_nice = 1;
+            return parse_integer(text, -20, 19, &placement->nice);
+        case PLACEMENT_CGROUP:
+            return parse_cgroup(text, placement->cgroup, sizeof(placement->cgroup));
+        case PLACEMENT_CPU_MAX:
+            return parse_cpu_max(text, placement->cpu_max, sizeof(placement->cpu_max));
+        case PLACEMENT_MEMORY_HIGH:
+            return parse_memory_size(text, placement->memory_high, sizeof(placement->memory_high));
+        case PLACEMENT_IO_PRIORITY:
+            return parse_io_priority(text, &placement->io_priority);
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief Set a control from the command line, overriding info.yaml
+ * @param key Control to set
+ * @param value Value of the control; must outlive the launcher
+ * @return EXIT_SUCCESS on success, EXIT_INVALID_ARGS if the value is invalid
+ */
+int placement_set_option(placement_key_t key, const char *value) {
+    placement_t scratch;
+    
+    placement_init(&scratch);
+    if (parse_placement_value(key, value, &scratch) != 0) {
+        log_message(LOG_ERROR, "Invalid --%s value: %s", placement_key_names[key], value);
+        return EXIT_INVALID_ARGS;
+    }
+    placement_options[key] = value;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Resolve every control of a bundle and check they fit together
+ * @param probe Opened bundle probe
+ * @param placement Receives the resolved placement
+ * @return 1 if anything is to be applied, 0 if not, -1 on invalid values
+ */
+static int resolve_placement(const bundle_probe_t *probe, placement_t *placement) {
+    char text[PLACEMENT_VALUE_LENGTH];
+    int active = 0;
+    
+    placement_init(placement);
+    for (int key = 0; key < PLACEMENT_COUNT; key++) {
+        const metadata_value_t *declared = &probe->metadata.placement[key];
+        const char *value = placement_options[key];
+        
+        if (value == NULL) {
+            if (declared->length == 0) {
+                continue;
+            }
+            if (metadata_copy(declared, text, sizeof(text)) != 0) {
+                log_message(LOG_ERROR, "info.yaml %s value too long", placement_key_names[key]);
+                return -1;
+            }
+            value = text;
+        }
+        if (parse_placement_value((placement_key_t)key, value, placement) != 0) {
+            log_message(LOG_ERROR, "Invalid %s value: %s", placement_key_names[key], value);
+            return -1;
+        }
+        active = 1;
+    }
+    
+    if ((placement->cpu_max[0] != '\0' || placement->memory_high[0] != '\0') && placement->cgroup[0] == '\0') {
+        log_message(LOG_ERROR, "cpu-max and memory-high require a cgroup");
+        return -1;
+    }
+    if (placement->has_priority && placement->policy != SCHED_FIFO && placement->policy != SCHED_RR) {
+        log_message(LOG_ERROR, "sched-priority requires sched-policy fifo or rr");
+        return -1;
+    }
+    if (!placement->has_priority && (placement->policy == SCHED_FIFO || placement->policy == SCHED_RR)) {
+        placement->priority = 1;
+    }
+    
+    return active;
+}
+
+/**
+ * @brief Write a value into a cgroup control file
+ * @param dirfd Cgroup directory
+ * @param name Control file name
+ * @param value Value to write
+ * @return 0 on success, -1 on failure with errno set
+ */
+static int write_control(int dirfd, const char *name, const char *value) {
+    size_t length = strlen(value);
+    ssize_t written;
+    int saved_errno;
+    int fd;
+    
+    fd = openat(dirfd, name, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    written = write(fd, value, length);
+    saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return written == (ssize_t)length ? 0 : -1;
+}
+
+/**
+ * @brief Open the cgroup2 directory a cgroup path starts from
+ * @param path Absolute path from the hierarchy root, or relative to the launcher's cgroup
+ * @return Directory descriptor, or -1 if no cgroup2 hierarchy is mounted
+ */
+static int open_cgroup_base(const char *path) {
+    char line[MAX_PATH_LENGTH + 8];
+    const char *own = NULL;
+    struct statfs fs;
+    int rootfd = -1;
+    int basefd;
+    
+    for (size_t i = 0; i < sizeof(placement_cgroup_roots) / sizeof(placement_cgroup_roots[0]); i++) {
+        rootfd = open(placement_cgroup_roots[i], O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (rootfd >= 0 && fstatfs(rootfd, &fs) == 0 && fs.f_type == CGROUP2_SUPER_MAGIC) {
+            break;
+        }
+        if (rootfd >= 0) {
+            close(rootfd);
+            rootfd = -1;
+        }
+    }
+    if (rootfd < 0 || path[0] == '/') {
+        return rootfd;
+    }
+    
+    // The unified hierarchy is the "0::" line
+    FILE *self = fopen("/proc/self/cgroup", "re");
+    if (self != NULL) {
+        while (fgets(line, sizeof(line), self) != NULL) {
+            if (strncmp(line, "0::/", 4) == 0) {
+                line[strcspn(line, "\n")] = '\0';
+                own = line + 4;
+                break;
+            }
+        }
+        fclose(self);
+    }
+    if (own == NULL || own[0] == '\0') {
+        return rootfd;
+    }
+    
+    basefd = openat(rootfd, own, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    close(rootfd);
+    return basefd;
+}
+
+/**
+ * @brief Create the cgroup, set its limits and move the calling process into it
+ * @param placement Resolved placement
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int join_cgroup(const placement_t *placement) {
+    char controllers[32] = "";
+    char component[NAME_MAX + 1];
+    const char *cursor = placement->cgroup;
+    int dirfd;
+    
+    if (placement->cpu_max[0] != '\0') {
+        strcat(controllers, "+cpu ");
+    }
+    if (placement->memory_high[0] != '\0') {
+        strcat(controllers, "+memory");
+    }
+    
+    dirfd = open_cgroup_base(placement->cgroup);
+    if (dirfd < 0) {
+        log_message(LOG_ERROR, "No cgroup v2 hierarchy is mounted");
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    while (*cursor == '/') {
+        cursor++;
+    }
+    while (*cursor != '\0') {
+        size_t length = strcspn(cursor, "/");
+        int childfd;
+        
+        if (length >= sizeof(component)) {
+            log_message(LOG_ERROR, "Cgroup name too long: %s", placement->cgroup);
+            close(dirfd);
+            return EXIT_SYSTEM_ERROR;
+        }
+        memcpy(component, cursor, length);
+        component[length] = '\0';
+        cursor += length;
+        while (*cursor == '/') {
+            cursor++;
+        }
+        
+        // Limits are only writable if every ancestor delegates the controller
+        if (controllers[0] != '\0' && write_control(dirfd, "cgroup.subtree_control", controllers) != 0) {
+            log_message(LOG_DEBUG, "Cannot delegate %s to %s: %s", controllers, component, strerror(errno));
+        }
+        if (mkdirat(dirfd, component, 0755) != 0 && errno != EEXIST) {
+            log_message(LOG_ERROR, "Cannot create cgroup %s: %s", placement->cgroup, strerror(errno));
+            close(dirfd);
+            return EXIT_SYSTEM_ERROR;
+        }
+        childfd = openat(dirfd, component, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        close(dirfd);
+        if (childfd < 0) {
+            log_message(LOG_ERROR, "Cannot open cgroup %s: %s", placement->cgroup, strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        dirfd = childfd;
+    }
+    
+    if ((placement->cpu_max[0] != '\0' && write_control(dirfd, "cpu.max", placement->cpu_max) != 0) ||
+        (placement->memory_high[0] != '\0' && write_control(dirfd, "memory.high", placement->memory_high) != 0)) {
+        log_message(LOG_ERROR, "Cannot set limits of cgroup %s: %s", placement->cgroup, strerror(errno));
+        close(dirfd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (write_control(dirfd, "cgroup.procs", "0") != 0) {
+        log_message(LOG_ERROR, "Cannot join cgroup %s: %s", placement->cgroup, strerror(errno));
+        close(dirfd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    close(dirfd);
+    log_message(LOG_DEBUG, "Joined cgroup %s (cpu.max %s, memory.high %s)", placement->cgroup,
+                placement->cpu_max[0] ? placement->cpu_max : "inherited",
+                placement->memory_high[0] ? placement->memory_high : "inherited");
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Restrict CPUs to a NUMA node and prefer its memory
+ * @param placement Resolved placement; its CPU set is narrowed to the node
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int bind_numa_node(placement_t *placement) {
+    unsigned long nodes[1024 / (8 * sizeof(unsigned long))] = { 0 };
+    size_t node = (size_t)placement->numa_node;
+    char path[64];
+    char list[1024];
+    cpu_set_t node_cpus;
+    ssize_t n;
+    int fd;
+    
+    snprintf(path, sizeof(path), PLACEMENT_NODE_CPULIST, placement->numa_node);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "NUMA node %d not found", placement->numa_node);
+        return EXIT_SYSTEM_ERROR;
+    }
+    n = read(fd, list, sizeof(list) - 1);
+    close(fd);
+    list[n > 0 ? n : 0] = '\0';
+    if (parse_cpu_list(list, &node_cpus) != 0) {
+        log_message(LOG_ERROR, "NUMA node %d has no CPUs", placement->numa_node);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (placement->has_cpus) {
+        CPU_AND(&placement->cpus, &placement->cpus, &node_cpus);
+        if (CPU_COUNT(&placement->cpus) == 0) {
+            log_message(LOG_ERROR, "cpus and numa-node %d do not overlap", placement->numa_node);
+            return EXIT_SYSTEM_ERROR;
+        }
+    } else {
+        placement->cpus = node_cpus;
+        placement->has_cpus = 1;
+    }
+    
+    // Preferred rather than bound, so an exhausted node does not OOM the app
+    nodes[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodes, sizeof(nodes) * 8) != 0) {
+        log_message(LOG_ERROR, "Cannot prefer memory of NUMA node %d: %s", placement->numa_node, strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_message(LOG_DEBUG, "Memory policy: prefer NUMA node %d", placement->numa_node);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Apply the bundle's placement to the calling process before exec
+ * @param probe Opened bundle probe
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int configure_placement(const bundle_probe_t *probe) {
+    placement_t placement;
+    int active;
+    
+    active = resolve_placement(probe, &placement);
+    if (active <= 0) {
+        return active < 0 ? EXIT_BUNDLE_ERROR : EXIT_SUCCESS;
+    }
+    
+    if (placement.cgroup[0] != '\0' && join_cgroup(&placement) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (placement.numa_node >= 0 && bind_numa_node(&placement) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (placement.has_cpus) {
+        if (sched_setaffinity(0, sizeof(placement.cpus), &placement.cpus) != 0) {
+            log_message(LOG_ERROR, "Cannot set CPU affinity: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        log_message(LOG_DEBUG, "CPU affinity: %d CPUs", CPU_COUNT(&placement.cpus));
+    }
+    
+    if (placement.policy >= 0) {
+        struct sched_param param = { .sched_priority = placement.priority };
+        
+        if (sched_setscheduler(0, placement.policy, &param) != 0) {
+            log_message(LOG_ERROR, "Cannot set scheduling policy: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        log_message(LOG_DEBUG, "Scheduling policy %d, priority %d", placement.policy, placement.priority);
+    }
+    
+    if (placement.has_nice) {
+        if (setpriority(PRIO_PROCESS, 0, placement.nice) != 0) {
+            log_message(LOG_ERROR, "Cannot set nice value %d: %s", placement.nice, strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        log_message(LOG_DEBUG, "Nice value: %d", placement.nice);
+    }
+    
+    if (placement.io_priority >= 0) {
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, placement.io_priority) != 0) {
+            log_message(LOG_ERROR, "Cannot set I/O priority: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        log_message(LOG_DEBUG, "I/O priority: class %d, level %d",
+                    (int)IOPRIO_PRIO_CLASS(placement.io_priority), (int)IOPRIO_PRIO_DATA(placement.io_priority));
+    }
+    
+    log_message(LOG_INFO, "Placement applied: %s", probe->path);
+    return EXIT_SUCCESS;
+}
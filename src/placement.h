@@ -0,0 +1,61 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file placement.h
+ * @brief Per-bundle CPU, memory and I/O placement
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Applies the scheduling controls a bundle declares in info.yaml, or the
+ * launcher was given on the command line, to the process that is about
+ * to exec the bundle: cgroup v2 placement with cpu.max and memory.high,
+ * NUMA node, CPU affinity, scheduling policy, nice value and I/O
+ * priority. Everything is inherited across exec.
+ */
+
+#ifndef VLAUNCH_PLACEMENT_H
+#define VLAUNCH_PLACEMENT_H
+
+#include "launcher.h"
+#include "metadata.h"
+
+/* Placement Configuration */
+#define PLACEMENT_CGROUP_ROOT   "/sys/fs/cgroup"
+#define PLACEMENT_NODE_CPULIST  "/sys/devices/system/node/node%d/cpulist"
+#define PLACEMENT_VALUE_LENGTH  256
+
+int placement_set_option(placement_key_t key, const char *value);
+int configure_placement(const bundle_probe_t *probe);
+
+#endif /* VLAUNCH_PLACEMENT_H */
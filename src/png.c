@@ -0,0 +1,793 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file png.c
+ * @brief Minimal PNG decoder
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The inflate follows RFC 1951 with canonical Huffman tables decoded a
+ * bit at a time; icons are small enough that table-driven decoding would
+ * not be measurable. Chunk CRCs and the Adler-32 trailer are not checked:
+ * the input comes from an installed bundle and every length and offset is
+ * bounds-checked regardless.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "png.h"
+
+/* Huffman code limits from RFC 1951 */
+#define INFLATE_MAX_BITS    15
+#define INFLATE_MAX_LENGTHS 288
+#define INFLATE_MAX_DISTS   30
+
+/* Reader and writer state of one inflate */
+typedef struct {
+    const uint8_t *in;
+    size_t in_size;
+    size_t in_pos;
+    uint32_t bit_buffer;
+    int bit_count;
+    uint8_t *out;
+    size_t out_size;
+    size_t out_pos;
+} inflate_t;
+
+/* Canonical Huffman code: number of codes per length and symbols in code order */
+typedef struct {
+    uint16_t count[INFLATE_MAX_BITS + 1];
+    uint16_t symbol[INFLATE_MAX_LENGTHS];
+} huffman_t;
+
+/* Length and distance bases and extra bits, RFC 1951 section 3.2.5 */
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[INFLATE_MAX_DISTS] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[INFLATE_MAX_DISTS] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* Order of code length code lengths in a dynamic block header */
+static const uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* Adam7 pass origins and steps; a plain image is one pass with step 1 */
+static const uint8_t adam7[7][4] = {
+    { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 },
+    { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+static const uint8_t single_pass[1][4] = {
+    { 0, 0, 1, 1 }
+};
+
+/**
+ * @brief Take bits from the input, least significant first
+ * @param state Inflate state
+ * @param count Number of bits, at most 16
+ * @param value Receives the bits
+ * @return 0 on success, -1 if the input ran out
+ */
+static int take_bits(inflate_t *state, int count, uint32_t *value) {
+    uint32_t bits = state->bit_buffer;
+    
+    while (state->bit_count < count) {
+        if (state->in_pos >= state->in_size) {
+            return -1;
+        }
+        bits |= (uint32_t)state->in[state->in_pos++] << state->bit_count;
+        state->bit_count += 8;
+    }
+    
+    *value = bits & ((1u << count) - 1);
+    state->bit_buffer = bits >> count;
+    state->bit_count -= count;
+    return 0;
+}
+
+/**
+ * @brief Build a canonical Huffman code from code lengths
+ * @param code Code to fill in
+ * @param lengths Code length of each symbol, 0 if unused
+ * @param count Number of symbols
+ * @return 0 on success, -1 if the lengths are over-subscribed
+ */
+static int huffman_build(huffman_t *code, const uint8_t *lengths, int count) {
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+    int left = 1;
+    
+    memset(code->count, 0, sizeof(code->count));
+    for (int i = 0; i < count; i++) {
+        code->count[lengths[i]]++;
+    }
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        left = (left << 1) - code->count[length];
+        if (left < 0) {
+            return -1;
+        }
+    }
+    
+    offsets[1] = 0;
+    for (int length = 1; length < INFLATE_MAX_BITS; length++) {
+        offsets[length + 1] = (uint16_t)(offsets[length] + code->count[length]);
+    }
+    for (int i = 0; i < count; i++) {
+        if (lengths[i] != 0) {
+            code->symbol[offsets[lengths[i]]++] = (uint16_t)i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decode one symbol
+ * @param state Inflate state
+ * @param code Huffman code
+ * @return Symbol, or -1 on invalid or truncated input
+ */
+static int huffman_decode(inflate_t *state, const huffman_t *code) {
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        uint32_t bit;
+        int count = code->count[length];
+        
+        if (take_bits(state, 1, &bit) != 0) {
+            return -1;
+        }
+        value |= (int)bit;
+        if (value - count < first) {
+            return code->symbol[index + (value - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief Copy a stored block
+ * @param state Inflate state
+ * @return 0 on success, -1 on invalid input
+ */
+static int inflate_stored(inflate_t *state) {
+    size_t length;
+    
+    // Stored blocks start on a byte boundary
+    state->bit_buffer = 0;
+    state->bit_count = 0;
+    if (state->in_size - state->in_pos < 4) {
+        return -1;
+    }
+    length = state->in[state->in_pos] | (size_t)state->in[state->in_pos + 1] << 8;
+    if ((length ^ 0xffff) != (state->in[state->in_pos + 2] | (size_t)state->in[state->in_pos + 3] << 8)) {
+        return -1;
+    }
+    state->in_pos += 4;
+    if (length > state->in_size - state->in_pos || length > state->out_size - state->out_pos) {
+        return -1;
+    }
+    
+    memcpy(state->out + state->out_pos, state->in + state->in_pos, length);
+    state->in_pos += length;
+    state->out_pos += length;
+    return 0;
+}
+
+/**
+ * @brief Decode the symbols of a compressed block
+ * @param state Inflate state
+ * @param lengths Literal/length code
+ * @param dists Distance code
+ * @return 0 on success, -1 on invalid input
+ */
+static int inflate_codes(inflate_t *state, const huffman_t *lengths, const huffman_t *dists) {
+    for (;;) {
+        uint32_t extra;
+        size_t length;
+        size_t dist;
+        int symbol = huffman_decode(state, lengths);
+        
+        if (symbol < 0) {
+            return -1;
+        }
+        if (symbol < 256) {
+            if (state->out_pos >= state->out_size) {
+                return -1;
+            }
+            state->out[state->out_pos++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 256) {
+            return 0;
+        }
+        
+        symbol -= 257;
+        if (symbol >= 29 || take_bits(state, length_extra[symbol], &extra) != 0) {
+            return -1;
+        }
+        length = length_base[symbol] + extra;
+        
+        symbol = huffman_decode(state, dists);
+        if (symbol < 0 || symbol >= INFLATE_MAX_DISTS || take_bits(state, dist_extra[symbol], &extra) != 0) {
+            return -1;
+        }
+        dist = dist_base[symbol] + extra;
+        if (dist > state->out_pos || length > state->out_size - state->out_pos) {
+            return -1;
+        }
+        
+        // Matches may overlap their own output
+        for (size_t i = 0; i < length; i++) {
+            state->out[state->out_pos] = state->out[state->out_pos - dist];
+            state->out_pos++;
+        }
+    }
+}
+
+/**
+ * @brief Decode a block with the fixed codes
+ * @param state Inflate state
+ * @return 0 on success, -1 on invalid input
+ */
+static int inflate_fixed(inflate_t *state) {
+    static huffman_t lengths;
+    static huffman_t dists;
+    static int built;
+    
+    if (!built) {
+        uint8_t code_lengths[INFLATE_MAX_LENGTHS];
+        int i;
+        
+        for (i = 0; i < 144; i++) {
+            code_lengths[i] = 8;
+        }
+        for (; i < 256; i++) {
+            code_lengths[i] = 9;
+        }
+        for (; i < 280; i++) {
+            code_lengths[i] = 7;
+        }
+        for (; i < INFLATE_MAX_LENGTHS; i++) {
+            code_lengths[i] = 8;
+        }
+        huffman_build(&lengths, code_lengths, INFLATE_MAX_LENGTHS);
+        memset(code_lengths, 5, INFLATE_MAX_DISTS);
+        huffman_build(&dists, code_lengths, INFLATE_MAX_DISTS);
+        built = 1;
+    }
+    
+    return inflate_codes(state, &lengths, &dists);
+}
+
+/**
+ * @brief Decode a block with codes described in its header
+ * @param state Inflate state
+ * @return 0 on success, -1 on invalid input
+ */
+static int inflate_dynamic(inflate_t *state) {
+    uint8_t code_lengths[INFLATE_MAX_LENGTHS + INFLATE_MAX_DISTS];
+    huffman_t lengths;
+    huffman_t dists;
+    uint32_t literal_count;
+    uint32_t dist_count;
+    uint32_t header_count;
+    uint32_t value;
+    uint32_t index = 0;
+    
+    if (take_bits(state, 5, &literal_count) != 0 || take_bits(state, 5, &dist_count) != 0 ||
+        take_bits(state, 4, &header_count) != 0) {
+        return -1;
+    }
+    literal_count += 257;
+    dist_count += 1;
+    header_count += 4;
+    if (literal_count > 286 || dist_count > INFLATE_MAX_DISTS) {
+        return -1;
+    }
+    
+    memset(code_lengths, 0, 19);
+    for (uint32_t i = 0; i < header_count; i++) {
+        if (take_bits(state, 3, &value) != 0) {
+            return -1;
+        }
+        code_lengths[code_length_order[i]] = (uint8_t)value;
+    }
+    if (huffman_build(&lengths, code_lengths, 19) != 0) {
+        return -1;
+    }
+    
+    while (index < literal_count + dist_count) {
+        int symbol = huffman_decode(state, &lengths);
+        uint8_t repeat_value = 0;
+        uint32_t repeat;
+        
+        if (symbol < 0) {
+            return -1;
+        }
+        if (symbol < 16) {
+            code_lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 16) {
+            if (index == 0 || take_bits(state, 2, &repeat) != 0) {
+                return -1;
+            }
+            repeat_value = code_lengths[index - 1];
+            repeat += 3;
+        } else if (symbol == 17) {
+            if (take_bits(state, 3, &repeat) != 0) {
+                return -1;
+            }
+            repeat += 3;
+        } else {
+            if (take_bits(state, 7, &repeat) != 0) {
+                return -1;
+            }
+            repeat += 11;
+        }
+        if (repeat > literal_count + dist_count - index) {
+            return -1;
+        }
+        memset(code_lengths + index, repeat_value, repeat);
+        index += repeat;
+    }
+    
+    // A block without an end-of-block code could never finish
+    if (code_lengths[256] == 0 ||
+        huffman_build(&lengths, code_lengths, (int)literal_count) != 0 ||
+        huffman_build(&dists, code_lengths + literal_count, (int)dist_count) != 0) {
+        return -1;
+    }
+    return inflate_codes(state, &lengths, &dists);
+}
+
+/**
+ * @brief Inflate a zlib stream into a buffer of known size
+ * @param in zlib stream
+ * @param in_size Size of the stream
+ * @param out Destination buffer
+ * @param out_size Exact size of the decompressed data
+ * @return 0 on success, -1 on invalid input or size mismatch
+ */
+static int zlib_inflate(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size) {
+    inflate_t state = { in, in_size, 2, 0, 0, out, out_size, 0 };
+    uint32_t last;
+    uint32_t type;
+    
+    // Deflate, no preset dictionary
+    if (in_size < 2 || (in[0] & 0x0f) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20)) {
+        return -1;
+    }
+    
+    do {
+        int result;
+        
+        if (take_bits(&state, 1, &last) != 0 || take_bits(&state, 2, &type) != 0) {
+            return -1;
+        }
+        if (type == 0) {
+            result = inflate_stored(&state);
+        } else if (type == 1) {
+            result = inflate_fixed(&state);
+        } else if (type == 2) {
+            result = inflate_dynamic(&state);
+        } else {
+            result = -1;
+        }
+        if (result != 0) {
+            return -1;
+        }
+    } while (!last);
+    
+    return state.out_pos == out_size ? 0 : -1;
+}
+
+/**
+ * @brief Read a big-endian 32-bit value
+ * @param data Four bytes
+ * @return Decoded value
+ */
+static uint32_t read_be32(const uint8_t *data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+/**
+ * @brief Undo the per-row filters of one pass in place
+ * @param data Filtered rows, each led by its filter type byte
+ * @param rows Number of rows
+ * @param row_bytes Bytes per row, excluding the filter byte
+ * @param bpp Bytes per complete pixel, at least 1
+ * @return 0 on success, -1 on an unknown filter type
+ */
+static int unfilter(uint8_t *data, uint32_t rows, size_t row_bytes, size_t bpp) {
+    const uint8_t *previous = NULL;
+    
+    for (uint32_t y = 0; y < rows; y++) {
+        uint8_t filter = data[0];
+        uint8_t *row = data + 1;
+        
+        for (size_t x = 0; x < row_bytes; x++) {
+            int left = x >= bpp ? row[x - bpp] : 0;
+            int up = previous ? previous[x] : 0;
+            int corner = previous && x >= bpp ? previous[x - bpp] : 0;
+            
+            switch (filter) {
+                case 0:
+                    break;
+                case 1:
+                    row[x] = (uint8_t)(row[x] + left);
+                    break;
+                case 2:
+                    row[x] = (uint8_t)(row[x] + up);
+                    break;
+                case 3:
+                    row[x] = (uint8_t)(row[x] + ((left + up) >> 1));
+                    break;
+                case 4: {
+                    int estimate = left + up - corner;
+                    int to_left = abs(estimate - left);
+                    int to_up = abs(estimate - up);
+                    int to_corner = abs(estimate - corner);
+                    int predictor = to_left <= to_up && to_left <= to_corner ? left :
+                                    to_up <= to_corner ? up : corner;
+                    row[x] = (uint8_t)(row[x] + predictor);
+                    break;
+                }
+                default:
+                    return -1;
+            }
+        }
+        
+        previous = row;
+        data += row_bytes + 1;
+    }
+    return 0;
+}
+
+/* Header fields and palette needed for pixel conversion */
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint8_t depth;
+    uint8_t color;
+    uint8_t channels;
+    uint8_t interlace;
+    uint8_t palette[256][4];
+    uint32_t palette_count;
+    uint16_t key[3];
+    int has_key;
+} png_info_t;
+
+/**
+ * @brief Read one sample of a row at the image's native depth
+ * @param info Image header
+ * @param row Unfiltered row
+ * @param index Sample index within the row
+ * @return Sample value
+ */
+static uint32_t read_sample(const png_info_t *info, const uint8_t *row, size_t index) {
+    if (info->depth == 8) {
+        return row[index];
+    }
+    if (info->depth == 16) {
+        return (uint32_t)row[index * 2] << 8 | row[index * 2 + 1];
+    }
+    size_t bit = index * info->depth;
+    return ((uint32_t)row[bit / 8] >> (8 - info->depth - bit % 8)) & ((1u << info->depth) - 1);
+}
+
+/**
+ * @brief Convert one pixel to 8-bit RGBA
+ * @param info Image header
+ * @param row Unfiltered row
+ * @param x Pixel index within the row
+ * @param out Receives four bytes
+ * @return 0 on success, -1 on an out-of-range palette index
+ */
+static int convert_pixel(const png_info_t *info, const uint8_t *row, uint32_t x, uint8_t *out) {
+    uint32_t samples[4];
+    uint32_t max = (1u << info->depth) - 1;
+    
+    for (int c = 0; c < info->channels; c++) {
+        samples[c] = read_sample(info, row, (size_t)x * info->channels + (size_t)c);
+    }
+    
+    // Scale a native sample to 8 bits
+#define SCALE(v) ((uint8_t)(info->depth == 16 ? (v) >> 8 : (v) * 255 / max))
+    switch (info->color) {
+        case 0:
+            out[0] = out[1] = out[2] = SCALE(samples[0]);
+            out[3] = info->has_key && samples[0] == info->key[0] ? 0 : 255;
+            break;
+        case 2:
+            out[0] = SCALE(samples[0]);
+            out[1] = SCALE(samples[1]);
+            out[2] = SCALE(samples[2]);
+            out[3] = info->has_key && samples[0] == info->key[0] && samples[1] == info->key[1] &&
+                     samples[2] == info->key[2] ? 0 : 255;
+            break;
+        case 3:
+            if (samples[0] >= info->palette_count) {
+                return -1;
+            }
+            memcpy(out, info->palette[samples[0]], 4);
+            break;
+        case 4:
+            out[0] = out[1] = out[2] = SCALE(samples[0]);
+            out[3] = SCALE(samples[1]);
+            break;
+        default:
+            out[0] = SCALE(samples[0]);
+            out[1] = SCALE(samples[1]);
+            out[2] = SCALE(samples[2]);
+            out[3] = SCALE(samples[3]);
+            break;
+    }
+#undef SCALE
+    return 0;
+}
+
+/**
+ * @brief Check that a colour type and bit depth combination is allowed
+ * @param color Colour type
+ * @param depth Bit depth
+ * @return Number of channels, or 0 if the combination is invalid
+ */
+static uint8_t color_channels(uint8_t color, uint8_t depth) {
+    int low_depth = depth == 1 || depth == 2 || depth == 4;
+    
+    switch (color) {
+        case 0:
+            return low_depth || depth == 8 || depth == 16 ? 1 : 0;
+        case 3:
+            return low_depth || depth == 8 ? 1 : 0;
+        case 2:
+            return depth == 8 || depth == 16 ? 3 : 0;
+        case 4:
+            return depth == 8 || depth == 16 ? 2 : 0;
+        case 6:
+            return depth == 8 || depth == 16 ? 4 : 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Parse the chunks of a PNG file
+ * @param data File contents
+ * @param size File size
+ * @param info Receives the header fields and palette
+ * @param idat Receives the concatenated image data, to be freed by the caller
+ * @param idat_size Receives the size of the image data
+ * @return 0 on success, -1 on invalid input
+ */
+static int parse_chunks(const uint8_t *data, size_t size, png_info_t *info, uint8_t **idat, size_t *idat_size) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    size_t pos = sizeof(signature);
+    int have_header = 0;
+    
+    *idat = NULL;
+    *idat_size = 0;
+    if (size < sizeof(signature) || memcmp(data, signature, sizeof(signature)) != 0) {
+        return -1;
+    }
+    
+    while (pos <= size && size - pos >= 12) {
+        uint32_t length = read_be32(data + pos);
+        const uint8_t *type = data + pos + 4;
+        const uint8_t *body = data + pos + 8;
+        
+        if (length > size - pos - 12) {
+            break;
+        }
+        pos += (size_t)length + 12;
+        
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) {
+                break;
+            }
+            info->width = read_be32(body);
+            info->height = read_be32(body + 4);
+            info->depth = body[8];
+            info->color = body[9];
+            info->interlace = body[12];
+            info->channels = color_channels(info->color, info->depth);
+            if (info->width == 0 || info->height == 0 || info->width > PNG_MAX_DIMENSION ||
+                info->height > PNG_MAX_DIMENSION || info->channels == 0 || body[10] != 0 || body[11] != 0 ||
+                info->interlace > 1) {
+                break;
+            }
+            have_header = 1;
+        } else if (!have_header) {
+            break;
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length / 3 > 256) {
+                break;
+            }
+            info->palette_count = length / 3;
+            for (uint32_t i = 0; i < info->palette_count; i++) {
+                memcpy(info->palette[i], body + i * 3, 3);
+                info->palette[i][3] = 255;
+            }
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            if (info->color == 3) {
+                for (uint32_t i = 0; i < length && i < info->palette_count; i++) {
+                    info->palette[i][3] = body[i];
+                }
+            } else if ((info->color == 0 && length == 2) || (info->color == 2 && length == 6)) {
+                for (uint32_t i = 0; i < length / 2; i++) {
+                    info->key[i] = (uint16_t)(body[i * 2] << 8 | body[i * 2 + 1]);
+                }
+                info->has_key = 1;
+            }
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            uint8_t *grown = realloc(*idat, *idat_size + length + 1);
+            if (grown == NULL) {
+                break;
+            }
+            *idat = grown;
+            memcpy(*idat + *idat_size, body, length);
+            *idat_size += length;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            return *idat_size > 0 && (info->color != 3 || info->palette_count > 0) ? 0 : -1;
+        }
+    }
+    
+    free(*idat);
+    *idat = NULL;
+    return -1;
+}
+
+/**
+ * @brief Decode a PNG file into 8-bit RGBA
+ * @param data File contents
+ * @param size File size
+ * @param image Receives the decoded image; release with png_image_free()
+ * @return 0 on success, -1 on invalid or unsupported input
+ */
+int png_decode(const uint8_t *data, size_t size, png_image_t *image) {
+    png_info_t info;
+    const uint8_t (*passes)[4];
+    int pass_count;
+    size_t bits_per_pixel;
+    size_t bpp;
+    size_t raw_size = 0;
+    uint8_t *idat;
+    size_t idat_size;
+    uint8_t *raw;
+    uint8_t *cursor;
+    int failed = 0;
+    
+    memset(image, 0, sizeof(*image));
+    memset(&info, 0, sizeof(info));
+    if (parse_chunks(data, size, &info, &idat, &idat_size) != 0) {
+        return -1;
+    }
+    
+    passes = info.interlace ? adam7 : single_pass;
+    pass_count = info.interlace ? 7 : 1;
+    bits_per_pixel = (size_t)info.channels * info.depth;
+    bpp = bits_per_pixel >= 8 ? bits_per_pixel / 8 : 1;
+    
+    // Every dimension is capped, so these sizes cannot overflow
+    for (int p = 0; p < pass_count; p++) {
+        uint32_t pass_width = (info.width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+        uint32_t pass_height = (info.height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+        
+        if (info.width > passes[p][0] && info.height > passes[p][1] && pass_width && pass_height) {
+            raw_size += (size_t)pass_height * ((pass_width * bits_per_pixel + 7) / 8 + 1);
+        }
+    }
+    
+    raw = malloc(raw_size);
+    image->pixels = malloc((size_t)info.width * info.height * 4);
+    if (!raw || !image->pixels || zlib_inflate(idat, idat_size, raw, raw_size) != 0) {
+        free(raw);
+        free(idat);
+        png_image_free(image);
+        return -1;
+    }
+    free(idat);
+    
+    cursor = raw;
+    for (int p = 0; p < pass_count && !failed; p++) {
+        uint32_t pass_width;
+        uint32_t pass_height;
+        size_t row_bytes;
+        
+        if (info.width <= passes[p][0] || info.height <= passes[p][1]) {
+            continue;
+        }
+        pass_width = (info.width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+        pass_height = (info.height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+        row_bytes = (pass_width * bits_per_pixel + 7) / 8;
+        
+        if (unfilter(cursor, pass_height, row_bytes, bpp) != 0) {
+            failed = 1;
+            break;
+        }
+        for (uint32_t y = 0; y < pass_height && !failed; y++) {
+            const uint8_t *row = cursor + (size_t)y * (row_bytes + 1) + 1;
+            uint32_t out_y = passes[p][1] + y * passes[p][3];
+            
+            for (uint32_t x = 0; x < pass_width; x++) {
+                uint32_t out_x = passes[p][0] + x * passes[p][2];
+                
+                if (convert_pixel(&info, row, x, image->pixels + ((size_t)out_y * info.width + out_x) * 4) != 0) {
+                    failed = 1;
+                    break;
+                }
+            }
+        }
+        cursor += (size_t)pass_height * (row_bytes + 1);
+    }
+    
+    free(raw);
+    if (failed) {
+        png_image_free(image);
+        return -1;
+    }
+    image->width = info.width;
+    image->height = info.height;
+    return 0;
+}
+
+/**
+ * @brief Release a decoded image
+ * @param image Image to release
+ */
+void png_image_free(png_image_t *image) {
+    free(image->pixels);
+    image->pixels = NULL;
+    image->width = 0;
+    image->height = 0;
+}
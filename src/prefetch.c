@@ -0,0 +1,636 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file prefetch.c
+ * @brief Page cache prefetching of bundle objects
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The prefetch set is exec/base plus every DT_NEEDED object that
+ * resolves inside the bundle's library layers (library/<arch>, then
+ * library/), walked breadth first. Reads are queued with
+ * readahead() from a small thread pool, which is joined before exec so
+ * no request is lost when the process image is replaced.
+ *
+ * The first launch warms whole files and leaves a detached recorder
+ * behind. After PREFETCH_RECORD_DELAY seconds it reads the page tables
+ * of the application through /proc/<pid>/pagemap and stores the file
+ * ranges that were actually faulted in under
+ * $XDG_CACHE_HOME/vlaunch/prefetch. Later launches only warm those
+ * ranges until one of the objects changes.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "elfinfo.h"
+#include "libpath.h"
+#include "prefetch.h"
+
+/* One object of the prefetch set, also stored as is in the hot list */
+typedef struct {
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t range_first;
+    uint32_t range_count;
+    char path[PREFETCH_NAME_LENGTH];
+} prefetch_file_t;
+
+/* File range touched by a previous launch; a file without ranges is read whole */
+typedef struct {
+    uint32_t file;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t length;
+} prefetch_range_t;
+
+/* Hot list header, followed by the bundle path, file records and ranges */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t file_count;
+    uint32_t range_count;
+    uint32_t path_length;
+    uint32_t reserved;
+} prefetch_header_t;
+
+/* Work queue shared by the prefetch threads */
+typedef struct {
+    int dirfd;
+    unsigned int count;
+    unsigned int next;
+} prefetch_job_t;
+
+static int prefetch_active = 0;
+static prefetch_file_t prefetch_files[PREFETCH_MAX_FILES];
+static unsigned int prefetch_file_count;
+static prefetch_range_t prefetch_ranges[PREFETCH_MAX_RANGES];
+static unsigned int prefetch_range_count;
+
+/**
+ * @brief Enable or disable prefetching before exec
+ * @param enabled Non-zero to warm bundle objects into the page cache
+ */
+void prefetch_set_enabled(int enabled) {
+    prefetch_active = enabled;
+}
+
+/**
+ * @brief Check whether prefetching was requested
+ * @return Non-zero if bundle objects are warmed before exec
+ */
+int prefetch_enabled(void) {
+    return prefetch_active;
+}
+
+/**
+ * @brief Add a regular file to the prefetch set unless already present
+ * @param dirfd Bundle root directory descriptor
+ * @param path Path relative to the bundle root
+ * @return 0 if there is no regular file at path, 1 otherwise
+ */
+static int prefetch_add(int dirfd, const char *path) {
+    prefetch_file_t *file;
+    struct stat st;
+    
+    for (unsigned int i = 0; i < prefetch_file_count; i++) {
+        if (strcmp(prefetch_files[i].path, path) == 0) {
+            return 1;
+        }
+    }
+    if (fstatat(dirfd, path, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (prefetch_file_count >= PREFETCH_MAX_FILES || strlen(path) >= PREFETCH_NAME_LENGTH) {
+        return 1;
+    }
+    
+    file = &prefetch_files[prefetch_file_count++];
+    memset(file, 0, sizeof(*file));
+    strcpy(file->path, path);
+    file->ino = st.st_ino;
+    file->size = (uint64_t)st.st_size;
+    file->mtime_sec = st.st_mtim.tv_sec;
+    file->mtime_nsec = st.st_mtim.tv_nsec;
+    return 1;
+}
+
+/**
+ * @brief Collect exec/base and its DT_NEEDED closure inside the bundle
+ * @param probe Probed bundle
+ * @return 1 if exec/base is an ELF object, 0 otherwise
+ */
+static int collect_prefetch_set(const bundle_probe_t *probe) {
+    libpath_layer_t layers[LIBPATH_LAYER_COUNT];
+    int layer_count = libpath_bundle_layers(probe, layers);
+    int exec_is_elf = 0;
+    
+    prefetch_file_count = 0;
+    prefetch_add(probe->dirfd, probe->exec_path);
+    
+    // The set doubles as the queue of the breadth-first walk
+    for (unsigned int i = 0; i < prefetch_file_count; i++) {
+        elf_info_t info;
+        
+        if (elf_open(probe->dirfd, prefetch_files[i].path, &info) != 0) {
+            continue;
+        }
+        exec_is_elf |= (i == 0);
+        
+        for (int n = 0; n < info.needed_count; n++) {
+            // Objects outside the bundle are shared with the system and usually warm
+            if (strchr(info.needed[n], '/') != NULL) {
+                continue;
+            }
+            
+            // The first layer with the object is the one the loader maps
+            for (int l = 0; l < layer_count; l++) {
+                char path[PREFETCH_NAME_LENGTH];
+                int written = snprintf(path, sizeof(path), "%s/%s", layers[l].path, info.needed[n]);
+                
+                if (written > 0 && (size_t)written < sizeof(path) && prefetch_add(probe->dirfd, path)) {
+                    break;
+                }
+            }
+        }
+        elf_close(&info);
+    }
+    
+    return exec_is_elf;
+}
+
+/**
+ * @brief Attach hot ranges recorded by a previous launch to the prefetch set
+ * @param bundle_path Bundle path the hot list is keyed on
+ * @return 1 if every object has a current hot list entry, 0 otherwise
+ */
+static int load_hot_list(const char *bundle_path) {
+    static prefetch_file_t stored_files[PREFETCH_MAX_FILES];
+    char entry_path[MAX_PATH_LENGTH];
+    char stored_path[MAX_PATH_LENGTH];
+    prefetch_header_t header;
+    size_t path_length = strlen(bundle_path);
+    size_t files_size;
+    size_t ranges_size;
+    unsigned int matched = 0;
+    int fd;
+    
+    prefetch_range_count = 0;
+    if (cache_entry_path(PREFETCH_CACHE_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return 0;
+    }
+    fd = open(entry_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    
+    int valid = read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+                header.magic == PREFETCH_MAGIC &&
+                header.version == PREFETCH_VERSION &&
+                header.path_length == path_length &&
+                header.file_count <= PREFETCH_MAX_FILES &&
+                header.range_count <= PREFETCH_MAX_RANGES;
+    if (valid) {
+        files_size = header.file_count * sizeof(prefetch_file_t);
+        ranges_size = header.range_count * sizeof(prefetch_range_t);
+        valid = read(fd, stored_path, path_length) == (ssize_t)path_length &&
+                memcmp(stored_path, bundle_path, path_length) == 0 &&
+                read(fd, stored_files, files_size) == (ssize_t)files_size &&
+                read(fd, prefetch_ranges, ranges_size) == (ssize_t)ranges_size;
+    }
+    close(fd);
+    if (!valid) {
+        return 0;
+    }
+    prefetch_range_count = header.range_count;
+    
+    // Objects that changed since the recording are read whole
+    for (unsigned int i = 0; i < prefetch_file_count; i++) {
+        prefetch_file_t *file = &prefetch_files[i];
+        
+        for (unsigned int j = 0; j < header.file_count; j++) {
+            const prefetch_file_t *stored = &stored_files[j];
+            
+            if (strncmp(stored->path, file->path, PREFETCH_NAME_LENGTH) != 0) {
+                continue;
+            }
+            if (stored->ino == file->ino && stored->size == file->size &&
+                stored->mtime_sec == file->mtime_sec && stored->mtime_nsec == file->mtime_nsec &&
+                stored->range_first <= prefetch_range_count &&
+                stored->range_count <= prefetch_range_count - stored->range_first) {
+                file->range_first = stored->range_first;
+                file->range_count = stored->range_count;
+                matched++;
+            }
+            break;
+        }
+    }
+    
+    return matched == prefetch_file_count;
+}
+
+/**
+ * @brief Queue a byte range of a file for reading into the page cache
+ * @param fd Open file descriptor
+ * @param offset Start of the range
+ * @param length Length of the range
+ */
+static void warm_range(int fd, uint64_t offset, uint64_t length) {
+    // readahead() is not supported everywhere; the advice does the same
+    if (readahead(fd, (off64_t)offset, (size_t)length) != 0) {
+        posix_fadvise(fd, (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED);
+    }
+}
+
+/**
+ * @brief Prefetch threads take objects off the shared queue until it is empty
+ * @param arg Shared prefetch_job_t
+ * @return Always NULL
+ */
+static void *prefetch_worker(void *arg) {
+    prefetch_job_t *job = arg;
+    unsigned int index;
+    
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count) {
+        const prefetch_file_t *file = &prefetch_files[index];
+        int fd = openat(job->dirfd, file->path, O_RDONLY | O_CLOEXEC);
+        
+        if (fd < 0) {
+            continue;
+        }
+        if (file->range_count == 0) {
+            warm_range(fd, 0, file->size);
+        }
+        for (uint32_t i = 0; i < file->range_count; i++) {
+            const prefetch_range_t *range = &prefetch_ranges[file->range_first + i];
+            warm_range(fd, range->offset, range->length);
+        }
+        close(fd);
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Order ranges by file and offset
+ * @param a First range
+ * @param b Second range
+ * @return Negative, zero or positive like strcmp
+ */
+static int compare_ranges(const void *a, const void *b) {
+    const prefetch_range_t *left = a;
+    const prefetch_range_t *right = b;
+    
+    if (left->file != right->file) {
+        return left->file < right->file ? -1 : 1;
+    }
+    return (left->offset > right->offset) - (left->offset < right->offset);
+}
+
+/**
+ * @brief Append a recorded range
+ * @param file Index of the object in the prefetch set
+ * @param offset Start of the range in the file
+ * @param length Length of the range
+ * @return 0 on success, -1 if the range table is full
+ */
+static int add_range(uint32_t file, uint64_t offset, uint64_t length) {
+    prefetch_range_t *range;
+    
+    if (prefetch_range_count >= PREFETCH_MAX_RANGES) {
+        return -1;
+    }
+    range = &prefetch_ranges[prefetch_range_count++];
+    range->file = file;
+    range->reserved = 0;
+    range->offset = offset;
+    range->length = length;
+    return 0;
+}
+
+/**
+ * @brief Record the resident pages of one file mapping of the application
+ * @param pagemap_fd Open /proc/<pid>/pagemap
+ * @param file Index of the mapped object in the prefetch set
+ * @param start First virtual address of the mapping
+ * @param end End of the mapping
+ * @param offset File offset of the first page
+ * @param page_size System page size
+ * @return 0 on success, -1 if the range table overflowed
+ */
+static int record_mapping(int pagemap_fd, uint32_t file, unsigned long start, unsigned long end,
+                          uint64_t offset, unsigned long page_size) {
+    uint64_t entries[512];
+    unsigned long pages = (end - start) / page_size;
+    unsigned long done = 0;
+    uint64_t run_start = 0;
+    int in_run = 0;
+    
+    while (done < pages) {
+        size_t batch = pages - done < 512 ? pages - done : 512;
+        ssize_t got = pread(pagemap_fd, entries, batch * sizeof(entries[0]),
+                            (off_t)((start / page_size + done) * sizeof(entries[0])));
+        if (got <= 0) {
+            break;
+        }
+        batch = (size_t)got / sizeof(entries[0]);
+        
+        for (size_t k = 0; k < batch; k++) {
+            // Bit 63 is set for pages present in the page tables of the process
+            int present = (int)(entries[k] >> 63);
+            uint64_t file_offset = offset + (done + k) * page_size;
+            
+            if (present && !in_run) {
+                run_start = file_offset;
+                in_run = 1;
+            } else if (!present && in_run) {
+                if (add_range(file, run_start, file_offset - run_start) != 0) {
+                    return -1;
+                }
+                in_run = 0;
+            }
+        }
+        done += batch;
+    }
+    
+    return in_run ? add_range(file, run_start, offset + done * page_size - run_start) : 0;
+}
+
+/**
+ * @brief Write the recorded hot list atomically
+ * @param bundle_path Bundle path the hot list is keyed on
+ */
+static void write_hot_list(const char *bundle_path) {
+    char entry_path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH + 16];
+    prefetch_header_t header;
+    size_t path_length = strlen(bundle_path);
+    size_t files_size = prefetch_file_count * sizeof(prefetch_file_t);
+    size_t ranges_size = prefetch_range_count * sizeof(prefetch_range_t);
+    int fd;
+    
+    if (cache_entry_path(PREFETCH_CACHE_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return;
+    }
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", entry_path, (long)getpid());
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = PREFETCH_MAGIC;
+    header.version = PREFETCH_VERSION;
+    header.file_count = prefetch_file_count;
+    header.range_count = prefetch_range_count;
+    header.path_length = (uint32_t)path_length;
+    
+    int failed = write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+                 write(fd, bundle_path, path_length) != (ssize_t)path_length ||
+                 write(fd, prefetch_files, files_size) != (ssize_t)files_size ||
+                 write(fd, prefetch_ranges, ranges_size) != (ssize_t)ranges_size;
+    if (close(fd) != 0 || failed || rename(temp_path, entry_path) != 0) {
+        unlink(temp_path);
+    }
+}
+
+/**
+ * @brief Learn which ranges of the prefetch set the application touched
+ * @param pid Process that exec'd the bundle
+ * @param bundle_path Bundle path the hot list is keyed on
+ */
+static void record_hot_pages(pid_t pid, const char *bundle_path) {
+    char maps_path[64];
+    char pagemap_path[64];
+    char line[MAX_PATH_LENGTH + 128];
+    unsigned long page_size = (unsigned long)sysconf(_SC_PAGESIZE);
+    unsigned int merged = 0;
+    int overflow = 0;
+    int exec_mapped = 0;
+    int pagemap_fd;
+    FILE *maps;
+    
+    snprintf(maps_path, sizeof(maps_path), "/proc/%ld/maps", (long)pid);
+    snprintf(pagemap_path, sizeof(pagemap_path), "/proc/%ld/pagemap", (long)pid);
+    maps = fopen(maps_path, "re");
+    if (maps == NULL) {
+        return;
+    }
+    pagemap_fd = open(pagemap_path, O_RDONLY | O_CLOEXEC);
+    if (pagemap_fd < 0) {
+        fclose(maps);
+        return;
+    }
+    
+    prefetch_range_count = 0;
+    while (!overflow && fgets(line, sizeof(line), maps) != NULL) {
+        unsigned long start;
+        unsigned long end;
+        unsigned long long offset;
+        unsigned long inode;
+        
+        if (sscanf(line, "%lx-%lx %*s %llx %*s %lu", &start, &end, &offset, &inode) != 4 || inode == 0) {
+            continue;
+        }
+        
+        // Match on the inode alone: maps reports the superblock device,
+        // which differs from st_dev on filesystems with subvolumes
+        for (unsigned int i = 0; i < prefetch_file_count; i++) {
+            if (prefetch_files[i].ino != inode) {
+                continue;
+            }
+            exec_mapped |= (i == 0);
+            overflow = record_mapping(pagemap_fd, i, start, end, offset, page_size) != 0;
+            break;
+        }
+    }
+    close(pagemap_fd);
+    fclose(maps);
+    
+    // The application exited or the pid now belongs to something else
+    if (!exec_mapped) {
+        return;
+    }
+    
+    // Merge ranges of the same file that are close enough to read as one
+    qsort(prefetch_ranges, prefetch_range_count, sizeof(prefetch_range_t), compare_ranges);
+    for (unsigned int i = 0; i < prefetch_range_count; i++) {
+        prefetch_range_t *last = merged > 0 ? &prefetch_ranges[merged - 1] : NULL;
+        const prefetch_range_t *range = &prefetch_ranges[i];
+        
+        if (last != NULL && last->file == range->file &&
+            range->offset <= last->offset + last->length + PREFETCH_RANGE_GAP) {
+            uint64_t end = range->offset + range->length;
+            if (end > last->offset + last->length) {
+                last->length = end - last->offset;
+            }
+        } else {
+            prefetch_ranges[merged++] = *range;
+        }
+    }
+    prefetch_range_count = merged;
+    
+    // An incomplete recording would starve later launches, so fall back to whole files
+    if (overflow) {
+        prefetch_range_count = 0;
+    }
+    for (unsigned int i = 0; i < prefetch_file_count; i++) {
+        prefetch_files[i].range_first = 0;
+        prefetch_files[i].range_count = 0;
+    }
+    for (unsigned int i = prefetch_range_count; i-- > 0;) {
+        prefetch_file_t *file = &prefetch_files[prefetch_ranges[i].file];
+        file->range_first = i;
+        file->range_count++;
+    }
+    
+    write_hot_list(bundle_path);
+}
+
+/**
+ * @brief Leave a detached process behind that records the hot list
+ * @param bundle_path Bundle path the hot list is keyed on
+ */
+static void spawn_recorder(const char *bundle_path) {
+    pid_t target = getpid();
+    pid_t pid;
+    
+    log_flush();
+    fflush(NULL);
+    pid = fork();
+    if (pid < 0) {
+        log_message(LOG_DEBUG, "Cannot start prefetch recorder: %s", strerror(errno));
+        return;
+    }
+    
+    if (pid == 0) {
+        int null_fd;
+        
+        // Fork twice so the application never inherits an unexpected child
+        if (setsid() < 0 || fork() != 0) {
+            _exit(0);
+        }
+        
+        // Do not hold pipes or sockets of the caller open while waiting
+        null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+#ifdef SYS_close_range
+        syscall(SYS_close_range, 3U, ~0U, 0U);
+#endif
+        
+        sleep(PREFETCH_RECORD_DELAY);
+        record_hot_pages(target, bundle_path);
+        _exit(0);
+    }
+    
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * @brief Warm the bundle objects, optionally learning the hot list afterwards
+ * @param probe Probed bundle
+ * @param record Non-zero if the caller is about to exec the bundle
+ */
+static void prefetch_run(const bundle_probe_t *probe, int record) {
+    pthread_t threads[PREFETCH_THREADS];
+    unsigned int thread_count = 0;
+    prefetch_job_t job;
+    int exec_is_elf;
+    int learned;
+    
+    exec_is_elf = collect_prefetch_set(probe);
+    if (prefetch_file_count == 0) {
+        return;
+    }
+    learned = load_hot_list(probe->path);
+    
+    job.dirfd = probe->dirfd;
+    job.count = prefetch_file_count;
+    job.next = 0;
+    
+    // The calling thread works the queue as well
+    while (thread_count + 1 < PREFETCH_THREADS && thread_count + 1 < job.count &&
+           pthread_create(&threads[thread_count], NULL, prefetch_worker, &job) == 0) {
+        thread_count++;
+    }
+    prefetch_worker(&job);
+    
+    // exec() discards threads that have not queued their reads yet
+    for (unsigned int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    log_message(LOG_DEBUG, "Prefetched %u bundle objects (%s) on %u threads",
+                prefetch_file_count, learned ? "hot ranges" : "whole files", thread_count + 1);
+    
+    if (record && exec_is_elf && !learned) {
+        spawn_recorder(probe->path);
+    }
+}
+
+/**
+ * @brief Warm the bundle executable and its libraries into the page cache
+ * @param probe Probed bundle
+ */
+void prefetch_bundle(const bundle_probe_t *probe) {
+    prefetch_run(probe, 1);
+}
+
+/**
+ * @brief Warm a bundle that is not being launched by this process
+ * @param probe Probed bundle
+ */
+void prefetch_warm(const bundle_probe_t *probe) {
+    // The recorder samples the page tables of its parent, which would not be the application
+    prefetch_run(probe, 0);
+}
@@ -0,0 +1,68 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file prefetch.h
+ * @brief Page cache prefetching of bundle objects
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Warms exec/base and its in-bundle DT_NEEDED closure into the page
+ * cache from a small thread pool before exec, optionally limited to the
+ * page ranges that previous launches actually touched.
+ */
+
+#ifndef VLAUNCH_PREFETCH_H
+#define VLAUNCH_PREFETCH_H
+
+#include <stdint.h>
+
+#include "launcher.h"
+
+/* Prefetch Configuration */
+#define PREFETCH_THREADS        4
+#define PREFETCH_MAX_FILES      256
+#define PREFETCH_MAX_RANGES     4096
+#define PREFETCH_NAME_LENGTH    288
+#define PREFETCH_RANGE_GAP      (64 * 1024)
+#define PREFETCH_RECORD_DELAY   10
+#define PREFETCH_CACHE_DIR      "prefetch"
+#define PREFETCH_MAGIC          0x50484c56u /* "VLHP" */
+#define PREFETCH_VERSION        1
+
+void prefetch_set_enabled(int enabled);
+int prefetch_enabled(void);
+void prefetch_bundle(const bundle_probe_t *probe);
+void prefetch_warm(const bundle_probe_t *probe);
+
+#endif /* VLAUNCH_PREFETCH_H */
@@ -0,0 +1,501 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file probe.c
+ * @brief dirfd-relative bundle probing
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The bundle directory is opened once with O_PATH and every component is
+ * examined with statx() relative to that descriptor. On network
+ * filesystems such as NFS, and where io_uring is available, the statx
+ * calls are submitted as one batch so the kernel overlaps the round
+ * trips; otherwise they are issued back to back.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#if __has_include(<linux/io_uring.h>)
+#define PROBE_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#endif
+#endif
+
+#include "launcher.h"
+#include "probe.h"
+#include "manifest.h"
+#include "pack.h"
+
+/* Component paths relative to the bundle directory */
+const char *const bundle_component_paths[COMPONENT_COUNT] = {
+    [COMPONENT_ROOT]      = ".",
+    [COMPONENT_EXEC]      = EXEC_PATH + 1,
+    [COMPONENT_LIBRARY]   = LIB_PATH + 1,
+    [COMPONENT_RESOURCES] = RES_PATH + 1,
+    [COMPONENT_METADATA]  = METADATA_PATH + 1,
+    [COMPONENT_ICON]      = ICON_PATH + 1
+};
+
+/* Filesystems where each lookup is a network round trip */
+#define NFS_SUPER_MAGIC     0x6969
+#define SMB2_SUPER_MAGIC    0xfe534d42
+#define CIFS_SUPER_MAGIC    0xff534d42
+#define FUSE_SUPER_MAGIC    0x65735546
+#define V9FS_SUPER_MAGIC    0x01021997
+#define CEPH_SUPER_MAGIC    0x00c36400
+
+/* One statx() call of the batch */
+typedef struct {
+    int dirfd;
+    const char *path;
+    int flags;
+    struct statx *buffer;
+    int result;
+} statx_request_t;
+
+#ifdef PROBE_HAVE_IO_URING
+/**
+ * @brief Decide whether batching is worth the cost of setting up a ring
+ * @param dirfd Bundle directory descriptor
+ * @return 1 for remote filesystems, 0 for local ones
+ */
+static int statx_batch_worthwhile(int dirfd) {
+    struct statfs fs;
+    
+    // Local lookups hit the dentry cache; a ring costs more than it saves there
+    if (fstatfs(dirfd, &fs) != 0) {
+        return 0;
+    }
+    
+    switch ((unsigned long)fs.f_type) {
+        case NFS_SUPER_MAGIC:
+        case SMB2_SUPER_MAGIC:
+        case CIFS_SUPER_MAGIC:
+        case FUSE_SUPER_MAGIC:
+        case V9FS_SUPER_MAGIC:
+        case CEPH_SUPER_MAGIC:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Run a batch of statx requests through a short-lived io_uring
+ * @param requests Requests to execute; results are stored in place
+ * @param count Number of requests
+ * @return 0 if the batch completed, -1 if io_uring is unavailable
+ */
+static int statx_batch_uring(statx_request_t *requests, unsigned count) {
+    struct io_uring_params params;
+    struct io_uring_sqe *sqes;
+    unsigned char *sq_ring;
+    unsigned char *cq_ring;
+    size_t sq_size, cq_size, sqes_size;
+    unsigned completed = 0;
+    int ring_fd;
+    int status = -1;
+    
+    memset(&params, 0, sizeof(params));
+    ring_fd = (int)syscall(__NR_io_uring_setup, count, &params);
+    if (ring_fd < 0) {
+        return -1;
+    }
+    
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+    }
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    
+    sq_ring = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        close(ring_fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring = sq_ring;
+    } else {
+        cq_ring = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            munmap(sq_ring, sq_size);
+            close(ring_fd);
+            return -1;
+        }
+    }
+    sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        goto out;
+    }
+    
+    // Queue every request, then publish them with a single tail update
+    unsigned *sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+    unsigned *sq_mask = (unsigned *)(sq_ring + params.sq_off.ring_mask);
+    unsigned *sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+    unsigned tail = *sq_tail;
+    
+    for (unsigned i = 0; i < count; i++) {
+        unsigned index = (tail + i) & *sq_mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = requests[i].dirfd;
+        sqe->addr = (unsigned long)requests[i].path;
+        sqe->len = PROBE_STATX_MASK;
+        sqe->off = (unsigned long)requests[i].buffer;
+        sqe->statx_flags = (unsigned)requests[i].flags;
+        sqe->user_data = i;
+        sq_array[index] = index;
+    }
+    __atomic_store_n(sq_tail, tail + count, __ATOMIC_RELEASE);
+    
+    unsigned *cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+    unsigned *cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+    unsigned *cq_mask = (unsigned *)(cq_ring + params.cq_off.ring_mask);
+    struct io_uring_cqe *cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    unsigned to_submit = count;
+    
+    while (completed < count) {
+        int ret = (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, count - completed,
+                               IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+        
+        unsigned head = *cq_head;
+        unsigned available = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != available; head++) {
+            struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+            if (cqe->user_data < count) {
+                requests[cqe->user_data].result = cqe->res;
+                completed++;
+            }
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+    
+    // Kernels older than 5.6 reject IORING_OP_STATX with EINVAL
+    status = completed == count ? 0 : -1;
+    for (unsigned i = 0; status == 0 && i < count; i++) {
+        if (requests[i].result == -EINVAL) {
+            status = -1;
+        }
+    }
+    
+    munmap(sqes, sqes_size);
+out:
+    if (cq_ring != sq_ring) {
+        munmap(cq_ring, cq_size);
+    }
+    munmap(sq_ring, sq_size);
+    close(ring_fd);
+    return status;
+}
+#endif
+
+/**
+ * @brief Execute a batch of statx requests
+ * @param requests Requests to execute; results are stored in place
+ * @param count Number of requests
+ */
+static void statx_batch(statx_request_t *requests, unsigned count) {
+#ifdef PROBE_HAVE_IO_URING
+    if (count > 1 && statx_batch_worthwhile(requests[0].dirfd) &&
+        statx_batch_uring(requests, count) == 0) {
+        log_message(LOG_DEBUG, "Probed %u bundle components through io_uring", count);
+        return;
+    }
+#endif
+    for (unsigned i = 0; i < count; i++) {
+        requests[i].result = statx(requests[i].dirfd, requests[i].path, requests[i].flags,
+                                   PROBE_STATX_MASK, requests[i].buffer) == 0 ? 0 : -errno;
+    }
+}
+
+/**
+ * @brief Map info.yaml and record its stat result
+ * @param probe Probe with an open bundle directory
+ */
+static void load_bundle_metadata(bundle_probe_t *probe) {
+    struct statx *stx = &probe->components[COMPONENT_METADATA];
+    int fd;
+    
+    fd = openat(probe->dirfd, bundle_component_paths[COMPONENT_METADATA], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    
+    // The descriptor is already open, so its stat result is free
+    if (statx(fd, "", AT_EMPTY_PATH | AT_STATX_SYNC_AS_STAT, PROBE_STATX_MASK, stx) == 0) {
+        probe->present[COMPONENT_METADATA] = 1;
+        if (S_ISREG(stx->stx_mode) && metadata_load(&probe->metadata, fd, stx->stx_size) != EXIT_SUCCESS) {
+            log_message(LOG_WARNING, "Cannot map metadata of %s: %s", probe->path, strerror(errno));
+        }
+    }
+    close(fd);
+}
+
+/**
+ * @brief Select the executable named by the metadata entry key
+ * @param probe Probe with loaded metadata
+ * @return 1 if the entry stays inside the bundle, 0 otherwise
+ */
+static int resolve_entry(bundle_probe_t *probe) {
+    char entry[MAX_PATH_LENGTH];
+    const char *relative = entry;
+    const char *component;
+    
+    snprintf(probe->exec_path, sizeof(probe->exec_path), "%s", bundle_component_paths[COMPONENT_EXEC]);
+    if (probe->metadata.entry.length == 0) {
+        return 1;
+    }
+    if (metadata_copy(&probe->metadata.entry, entry, sizeof(entry)) != 0) {
+        log_message(LOG_WARNING, "Entry in metadata of %s is too long", probe->path);
+        return 0;
+    }
+    
+    // Entries are relative to the bundle root, usually written with a leading slash
+    while (*relative == '/') {
+        relative++;
+    }
+    snprintf(probe->exec_path, sizeof(probe->exec_path), "%s", relative);
+    
+    for (component = relative; *component; component += strcspn(component, "/")) {
+        component += strspn(component, "/");
+        if (strncmp(component, "..", 2) == 0 && (component[2] == '/' || component[2] == '\0')) {
+            log_message(LOG_WARNING, "Entry in metadata of %s leaves the bundle: %s", probe->path, entry);
+            return 0;
+        }
+    }
+    
+    return *relative != '\0';
+}
+
+/**
+ * @brief Get the path of a component relative to the bundle directory
+ * @param probe Opened bundle
+ * @param component Component to look up
+ * @return Relative path; the executable follows the metadata entry key
+ */
+const char *bundle_probe_relative_path(const bundle_probe_t *probe, bundle_component_t component) {
+    return component == COMPONENT_EXEC ? probe->exec_path : bundle_component_paths[component];
+}
+
+/**
+ * @brief Read the metadata and pin the executable it names
+ * @param probe Probe with an open bundle directory
+ */
+void bundle_probe_load_entry(bundle_probe_t *probe) {
+    // The metadata may move the entry point, so it is read before anything is pinned
+    load_bundle_metadata(probe);
+    
+    // Pin the executable now so the file we validate is the file we exec
+    if (resolve_entry(probe)) {
+        probe->exec_fd = openat(probe->dirfd, probe->exec_path, O_PATH | O_CLOEXEC);
+    }
+}
+
+/**
+ * @brief Open a bundle and stat all of its components
+ * @param probe Probe to fill in
+ * @param bundle_path Path to application bundle
+ * @return EXIT_SUCCESS on success, EXIT_BUNDLE_ERROR if the bundle directory cannot be opened
+ */
+int bundle_probe_open(bundle_probe_t *probe, const char *bundle_path) {
+    statx_request_t requests[COMPONENT_COUNT];
+    int components[COMPONENT_COUNT];
+    unsigned count = 0;
+    
+    memset(probe, 0, sizeof(*probe));
+    snprintf(probe->path, sizeof(probe->path), "%s", bundle_path);
+    probe->exec_fd = -1;
+    probe->image_lock = -1;
+    
+    probe->dirfd = open(bundle_path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (probe->dirfd < 0) {
+        // A packed image answers from its index instead of the batch
+        return errno == ENOTDIR ? pack_probe_open(probe, bundle_path) : EXIT_BUNDLE_ERROR;
+    }
+    
+    // A current compiled manifest answers everything the batch and info.yaml would
+    if (manifest_load(probe) == EXIT_SUCCESS) {
+        return EXIT_SUCCESS;
+    }
+    
+    bundle_probe_load_entry(probe);
+    
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        statx_request_t *request = &requests[count];
+        
+        request->dirfd = probe->dirfd;
+        request->path = bundle_component_paths[i];
+        request->flags = AT_STATX_SYNC_AS_STAT;
+        request->buffer = &probe->components[i];
+        request->result = -ENOENT;
+        
+        if (i == COMPONENT_ROOT) {
+            request->path = "";
+            request->flags |= AT_EMPTY_PATH;
+        } else if (i == COMPONENT_METADATA) {
+            continue;
+        } else if (i == COMPONENT_EXEC) {
+            if (probe->exec_fd < 0) {
+                continue;
+            }
+            request->dirfd = probe->exec_fd;
+            request->path = "";
+            request->flags |= AT_EMPTY_PATH;
+        }
+        components[count++] = i;
+    }
+    
+    statx_batch(requests, count);
+    
+    for (unsigned i = 0; i < count; i++) {
+        probe->present[components[i]] = requests[i].result == 0;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Release the descriptors held by a probe
+ * @param probe Probe to close
+ */
+void bundle_probe_close(bundle_probe_t *probe) {
+    metadata_release(&probe->metadata);
+    if (probe->exec_fd >= 0) {
+        close(probe->exec_fd);
+        probe->exec_fd = -1;
+    }
+    if (probe->dirfd >= 0) {
+        close(probe->dirfd);
+        probe->dirfd = -1;
+    }
+    if (probe->image_lock >= 0) {
+        close(probe->image_lock);
+        probe->image_lock = -1;
+    }
+}
+
+/**
+ * @brief Check whether a probed component is a regular file
+ * @param probe Opened probe
+ * @param component Component to check
+ * @return 1 if the component exists and is a regular file, 0 otherwise
+ */
+int bundle_probe_is_file(const bundle_probe_t *probe, bundle_component_t component) {
+    return probe->present[component] && S_ISREG(probe->components[component].stx_mode);
+}
+
+/**
+ * @brief Check whether a probed component is a directory
+ * @param probe Opened probe
+ * @param component Component to check
+ * @return 1 if the component exists and is a directory, 0 otherwise
+ */
+int bundle_probe_is_directory(const bundle_probe_t *probe, bundle_component_t component) {
+    return probe->present[component] && S_ISDIR(probe->components[component].stx_mode);
+}
+
+/**
+ * @brief Build the path of a component below the bundle path as given, for messages and the environment
+ * @param probe Opened probe
+ * @param component Component whose path is wanted
+ * @param out Destination buffer
+ * @param size Size of destination buffer
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR if the path does not fit
+ */
+int bundle_probe_component_path(const bundle_probe_t *probe, bundle_component_t component,
+                                char *out, size_t size) {
+    int written;
+    
+    if (component == COMPONENT_ROOT) {
+        written = snprintf(out, size, "%s", probe->path);
+    } else {
+        written = snprintf(out, size, "%s/%s", probe->path, bundle_probe_relative_path(probe, component));
+    }
+    
+    return (written < 0 || (size_t)written >= size) ? EXIT_SYSTEM_ERROR : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Build the absolute path of a component, for paths that must survive a chdir()
+ * @param probe Opened probe
+ * @param component Component whose path is wanted
+ * @param out Destination buffer
+ * @param size Size of destination buffer
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR if unresolvable or the path does not fit
+ */
+int bundle_probe_resolved_path(const bundle_probe_t *probe, bundle_component_t component,
+                               char *out, size_t size) {
+    char link[32];
+    char root[PATH_MAX];
+    int written;
+    
+    // The directory the probe pinned, wherever the given path points by now
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", probe->dirfd);
+    if (realpath(link, root) == NULL) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (component == COMPONENT_ROOT) {
+        written = snprintf(out, size, "%s", root);
+    } else {
+        written = snprintf(out, size, "%s/%s", root, bundle_probe_relative_path(probe, component));
+    }
+    
+    return (written < 0 || (size_t)written >= size) ? EXIT_SYSTEM_ERROR : EXIT_SUCCESS;
+}
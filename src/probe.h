@@ -0,0 +1,98 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file probe.h
+ * @brief dirfd-relative bundle probing
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Opens a bundle once and stats all of its components relative to the
+ * bundle directory in a single batched pass, so the per-component cost
+ * does not depend on how deep the bundle path is.
+ */
+
+#ifndef VLAUNCH_PROBE_H
+#define VLAUNCH_PROBE_H
+
+#include <sys/stat.h>
+
+#include "launcher.h"
+#include "metadata.h"
+
+/* Stat fields recorded for every component */
+#define PROBE_STATX_MASK    (STATX_TYPE | STATX_MODE | STATX_INO | STATX_SIZE | \
+                             STATX_MTIME | STATX_CTIME)
+
+/* Bundle components inspected by the probe */
+typedef enum {
+    COMPONENT_ROOT,
+    COMPONENT_EXEC,
+    COMPONENT_LIBRARY,
+    COMPONENT_RESOURCES,
+    COMPONENT_METADATA,
+    COMPONENT_ICON,
+    COMPONENT_COUNT
+} bundle_component_t;
+
+/* An opened bundle, its metadata and the stat results of its components */
+struct bundle_probe {
+    char path[MAX_PATH_LENGTH];
+    char exec_path[MAX_PATH_LENGTH];
+    int dirfd;
+    int exec_fd;
+    int present[COMPONENT_COUNT];
+    struct statx components[COMPONENT_COUNT];
+    bundle_metadata_t metadata;
+    int manifest;
+    
+    // Set if the bundle was unpacked from a .vapp image, see pack.h
+    char image_path[MAX_PATH_LENGTH];
+    struct statx image;
+    int image_lock;                     // Shared lock on the unpacked tree, inherited by the application
+};
+
+extern const char *const bundle_component_paths[COMPONENT_COUNT];
+
+int bundle_probe_open(bundle_probe_t *probe, const char *bundle_path);
+void bundle_probe_load_entry(bundle_probe_t *probe);
+void bundle_probe_close(bundle_probe_t *probe);
+int bundle_probe_is_file(const bundle_probe_t *probe, bundle_component_t component);
+int bundle_probe_is_directory(const bundle_probe_t *probe, bundle_component_t component);
+const char *bundle_probe_relative_path(const bundle_probe_t *probe, bundle_component_t component);
+int bundle_probe_component_path(const bundle_probe_t *probe, bundle_component_t component,
+                                char *out, size_t size);
+int bundle_probe_resolved_path(const bundle_probe_t *probe, bundle_component_t component,
+                               char *out, size_t size);
+
+#endif /* VLAUNCH_PROBE_H */
@@ -0,0 +1,487 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file resource.c
+ * @brief Packed resource index builder and launch-time hand-off
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The blob is written next to the bundle, or into the user cache when the
+ * bundle is read-only. It is stamped with the identity of resources/ and
+ * with a hash of the name, size and mtime of every file below it, which
+ * each launch recomputes with one fstatat() per file before handing the
+ * blob out. The per-file hashes are summed, so readdir order does not
+ * matter.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "cache.h"
+#include "resource.h"
+#include "environment.h"
+#include "handoff.h"
+
+/* Buffer size for copying resource contents */
+#define RESOURCE_COPY_CHUNK (64 * 1024)
+
+/* Nesting limit for resources/, far beyond any real bundle */
+#define RESOURCE_MAX_DEPTH  32
+
+/* A file found below resources/ */
+typedef struct {
+    char *name;
+    uint32_t hash;
+    uint64_t size;
+} resource_build_entry_t;
+
+/* Growable list of files */
+typedef struct {
+    resource_build_entry_t *entries;
+    size_t count;
+    size_t capacity;
+} resource_build_t;
+
+/* Running stamp of a resources/ tree */
+typedef struct {
+    uint64_t sum;
+    uint64_t count;
+} resource_stamp_t;
+
+/**
+ * @brief Hash the name, size and mtime of one file (64-bit FNV-1a)
+ * @param name Path relative to resources/
+ * @param st Status of the file
+ * @return Hash value
+ */
+static uint64_t file_stamp(const char *name, const struct stat *st) {
+    int64_t fields[3] = { (int64_t)st->st_size, (int64_t)st->st_mtim.tv_sec, (int64_t)st->st_mtim.tv_nsec };
+    const unsigned char *bytes = (const unsigned char *)fields;
+    uint64_t hash = 14695981039346656037ULL;
+    
+    // The terminator keeps "a" + size from hashing like "a\0..."
+    for (const unsigned char *p = (const unsigned char *)name; ; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+        if (*p == '\0') {
+            break;
+        }
+    }
+    for (size_t i = 0; i < sizeof(fields); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Release a file list
+ * @param build File list
+ */
+static void build_free(resource_build_t *build) {
+    for (size_t i = 0; i < build->count; i++) {
+        free(build->entries[i].name);
+    }
+    free(build->entries);
+}
+
+/**
+ * @brief Add a file to the list
+ * @param build File list
+ * @param name Path relative to resources/
+ * @param size File size
+ * @return 0 on success, -1 on allocation failure
+ */
+static int build_add(resource_build_t *build, const char *name, uint64_t size) {
+    if (build->count == build->capacity) {
+        size_t capacity = build->capacity ? build->capacity * 2 : 64;
+        resource_build_entry_t *grown = realloc(build->entries, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        build->entries = grown;
+        build->capacity = capacity;
+    }
+    
+    build->entries[build->count].name = strdup(name);
+    if (build->entries[build->count].name == NULL) {
+        return -1;
+    }
+    build->entries[build->count].hash = resource_hash(name, strlen(name));
+    build->entries[build->count].size = size;
+    build->count++;
+    return 0;
+}
+
+/**
+ * @brief Order files the way resource_lookup() searches them
+ * @param a First entry
+ * @param b Second entry
+ * @return Comparison result for qsort()
+ */
+static int compare_entries(const void *a, const void *b) {
+    const resource_build_entry_t *left = a;
+    const resource_build_entry_t *right = b;
+    size_t left_length = strlen(left->name);
+    size_t right_length = strlen(right->name);
+    int cmp;
+    
+    if (left->hash != right->hash) {
+        return left->hash < right->hash ? -1 : 1;
+    }
+    cmp = memcmp(left->name, right->name, left_length < right_length ? left_length : right_length);
+    if (cmp == 0 && left_length != right_length) {
+        cmp = left_length < right_length ? -1 : 1;
+    }
+    return cmp;
+}
+
+/**
+ * @brief Collect and stamp the regular files of a directory tree
+ * @param dirfd Directory to list; consumed
+ * @param prefix Path of the directory relative to resources/
+ * @param depth Current nesting depth
+ * @param build File list, or NULL to only stamp the tree
+ * @param stamp Stamp to add every file to
+ * @return 0 on success, -1 on failure
+ */
+static int collect_files(int dirfd, const char *prefix, int depth, resource_build_t *build, resource_stamp_t *stamp) {
+    char name[MAX_PATH_LENGTH];
+    struct dirent *entry;
+    struct stat st;
+    int failed = 0;
+    DIR *dir;
+    
+    dir = fdopendir(dirfd);
+    if (dir == NULL) {
+        close(dirfd);
+        return -1;
+    }
+    
+    while (!failed && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf(name, sizeof(name), "%s%s%s", prefix, prefix[0] ? "/" : "", entry->d_name) >= (int)sizeof(name) ||
+            fstatat(dirfd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            log_message(build ? LOG_ERROR : LOG_DEBUG, "Cannot index resource %s/%s", prefix, entry->d_name);
+            failed = 1;
+            break;
+        }
+        
+        if (S_ISREG(st.st_mode)) {
+            stamp->sum += file_stamp(name, &st);
+            stamp->count++;
+            failed = build != NULL && build_add(build, name, (uint64_t)st.st_size) != 0;
+        } else if (S_ISDIR(st.st_mode) && depth < RESOURCE_MAX_DEPTH) {
+            int child = openat(dirfd, entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            failed = child < 0 || collect_files(child, name, depth + 1, build, stamp) != 0;
+        } else if (build != NULL) {
+            log_message(LOG_DEBUG, "Not indexing resource %s", name);
+        }
+    }
+    
+    closedir(dir);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Copy one resource into the blob
+ * @param resfd resources/ directory
+ * @param entry File to copy
+ * @param out Blob being written
+ * @param offset Offset of the contents in the blob
+ * @return 0 on success, -1 on failure or if the file changed size
+ */
+static int copy_resource(int resfd, const resource_build_entry_t *entry, int out, uint64_t offset) {
+    char buffer[RESOURCE_COPY_CHUNK];
+    uint64_t copied = 0;
+    ssize_t n;
+    int fd;
+    
+    fd = openat(resfd, entry->name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    while (copied < entry->size && (n = read(fd, buffer, sizeof(buffer))) > 0) {
+        if ((uint64_t)n > entry->size - copied ||
+            pwrite(out, buffer, (size_t)n, (off_t)(offset + copied)) != n) {
+            break;
+        }
+        copied += (uint64_t)n;
+    }
+    close(fd);
+    return copied == entry->size ? 0 : -1;
+}
+
+/**
+ * @brief Write a blob atomically
+ * @param dirfd Directory the blob path is relative to
+ * @param path Blob path
+ * @param resfd resources/ directory
+ * @param build Sorted file list
+ * @param resources statx result of resources/ at scan time
+ * @param stamp Stamp of the tree at scan time
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+static int write_blob(int dirfd, const char *path, int resfd, const resource_build_t *build,
+                      const struct statx *resources, const resource_stamp_t *stamp) {
+    char temp_path[MAX_PATH_LENGTH + 16];
+    resource_header_t header;
+    resource_entry_t *entries;
+    char *strings;
+    size_t strings_size = 0;
+    size_t used = 0;
+    uint64_t offset;
+    int failed;
+    int fd;
+    
+    for (size_t i = 0; i < build->count; i++) {
+        strings_size += strlen(build->entries[i].name) + 1;
+    }
+    if (strings_size > UINT32_MAX || build->count > UINT32_MAX / sizeof(*entries)) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    entries = calloc(build->count ? build->count : 1, sizeof(*entries));
+    strings = malloc(strings_size ? strings_size : 1);
+    if (!entries || !strings) {
+        free(entries);
+        free(strings);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    memset(&header, 0, sizeof(header));
+    header.magic = RESOURCE_MAGIC;
+    header.version = RESOURCE_VERSION;
+    header.entry_count = (uint32_t)build->count;
+    header.strings_offset = (uint32_t)(sizeof(header) + build->count * sizeof(*entries));
+    header.strings_size = (uint32_t)strings_size;
+    header.dir_dev = makedev(resources->stx_dev_major, resources->stx_dev_minor);
+    header.dir_ino = resources->stx_ino;
+    header.tree_stamp = stamp->sum;
+    header.file_count = stamp->count;
+    
+    // Contents start on a page so an app can map just the data it needs
+    offset = (header.strings_offset + strings_size + 4095) & ~(uint64_t)4095;
+    header.data_offset = offset;
+    for (size_t i = 0; i < build->count; i++) {
+        size_t length = strlen(build->entries[i].name);
+        
+        entries[i].hash = build->entries[i].hash;
+        entries[i].name_offset = (uint32_t)used;
+        entries[i].name_length = (uint32_t)length;
+        entries[i].offset = offset;
+        entries[i].size = build->entries[i].size;
+        memcpy(strings + used, build->entries[i].name, length + 1);
+        used += length + 1;
+        offset = (offset + build->entries[i].size + RESOURCE_ALIGNMENT - 1) & ~(uint64_t)(RESOURCE_ALIGNMENT - 1);
+    }
+    header.size = offset;
+    
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld", path, (long)getpid());
+    fd = openat(dirfd, temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(entries);
+        free(strings);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    failed = ftruncate(fd, (off_t)header.size) != 0 ||
+             pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+             pwrite(fd, entries, build->count * sizeof(*entries), sizeof(header)) != (ssize_t)(build->count * sizeof(*entries)) ||
+             pwrite(fd, strings, strings_size, header.strings_offset) != (ssize_t)strings_size;
+    for (size_t i = 0; !failed && i < build->count; i++) {
+        if (copy_resource(resfd, &build->entries[i], fd, entries[i].offset) != 0) {
+            log_message(LOG_ERROR, "Cannot pack resource %s", build->entries[i].name);
+            failed = 1;
+        }
+    }
+    
+    free(entries);
+    free(strings);
+    if (close(fd) == 0 && !failed && renameat(dirfd, temp_path, dirfd, path) == 0) {
+        return EXIT_SUCCESS;
+    }
+    unlinkat(dirfd, temp_path, 0);
+    return EXIT_SYSTEM_ERROR;
+}
+
+/**
+ * @brief Build the resource blob of a bundle
+ * @param probe Opened bundle probe with an existing resources/ directory
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int resource_index_build(const bundle_probe_t *probe) {
+    char root[MAX_PATH_LENGTH];
+    char cache_path[MAX_PATH_LENGTH];
+    resource_build_t build = { NULL, 0, 0 };
+    resource_stamp_t stamp = { 0, 0 };
+    int result = EXIT_SYSTEM_ERROR;
+    int resfd;
+    int fd;
+    
+    if (bundle_probe_component_path(probe, COMPONENT_RESOURCES, root, sizeof(root)) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    resfd = openat(probe->dirfd, bundle_component_paths[COMPONENT_RESOURCES], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    fd = resfd >= 0 ? dup(resfd) : -1;
+    if (fd < 0 || collect_files(fd, "", 0, &build, &stamp) != 0) {
+        log_message(LOG_ERROR, "Cannot list resources of %s: %s", probe->path, strerror(errno));
+        if (resfd >= 0) {
+            close(resfd);
+        }
+        build_free(&build);
+        return EXIT_SYSTEM_ERROR;
+    }
+    qsort(build.entries, build.count, sizeof(*build.entries), compare_entries);
+    
+    result = write_blob(probe->dirfd, RESOURCE_FILE_NAME, resfd, &build, &probe->components[COMPONENT_RESOURCES], &stamp);
+    if (result != EXIT_SUCCESS && cache_entry_path(RESOURCE_CACHE_DIR, root, cache_path, sizeof(cache_path)) == EXIT_SUCCESS) {
+        log_message(LOG_DEBUG, "Bundle not writable, storing resource index in cache");
+        result = write_blob(AT_FDCWD, cache_path, resfd, &build, &probe->components[COMPONENT_RESOURCES], &stamp);
+    }
+    
+    if (result == EXIT_SUCCESS) {
+        log_message(LOG_INFO, "Indexed %zu resources in %s", build.count, root);
+    } else {
+        log_message(LOG_WARNING, "Failed to write resource index for %s", root);
+    }
+    close(resfd);
+    build_free(&build);
+    return result;
+}
+
+/**
+ * @brief Open a blob if every file below resources/ is as it was when the blob was built
+ * @param dirfd Directory the blob path is relative to
+ * @param path Blob path
+ * @param probe Opened bundle probe
+ * @param stamp Current stamp of resources/, computed by the first call that needs it
+ * @return Open descriptor of the blob, or -1 if it is missing or stale
+ */
+static int open_current_blob(int dirfd, const char *path, const bundle_probe_t *probe, resource_stamp_t *stamp) {
+    const struct statx *resources = &probe->components[COMPONENT_RESOURCES];
+    resource_header_t header;
+    int resfd;
+    int fd;
+    
+    // Left open across exec for the application
+    fd = openat(dirfd, path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != RESOURCE_MAGIC ||
+        header.version != RESOURCE_VERSION ||
+        header.dir_dev != makedev(resources->stx_dev_major, resources->stx_dev_minor) ||
+        header.dir_ino != resources->stx_ino) {
+        close(fd);
+        return -1;
+    }
+    
+    // Only walked once a blob for this directory exists; UINT64_MAX files means not yet
+    if (stamp->count == UINT64_MAX) {
+        stamp->sum = 0;
+        stamp->count = 0;
+        resfd = openat(probe->dirfd, bundle_component_paths[COMPONENT_RESOURCES], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (resfd < 0 || collect_files(resfd, "", 0, NULL, stamp) != 0) {
+            // A tree that cannot be walked matches no blob
+            stamp->count = UINT64_MAX - 1;
+        }
+    }
+    if (stamp->count != header.file_count || stamp->sum != header.tree_stamp) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Pass the bundle's resource blob to the application
+ * @param probe Opened bundle probe
+ * @param env Environment of the application
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int configure_resources(const bundle_probe_t *probe, env_builder_t *env) {
+    resource_stamp_t stamp = { 0, UINT64_MAX };
+    char root[MAX_PATH_LENGTH];
+    char cache_path[MAX_PATH_LENGTH];
+    char value[16];
+    int fd;
+    
+    // An inherited descriptor must not leak into an app that has no blob
+    env_builder_unset(env, RESOURCE_FD_ENV);
+    if (!bundle_probe_is_directory(probe, COMPONENT_RESOURCES)) {
+        return EXIT_SUCCESS;
+    }
+    
+    fd = open_current_blob(probe->dirfd, RESOURCE_FILE_NAME, probe, &stamp);
+    if (fd < 0 && bundle_probe_component_path(probe, COMPONENT_RESOURCES, root, sizeof(root)) == EXIT_SUCCESS &&
+        cache_entry_path(RESOURCE_CACHE_DIR, root, cache_path, sizeof(cache_path)) == EXIT_SUCCESS) {
+        fd = open_current_blob(AT_FDCWD, cache_path, probe, &stamp);
+    }
+    if (fd < 0) {
+        log_message(LOG_DEBUG, "No current resource index for %s", probe->path);
+        return EXIT_SUCCESS;
+    }
+    
+    // Kept clear of the range descriptors are handed to the application in
+    if (fd < HANDOFF_FIRST_FD + HANDOFF_MAX_FDS) {
+        int moved = fcntl(fd, F_DUPFD, HANDOFF_FIRST_FD + HANDOFF_MAX_FDS);
+        if (moved >= 0) {
+            close(fd);
+            fd = moved;
+        }
+    }
+    
+    snprintf(value, sizeof(value), "%d", fd);
+    if (env_builder_set(env, RESOURCE_FD_ENV, value) != 0) {
+        log_message(LOG_ERROR, "Failed to set %s: %s", RESOURCE_FD_ENV, strerror(ENOMEM));
+        close(fd);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    log_message(LOG_DEBUG, "Resource index passed as fd %d", fd);
+    return EXIT_SUCCESS;
+}
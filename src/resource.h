@@ -0,0 +1,256 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file resource.h
+ * @brief Packed resource index and reader
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * --compile packs every regular file below resources/ into one blob: a
+ * header, entries sorted by name hash, the name table and the file
+ * contents. The launcher hands the blob to the application as an
+ * inherited file descriptor named by VLAUNCH_RESOURCES_FD, so after one
+ * mmap() every lookup is a binary search in memory.
+ *
+ * Applications can copy this header into their own tree and define
+ * RESOURCE_FORMAT_ONLY before including it; the reader below depends
+ * only on libc:
+ *
+ *     resource_map_t resources;
+ *     size_t size;
+ *     if (resource_map_open(&resources) == 0) {
+ *         const void *png = resource_lookup(&resources, "icons/app.png", &size);
+ *     }
+ *
+ * The blob is a snapshot taken at compile time and is only handed out
+ * while every file below resources/ has the name, size and mtime it had
+ * then, so an in-place edit or a change in a subdirectory makes it stale.
+ */
+
+#ifndef VLAUNCH_RESOURCE_H
+#define VLAUNCH_RESOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Blob Format */
+#define RESOURCE_MAGIC      0x53524c56u /* "VLRS" */
+#define RESOURCE_VERSION    2
+#define RESOURCE_FILE_NAME  ".resources"
+#define RESOURCE_CACHE_DIR  "resources"
+#define RESOURCE_FD_ENV     "VLAUNCH_RESOURCES_FD"
+#define RESOURCE_ALIGNMENT  16
+
+/* Blob header; entries and the name table follow, contents start at data_offset */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint32_t reserved;
+    uint64_t dir_dev;
+    uint64_t dir_ino;
+    uint64_t tree_stamp;                // Sum over the files of a hash of name, size and mtime
+    uint64_t file_count;
+    uint64_t data_offset;
+    uint64_t size;
+} resource_header_t;
+
+/* One file, sorted by hash and then name; offset is from the start of the blob */
+typedef struct {
+    uint32_t hash;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+} resource_entry_t;
+
+/* A mapped blob */
+typedef struct {
+    const void *map;
+    size_t size;
+} resource_map_t;
+
+/**
+ * @brief Hash a resource name (32-bit FNV-1a)
+ * @param name Resource name
+ * @param length Length of the name
+ * @return Hash value
+ */
+static inline uint32_t resource_hash(const char *name, size_t length) {
+    uint32_t hash = 2166136261u;
+    
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Check that a mapped blob is structurally sound
+ * @param map Start of the mapped blob
+ * @param size Size of the mapping
+ * @return 1 if the blob can be searched, 0 otherwise
+ */
+static inline int resource_valid(const void *map, size_t size) {
+    const resource_header_t *header = map;
+    
+    return size >= sizeof(*header) &&
+           header->magic == RESOURCE_MAGIC &&
+           header->version == RESOURCE_VERSION &&
+           header->size == size &&
+           header->strings_offset <= size &&
+           header->strings_size <= size - header->strings_offset &&
+           header->data_offset <= size &&
+           (size - sizeof(*header)) / sizeof(resource_entry_t) >= header->entry_count;
+}
+
+/**
+ * @brief Find a resource in a mapped blob
+ * @param resources Mapped blob
+ * @param name Path of the resource relative to resources/, e.g. "icons/app.png"
+ * @param size Receives the size of the resource; may be NULL
+ * @return Start of the resource contents inside the mapping, or NULL if not found
+ */
+static inline const void *resource_lookup(const resource_map_t *resources, const char *name, size_t *size) {
+    const resource_header_t *header = resources->map;
+    const resource_entry_t *entries = (const resource_entry_t *)(header + 1);
+    const char *strings = (const char *)resources->map + header->strings_offset;
+    size_t length = strlen(name);
+    uint32_t hash = resource_hash(name, length);
+    uint32_t low = 0;
+    uint32_t high = header->entry_count;
+    
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const resource_entry_t *entry = &entries[mid];
+        int cmp;
+        
+        if (entry->name_offset > header->strings_size ||
+            entry->name_length > header->strings_size - entry->name_offset ||
+            entry->offset > resources->size || entry->size > resources->size - entry->offset) {
+            return NULL;
+        }
+        
+        if (hash != entry->hash) {
+            cmp = hash < entry->hash ? -1 : 1;
+        } else {
+            cmp = memcmp(name, strings + entry->name_offset,
+                         length < entry->name_length ? length : entry->name_length);
+            if (cmp == 0 && length != entry->name_length) {
+                cmp = length < entry->name_length ? -1 : 1;
+            }
+        }
+        if (cmp == 0) {
+            if (size) {
+                *size = (size_t)entry->size;
+            }
+            return (const char *)resources->map + entry->offset;
+        }
+        if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Map the blob the launcher passed to this process
+ * @param resources Receives the mapping
+ * @return 0 on success, -1 if no valid blob was passed
+ */
+static inline int resource_map_open(resource_map_t *resources) {
+    const char *value = getenv(RESOURCE_FD_ENV);
+    struct stat st;
+    char *end;
+    long fd;
+    void *map;
+    
+    resources->map = NULL;
+    resources->size = 0;
+    if (!value || value[0] == '\0') {
+        return -1;
+    }
+    fd = strtol(value, &end, 10);
+    if (*end != '\0' || fd < 0 || fstat((int)fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return -1;
+    }
+    
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, (int)fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    if (!resource_valid(map, (size_t)st.st_size)) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    
+    // The mapping keeps the blob alive; the descriptor is no longer needed
+    close((int)fd);
+    resources->map = map;
+    resources->size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * @brief Unmap a blob mapped with resource_map_open()
+ * @param resources Mapping to release
+ */
+static inline void resource_map_close(resource_map_t *resources) {
+    if (resources->map) {
+        munmap((void *)resources->map, resources->size);
+        resources->map = NULL;
+        resources->size = 0;
+    }
+}
+
+#ifndef RESOURCE_FORMAT_ONLY
+#include "launcher.h"
+
+int resource_index_build(const bundle_probe_t *probe);
+int configure_resources(const bundle_probe_t *probe, env_builder_t *env);
+#endif
+
+#endif /* VLAUNCH_RESOURCE_H */
@@ -0,0 +1,607 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file sandbox.c
+ * @brief Namespace sandbox for launched bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Every sandbox has a mount namespace; "net" and "pid" add a network
+ * namespace with only the loopback interface up and a pid namespace
+ * with a fresh /proc. Mount propagation is made private first, so the
+ * read-only trees never show up outside the sandbox.
+ *
+ * A direct launch that asks for a pid namespace cannot exec into it, so
+ * the launcher stays the parent: it waits for the application and exits
+ * with its status. The application is the init of its namespace and
+ * only receives the signals it handles, so a second stop signal passed
+ * on is sent as SIGKILL.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/mount.h>
+#include <linux/sched.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "sandbox.h"
+
+/* Names accepted in --sandbox and the "sandbox" key of info.yaml */
+static const struct {
+    const char *name;
+    unsigned int features;
+} sandbox_names[] = {
+    { "none",  0             },
+    { "mount", SANDBOX_MOUNT },
+    { "net",   SANDBOX_NET   },
+    { "pid",   SANDBOX_PID   },
+};
+
+// Signals the launcher passes on while it waits in pid namespace mode
+static const int wait_signals[] = { SIGCHLD, SIGTERM, SIGINT, SIGHUP };
+
+static const char *sandbox_option;
+
+// Ids outside the user namespace, captured when the namespaces are made
+static int user_namespace;
+static uid_t outer_uid;
+static gid_t outer_gid;
+
+/**
+ * @brief Parse a list of sandbox features
+ * @param text Feature names separated by commas or blanks, not NUL-terminated
+ * @param length Length of text
+ * @param features Receives the SANDBOX_* flags; any feature implies SANDBOX_MOUNT
+ * @return 0 on success, -1 on an unknown name
+ */
+static int parse_features(const char *text, size_t length, unsigned int *features) {
+    size_t position = 0;
+    
+    *features = 0;
+    while (position < length) {
+        const char *name = text + position;
+        size_t size = 0;
+        size_t i;
+        
+        if (strchr(", \t", *name)) {
+            position++;
+            continue;
+        }
+        while (position + size < length && !strchr(", \t", name[size])) {
+            size++;
+        }
+        for (i = 0; i < sizeof(sandbox_names) / sizeof(sandbox_names[0]); i++) {
+            if (strlen(sandbox_names[i].name) == size && strncmp(sandbox_names[i].name, name, size) == 0) {
+                *features |= sandbox_names[i].features;
+                break;
+            }
+        }
+        if (i == sizeof(sandbox_names) / sizeof(sandbox_names[0])) {
+            return -1;
+        }
+        position += size;
+    }
+    
+    if (*features != 0) {
+        *features |= SANDBOX_MOUNT;
+    }
+    return 0;
+}
+
+/**
+ * @brief Set the sandbox features from the command line
+ * @param value Feature list, overriding info.yaml
+ * @return EXIT_SUCCESS, or EXIT_INVALID_ARGS on an unknown feature
+ */
+int sandbox_set_option(const char *value) {
+    unsigned int features;
+    
+    if (parse_features(value, strlen(value), &features) != 0) {
+        log_message(LOG_ERROR, "Invalid --sandbox value: %s", value);
+        return EXIT_INVALID_ARGS;
+    }
+    sandbox_option = value;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Resolve the sandbox a bundle runs in
+ * @param probe Opened bundle probe
+ * @param features Receives the SANDBOX_* flags, 0 for none
+ * @return EXIT_SUCCESS, or EXIT_BUNDLE_ERROR if info.yaml names an unknown feature
+ */
+int sandbox_features(const bundle_probe_t *probe, unsigned int *features) {
+    const metadata_value_t *declared = &probe->metadata.sandbox;
+    
+    if (sandbox_option) {
+        return parse_features(sandbox_option, strlen(sandbox_option), features) == 0 ? EXIT_SUCCESS
+                                                                                    : EXIT_INVALID_ARGS;
+    }
+    if (parse_features(declared->data, declared->length, features) != 0) {
+        log_message(LOG_ERROR, "Invalid info.yaml sandbox value: %.*s", (int)declared->length, declared->data);
+        return EXIT_BUNDLE_ERROR;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Clone a mount tree and make it read-only
+ * @param dirfd Directory path is relative to, or the tree itself
+ * @param path Path to clone, or "" to clone dirfd
+ * @return Descriptor of the detached tree, or -1 with errno set
+ */
+static int clone_tree(int dirfd, const char *path) {
+    struct mount_attr attr;
+    int flags = OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | AT_RECURSIVE;
+    int saved;
+    int fd;
+    
+    fd = (int)syscall(SYS_open_tree, dirfd, path, flags | (path[0] ? AT_SYMLINK_NOFOLLOW : AT_EMPTY_PATH));
+    if (fd < 0) {
+        return -1;
+    }
+    
+    memset(&attr, 0, sizeof(attr));
+    attr.attr_set = MOUNT_ATTR_RDONLY | MOUNT_ATTR_NOSUID | MOUNT_ATTR_NODEV;
+    if (syscall(SYS_mount_setattr, fd, "", AT_EMPTY_PATH | AT_RECURSIVE, &attr, sizeof(attr)) != 0) {
+        saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief List the bundle directories a sandbox makes read-only
+ * @param probe Opened bundle probe
+ * @param trees Receives the names; descriptors are left alone
+ */
+static void list_trees(const bundle_probe_t *probe, sandbox_trees_t *trees) {
+    static const bundle_component_t optional[] = { COMPONENT_LIBRARY, COMPONENT_RESOURCES };
+    const char *slash = strchr(probe->exec_path, '/');
+    size_t length = slash ? (size_t)(slash - probe->exec_path) : strlen(probe->exec_path);
+    
+    // The top-level entry holding the executable, normally exec/
+    trees->count = 0;
+    if (length > 0 && length < SANDBOX_NAME_LENGTH) {
+        memcpy(trees->names[0], probe->exec_path, length);
+        trees->names[0][length] = '\0';
+        trees->count = 1;
+    }
+    
+    for (size_t i = 0; i < sizeof(optional) / sizeof(optional[0]); i++) {
+        const char *name = bundle_component_paths[optional[i]];
+        
+        if (bundle_probe_is_directory(probe, optional[i]) &&
+            (trees->count == 0 || strcmp(trees->names[0], name) != 0)) {
+            snprintf(trees->names[trees->count], SANDBOX_NAME_LENGTH, "%s", name);
+            trees->count++;
+        }
+    }
+}
+
+/**
+ * @brief Make the read-only trees for a bundle's sandbox
+ * @param probe Opened bundle probe
+ * @param trees Receives the trees; release with sandbox_release()
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+int sandbox_prepare(const bundle_probe_t *probe, sandbox_trees_t *trees) {
+    unsigned int count;
+    
+    list_trees(probe, trees);
+    count = trees->count;
+    trees->count = 0;
+    trees->deferred = 0;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        int fd = clone_tree(probe->dirfd, trees->names[i]);
+        
+        if (fd < 0) {
+            int saved = errno;
+            
+            sandbox_release(trees);
+            
+            // Unprivileged callers may only clone mounts inside their own user namespace
+            if (saved == EPERM && geteuid() != 0) {
+                log_message(LOG_DEBUG, "Sandbox trees of %s are made at launch", probe->path);
+                trees->deferred = 1;
+                return EXIT_SUCCESS;
+            }
+            log_message(LOG_ERROR, "Failed to prepare sandbox for %s/%s: %s", probe->path, trees->names[i],
+                        strerror(saved));
+            return EXIT_SYSTEM_ERROR;
+        }
+        trees->fds[trees->count++] = fd;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Copy prepared trees for one launch
+ * @param source Trees from sandbox_prepare(), which stay detached for the next launch
+ * @param copy Receives the copies; release with sandbox_release()
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+int sandbox_copy(const sandbox_trees_t *source, sandbox_trees_t *copy) {
+    copy->count = 0;
+    copy->deferred = source->deferred;
+    
+    // An attached tree cannot be attached again, so each launch moves a clone
+    for (unsigned int i = 0; i < source->count; i++) {
+        int fd = clone_tree(source->fds[i], "");
+        
+        if (fd < 0) {
+            log_message(LOG_ERROR, "Failed to copy sandbox tree %s: %s", source->names[i], strerror(errno));
+            sandbox_release(copy);
+            return EXIT_SYSTEM_ERROR;
+        }
+        memcpy(copy->names[copy->count], source->names[i], SANDBOX_NAME_LENGTH);
+        copy->fds[copy->count++] = fd;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Close the trees of a sandbox
+ * @param trees Trees from sandbox_prepare() or sandbox_copy()
+ */
+void sandbox_release(sandbox_trees_t *trees) {
+    for (unsigned int i = 0; i < trees->count; i++) {
+        close(trees->fds[i]);
+    }
+    trees->count = 0;
+    trees->deferred = 0;
+}
+
+/**
+ * @brief Work out the namespaces for a set of features
+ * @param features SANDBOX_* flags
+ * @return CLONE_NEW* flags
+ */
+static int namespace_flags(unsigned int features) {
+    int flags = CLONE_NEWNS;
+    
+    if (features & SANDBOX_NET) {
+        flags |= CLONE_NEWNET;
+    }
+    if (features & SANDBOX_PID) {
+        flags |= CLONE_NEWPID;
+    }
+    
+    // Without root the other namespaces need one of their own to be created in
+    outer_uid = geteuid();
+    outer_gid = getegid();
+    user_namespace = outer_uid != 0;
+    if (user_namespace) {
+        flags |= CLONE_NEWUSER;
+    }
+    return flags;
+}
+
+/**
+ * @brief Start a child in the namespaces of a sandbox
+ * @param features SANDBOX_* flags
+ * @return Child pid in the parent, 0 in the child, -1 on failure, like fork()
+ */
+pid_t sandbox_clone(unsigned int features) {
+    struct clone_args args;
+    
+    memset(&args, 0, sizeof(args));
+    args.flags = (unsigned int)namespace_flags(features);
+    args.exit_signal = SIGCHLD;
+    return (pid_t)syscall(SYS_clone3, &args, sizeof(args));
+}
+
+/**
+ * @brief Write a short string to a file
+ * @param path File path
+ * @param text String to write
+ * @return 0 on success, -1 on failure
+ */
+static int write_file(const char *path, const char *text) {
+    size_t length = strlen(text);
+    ssize_t written;
+    int fd;
+    
+    fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    written = write(fd, text, length);
+    close(fd);
+    return written == (ssize_t)length ? 0 : -1;
+}
+
+/**
+ * @brief Map the caller's ids into its new user namespace
+ * @return 0 on success, -1 on failure
+ */
+static int map_user(void) {
+    char map[64];
+    
+    snprintf(map, sizeof(map), "%lu %lu 1\n", (unsigned long)outer_uid, (unsigned long)outer_uid);
+    if (write_file("/proc/self/uid_map", map) != 0) {
+        return -1;
+    }
+    
+    // The gid map can only be written once setgroups() is given up
+    if (write_file("/proc/self/setgroups", "deny") != 0 && errno != ENOENT) {
+        return -1;
+    }
+    snprintf(map, sizeof(map), "%lu %lu 1\n", (unsigned long)outer_gid, (unsigned long)outer_gid);
+    return write_file("/proc/self/gid_map", map);
+}
+
+/**
+ * @brief Bring up the loopback interface of a new network namespace
+ * @return 0 on success, -1 on failure
+ */
+static int loopback_up(void) {
+    struct ifreq request;
+    int result = -1;
+    int fd;
+    
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&request, 0, sizeof(request));
+    snprintf(request.ifr_name, sizeof(request.ifr_name), "lo");
+    if (ioctl(fd, SIOCGIFFLAGS, &request) == 0) {
+        request.ifr_flags |= IFF_UP;
+        result = ioctl(fd, SIOCSIFFLAGS, &request);
+    }
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief Set up a sandbox from inside its new namespaces
+ * @param probe Opened bundle probe
+ * @param trees Trees to attach, consumed by this call
+ * @param features SANDBOX_* flags the namespaces were made with
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+int sandbox_enter(const bundle_probe_t *probe, sandbox_trees_t *trees, unsigned int features) {
+    char target[MAX_PATH_LENGTH];
+    
+    if (user_namespace && map_user() != 0) {
+        log_message(LOG_ERROR, "Failed to map ids into the sandbox: %s", strerror(errno));
+        sandbox_release(trees);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Nothing mounted from here on may propagate to the outside
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+        log_message(LOG_ERROR, "Failed to make sandbox mounts private: %s", strerror(errno));
+        sandbox_release(trees);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // The bundle directory belongs to the old namespace, so trees are found by path
+    if (trees->deferred) {
+        unsigned int count;
+        
+        list_trees(probe, trees);
+        count = trees->count;
+        trees->count = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            if ((size_t)snprintf(target, sizeof(target), "%s/%s", probe->path, trees->names[i]) >= sizeof(target)) {
+                log_message(LOG_ERROR, "Bundle path too long to sandbox: %s", probe->path);
+                sandbox_release(trees);
+                return EXIT_BUNDLE_ERROR;
+            }
+            trees->fds[i] = clone_tree(AT_FDCWD, target);
+            if (trees->fds[i] < 0) {
+                log_message(LOG_ERROR, "Failed to prepare sandbox for %s: %s", target, strerror(errno));
+                sandbox_release(trees);
+                return EXIT_SYSTEM_ERROR;
+            }
+            trees->count++;
+        }
+    }
+    
+    for (unsigned int i = 0; i < trees->count; i++) {
+        if ((size_t)snprintf(target, sizeof(target), "%s/%s", probe->path, trees->names[i]) >= sizeof(target)) {
+            log_message(LOG_ERROR, "Bundle path too long to sandbox: %s", probe->path);
+            sandbox_release(trees);
+            return EXIT_BUNDLE_ERROR;
+        }
+        if (syscall(SYS_move_mount, trees->fds[i], "", AT_FDCWD, target, MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+            log_message(LOG_ERROR, "Failed to mount sandbox tree %s: %s", target, strerror(errno));
+            sandbox_release(trees);
+            return EXIT_SYSTEM_ERROR;
+        }
+    }
+    sandbox_release(trees);
+    
+    if ((features & SANDBOX_NET) && loopback_up() != 0) {
+        log_message(LOG_WARNING, "Failed to bring up loopback in the sandbox: %s", strerror(errno));
+    }
+    if ((features & SANDBOX_PID) &&
+        mount("proc", SANDBOX_PROC_PATH, "proc", MS_NOSUID | MS_NODEV | MS_NOEXEC, NULL) != 0) {
+        log_message(LOG_WARNING, "Failed to mount %s in the sandbox: %s", SANDBOX_PROC_PATH, strerror(errno));
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Give the current process mounts of its own, with no propagation either way
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR on failure
+ */
+int sandbox_private_mounts(void) {
+    if (unshare(CLONE_NEWNS) != 0) {
+        if (errno != EPERM) {
+            log_message(LOG_ERROR, "Failed to create a mount namespace: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        
+        // Outside a sandbox an unprivileged caller needs a user namespace first
+        namespace_flags(0);
+        user_namespace = 1;
+        if (unshare(CLONE_NEWNS | CLONE_NEWUSER) != 0 || map_user() != 0) {
+            log_message(LOG_ERROR, "Failed to create a mount namespace: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+    }
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+        log_message(LOG_ERROR, "Failed to make mounts private: %s", strerror(errno));
+        return EXIT_SYSTEM_ERROR;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Wait for the application in its pid namespace, passing stop signals on
+ * @param pid Application pid
+ * @param waited Signal set of wait_signals, blocked by the caller
+ * @return Exit status of the application in the manner of a shell
+ */
+static int wait_application(pid_t pid, const sigset_t *waited) {
+    siginfo_t info;
+    int forwarded = 0;
+    int status;
+    
+    for (;;) {
+        pid_t reaped = waitpid(pid, &status, WNOHANG);
+        
+        if (reaped == pid) {
+            return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+        if (reaped < 0 && errno != EINTR) {
+            log_message(LOG_ERROR, "Failed to wait for application: %s", strerror(errno));
+            return EXIT_SYSTEM_ERROR;
+        }
+        
+        // An init without a handler ignores the first one, so the second one kills
+        if (sigwaitinfo(waited, &info) > 0 && info.si_signo != SIGCHLD) {
+            kill(pid, forwarded++ ? SIGKILL : info.si_signo);
+        }
+    }
+}
+
+/**
+ * @brief Move the launch into a new pid namespace
+ *
+ * Unlike the other namespaces this cannot be entered with unshare(), so
+ * the launcher stays behind as a waiting parent for the application's
+ * lifetime, passing on signals.
+ *
+ * @param features SANDBOX_* flags
+ * @return EXIT_SUCCESS in the child; the parent exits with the application's status
+ */
+static int enter_pid_namespace(unsigned int features) {
+    sigset_t waited;
+    sigset_t original;
+    int status;
+    pid_t pid;
+    
+    sigemptyset(&waited);
+    for (size_t i = 0; i < sizeof(wait_signals) / sizeof(wait_signals[0]); i++) {
+        sigaddset(&waited, wait_signals[i]);
+    }
+    sigprocmask(SIG_BLOCK, &waited, &original);
+    
+    log_flush();
+    fflush(NULL);
+    pid = sandbox_clone(features);
+    if (pid < 0) {
+        log_message(LOG_ERROR, "Failed to create sandbox namespaces: %s", strerror(errno));
+        sigprocmask(SIG_SETMASK, &original, NULL);
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &original, NULL);
+        return EXIT_SUCCESS;
+    }
+    
+    log_message(LOG_DEBUG, "Sandboxed application is pid %ld", (long)pid);
+    status = wait_application(pid, &waited);
+    log_flush();
+    _exit(status);
+}
+
+/**
+ * @brief Move the current process into the sandbox its bundle asks for
+ * @param probe Validated bundle probe
+ * @return EXIT_SUCCESS in the process that goes on to exec, error code otherwise
+ */
+int sandbox_apply(const bundle_probe_t *probe) {
+    sandbox_trees_t trees;
+    unsigned int features;
+    int result;
+    
+    result = sandbox_features(probe, &features);
+    if (result != EXIT_SUCCESS || features == 0) {
+        return result;
+    }
+    
+    result = sandbox_prepare(probe, &trees);
+    if (result != EXIT_SUCCESS) {
+        return result;
+    }
+    
+    // Only a new process can be the first one in a pid namespace
+    if (features & SANDBOX_PID) {
+        result = enter_pid_namespace(features);
+    } else if (unshare(namespace_flags(features)) != 0) {
+        log_message(LOG_ERROR, "Failed to create sandbox namespaces: %s", strerror(errno));
+        result = EXIT_SYSTEM_ERROR;
+    }
+    
+    if (result != EXIT_SUCCESS) {
+        sandbox_release(&trees);
+        return result;
+    }
+    log_message(LOG_DEBUG, "Sandboxed %s", probe->path);
+    return sandbox_enter(probe, &trees, features);
+}
@@ -0,0 +1,95 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file sandbox.h
+ * @brief Namespace sandbox for launched bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A sandboxed application runs in its own mount namespace in which the
+ * bundle's executable directory, library/ and resources/ are read-only,
+ * and optionally in its own network namespace (loopback only) and pid
+ * namespace. Bundles ask for it with "sandbox: mount, net, pid" in
+ * info.yaml; --sandbox overrides that.
+ *
+ * The read-only directories are detached mount trees made with
+ * open_tree() and mount_setattr() ahead of time, which the daemon keeps
+ * with its resident bundles and copies for each launch. Starting a
+ * sandboxed application is one clone3() with the namespace flags, then
+ * one move_mount() per tree in the child; no helper process is involved.
+ * A pid namespace is the exception: the process that creates one stays
+ * outside it, so the launcher remains behind as the application's
+ * parent, waits for it and exits with its status.
+ * Without root, a user namespace mapping only the caller's ids is added,
+ * and the trees are made in the child, which is the first place the
+ * launcher may clone mounts.
+ */
+
+#ifndef VLAUNCH_SANDBOX_H
+#define VLAUNCH_SANDBOX_H
+
+#include <sys/types.h>
+
+#include "launcher.h"
+
+/* Sandbox Features */
+#define SANDBOX_MOUNT       0x1
+#define SANDBOX_NET         0x2
+#define SANDBOX_PID         0x4
+
+/* Sandbox Configuration */
+#define SANDBOX_MAX_TREES   3
+#define SANDBOX_NAME_LENGTH 256
+#define SANDBOX_PROC_PATH   "/proc"
+
+/* Read-only copies of bundle directories, not yet attached anywhere */
+typedef struct {
+    int fds[SANDBOX_MAX_TREES];
+    char names[SANDBOX_MAX_TREES][SANDBOX_NAME_LENGTH];  // Where each goes, relative to the bundle
+    unsigned int count;
+    int deferred;  // Cloning needs privilege; the child makes the trees itself
+} sandbox_trees_t;
+
+int sandbox_set_option(const char *value);
+int sandbox_features(const bundle_probe_t *probe, unsigned int *features);
+int sandbox_prepare(const bundle_probe_t *probe, sandbox_trees_t *trees);
+int sandbox_copy(const sandbox_trees_t *source, sandbox_trees_t *copy);
+void sandbox_release(sandbox_trees_t *trees);
+pid_t sandbox_clone(unsigned int features);
+int sandbox_enter(const bundle_probe_t *probe, sandbox_trees_t *trees, unsigned int features);
+int sandbox_private_mounts(void);
+int sandbox_apply(const bundle_probe_t *probe);
+
+#endif /* VLAUNCH_SANDBOX_H */
@@ -0,0 +1,344 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file sha256.c
+ * @brief SHA-256 message digest
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_SHANI 1
+#endif
+
+#include "sha256.h"
+
+/* Buffer size for hashing a file */
+#define SHA256_READ_CHUNK   (64 * 1024)
+
+/* First 32 bits of the fractional parts of the cube roots of the first 64 primes */
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * @brief Rotate a word right
+ * @param value Word to rotate
+ * @param count Bits to rotate by
+ * @return Rotated word
+ */
+static inline uint32_t rotate_right(uint32_t value, unsigned count) {
+    return (value >> count) | (value << (32 - count));
+}
+
+/**
+ * @brief Mix one 64-byte block into the state
+ * @param ctx Digest state
+ * @param block Block to process
+ */
+static void sha256_block(sha256_t *ctx, const uint8_t *block) {
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+               (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    
+    a = ctx->state[0];
+    b = ctx->state[1];
+    c = ctx->state[2];
+    d = ctx->state[3];
+    e = ctx->state[4];
+    f = ctx->state[5];
+    g = ctx->state[6];
+    h = ctx->state[7];
+    
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + choice + sha256_k[i] + w[i];
+        uint32_t s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + majority;
+        
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+    ctx->state[5] += f;
+    ctx->state[6] += g;
+    ctx->state[7] += h;
+}
+
+#ifdef SHA256_SHANI
+/**
+ * @brief Mix consecutive 64-byte blocks into the state with the x86 SHA extensions
+ * @param ctx Digest state
+ * @param data Blocks to process
+ * @param count Number of blocks
+ *
+ * The instructions keep the state as ABEF and CDGH halves and run two
+ * rounds each; sha256msg1/2 extend the schedule four words at a time.
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(sha256_t *ctx, const uint8_t *data, size_t count) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i dcba = _mm_loadu_si128((const __m128i *)&ctx->state[0]);
+    __m128i hgfe = _mm_loadu_si128((const __m128i *)&ctx->state[4]);
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+    
+    for (; count > 0; count--, data += 64) {
+        __m128i abef_start = abef;
+        __m128i cdgh_start = cdgh;
+        __m128i w[4];
+        
+        for (int i = 0; i < 4; i++) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + i * 16)), byte_swap);
+        }
+        
+        // w[i & 3] holds words 4i..4i+3, replacing the group four back
+        for (int i = 0; i < 16; i++) {
+            __m128i k;
+            
+            if (i >= 4) {
+                __m128i next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+            }
+            k = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&sha256_k[i * 4]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, k);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(k, 0x0e));
+        }
+        
+        abef = _mm_add_epi32(abef, abef_start);
+        cdgh = _mm_add_epi32(cdgh, cdgh_start);
+    }
+    
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128((__m128i *)&ctx->state[0], _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128((__m128i *)&ctx->state[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/**
+ * @brief Check whether the CPU has the SHA extensions and the SSE levels they are used with
+ * @return Non-zero if sha256_blocks_shani() can run
+ */
+static int sha256_shani_supported(void) {
+    unsigned int eax, ebx, ecx, edx;
+    
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1)) {
+        return 0;
+    }
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+}
+#endif
+
+/**
+ * @brief Mix consecutive 64-byte blocks into the state
+ * @param ctx Digest state
+ * @param data Blocks to process
+ * @param count Number of blocks
+ */
+static void sha256_blocks(sha256_t *ctx, const uint8_t *data, size_t count) {
+#ifdef SHA256_SHANI
+    static int accelerated = -1;
+    int usable = __atomic_load_n(&accelerated, __ATOMIC_RELAXED);
+    
+    // Checked once; concurrent first callers reach the same answer
+    if (usable < 0) {
+        usable = sha256_shani_supported();
+        __atomic_store_n(&accelerated, usable, __ATOMIC_RELAXED);
+    }
+    if (usable) {
+        sha256_blocks_shani(ctx, data, count);
+        return;
+    }
+#endif
+    for (; count > 0; count--, data += 64) {
+        sha256_block(ctx, data);
+    }
+}
+
+/**
+ * @brief Start a new digest
+ * @param ctx Digest state
+ */
+void sha256_init(sha256_t *ctx) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+/**
+ * @brief Add data to a digest
+ * @param ctx Digest state
+ * @param data Bytes to add
+ * @param size Number of bytes
+ */
+void sha256_update(sha256_t *ctx, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    
+    ctx->length += size;
+    
+    if (ctx->used > 0) {
+        size_t take = sizeof(ctx->block) - ctx->used < size ? sizeof(ctx->block) - ctx->used : size;
+        memcpy(ctx->block + ctx->used, bytes, take);
+        ctx->used += take;
+        bytes += take;
+        size -= take;
+        if (ctx->used < sizeof(ctx->block)) {
+            return;
+        }
+        sha256_blocks(ctx, ctx->block, 1);
+        ctx->used = 0;
+    }
+    
+    if (size >= sizeof(ctx->block)) {
+        size_t blocks = size / sizeof(ctx->block);
+        sha256_blocks(ctx, bytes, blocks);
+        bytes += blocks * sizeof(ctx->block);
+        size -= blocks * sizeof(ctx->block);
+    }
+    
+    memcpy(ctx->block, bytes, size);
+    ctx->used = size;
+}
+
+/**
+ * @brief Finish a digest
+ * @param ctx Digest state; must be initialized again before reuse
+ * @param digest Receives the digest
+ */
+void sha256_final(sha256_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bits = ctx->length * 8;
+    
+    ctx->block[ctx->used++] = 0x80;
+    if (ctx->used > 56) {
+        memset(ctx->block + ctx->used, 0, sizeof(ctx->block) - ctx->used);
+        sha256_blocks(ctx, ctx->block, 1);
+        ctx->used = 0;
+    }
+    memset(ctx->block + ctx->used, 0, 56 - ctx->used);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (uint8_t)(bits >> (56 - i * 8));
+    }
+    sha256_blocks(ctx, ctx->block, 1);
+    
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+/**
+ * @brief Format a digest as lowercase hex
+ * @param digest Digest to format
+ * @param hex Receives the NUL-terminated hex string
+ */
+void sha256_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char hex[SHA256_HEX_SIZE]) {
+    static const char digits[] = "0123456789abcdef";
+    
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0xf];
+    }
+    hex[SHA256_DIGEST_SIZE * 2] = '\0';
+}
+
+/**
+ * @brief Digest the rest of a file from its current offset
+ * @param fd File to read
+ * @param digest Receives the digest
+ * @return 0 on success, -1 on read failure with errno set
+ */
+int sha256_fd(int fd, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint8_t buffer[SHA256_READ_CHUNK];
+    sha256_t ctx;
+    ssize_t n;
+    
+    sha256_init(&ctx);
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        sha256_update(&ctx, buffer, (size_t)n);
+    }
+    sha256_final(&ctx, digest);
+    return 0;
+}
@@ -0,0 +1,364 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file stats.c
+ * @brief Resource accounting of supervised and daemon-launched applications
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Totals are updated under an exclusive flock() on the bundle's entry,
+ * since a supervisor and a daemon may report runs of the same bundle at
+ * once. Entries are keyed on the canonical bundle path.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "launcher.h"
+#include "cache.h"
+#include "trace.h"
+#include "stats.h"
+
+/* A bundle's totals as printed by --stats */
+typedef struct {
+    stats_entry_t entry;
+    char path[MAX_PATH_LENGTH];
+} stats_row_t;
+
+/**
+ * @brief Convert a timeval to microseconds
+ * @param tv Time value
+ * @return Microseconds
+ */
+static uint64_t timeval_us(const struct timeval *tv) {
+    return (uint64_t)tv->tv_sec * 1000000ULL + (uint64_t)tv->tv_usec;
+}
+
+/**
+ * @brief Read the storage I/O of a process
+ * @param pid Process, which may be a zombie
+ * @param usage Receives read_bytes and write_bytes
+ * @return 0 on success, -1 if /proc/<pid>/io cannot be read
+ */
+static int read_process_io(pid_t pid, stats_usage_t *usage) {
+    char path[64];
+    char line[128];
+    unsigned long long value;
+    FILE *file;
+    
+    snprintf(path, sizeof(path), "/proc/%ld/io", (long)pid);
+    file = fopen(path, "re");
+    if (file == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "read_bytes: %llu", &value) == 1) {
+            usage->read_bytes = value;
+        } else if (sscanf(line, "write_bytes: %llu", &value) == 1) {
+            usage->write_bytes = value;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Reap an exited child and collect what it used
+ * @param pid Child that has exited but not been waited for (see WNOWAIT)
+ * @param status Receives the wait status
+ * @param usage Receives the resource use; wall_ms is left to the caller
+ * @return 0 on success, -1 if the child could not be reaped
+ */
+int stats_reap(pid_t pid, int *status, stats_usage_t *usage) {
+    struct rusage rusage;
+    pid_t reaped;
+    int have_io;
+    
+    memset(usage, 0, sizeof(*usage));
+    
+    // /proc/<pid>/io is gone once the zombie is reaped
+    have_io = read_process_io(pid, usage) == 0;
+    do {
+        reaped = wait4(pid, status, 0, &rusage);
+    } while (reaped < 0 && errno == EINTR);
+    if (reaped != pid) {
+        return -1;
+    }
+    
+    usage->user_us = timeval_us(&rusage.ru_utime);
+    usage->system_us = timeval_us(&rusage.ru_stime);
+    usage->max_rss_kb = (uint64_t)rusage.ru_maxrss;
+    usage->minor_faults = (uint64_t)rusage.ru_minflt;
+    usage->major_faults = (uint64_t)rusage.ru_majflt;
+    if (!have_io) {
+        // Block counts are in 512-byte units and miss I/O of other kinds
+        usage->read_bytes = (uint64_t)rusage.ru_inblock * 512;
+        usage->write_bytes = (uint64_t)rusage.ru_oublock * 512;
+    }
+    return 0;
+}
+
+/**
+ * @brief Add one run to the stored totals of a bundle
+ * @param bundle_path Canonical bundle path
+ * @param failed Non-zero if the run did not exit cleanly
+ * @param usage Resource use of the run
+ */
+static void store_usage(const char *bundle_path, int failed, const stats_usage_t *usage) {
+    char entry_path[MAX_PATH_LENGTH];
+    char stored_path[MAX_PATH_LENGTH];
+    size_t path_length = strlen(bundle_path);
+    const uint64_t *run = (const uint64_t *)usage;
+    struct timespec now;
+    stats_entry_t entry;
+    uint64_t *total;
+    uint64_t *peak;
+    int fd;
+    
+    if (cache_entry_path(STATS_CACHE_DIR, bundle_path, entry_path, sizeof(entry_path)) != EXIT_SUCCESS) {
+        return;
+    }
+    fd = open(entry_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+        log_message(LOG_DEBUG, "Cannot update stats of %s: %s", bundle_path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    
+    // Entries that are new, of another format or another path start over
+    if (pread(fd, &entry, sizeof(entry), 0) != (ssize_t)sizeof(entry) ||
+        entry.magic != STATS_MAGIC || entry.version != STATS_VERSION || entry.path_length != path_length ||
+        pread(fd, stored_path, path_length, sizeof(entry)) != (ssize_t)path_length ||
+        memcmp(stored_path, bundle_path, path_length) != 0) {
+        memset(&entry, 0, sizeof(entry));
+        entry.magic = STATS_MAGIC;
+        entry.version = STATS_VERSION;
+        entry.path_length = (uint32_t)path_length;
+    }
+    
+    // Every field of stats_usage_t is a counter, so the totals are summed field by field
+    total = (uint64_t *)&entry.total;
+    peak = (uint64_t *)&entry.peak;
+    for (size_t i = 0; i < sizeof(*usage) / sizeof(uint64_t); i++) {
+        total[i] += run[i];
+        if (run[i] > peak[i]) {
+            peak[i] = run[i];
+        }
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    entry.runs++;
+    entry.failures += failed != 0;
+    entry.last_ms = (uint64_t)now.tv_sec * 1000ULL + (uint64_t)now.tv_nsec / 1000000ULL;
+    
+    if (pwrite(fd, &entry, sizeof(entry), 0) != (ssize_t)sizeof(entry) ||
+        pwrite(fd, bundle_path, path_length, sizeof(entry)) != (ssize_t)path_length) {
+        log_message(LOG_DEBUG, "Cannot update stats of %s: %s", bundle_path, strerror(errno));
+    }
+    close(fd);
+}
+
+/**
+ * @brief Log, trace and store the resource use of a finished run
+ * @param bundle_path Bundle the run was of
+ * @param pid Process the run was
+ * @param status Wait status of the run
+ * @param usage Resource use of the run
+ */
+void stats_report(const char *bundle_path, pid_t pid, int status, const stats_usage_t *usage) {
+    char canonical[MAX_PATH_LENGTH];
+    char record[MAX_PATH_LENGTH * 2 + 512];
+    int exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    size_t used;
+    
+    if (realpath(bundle_path, canonical) == NULL) {
+        snprintf(canonical, sizeof(canonical), "%s", bundle_path);
+    }
+    
+    log_message(LOG_INFO, "Usage of %s (pid %ld, status %d): %llu ms CPU, %llu KB peak RSS, "
+                "%llu major and %llu minor faults, %llu KB read, %llu KB written in %llu ms",
+                canonical, (long)pid, exit_code,
+                (unsigned long long)((usage->user_us + usage->system_us) / 1000),
+                (unsigned long long)usage->max_rss_kb,
+                (unsigned long long)usage->major_faults, (unsigned long long)usage->minor_faults,
+                (unsigned long long)(usage->read_bytes / 1024), (unsigned long long)(usage->write_bytes / 1024),
+                (unsigned long long)usage->wall_ms);
+    
+    memcpy(record, "{\"bundle\":\"", 11);
+    used = trace_append_json_string(record, 11, sizeof(record), canonical);
+    used += (size_t)snprintf(record + used, sizeof(record) - used,
+                             "\",\"pid\":%ld,\"status\":%d,\"usage\":{\"user_us\":%llu,\"system_us\":%llu,"
+                             "\"wall_ms\":%llu,\"max_rss_kb\":%llu,\"minor_faults\":%llu,\"major_faults\":%llu,"
+                             "\"read_bytes\":%llu,\"write_bytes\":%llu}}\n",
+                             (long)pid, exit_code,
+                             (unsigned long long)usage->user_us, (unsigned long long)usage->system_us,
+                             (unsigned long long)usage->wall_ms, (unsigned long long)usage->max_rss_kb,
+                             (unsigned long long)usage->minor_faults, (unsigned long long)usage->major_faults,
+                             (unsigned long long)usage->read_bytes, (unsigned long long)usage->write_bytes);
+    if (used < sizeof(record)) {
+        trace_write(record, used);
+    }
+    
+    store_usage(canonical, exit_code != 0, usage);
+}
+
+/**
+ * @brief Read the stored totals of a bundle
+ * @param fd Open entry file
+ * @param row Receives the totals and the bundle path
+ * @return 0 on success, -1 if the entry is not valid
+ */
+static int load_row(int fd, stats_row_t *row) {
+    if (flock(fd, LOCK_SH) != 0) {
+        return -1;
+    }
+    
+    if (pread(fd, &row->entry, sizeof(row->entry), 0) != (ssize_t)sizeof(row->entry) ||
+        row->entry.magic != STATS_MAGIC || row->entry.version != STATS_VERSION ||
+        row->entry.path_length >= sizeof(row->path) || row->entry.runs == 0 ||
+        pread(fd, row->path, row->entry.path_length, sizeof(row->entry)) != (ssize_t)row->entry.path_length) {
+        flock(fd, LOCK_UN);
+        return -1;
+    }
+    row->path[row->entry.path_length] = '\0';
+    flock(fd, LOCK_UN);
+    return 0;
+}
+
+/**
+ * @brief Order rows by descending number of runs
+ * @param a First row
+ * @param b Second row
+ * @return Comparison result
+ */
+static int compare_rows(const void *a, const void *b) {
+    uint64_t x = ((const stats_row_t *)a)->entry.runs;
+    uint64_t y = ((const stats_row_t *)b)->entry.runs;
+    
+    return (x < y) - (x > y);
+}
+
+/**
+ * @brief Print the stored totals of some or all bundles
+ * @param bundle_paths Bundles to print, or NULL for every bundle with stats
+ * @param count Number of bundle paths
+ * @return EXIT_SUCCESS on success, error code on failure
+ */
+int stats_print(char *const *bundle_paths, unsigned int count) {
+    char directory[MAX_PATH_LENGTH];
+    stats_row_t *rows;
+    unsigned int row_count = 0;
+    
+    if (cache_directory(STATS_CACHE_DIR, directory, sizeof(directory)) != EXIT_SUCCESS) {
+        log_message(LOG_ERROR, "Cannot find the stats directory");
+        return EXIT_SYSTEM_ERROR;
+    }
+    rows = malloc(STATS_MAX_BUNDLES * sizeof(*rows));
+    if (rows == NULL) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (bundle_paths != NULL) {
+        for (unsigned int i = 0; i < count && row_count < STATS_MAX_BUNDLES; i++) {
+            char canonical[MAX_PATH_LENGTH];
+            char entry_path[MAX_PATH_LENGTH];
+            int fd;
+            
+            if (realpath(bundle_paths[i], canonical) == NULL ||
+                cache_entry_path(STATS_CACHE_DIR, canonical, entry_path, sizeof(entry_path)) != EXIT_SUCCESS ||
+                (fd = open(entry_path, O_RDONLY | O_CLOEXEC)) < 0) {
+                log_message(LOG_WARNING, "No stats recorded for %s", bundle_paths[i]);
+                continue;
+            }
+            if (load_row(fd, &rows[row_count]) == 0 && strcmp(rows[row_count].path, canonical) == 0) {
+                row_count++;
+            }
+            close(fd);
+        }
+    } else {
+        int dirfd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        DIR *dir = dirfd >= 0 ? fdopendir(dirfd) : NULL;
+        struct dirent *entry;
+        
+        while (dir != NULL && (entry = readdir(dir)) != NULL && row_count < STATS_MAX_BUNDLES) {
+            int fd = entry->d_name[0] == '.' ? -1 : openat(dirfd, entry->d_name, O_RDONLY | O_CLOEXEC);
+            
+            if (fd >= 0) {
+                row_count += load_row(fd, &rows[row_count]) == 0;
+                close(fd);
+            }
+        }
+        if (dir != NULL) {
+            closedir(dir);
+        } else if (dirfd >= 0) {
+            close(dirfd);
+        }
+    }
+    
+    // Averages are per run; RSS is the peak of any run
+    qsort(rows, row_count, sizeof(*rows), compare_rows);
+    printf("%-40s %6s %6s %9s %10s %8s %9s %10s %10s %9s\n", "BUNDLE", "RUNS", "FAILED", "CPU ms",
+           "PEAK RSS K", "MAJFLT", "MINFLT", "READ KB", "WRITE KB", "WALL ms");
+    for (unsigned int i = 0; i < row_count; i++) {
+        const stats_entry_t *entry = &rows[i].entry;
+        uint64_t runs = entry->runs;
+        
+        printf("%-40s %6llu %6llu %9llu %10llu %8llu %9llu %10llu %10llu %9llu\n", rows[i].path,
+               (unsigned long long)runs, (unsigned long long)entry->failures,
+               (unsigned long long)((entry->total.user_us + entry->total.system_us) / 1000 / runs),
+               (unsigned long long)entry->peak.max_rss_kb,
+               (unsigned long long)(entry->total.major_faults / runs),
+               (unsigned long long)(entry->total.minor_faults / runs),
+               (unsigned long long)(entry->total.read_bytes / 1024 / runs),
+               (unsigned long long)(entry->total.write_bytes / 1024 / runs),
+               (unsigned long long)(entry->total.wall_ms / runs));
+    }
+    
+    free(rows);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file stats.h
+ * @brief Resource accounting of supervised and daemon-launched applications
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * When an application the launcher is a parent of exits, its storage
+ * I/O is read from /proc/<pid>/io while it is still a zombie, then it
+ * is reaped with wait4() for CPU time, faults and peak RSS. Each report
+ * is logged, written to the trace target as a JSON record, and added to
+ * a per-bundle total under $XDG_CACHE_HOME/vlaunch/stats that --stats
+ * prints.
+ */
+
+#ifndef VLAUNCH_STATS_H
+#define VLAUNCH_STATS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "launcher.h"
+
+/* Stats Configuration */
+#define STATS_CACHE_DIR     "stats"
+#define STATS_MAGIC         0x53534c56u /* "VLSS" */
+#define STATS_VERSION       1
+#define STATS_MAX_BUNDLES   1024
+
+/* Resource use of one run, or the sum or maximum of several */
+typedef struct {
+    uint64_t user_us;
+    uint64_t system_us;
+    uint64_t wall_ms;
+    uint64_t max_rss_kb;
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t read_bytes;                // Storage I/O, not page cache hits
+    uint64_t write_bytes;
+} stats_usage_t;
+
+/* Per-bundle totals, followed by the bundle path */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t path_length;
+    uint32_t reserved;
+    uint64_t runs;
+    uint64_t failures;                  // Runs that did not exit with status 0
+    uint64_t last_ms;                   // Wall clock of the last exit
+    stats_usage_t total;
+    stats_usage_t peak;
+} stats_entry_t;
+
+int stats_reap(pid_t pid, int *status, stats_usage_t *usage);
+void stats_report(const char *bundle_path, pid_t pid, int status, const stats_usage_t *usage);
+int stats_print(char *const *bundle_paths, unsigned int count);
+
+#endif /* VLAUNCH_STATS_H */
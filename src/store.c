@@ -0,0 +1,367 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file store.c
+ * @brief Content-addressed shared library store
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Store objects are named by the lowercase hex SHA-256 of their contents.
+ * Hard links only work within one filesystem, so the store is picked per
+ * library directory: $VLAUNCH_LIBRARY_STORE if set, the launcher cache if
+ * it shares a filesystem with the bundle, otherwise a .vlaunch-store
+ * directory next to the bundle, shared by everything installed there.
+ *
+ * Shared objects lose their write bits so no bundle can modify a file
+ * other bundles map; updating a library means replacing the file, which
+ * only unshares that bundle's copy. An existing object is hashed again
+ * before a bundle is linked to it, and every link is made from the
+ * descriptor that was hashed, never by name. Objects no bundle links to
+ * any more (a link count of one) are pruned after each sharing pass.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "launcher.h"
+#include "cache.h"
+#include "sha256.h"
+#include "store.h"
+
+/* Outcome of sharing one library directory */
+typedef struct {
+    unsigned files;
+    unsigned shared;
+    unsigned added;
+    unsigned pruned;
+    uint64_t reclaimed;
+} store_stats_t;
+
+/**
+ * @brief Give an open file a new name, so the inode linked is the one that was checked
+ * @param fd Open regular file
+ * @param dirfd Directory to create the name in
+ * @param name New name
+ * @return 0 on success, -1 with errno set on failure
+ */
+static int link_descriptor(int fd, int dirfd, const char *name) {
+    char path[32];
+    
+    // AT_EMPTY_PATH needs CAP_DAC_READ_SEARCH; /proc resolves the same inode without it
+    if (linkat(fd, "", dirfd, name, AT_EMPTY_PATH) == 0) {
+        return 0;
+    }
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    return linkat(AT_FDCWD, path, dirfd, name, AT_SYMLINK_FOLLOW);
+}
+
+/**
+ * @brief Open a store object if its contents still hash to its name
+ * @param storefd Store directory
+ * @param hex Object name
+ * @param digest Digest the contents must have
+ * @param object Receives the object's status
+ * @return Descriptor of the object, -1 with errno ENOENT if there is none, or -1 with another errno if it does not match
+ */
+static int open_object(int storefd, const char *hex, const uint8_t digest[SHA256_DIGEST_SIZE], struct stat *object) {
+    uint8_t actual[SHA256_DIGEST_SIZE];
+    int fd;
+    
+    fd = openat(storefd, hex, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            errno = EINVAL;
+        }
+        return -1;
+    }
+    if (fstat(fd, object) != 0 || !S_ISREG(object->st_mode) || sha256_fd(fd, actual) != 0 ||
+        memcmp(actual, digest, SHA256_DIGEST_SIZE) != 0) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Use a store directory if it is on the library's filesystem
+ * @param path Store directory, created if missing
+ * @param library Stat of the library directory
+ * @return 1 if the store can hold links to the library's files, 0 otherwise
+ */
+static int store_usable(const char *path, const struct stat *library) {
+    struct stat st;
+    
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return 0;
+    }
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode) && st.st_dev == library->st_dev;
+}
+
+/**
+ * @brief Pick the store directory for a library directory
+ * @param library_path Library directory being shared
+ * @param library Stat of the library directory
+ * @param out Destination buffer
+ * @param size Size of destination buffer
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR if no store is usable
+ */
+static int store_locate(const char *library_path, const struct stat *library, char *out, size_t size) {
+    const char *configured = getenv(STORE_ENV);
+    char resolved[MAX_PATH_LENGTH];
+    char *slash;
+    
+    if (configured && configured[0] == '/') {
+        if (snprintf(out, size, "%s", configured) < (int)size && store_usable(out, library)) {
+            return EXIT_SUCCESS;
+        }
+        log_message(LOG_WARNING, "%s=%s is not usable for %s", STORE_ENV, configured, library_path);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    if (cache_directory(STORE_CACHE_DIR, out, size) == EXIT_SUCCESS && store_usable(out, library)) {
+        return EXIT_SUCCESS;
+    }
+    
+    // <install dir>/<bundle>/library -> <install dir>/.vlaunch-store
+    if (!realpath(library_path, resolved)) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    for (int i = 0; i < 2; i++) {
+        slash = strrchr(resolved, '/');
+        if (!slash || slash == resolved) {
+            return EXIT_SYSTEM_ERROR;
+        }
+        *slash = '\0';
+    }
+    if (snprintf(out, size, "%s/%s", resolved, STORE_LOCAL_DIR) < (int)size && store_usable(out, library)) {
+        return EXIT_SUCCESS;
+    }
+    return EXIT_SYSTEM_ERROR;
+}
+
+/**
+ * @brief Link one library file with its store object
+ * @param libfd Library directory
+ * @param name File name inside the library directory
+ * @param storefd Store directory
+ * @param stats Counters to update
+ */
+static void share_file(int libfd, const char *name, int storefd, store_stats_t *stats) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    char hex[SHA256_HEX_SIZE];
+    char temp[64];
+    struct stat st;
+    struct stat object;
+    struct stat current;
+    mode_t mode;
+    int objfd;
+    int fd;
+    
+    fd = openat(libfd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return;
+    }
+    stats->files++;
+    
+    if (sha256_fd(fd, digest) != 0) {
+        log_message(LOG_WARNING, "Cannot read library %s: %s", name, strerror(errno));
+        close(fd);
+        return;
+    }
+    sha256_hex(digest, hex);
+    mode = st.st_mode & 07555;
+    
+    // Second pass only runs if another installer created the object meanwhile
+    for (int attempt = 0; attempt < 2; attempt++) {
+        objfd = open_object(storefd, hex, digest, &object);
+        if (objfd >= 0) {
+            if (object.st_dev == st.st_dev && object.st_ino == st.st_ino) {
+                stats->shared++;
+                close(objfd);
+                break;
+            }
+            if (object.st_size != st.st_size || (object.st_mode & 07777) != mode) {
+                log_message(LOG_DEBUG, "Store object %s does not match %s, keeping own copy", hex, name);
+                close(objfd);
+                break;
+            }
+            
+            // Swap the file for the store object in one step so the bundle never lacks it,
+            // unless the name was given to another file since it was hashed
+            snprintf(temp, sizeof(temp), ".store.%ld", (long)getpid());
+            unlinkat(libfd, temp, 0);
+            if (link_descriptor(objfd, libfd, temp) != 0) {
+                log_message(LOG_DEBUG, "Cannot link store object %s: %s", hex, strerror(errno));
+                close(objfd);
+                break;
+            }
+            close(objfd);
+            if (fstatat(libfd, name, &current, AT_SYMLINK_NOFOLLOW) != 0 ||
+                current.st_dev != st.st_dev || current.st_ino != st.st_ino) {
+                log_message(LOG_DEBUG, "Library %s changed while it was shared, keeping it", name);
+                unlinkat(libfd, temp, 0);
+                break;
+            }
+            if (renameat(libfd, temp, libfd, name) != 0) {
+                log_message(LOG_WARNING, "Cannot replace library %s: %s", name, strerror(errno));
+                unlinkat(libfd, temp, 0);
+                break;
+            }
+            stats->shared++;
+            stats->reclaimed += (uint64_t)st.st_blocks * 512;
+            break;
+        }
+        if (errno != ENOENT) {
+            log_message(LOG_DEBUG, "Store object %s does not hash to its name, keeping own copy of %s", hex, name);
+            break;
+        }
+        
+        // First copy of this content: the hashed file itself becomes the store object
+        if (fchmod(fd, mode) != 0) {
+            log_message(LOG_WARNING, "Cannot make %s read-only: %s", name, strerror(errno));
+        }
+        if (link_descriptor(fd, storefd, hex) == 0) {
+            stats->added++;
+            break;
+        }
+        if (errno != EEXIST) {
+            log_message(LOG_DEBUG, "Cannot add %s to the library store: %s", name, strerror(errno));
+            break;
+        }
+    }
+    
+    close(fd);
+}
+
+/**
+ * @brief Remove store objects that no bundle links to any more
+ * @param storefd Store directory
+ * @param stats Counters to update
+ */
+static void prune_objects(int storefd, store_stats_t *stats) {
+    struct dirent *entry;
+    struct stat object;
+    DIR *dir;
+    int fd;
+    
+    fd = openat(storefd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (dir == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    
+    // An installer that picks an object up as it goes fails to link it and keeps its own copy
+    while ((entry = readdir(dir)) != NULL) {
+        if (strlen(entry->d_name) != SHA256_HEX_SIZE - 1 ||
+            strspn(entry->d_name, "0123456789abcdef") != SHA256_HEX_SIZE - 1) {
+            continue;
+        }
+        if (fstatat(dirfd(dir), entry->d_name, &object, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(object.st_mode) &&
+            object.st_nlink == 1 && unlinkat(dirfd(dir), entry->d_name, 0) == 0) {
+            stats->pruned++;
+            stats->reclaimed += (uint64_t)object.st_blocks * 512;
+        }
+    }
+    
+    closedir(dir);
+}
+
+/**
+ * @brief Share the regular files of a library directory through the store
+ * @param library_path Library directory of a bundle
+ * @return EXIT_SUCCESS on success, EXIT_SYSTEM_ERROR if no store is usable
+ */
+int store_share_libraries(const char *library_path) {
+    char store_path[MAX_PATH_LENGTH];
+    store_stats_t stats = { 0, 0, 0, 0, 0 };
+    struct dirent *entry;
+    struct stat library;
+    int storefd;
+    DIR *dir;
+    
+    if (stat(library_path, &library) != 0 || !S_ISDIR(library.st_mode)) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    if (store_locate(library_path, &library, store_path, sizeof(store_path)) != EXIT_SUCCESS) {
+        log_message(LOG_WARNING, "No library store on the filesystem of %s", library_path);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    storefd = open(store_path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    dir = opendir(library_path);
+    if (storefd < 0 || !dir) {
+        log_message(LOG_WARNING, "Cannot open library store %s: %s", store_path, strerror(errno));
+        if (storefd >= 0) {
+            close(storefd);
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Dot files are launcher state such as the ld-index, not libraries
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)) {
+            continue;
+        }
+        share_file(dirfd(dir), entry->d_name, storefd, &stats);
+    }
+    
+    closedir(dir);
+    prune_objects(storefd, &stats);
+    close(storefd);
+    
+    log_message(LOG_INFO, "Library store %s: %u of %u libraries shared, %u added, %u pruned, %llu KiB reclaimed",
+                store_path, stats.shared, stats.files, stats.added, stats.pruned,
+                (unsigned long long)(stats.reclaimed / 1024));
+    return EXIT_SUCCESS;
+}
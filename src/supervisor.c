@@ -0,0 +1,458 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file supervisor.c
+ * @brief Supervised launches with restart on failure
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The application is started with clone(CLONE_VM | CLONE_VFORK): the
+ * child runs on a small static stack in the supervisor's memory until
+ * execve(), so no page tables are copied however large the supervisor
+ * is. The kernel hands back a pidfd the supervisor waits on, which also
+ * makes forwarding a stop signal immune to pid reuse.
+ *
+ * A failure within SUPERVISOR_STABLE_MS of the start counts towards a
+ * crash loop: restarts back off exponentially from
+ * SUPERVISOR_BACKOFF_MIN_MS and the supervisor gives up after
+ * SUPERVISOR_MAX_FAILURES in a row. A clean exit ends supervision, and
+ * SIGTERM, SIGINT or SIGHUP are passed on to the application, which is
+ * then not restarted.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "trace.h"
+#include "history.h"
+#include "prefetch.h"
+#include "placement.h"
+#include "resource.h"
+#include "environment.h"
+#include "handoff.h"
+#include "supervisor.h"
+#include "stats.h"
+#include "sandbox.h"
+#include "lazy.h"
+
+#ifndef CLONE_PIDFD
+#define CLONE_PIDFD 0x00001000
+#endif
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+/* Everything the cloned child needs to exec the application */
+typedef struct {
+    const bundle_probe_t *probe;
+    const launch_handoff_t *handoff;
+    char *const *argv;
+    char *const *envp;
+    char *pid_slot;
+    const char *exec_path;
+    const sigset_t *mask;
+    int error;
+} spawn_request_t;
+
+/* Stop signals the supervisor passes on */
+static const int stop_signals[] = { SIGTERM, SIGINT, SIGHUP };
+
+static volatile sig_atomic_t stop_signal;
+static char spawn_stack[SUPERVISOR_STACK_SIZE] __attribute__((aligned(16)));
+
+/**
+ * @brief Record a stop signal for the supervision loop
+ * @param sig Signal number
+ */
+static void handle_stop_signal(int sig) {
+    stop_signal = sig;
+}
+
+/**
+ * @brief Child side of the clone: restore signals and exec
+ * @param arg spawn_request_t
+ * @return Does not return
+ */
+static int spawn_child(void *arg) {
+    spawn_request_t *request = arg;
+    struct sigaction action;
+    int exec_fd;
+    
+    // Handlers are copied rather than shared, so this leaves the supervisor's alone
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    for (size_t i = 0; i < sizeof(stop_signals) / sizeof(stop_signals[0]); i++) {
+        sigaction(stop_signals[i], &action, NULL);
+    }
+    sigprocmask(SIG_SETMASK, request->mask, NULL);
+    
+    // Descriptor tables are not shared, so every start moves the handed descriptors anew
+    exec_fd = request->probe->exec_fd;
+    if (handoff_apply(request->handoff, request->pid_slot, &exec_fd) != 0) {
+        request->error = errno;
+        _exit(127);
+    }
+    syscall(SYS_execveat, exec_fd, "", request->argv, request->envp, AT_EMPTY_PATH);
+    
+    // Interpreters cannot reopen a script through a close-on-exec descriptor
+    if (errno == ENOENT) {
+        execve(request->exec_path, request->argv, request->envp);
+    }
+    
+    // Memory is shared until exec, so the supervisor sees why it failed
+    request->error = errno;
+    _exit(127);
+}
+
+/**
+ * @brief Start the application
+ * @param request Exec arguments
+ * @param pidfd Receives a pidfd for the child, or -1 if the kernel has none
+ * @return Child pid, or -1 with errno set if it could not be started
+ */
+static pid_t spawn_application(spawn_request_t *request, int *pidfd) {
+    char *stack_top = spawn_stack + sizeof(spawn_stack);
+    pid_t pid;
+    
+    request->error = 0;
+    *pidfd = -1;
+    log_flush();
+    
+    // The supervisor is suspended until the child has exec'd or exited
+    pid = clone(spawn_child, stack_top, CLONE_VM | CLONE_VFORK | CLONE_PIDFD | SIGCHLD, request, pidfd);
+    if (pid < 0 && errno == EINVAL) {
+        *pidfd = -1;
+        pid = clone(spawn_child, stack_top, CLONE_VM | CLONE_VFORK | SIGCHLD, request);
+    }
+    if (pid < 0) {
+        return -1;
+    }
+    
+    if (request->error != 0) {
+        waitpid(pid, NULL, 0);
+        if (*pidfd >= 0) {
+            close(*pidfd);
+            *pidfd = -1;
+        }
+        errno = request->error;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Pass a stop signal on to the application
+ * @param pid Child pid
+ * @param pidfd Child pidfd, or -1
+ * @param sig Signal to send
+ */
+static void forward_signal(pid_t pid, int pidfd, int sig) {
+    if (pidfd < 0 || syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0) != 0) {
+        kill(pid, sig);
+    }
+}
+
+/**
+ * @brief Wait for the application to exit, passing on stop signals meanwhile
+ * @param pid Child pid
+ * @param pidfd Child pidfd, or -1
+ * @param unblocked Signal mask with the stop signals deliverable
+ * @param info Receives the exit status; the child is not reaped
+ * @return 0 on success, -1 if waiting failed
+ */
+static int wait_application(pid_t pid, int pidfd, const sigset_t *unblocked, siginfo_t *info) {
+    struct pollfd poll_fd = { pidfd, POLLIN, 0 };
+    int forwarded = 0;
+    
+    for (;;) {
+        if (stop_signal && !forwarded) {
+            forward_signal(pid, pidfd, stop_signal);
+            forwarded = 1;
+        }
+        
+        // With a pidfd, stop signals can only arrive inside ppoll, so none is missed
+        if (pidfd >= 0 && ppoll(&poll_fd, 1, NULL, unblocked) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        
+        // The exited child is left to stats_reap(), which reads its I/O counters first
+        memset(info, 0, sizeof(*info));
+        if (pidfd >= 0 ? waitid(P_PIDFD, (id_t)pidfd, info, WEXITED | WNOWAIT) == 0
+                       : waitid(P_PID, (id_t)pid, info, WEXITED | WNOWAIT) == 0) {
+            return 0;
+        }
+        if (errno == EINVAL && pidfd >= 0) {
+            // Kernels before 5.4 hand out pidfds but cannot wait on them
+            return waitid(P_PID, (id_t)pid, info, WEXITED | WNOWAIT);
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Sleep before a restart unless a stop signal arrives
+ * @param milliseconds Delay
+ * @param unblocked Signal mask with the stop signals deliverable
+ */
+static void backoff_sleep(unsigned int milliseconds, const sigset_t *unblocked) {
+    struct timespec delay = { milliseconds / 1000, (long)(milliseconds % 1000) * 1000000L };
+    
+    ppoll(NULL, 0, &delay, unblocked);
+}
+
+/**
+ * @brief Milliseconds elapsed since a CLOCK_MONOTONIC time
+ * @param start Start time
+ * @return Elapsed milliseconds
+ */
+static long elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000L + (now.tv_nsec - start->tv_nsec) / 1000000L;
+}
+
+/**
+ * @brief Run the application under supervision until it exits cleanly or is stopped
+ * @param probe Probe of a validated bundle
+ * @param env Environment for every start, with the handoff configured
+ * @param handoff Arguments and descriptors for the application, or NULL
+ * @return EXIT_SUCCESS on a clean exit or stop, EXIT_EXEC_ERROR on a crash loop or exec failure
+ */
+static int supervise(const bundle_probe_t *probe, env_builder_t *env, const launch_handoff_t *handoff) {
+    char exec_path[MAX_PATH_LENGTH];
+    char *argv_storage[HANDOFF_ARGV_SIZE];
+    char **argv;
+    char *const *envp;
+    struct sigaction action;
+    sigset_t blocked;
+    sigset_t original;
+    spawn_request_t request;
+    unsigned int failures = 0;
+    int result = EXIT_SUCCESS;
+    
+    bundle_probe_component_path(probe, COMPONENT_EXEC, exec_path, sizeof(exec_path));
+    envp = env_builder_envp(env);
+    argv = handoff_argv(handoff, exec_path, argv_storage);
+    if (envp == NULL) {
+        log_message(LOG_ERROR, "Failed to build environment: %s", strerror(ENOMEM));
+        history_record(probe->path, trace_started_ms(), EXIT_SYSTEM_ERROR, trace_elapsed_ns());
+        trace_emit(EXIT_SYSTEM_ERROR);
+        return EXIT_SYSTEM_ERROR;
+    }
+    
+    // Stop signals are only taken while waiting, and the child gets the original mask back
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigemptyset(&blocked);
+    for (size_t i = 0; i < sizeof(stop_signals) / sizeof(stop_signals[0]); i++) {
+        sigaction(stop_signals[i], &action, NULL);
+        sigaddset(&blocked, stop_signals[i]);
+    }
+    sigprocmask(SIG_BLOCK, &blocked, &original);
+    
+    request.probe = probe;
+    request.handoff = handoff;
+    request.argv = argv;
+    request.envp = envp;
+    request.pid_slot = (char *)env_builder_get(env, "LISTEN_PID");
+    request.exec_path = exec_path;
+    request.mask = &original;
+    
+    log_message(LOG_INFO, "Launching application under supervision: %s", exec_path);
+    for (unsigned int starts = 0; ; starts++) {
+        struct timespec started;
+        stats_usage_t usage;
+        siginfo_t info;
+        long uptime;
+        int status;
+        unsigned int delay;
+        int pidfd;
+        pid_t pid;
+        
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        pid = spawn_application(&request, &pidfd);
+        if (pid < 0) {
+            log_message(LOG_ERROR, "Failed to execute application: %s", strerror(errno));
+            if (starts == 0) {
+                history_record(probe->path, trace_started_ms(), EXIT_EXEC_ERROR, trace_elapsed_ns());
+                trace_emit(EXIT_EXEC_ERROR);
+            }
+            result = EXIT_EXEC_ERROR;
+            break;
+        }
+        if (starts == 0) {
+            trace_mark(TRACE_EXEC);
+            history_record(probe->path, trace_started_ms(), EXIT_SUCCESS, trace_elapsed_ns());
+            trace_emit(EXIT_SUCCESS);
+        }
+        log_message(LOG_DEBUG, "Application started as pid %d", (int)pid);
+        
+        if (wait_application(pid, pidfd, &original, &info) != 0) {
+            log_message(LOG_ERROR, "Failed to wait for application: %s", strerror(errno));
+            result = EXIT_SYSTEM_ERROR;
+            if (pidfd >= 0) {
+                close(pidfd);
+            }
+            break;
+        }
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        uptime = elapsed_ms(&started);
+        if (stats_reap(pid, &status, &usage) == 0) {
+            usage.wall_ms = (uint64_t)uptime;
+            stats_report(probe->path, pid, status, &usage);
+        }
+        
+        if (stop_signal) {
+            log_message(LOG_INFO, "Application stopped by %s", strsignal(stop_signal));
+            break;
+        }
+        if (info.si_code == CLD_EXITED && info.si_status == 0) {
+            log_message(LOG_INFO, "Application exited cleanly after %ld ms", uptime);
+            break;
+        }
+        
+        // A run that lasted is not part of a crash loop
+        failures = uptime >= SUPERVISOR_STABLE_MS ? 1 : failures + 1;
+        if (info.si_code == CLD_EXITED) {
+            log_message(LOG_WARNING, "Application exited with status %d after %ld ms", info.si_status, uptime);
+        } else {
+            log_message(LOG_WARNING, "Application killed by %s after %ld ms", strsignal(info.si_status), uptime);
+        }
+        if (failures >= SUPERVISOR_MAX_FAILURES) {
+            log_message(LOG_ERROR, "Application failed %u times in a row, giving up", failures);
+            result = EXIT_EXEC_ERROR;
+            break;
+        }
+        
+        delay = SUPERVISOR_BACKOFF_MIN_MS;
+        for (unsigned int i = 1; i < failures && delay < SUPERVISOR_BACKOFF_MAX_MS; i++) {
+            delay *= 2;
+        }
+        if (delay > SUPERVISOR_BACKOFF_MAX_MS) {
+            delay = SUPERVISOR_BACKOFF_MAX_MS;
+        }
+        log_message(LOG_INFO, "Restarting application in %u ms", delay);
+        backoff_sleep(delay, &original);
+        if (stop_signal) {
+            log_message(LOG_INFO, "Supervision stopped by %s", strsignal(stop_signal));
+            break;
+        }
+    }
+    
+    sigprocmask(SIG_SETMASK, &original, NULL);
+    return result;
+}
+
+/**
+ * @brief Validate a bundle once and keep its application running
+ * @param bundle_path Path to application bundle
+ * @param handoff Arguments and descriptors for every start, or NULL
+ * @return EXIT_SUCCESS once supervision ends normally, error code on failure
+ */
+int supervise_application(const char *bundle_path, const launch_handoff_t *handoff) {
+    bundle_probe_t probe;
+    env_builder_t env;
+    int result;
+    
+    // The first start is recorded by supervise(), and failures before it here
+    result = prepare_application(&probe, bundle_path);
+    if (result != EXIT_SUCCESS) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    result = prepare_environment(&probe, &env);
+    if (result != EXIT_SUCCESS) {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+        bundle_probe_close(&probe);
+        return result;
+    }
+    trace_mark(TRACE_LIBRARY);
+    
+    // Placement is inherited by every start, and so are the sandbox and the resource descriptor
+    result = configure_placement(&probe);
+    if (result == EXIT_SUCCESS) {
+        trace_mark(TRACE_PLACEMENT);
+        result = sandbox_apply(&probe);
+    }
+    if (result == EXIT_SUCCESS) {
+        result = lazy_resources_attach(&probe);
+    }
+    if (result == EXIT_SUCCESS) {
+        result = configure_resources(&probe, &env);
+    }
+    if (result == EXIT_SUCCESS) {
+        result = handoff_configure(handoff, &env);
+    }
+    
+    if (result == EXIT_SUCCESS) {
+        if (prefetch_enabled() || probe.metadata.prefetch) {
+            prefetch_bundle(&probe);
+            trace_mark(TRACE_PREFETCH);
+        }
+        result = supervise(&probe, &env, handoff);
+    } else {
+        history_record(bundle_path, trace_started_ms(), result, trace_elapsed_ns());
+        trace_emit(result);
+    }
+    
+    env_builder_free(&env);
+    bundle_probe_close(&probe);
+    return result;
+}
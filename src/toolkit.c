@@ -0,0 +1,345 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file toolkit.c
+ * @brief Pre-initialised toolkit hosts for GUI bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The host only does the display-independent part of a toolkit's start:
+ * loading and relocating its libraries, reading the fontconfig cache,
+ * building the font map and registering the widget types. A display
+ * connection cannot be shared by processes forked from one host, so the
+ * application's own gtk_init() still opens it.
+ *
+ * Entering the application stands in for execve(): descriptors marked
+ * close-on-exec are closed, signal handlers reset and environ replaced.
+ * The dynamic loader read LD_LIBRARY_PATH when the daemon started, so
+ * the executable's bundle libraries are loaded from the application's
+ * search path by full path before the executable itself.
+ *
+ * A statically linked launcher (VLAUNCH_STATIC) has no usable dlopen(),
+ * so it hosts nothing and every toolkit bundle is exec'd as usual.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <signal.h>
+
+#include "launcher.h"
+#include "probe.h"
+#include "elfinfo.h"
+#include "trace.h"
+#include "history.h"
+#include "prefetch.h"
+#include "resource.h"
+#include "environment.h"
+#include "handoff.h"
+#include "toolkit.h"
+
+extern char **environ;
+
+/* Entry point of a loaded application */
+typedef int (*toolkit_entry_t)(int argc, char **argv, char **envp);
+
+/* Warm-up function of a toolkit; return values are ignored */
+typedef void (*toolkit_hook_t)(void);
+
+/* Known toolkit stacks */
+static const toolkit_stack_t toolkit_stacks[] = {
+    { "gtk2", { "libgtk-x11-2.0.so.0", NULL }, { "FcInit", "pango_cairo_font_map_get_default", "gtk_widget_get_type", NULL } },
+    { "gtk3", { "libgtk-3.so.0", NULL },       { "FcInit", "pango_cairo_font_map_get_default", "gtk_widget_get_type", NULL } },
+    { "gtk4", { "libgtk-4.so.1", NULL },       { "FcInit", "pango_cairo_font_map_get_default", "gtk_widget_get_type", NULL } }
+};
+
+#ifndef VLAUNCH_STATIC
+/* Signals whose handlers the daemon installs */
+static const int host_signals[] = { SIGTERM, SIGINT, SIGPIPE, SIGCHLD };
+#endif
+
+/**
+ * @brief Find the toolkit stack a bundle can be hosted by
+ * @param probe Probe of a validated bundle
+ * @return Stack named in info.yaml, or NULL if the bundle is exec'd as usual
+ */
+const toolkit_stack_t *toolkit_for_bundle(const bundle_probe_t *probe) {
+    const metadata_value_t *name = &probe->metadata.toolkit;
+    const toolkit_stack_t *stack = NULL;
+    elf_info_t info;
+    int loadable;
+    
+    if (name->length == 0) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(toolkit_stacks) / sizeof(toolkit_stacks[0]); i++) {
+        if (strlen(toolkit_stacks[i].name) == name->length &&
+            memcmp(toolkit_stacks[i].name, name->data, name->length) == 0) {
+            stack = &toolkit_stacks[i];
+        }
+    }
+    if (stack == NULL) {
+        log_message(LOG_WARNING, "Unknown toolkit in info.yaml: %.*s", (int)name->length, name->data);
+        return NULL;
+    }
+#ifdef VLAUNCH_STATIC
+    // dlopen() in a static binary needs the very glibc build it was linked from
+    log_message(LOG_INFO, "A statically linked launcher cannot host the %s toolkit, exec'ing %s",
+                stack->name, probe->exec_path);
+    (void)info;
+    (void)loadable;
+    return NULL;
+#else
+    
+    if (elf_open(probe->dirfd, probe->exec_path, &info) != 0) {
+        log_message(LOG_INFO, "%s is not an ELF object, not hosting it", probe->exec_path);
+        return NULL;
+    }
+    loadable = info.is_shared_object && !info.is_pie;
+    elf_close(&info);
+    if (!loadable) {
+        log_message(LOG_INFO, "%s cannot be loaded into the %s host, build it with -shared -fPIC",
+                    probe->exec_path, stack->name);
+        return NULL;
+    }
+    return stack;
+#endif
+}
+
+/**
+ * @brief Load and warm up a toolkit stack in the calling process
+ * @param stack Toolkit stack
+ * @return EXIT_SUCCESS on success, EXIT_EXEC_ERROR if a library is missing
+ */
+int toolkit_preinit(const toolkit_stack_t *stack) {
+#ifdef VLAUNCH_STATIC
+    log_message(LOG_ERROR, "The %s host needs a dynamically linked launcher", stack->name);
+    return EXIT_EXEC_ERROR;
+#else
+    for (int i = 0; i < TOOLKIT_MAX_LIBRARIES && stack->libraries[i]; i++) {
+        if (dlopen(stack->libraries[i], RTLD_NOW | RTLD_GLOBAL) == NULL) {
+            log_message(LOG_ERROR, "Failed to load %s for the %s host: %s", stack->libraries[i], stack->name, dlerror());
+            return EXIT_EXEC_ERROR;
+        }
+    }
+    
+    for (int i = 0; i < TOOLKIT_MAX_HOOKS && stack->hooks[i]; i++) {
+        void *symbol = dlsym(RTLD_DEFAULT, stack->hooks[i]);
+        toolkit_hook_t hook;
+        
+        if (symbol == NULL) {
+            log_message(LOG_DEBUG, "%s host: %s not found", stack->name, stack->hooks[i]);
+            continue;
+        }
+        memcpy(&hook, &symbol, sizeof(hook));
+        hook();
+    }
+    
+    log_message(LOG_INFO, "Toolkit host ready: %s", stack->name);
+    return EXIT_SUCCESS;
+#endif
+}
+
+#ifndef VLAUNCH_STATIC
+
+/**
+ * @brief Load the bundle libraries an object needs, dependencies first
+ * @param search Application library search path, colon-separated
+ * @param dirfd Directory descriptor that path is relative to (or AT_FDCWD)
+ * @param path Object whose DT_NEEDED entries are loaded
+ * @param depth Current recursion depth
+ */
+static void preload_needed(const char *search, int dirfd, const char *path, unsigned int depth) {
+    elf_info_t info;
+    
+    if (depth > TOOLKIT_PRELOAD_DEPTH || elf_open(dirfd, path, &info) != 0) {
+        return;
+    }
+    
+    for (int i = 0; i < info.needed_count; i++) {
+        const char *cursor = search;
+        
+        // Sonames already loaded, the toolkit's included, satisfy the object as they are
+        if (dlopen(info.needed[i], RTLD_NOW | RTLD_NOLOAD) != NULL) {
+            continue;
+        }
+        while (cursor != NULL && *cursor != '\0') {
+            const char *end = strchr(cursor, ':');
+            size_t length = end ? (size_t)(end - cursor) : strlen(cursor);
+            char candidate[MAX_PATH_LENGTH];
+            
+            if (length > 0 &&
+                (size_t)snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)length, cursor, info.needed[i]) < sizeof(candidate) &&
+                access(candidate, R_OK) == 0) {
+                preload_needed(search, AT_FDCWD, candidate, depth + 1);
+                if (dlopen(candidate, RTLD_NOW | RTLD_GLOBAL) == NULL) {
+                    log_message(LOG_DEBUG, "Failed to preload %s: %s", candidate, dlerror());
+                }
+                break;
+            }
+            cursor = end ? end + 1 : NULL;
+        }
+    }
+    elf_close(&info);
+}
+
+/**
+ * @brief Close the descriptors execve() would have, as marked close-on-exec
+ */
+static void close_exec_descriptors(void) {
+    DIR *dir = opendir("/proc/self/fd");
+    struct dirent *entry;
+    int fds[256];
+    size_t count = 0;
+    
+    if (dir == NULL) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL && count < sizeof(fds) / sizeof(fds[0])) {
+        int fd = atoi(entry->d_name);
+        int flags;
+        
+        if (entry->d_name[0] == '.' || fd == dirfd(dir)) {
+            continue;
+        }
+        flags = fcntl(fd, F_GETFD);
+        if (flags >= 0 && (flags & FD_CLOEXEC)) {
+            fds[count++] = fd;
+        }
+    }
+    closedir(dir);
+    
+    // Closed after the walk, which would otherwise change what it lists
+    for (size_t i = 0; i < count; i++) {
+        close(fds[i]);
+    }
+}
+
+/**
+ * @brief Load the bundle executable into a process forked from a toolkit host and run it
+ * @param probe Probe of a validated bundle
+ * @param env Environment for the application
+ * @param handoff Arguments and descriptors for the application, or NULL
+ * @return Error code if the executable could not be loaded; does not return otherwise
+ */
+int toolkit_enter(const bundle_probe_t *probe, env_builder_t *env, const launch_handoff_t *handoff) {
+    char exec_path[MAX_PATH_LENGTH];
+    char object[64];
+    char *const *envp;
+    char *argv_storage[HANDOFF_ARGV_SIZE];
+    char **argv;
+    const char *search;
+    struct sigaction action;
+    toolkit_entry_t entry;
+    void *handle;
+    void *symbol;
+    int exec_fd = probe->exec_fd;
+    int argc = 0;
+    
+    if (configure_resources(probe, env) != EXIT_SUCCESS || handoff_configure(handoff, env) != EXIT_SUCCESS) {
+        return EXIT_SYSTEM_ERROR;
+    }
+    bundle_probe_component_path(probe, COMPONENT_EXEC, exec_path, sizeof(exec_path));
+    envp = env_builder_envp(env);
+    argv = handoff_argv(handoff, exec_path, argv_storage);
+    if (envp == NULL) {
+        log_message(LOG_ERROR, "Failed to build environment: %s", strerror(ENOMEM));
+        return EXIT_SYSTEM_ERROR;
+    }
+    while (argv[argc] != NULL) {
+        argc++;
+    }
+    
+    if (prefetch_enabled() || probe->metadata.prefetch) {
+        prefetch_bundle(probe);
+        trace_mark(TRACE_PREFETCH);
+    }
+    
+    // Load the file the probe validated rather than whatever the path names now
+    search = env_builder_get(env, "LD_LIBRARY_PATH");
+    preload_needed(search ? search : "", probe->dirfd, probe->exec_path, 0);
+    snprintf(object, sizeof(object), "/proc/self/fd/%d", exec_fd);
+    handle = dlopen(object, RTLD_NOW | RTLD_GLOBAL);
+    symbol = handle ? dlsym(handle, TOOLKIT_ENTRY_SYMBOL) : NULL;
+    if (symbol == NULL) {
+        log_message(LOG_ERROR, "Failed to load application: %s", dlerror());
+        return EXIT_EXEC_ERROR;
+    }
+    memcpy(&entry, &symbol, sizeof(entry));
+    
+    log_message(LOG_INFO, "Launching application in toolkit host: %s", exec_path);
+    log_flush();
+    trace_mark(TRACE_EXEC);
+    
+    // A failure here is no launch: the daemon falls back to exec'ing the bundle
+    if (handoff_apply(handoff, (char *)env_builder_get(env, "LISTEN_PID"), &exec_fd) != 0) {
+        log_message(LOG_ERROR, "Failed to pass descriptors: %s", strerror(errno));
+        return EXIT_EXEC_ERROR;
+    }
+    history_record(probe->path, trace_started_ms(), EXIT_SUCCESS, trace_elapsed_ns());
+    trace_emit(EXIT_SUCCESS);
+    
+    // From here on the process is the application, as after execve()
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    for (size_t i = 0; i < sizeof(host_signals) / sizeof(host_signals[0]); i++) {
+        sigaction(host_signals[i], &action, NULL);
+    }
+    close_exec_descriptors();
+    environ = (char **)envp;
+    exit(entry(argc, argv, (char **)envp));
+}
+#else
+/**
+ * @brief Refuse to host a bundle, there being no dlopen() in a static launcher
+ * @param probe Probe of a validated bundle
+ * @param env Environment for the application (unused)
+ * @param handoff Arguments and descriptors for the application (unused)
+ * @return EXIT_EXEC_ERROR
+ */
+int toolkit_enter(const bundle_probe_t *probe, env_builder_t *env, const launch_handoff_t *handoff) {
+    (void)env;
+    (void)handoff;
+    log_message(LOG_ERROR, "Cannot load %s: toolkit hosts need a dynamically linked launcher", probe->exec_path);
+    return EXIT_EXEC_ERROR;
+}
+#endif
@@ -0,0 +1,75 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file toolkit.h
+ * @brief Pre-initialised toolkit hosts for GUI bundles
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A bundle whose info.yaml names a toolkit stack ("toolkit: gtk3") is
+ * launched by the daemon from a host process that has already loaded and
+ * warmed up that stack. The application is forked from the host and its
+ * executable loaded with dlopen(), so it finds the toolkit's libraries
+ * relocated and their caches filled instead of paying for them itself.
+ *
+ * The executable must therefore be a shared object exporting main, as
+ * built with "gcc -shared -fPIC". Position-independent executables are
+ * refused by the dynamic loader; such bundles are exec'd as usual.
+ */
+
+#ifndef VLAUNCH_TOOLKIT_H
+#define VLAUNCH_TOOLKIT_H
+
+#include "launcher.h"
+
+/* Toolkit Host Configuration */
+#define TOOLKIT_MAX_LIBRARIES   4
+#define TOOLKIT_MAX_HOOKS       4
+#define TOOLKIT_MAX_HOSTS       4
+#define TOOLKIT_PRELOAD_DEPTH   16
+#define TOOLKIT_ENTRY_SYMBOL    "main"
+
+/* Libraries of a toolkit stack and the functions that warm them up */
+typedef struct {
+    const char *name;
+    const char *libraries[TOOLKIT_MAX_LIBRARIES];
+    const char *hooks[TOOLKIT_MAX_HOOKS];
+} toolkit_stack_t;
+
+const toolkit_stack_t *toolkit_for_bundle(const bundle_probe_t *probe);
+int toolkit_preinit(const toolkit_stack_t *stack);
+int toolkit_enter(const bundle_probe_t *probe, env_builder_t *env, const launch_handoff_t *handoff);
+
+#endif /* VLAUNCH_TOOLKIT_H */
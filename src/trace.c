@@ -0,0 +1,379 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file trace.c
+ * @brief Launch-phase timing instrumentation
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A launch produces a single line such as
+ *
+ *   {"bundle":"/apps/Test.app","pid":123,"time_ms":1760000000000,
+ *    "result":0,"total_ns":81234,"phases":{"args_ns":2100,...}}
+ *
+ * written with one write() to the configured descriptor. Phases that did
+ * not run (for example validation on a cache hit) are omitted.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/sched.h>
+
+#include "launcher.h"
+#include "handoff.h"
+#include "trace.h"
+
+static const char *const trace_phase_names[TRACE_PHASE_COUNT] = {
+    [TRACE_START]     = "start",
+    [TRACE_ARGS]      = "args",
+    [TRACE_PROBE]     = "probe",
+    [TRACE_VALIDATE]  = "validate",
+    [TRACE_LIBRARY]   = "library",
+    [TRACE_PLACEMENT] = "placement",
+    [TRACE_INSPECT]   = "inspect",
+    [TRACE_PREFETCH]  = "prefetch",
+    [TRACE_FORK]      = "fork",
+    [TRACE_EXEC]      = "exec"
+};
+
+static int trace_fd = -1;
+static char trace_bundle[MAX_PATH_LENGTH];
+static long long trace_wall_ms;
+static long long trace_marks[TRACE_PHASE_COUNT];
+
+/**
+ * @brief Read a clock in nanoseconds
+ * @param clock_id Clock to read
+ * @return Current time in nanoseconds
+ */
+static long long clock_ns(clockid_t clock_id) {
+    struct timespec ts;
+    
+    clock_gettime(clock_id, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Configure where trace records are written
+ * @param target "fd:<n>" for an inherited descriptor, otherwise a file path
+ * @return EXIT_SUCCESS on success, EXIT_INVALID_ARGS if the target is unusable
+ */
+int trace_open(const char *target) {
+    int inherited = strncmp(target, "fd:", 3) == 0;
+    int fd;
+    
+    if (inherited) {
+        char *end;
+        long number = strtol(target + 3, &end, 10);
+        
+        if (*end != '\0' || number < 0 || number > INT_MAX || fcntl((int)number, F_GETFD) < 0) {
+            log_message(LOG_ERROR, "Invalid trace descriptor: %s", target);
+            return EXIT_INVALID_ARGS;
+        }
+        fd = (int)number;
+        
+        // Keep the descriptor away from the launched application
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    } else {
+        fd = open(target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            log_message(LOG_ERROR, "Cannot open trace file %s: %s", target, strerror(errno));
+            return EXIT_INVALID_ARGS;
+        }
+    }
+    
+    // Kept clear of the range descriptors are handed to the application in,
+    // since the failure record is written after the handoff has been applied
+    trace_fd = fcntl(fd, F_DUPFD_CLOEXEC, HANDOFF_FIRST_FD + HANDOFF_MAX_FDS);
+    if (!inherited) {
+        close(fd);
+    }
+    if (trace_fd < 0) {
+        log_message(LOG_ERROR, "Cannot move trace descriptor: %s", strerror(errno));
+        return EXIT_INVALID_ARGS;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Start timing a new launch
+ * @param bundle_path Bundle being launched, or NULL if not yet known
+ */
+void trace_reset(const char *bundle_path) {
+    memset(trace_marks, 0, sizeof(trace_marks));
+    trace_set_bundle(bundle_path);
+    trace_wall_ms = clock_ns(CLOCK_REALTIME) / 1000000LL;
+    trace_marks[TRACE_START] = clock_ns(CLOCK_MONOTONIC);
+}
+
+/**
+ * @brief Name the bundle the current launch is for
+ * @param bundle_path Bundle being launched, or NULL
+ */
+void trace_set_bundle(const char *bundle_path) {
+    snprintf(trace_bundle, sizeof(trace_bundle), "%s", bundle_path ? bundle_path : "");
+}
+
+/**
+ * @brief Record the end of a launch phase
+ * @param phase Phase that just completed
+ */
+void trace_mark(trace_phase_t phase) {
+    // Marks are taken unconditionally because the target is configured after startup
+    trace_marks[phase] = clock_ns(CLOCK_MONOTONIC);
+}
+
+/**
+ * @brief Append a JSON-escaped string to a buffer
+ * @param out Destination buffer
+ * @param used Bytes already used in the buffer
+ * @param size Size of destination buffer
+ * @param text String to escape
+ * @return New number of used bytes
+ */
+size_t trace_append_json_string(char *out, size_t used, size_t size, const char *text) {
+    static const char hex[] = "0123456789abcdef";
+    
+    for (const unsigned char *p = (const unsigned char *)text; *p && used + 7 < size; p++) {
+        if (*p == '"' || *p == '\\') {
+            out[used++] = '\\';
+            out[used++] = (char)*p;
+        } else if (*p < 0x20) {
+            memcpy(out + used, "\\u00", 4);
+            out[used + 4] = hex[*p >> 4];
+            out[used + 5] = hex[*p & 0xf];
+            used += 6;
+        } else {
+            out[used++] = (char)*p;
+        }
+    }
+    
+    return used;
+}
+
+/**
+ * @brief Get the wall clock time the current launch started
+ * @return Milliseconds since the epoch
+ */
+long long trace_started_ms(void) {
+    return trace_wall_ms;
+}
+
+/**
+ * @brief Get the time from the start of the current launch to its latest mark
+ * @return Nanoseconds
+ */
+long long trace_elapsed_ns(void) {
+    long long last = trace_marks[TRACE_START];
+    
+    for (int i = TRACE_START + 1; i < TRACE_PHASE_COUNT; i++) {
+        if (trace_marks[i] > last) {
+            last = trace_marks[i];
+        }
+    }
+    
+    return last - trace_marks[TRACE_START];
+}
+
+/**
+ * @brief Format the trace record for the current launch
+ * @param result Launch result
+ * @param record Destination buffer of TRACE_RECORD_SIZE bytes
+ * @return Length of the record, or 0 if it did not fit
+ */
+static size_t trace_format(int result, char *record) {
+    long long previous;
+    size_t used;
+    int first = 1;
+    
+    memcpy(record, "{\"bundle\":\"", 11);
+    used = trace_append_json_string(record, 11, TRACE_RECORD_SIZE, trace_bundle);
+    
+    used += (size_t)snprintf(record + used, TRACE_RECORD_SIZE - used,
+                             "\",\"pid\":%ld,\"time_ms\":%lld,\"result\":%d,\"total_ns\":%lld,\"phases\":{",
+                             (long)getpid(), trace_wall_ms, result, trace_elapsed_ns());
+    
+    // A phase lasts from the chronologically previous mark, which is not
+    // always the previous enum value (the daemon inspects before forking)
+    for (int i = TRACE_START + 1; i < TRACE_PHASE_COUNT && used < TRACE_RECORD_SIZE; i++) {
+        if (trace_marks[i] == 0) {
+            continue;
+        }
+        
+        previous = trace_marks[TRACE_START];
+        for (int j = TRACE_START + 1; j < TRACE_PHASE_COUNT; j++) {
+            if (trace_marks[j] != 0 && trace_marks[j] < trace_marks[i] && trace_marks[j] > previous) {
+                previous = trace_marks[j];
+            }
+        }
+        
+        used += (size_t)snprintf(record + used, TRACE_RECORD_SIZE - used, "%s\"%s_ns\":%lld",
+                                 first ? "" : ",", trace_phase_names[i], trace_marks[i] - previous);
+        first = 0;
+    }
+    
+    if (used + 3 >= TRACE_RECORD_SIZE) {
+        log_message(LOG_WARNING, "Trace record truncated");
+        return 0;
+    }
+    memcpy(record + used, "}}\n", 3);
+    return used + 3;
+}
+
+/**
+ * @brief Write the trace record for the current launch, if tracing is on
+ * @param result Launch result
+ */
+void trace_emit(int result) {
+    char record[TRACE_RECORD_SIZE];
+    size_t length;
+    
+    if (trace_fd < 0) {
+        return;
+    }
+    
+    length = trace_format(result, record);
+    if (length > 0) {
+        trace_write(record, length);
+    }
+}
+
+/**
+ * @brief Write the success record once the exec about to be made has gone through
+ * @return Descriptor to pass to trace_exec_failed() if the exec fails, or -1
+ *
+ * Nothing outlives a successful exec to report it, so a detached process
+ * holds the success record and the read end of a pipe whose write end is
+ * close-on-exec. End of file means the exec happened and the record is
+ * written; a byte from trace_exec_failed() means it did not. Either way
+ * the launch gets exactly one record.
+ */
+int trace_emit_after_exec(void) {
+    char record[TRACE_RECORD_SIZE];
+    struct clone_args args;
+    int status_pipe[2];
+    size_t length;
+    int status;
+    int watcher;
+    pid_t pid;
+    
+    if (trace_fd < 0) {
+        return -1;
+    }
+    length = trace_format(EXIT_SUCCESS, record);
+    if (length == 0) {
+        return -1;
+    }
+    if (pipe2(status_pipe, O_CLOEXEC) != 0) {
+        log_message(LOG_WARNING, "Cannot trace the exec: %s", strerror(errno));
+        return -1;
+    }
+    
+    // The writer follows the trace descriptor out of the handoff range
+    watcher = fcntl(status_pipe[1], F_DUPFD_CLOEXEC, HANDOFF_FIRST_FD + HANDOFF_MAX_FDS);
+    close(status_pipe[1]);
+    if (watcher < 0) {
+        log_message(LOG_WARNING, "Cannot trace the exec: %s", strerror(errno));
+        close(status_pipe[0]);
+        return -1;
+    }
+    
+    // The intermediate child is no SIGCHLD child, so no signal is left
+    // pending for the application; the watcher itself is reparented
+    memset(&args, 0, sizeof(args));
+    pid = (pid_t)syscall(SYS_clone3, &args, sizeof(args));
+    if (pid == 0) {
+        char byte;
+        
+        close(watcher);
+        pid = fork();
+        if (pid != 0) {
+            _exit(pid < 0 ? EXIT_SYSTEM_ERROR : EXIT_SUCCESS);
+        }
+        
+        // Hold nothing the application was handed beyond the exec
+        if (dup2(status_pipe[0], STDIN_FILENO) < 0 || dup2(trace_fd, STDOUT_FILENO) < 0) {
+            _exit(EXIT_SYSTEM_ERROR);
+        }
+        syscall(SYS_close_range, 2u, ~0u, 0u);
+        if (read(STDIN_FILENO, &byte, 1) == 0 && write(STDOUT_FILENO, record, length) < 0) {
+            _exit(EXIT_SYSTEM_ERROR);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+    close(status_pipe[0]);
+    if (pid < 0 || waitpid(pid, &status, __WALL) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        log_message(LOG_WARNING, "Cannot trace the exec: %s", pid < 0 ? strerror(errno) : "watcher did not start");
+        close(watcher);
+        return -1;
+    }
+    
+    return watcher;
+}
+
+/**
+ * @brief Write the failure record in place of the one trace_emit_after_exec() holds
+ * @param watcher Descriptor from trace_emit_after_exec(), or -1
+ * @param result Launch result
+ */
+void trace_exec_failed(int watcher, int result) {
+    if (watcher >= 0) {
+        if (write(watcher, "", 1) < 0) {
+            // The watcher is gone and has nothing to write
+        }
+        close(watcher);
+    }
+    trace_emit(result);
+}
+
+/**
+ * @brief Write a complete record to the trace target, if there is one
+ * @param record JSON record ending in a newline
+ * @param length Length of the record
+ */
+void trace_write(const char *record, size_t length) {
+    if (trace_fd >= 0 && write(trace_fd, record, length) < 0) {
+        log_message(LOG_WARNING, "Failed to write trace record: %s", strerror(errno));
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file trace.h
+ * @brief Launch-phase timing instrumentation
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Records a monotonic timestamp at the end of every launch phase and
+ * emits them as one JSON line per launch, for fleet collectors that
+ * aggregate launcher overhead without parsing human-readable logs.
+ */
+
+#ifndef VLAUNCH_TRACE_H
+#define VLAUNCH_TRACE_H
+
+#include <stddef.h>
+
+#include "launcher.h"
+
+/* Launch phases, in the order they complete */
+typedef enum {
+    TRACE_START,
+    TRACE_ARGS,
+    TRACE_PROBE,
+    TRACE_VALIDATE,
+    TRACE_LIBRARY,
+    TRACE_PLACEMENT,
+    TRACE_INSPECT,
+    TRACE_PREFETCH,
+    TRACE_FORK,
+    TRACE_EXEC,
+    TRACE_PHASE_COUNT
+} trace_phase_t;
+
+/* Trace Configuration */
+#define TRACE_RECORD_SIZE   (MAX_PATH_LENGTH * 2 + 512)
+
+int trace_open(const char *target);
+void trace_reset(const char *bundle_path);
+void trace_set_bundle(const char *bundle_path);
+void trace_mark(trace_phase_t phase);
+long long trace_started_ms(void);
+long long trace_elapsed_ns(void);
+void trace_emit(int result);
+int trace_emit_after_exec(void);
+void trace_exec_failed(int watcher, int result);
+void trace_write(const char *record, size_t length);
+size_t trace_append_json_string(char *out, size_t used, size_t size, const char *text);
+
+#endif /* VLAUNCH_TRACE_H */
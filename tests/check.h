@@ -0,0 +1,174 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file check.h
+ * @brief Minimal assertion helpers for the unit tests
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Each unit test is one program that includes the module it tests, so
+ * static functions can be called directly, and exits non-zero if any
+ * check failed. Scratch files go below $TEST_TMPDIR, which run_tests.sh
+ * creates for every test and removes afterwards.
+ *
+ * Parsers are handed copies in allocations of exactly their size, so a
+ * read past the end is caught by the sanitizer as well as by the checks.
+ */
+
+#ifndef VLAUNCH_CHECK_H
+#define VLAUNCH_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static int check_failures;
+static int check_count;
+
+/* Record a failed check without stopping, so one run reports every failure */
+#define CHECK(condition) \
+    do { \
+        check_count++; \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++; \
+        } \
+    } while (0)
+
+/* Format into an array, failing the check rather than going on with a cut-short string */
+#define CHECK_FORMAT(out, ...) CHECK((size_t)snprintf(out, sizeof(out), __VA_ARGS__) < sizeof(out))
+
+/**
+ * @brief Build a path below the test's scratch directory
+ * @param name File name below $TEST_TMPDIR
+ * @param out Receives the path
+ * @param size Size of out
+ * @return out
+ */
+static inline char *check_path(const char *name, char *out, size_t size) {
+    const char *root = getenv("TEST_TMPDIR");
+    
+    if ((size_t)snprintf(out, size, "%s/%s", root && root[0] ? root : "/tmp", name) >= size) {
+        fprintf(stderr, "TEST_TMPDIR too long\n");
+        exit(EXIT_FAILURE);
+    }
+    return out;
+}
+
+/**
+ * @brief Write a file below a directory, creating its parents
+ * @param root Directory
+ * @param name Path below root
+ * @param content File content
+ * @param mode Permission bits
+ */
+static inline void check_write_file(const char *root, const char *name, const char *content, mode_t mode) {
+    char path[4096];
+    FILE *file;
+    
+    CHECK_FORMAT(path, "%s/%s", root, name);
+    for (char *slash = strchr(path + strlen(root) + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+    file = fopen(path, "w");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        fputs(content, file);
+        fclose(file);
+        CHECK(chmod(path, mode) == 0);
+    }
+}
+
+/**
+ * @brief Read a whole file into memory
+ * @param path File to read
+ * @param size Receives the size
+ * @return Heap copy of the file, or NULL
+ */
+static inline char *check_read_file(const char *path, size_t *size) {
+    struct stat st;
+    char *data = NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) == 0 && (data = malloc(st.st_size ? (size_t)st.st_size : 1)) != NULL &&
+        read(fd, data, (size_t)st.st_size) != st.st_size) {
+        free(data);
+        data = NULL;
+    }
+    close(fd);
+    *size = data ? (size_t)st.st_size : 0;
+    return data;
+}
+
+/**
+ * @brief Copy bytes into an allocation of exactly their size
+ * @param data Bytes to copy
+ * @param size Number of bytes
+ * @return Heap copy, to be freed by the caller
+ */
+static inline void *check_copy(const void *data, size_t size) {
+    void *copy = malloc(size ? size : 1);
+    
+    if (copy == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, data, size);
+    return copy;
+}
+
+/**
+ * @brief Report the result of a test program
+ * @param name Test name
+ * @return Exit status for main()
+ */
+static inline int check_finish(const char *name) {
+    if (check_failures > 0) {
+        fprintf(stderr, "%s: %d of %d checks failed\n", name, check_failures, check_count);
+        return EXIT_FAILURE;
+    }
+    printf("%s: %d checks passed\n", name, check_count);
+    return EXIT_SUCCESS;
+}
+
+#endif /* VLAUNCH_CHECK_H */
@@ -0,0 +1,131 @@
+#!/bin/sh
+# BSD 3-Clause License
+# 
+# Copyright (c) 2025, Ariz Kamizuki
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+# 
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Launcher test runner
+# Version: 1.0.0
+# Author: Ariz Kamizuki
+# Date: 2025
+#
+# Unit tests (test_*.c) include the module they test and link against an
+# archive of the other modules, with main() of the launcher renamed so
+# the test can have its own. Launcher tests (test_*.sh) drive the built
+# launcher named by $LAUNCHER. A test exits 77 to report that it was
+# skipped, for example when the machine lacks the feature it covers.
+
+set -u
+
+cd "$(dirname "$0")" || exit 1
+
+CC=${CC:-gcc}
+LAUNCHER=${LAUNCHER:-../build/launcher}
+case $LAUNCHER in
+    /*) ;;
+    *) LAUNCHER=$(pwd)/$LAUNCHER ;;
+esac
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/vlaunch-tests.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+trap 'exit 130' INT TERM
+
+CFLAGS="-std=gnu11 -g -O1 -Wall -Wextra -I../src -DVLAUNCH_ARCH=\"$(uname -m)\""
+LIBS="-lpthread -ldl"
+
+# Sanitizers catch the out-of-bounds reads corrupt input is meant to provoke
+echo 'int main(void) { return 0; }' > "$WORK/probe.c"
+if $CC -fsanitize=address,undefined -o "$WORK/probe" "$WORK/probe.c" 2>/dev/null && "$WORK/probe"; then
+    CFLAGS="$CFLAGS -fsanitize=address,undefined -fno-sanitize-recover=undefined"
+fi
+export ASAN_OPTIONS=${ASAN_OPTIONS:-detect_leaks=0}
+
+mkdir "$WORK/obj"
+for source in ../src/*.c; do
+    name=$(basename "$source" .c)
+    case $name in
+        audit) continue ;;
+        main) extra=-Dmain=vlaunch_main ;;
+        *) extra= ;;
+    esac
+    if ! $CC $CFLAGS $extra -c "$source" -o "$WORK/obj/$name.o"; then
+        echo "FAIL: cannot compile $source"
+        exit 1
+    fi
+done
+ar rcs "$WORK/libvlaunch.a" "$WORK"/obj/*.o
+
+passed=0
+failed=0
+skipped=0
+
+# Run one test with a scratch directory and caches of its own
+run_test() {
+    name=$1
+    shift
+    mkdir -p "$WORK/$name/cache"
+    TEST_TMPDIR="$WORK/$name" XDG_CACHE_HOME="$WORK/$name/cache" HOME="$WORK/$name" \
+        LAUNCHER="$LAUNCHER" "$@" > "$WORK/$name.log" 2>&1
+    status=$?
+    if [ $status -eq 0 ]; then
+        echo "PASS: $name"
+        passed=$((passed + 1))
+    elif [ $status -eq 77 ]; then
+        echo "SKIP: $name"
+        skipped=$((skipped + 1))
+    else
+        echo "FAIL: $name (status $status)"
+        sed 's/^/    /' "$WORK/$name.log"
+        failed=$((failed + 1))
+    fi
+}
+
+for test in test_*.c; do
+    [ -e "$test" ] || continue
+    name=$(basename "$test" .c)
+    if ! $CC $CFLAGS -o "$WORK/$name.bin" "$test" "$WORK/libvlaunch.a" $LIBS; then
+        echo "FAIL: $name (does not build)"
+        failed=$((failed + 1))
+        continue
+    fi
+    run_test "$name" "$WORK/$name.bin"
+done
+
+for test in test_*.sh; do
+    [ -e "$test" ] || continue
+    name=$(basename "$test" .sh)
+    if [ ! -x "$LAUNCHER" ]; then
+        echo "SKIP: $name (no launcher at $LAUNCHER)"
+        skipped=$((skipped + 1))
+        continue
+    fi
+    run_test "$name" sh "$(pwd)/$test"
+done
+
+echo "$passed passed, $failed failed, $skipped skipped"
+[ $failed -eq 0 ]
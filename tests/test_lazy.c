@@ -0,0 +1,860 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_lazy.c
+ * @brief Tests of the lazy resource index, HTTP fetcher and FUSE server
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The index parser is fed malformed lines and a valid index cut short
+ * inside its last line, and must build one node per file and directory
+ * with the digest and size the line gave. The resource URL parser
+ * is checked on good and bad URLs. fetch_range() and fetch_object() talk
+ * to a local HTTP server thread that sends good and bad replies. The
+ * FUSE request handler answers requests written to one end of a
+ * socketpair standing in for /dev/fuse; each request sits in an
+ * allocation of exactly its length, so a read past what the kernel
+ * sent is caught.
+ */
+
+#include "../src/lazy.c"
+
+#include <ctype.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "check.h"
+
+/* Files of the test index and their contents */
+static const char *const lazy_files[][2] = {
+    { "app.txt", "0123456789" },
+    { "icons/app.png", "image" },
+    { "icons/empty", "" },
+    { "deep/er/still.txt", "nested\n" },
+};
+
+#define LAZY_FILE_COUNT     (sizeof(lazy_files) / sizeof(lazy_files[0]))
+#define LAZY_MANY_FILES     200
+
+/* Canned reply of the HTTP server thread */
+typedef struct {
+    pthread_mutex_t lock;
+    int listener;
+    const char *reply;
+    size_t pad;
+    char request[2048];
+    unsigned int connections;
+} http_server_t;
+
+static http_server_t http_server = { PTHREAD_MUTEX_INITIALIZER, -1, NULL, 0, "", 0 };
+
+/**
+ * @brief Answer every connection with the current canned reply
+ * @param arg Unused
+ * @return Never returns
+ */
+static void *http_worker(void *arg) {
+    char pad[4096];
+    
+    (void)arg;
+    memset(pad, 'a', sizeof(pad));
+    for (;;) {
+        char request[sizeof(http_server.request)];
+        size_t have = 0;
+        const char *reply;
+        size_t remaining;
+        int fd = accept(http_server.listener, NULL, NULL);
+        
+        if (fd < 0) {
+            continue;
+        }
+        while (have < sizeof(request) - 1 && memmem(request, have, "\r\n\r\n", 4) == NULL) {
+            ssize_t got = recv(fd, request + have, sizeof(request) - 1 - have, 0);
+            if (got <= 0) {
+                break;
+            }
+            have += (size_t)got;
+        }
+        request[have] = '\0';
+        
+        pthread_mutex_lock(&http_server.lock);
+        memcpy(http_server.request, request, have + 1);
+        http_server.connections++;
+        reply = http_server.reply;
+        remaining = http_server.pad;
+        pthread_mutex_unlock(&http_server.lock);
+        
+        if (reply != NULL) {
+            send(fd, reply, strlen(reply), MSG_NOSIGNAL);
+        }
+        while (remaining > 0) {
+            ssize_t sent = send(fd, pad, remaining < sizeof(pad) ? remaining : sizeof(pad), MSG_NOSIGNAL);
+            if (sent <= 0) {
+                break;
+            }
+            remaining -= (size_t)sent;
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Set the reply of the HTTP server thread
+ * @param reply Bytes sent verbatim, or NULL to close without a reply
+ * @param pad Number of 'a' bytes sent after it
+ */
+static void http_reply(const char *reply, size_t pad) {
+    pthread_mutex_lock(&http_server.lock);
+    http_server.reply = reply;
+    http_server.pad = pad;
+    http_server.connections = 0;
+    http_server.request[0] = '\0';
+    pthread_mutex_unlock(&http_server.lock);
+}
+
+/**
+ * @brief Check whether the last request to the HTTP server contains a string
+ * @param text Text to look for
+ * @return Non-zero if found
+ */
+static int http_requested(const char *text) {
+    int found;
+    
+    pthread_mutex_lock(&http_server.lock);
+    found = strstr(http_server.request, text) != NULL;
+    pthread_mutex_unlock(&http_server.lock);
+    return found;
+}
+
+/**
+ * @brief Format the SHA-256 of a string as hex
+ * @param content String to digest
+ * @param hex Receives the digest
+ */
+static void digest_hex(const char *content, char hex[SHA256_HEX_SIZE]) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_t ctx;
+    
+    sha256_init(&ctx);
+    sha256_update(&ctx, content, strlen(content));
+    sha256_final(&ctx, digest);
+    sha256_hex(digest, hex);
+}
+
+/**
+ * @brief Replace the index of the test bundle
+ * @param probe Probe of the test bundle
+ * @param text Index contents
+ * @param size Number of bytes
+ */
+static void write_index(const bundle_probe_t *probe, const char *text, size_t size) {
+    int fd = openat(probe->dirfd, LAZY_INDEX_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    
+    CHECK(fd >= 0 && write(fd, text, size) == (ssize_t)size);
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Load an index from text
+ * @param probe Probe of the test bundle
+ * @param text Index contents
+ * @param tree Receives the index
+ * @return Result of load_index()
+ */
+static int load_text(const bundle_probe_t *probe, const char *text, lazy_tree_t *tree) {
+    write_index(probe, text, strlen(text));
+    return load_index(probe, tree);
+}
+
+/**
+ * @brief Check that an index line is refused
+ * @param probe Probe of the test bundle
+ * @param text Index contents
+ * @return 1 if load_index() reports a bundle error
+ */
+static int refused(const bundle_probe_t *probe, const char *text) {
+    lazy_tree_t tree;
+    int result = load_text(probe, text, &tree);
+    
+    if (result == EXIT_SUCCESS) {
+        lazy_tree_free(&tree);
+    }
+    return result == EXIT_BUNDLE_ERROR;
+}
+
+/**
+ * @brief Parse a resource URL
+ * @param probe Probe of the test bundle
+ * @param url Value of LAZY_URL_ENV
+ * @param tree Receives the backend
+ * @return Result of configure_backend()
+ */
+static int backend(const bundle_probe_t *probe, const char *url, lazy_tree_t *tree) {
+    memset(tree, 0, sizeof(*tree));
+    setenv(LAZY_URL_ENV, url, 1);
+    return configure_backend(probe, tree);
+}
+
+/**
+ * @brief Send one request to the FUSE handler and collect its reply
+ * @param tree Mounted index; fuse_fd is one end of the socketpair
+ * @param peer Other end of the socketpair
+ * @param opcode Request opcode
+ * @param nodeid Node the request is about
+ * @param arg Request arguments
+ * @param arg_size Size of the arguments
+ * @param out Receives the reply payload
+ * @param out_size Size of out
+ * @param error Receives the positive errno of the reply
+ * @return Size of the payload, or -1 if there was no reply
+ */
+static ssize_t fuse_call(lazy_tree_t *tree, int peer, uint32_t opcode, uint64_t nodeid, const void *arg,
+                         size_t arg_size, void *out, size_t out_size, int *error) {
+    static uint64_t unique;
+    struct fuse_in_header header;
+    struct fuse_out_header *reply_header;
+    char *request = malloc(sizeof(header) + arg_size);
+    char *data = malloc(LAZY_MAX_READ);
+    char *buffer = malloc(LAZY_MAX_READ + sizeof(*reply_header));
+    ssize_t got;
+    
+    memset(&header, 0, sizeof(header));
+    header.len = (uint32_t)(sizeof(header) + arg_size);
+    header.opcode = opcode;
+    header.unique = ++unique;
+    header.nodeid = nodeid;
+    memcpy(request, &header, sizeof(header));
+    if (arg_size > 0) {
+        memcpy(request + sizeof(header), arg, arg_size);
+    }
+    handle_request(tree, request, sizeof(header) + arg_size, data);
+    
+    *error = 0;
+    got = recv(peer, buffer, LAZY_MAX_READ + sizeof(*reply_header), MSG_DONTWAIT);
+    reply_header = (struct fuse_out_header *)(void *)buffer;
+    if (got >= (ssize_t)sizeof(*reply_header)) {
+        CHECK(reply_header->unique == unique && reply_header->len == (uint32_t)got);
+        *error = -reply_header->error;
+        got -= (ssize_t)sizeof(*reply_header);
+        memcpy(out, buffer + sizeof(*reply_header), (size_t)got < out_size ? (size_t)got : out_size);
+    } else {
+        got = -1;
+    }
+    free(request);
+    free(data);
+    free(buffer);
+    return got;
+}
+
+/**
+ * @brief Look up a name in a directory through the FUSE handler
+ * @param tree Mounted index
+ * @param peer Other end of the socketpair
+ * @param parent Directory node
+ * @param name Name to look up
+ * @param out Receives the reply
+ * @return Node id, or 0 for a miss or a failed request
+ */
+static uint64_t fuse_lookup(lazy_tree_t *tree, int peer, uint64_t parent, const char *name, struct fuse_entry_out *out) {
+    int error;
+    
+    memset(out, 0, sizeof(*out));
+    if (fuse_call(tree, peer, FUSE_LOOKUP, parent, name, strlen(name) + 1, out, sizeof(*out), &error) !=
+        (ssize_t)sizeof(*out) || error != 0) {
+        return 0;
+    }
+    return out->nodeid;
+}
+
+/**
+ * @brief Check the index loader
+ * @param probe Probe of the test bundle
+ * @param valid Text of a valid index
+ */
+static void test_index(const bundle_probe_t *probe, const char *valid) {
+    const char *zero = "0000000000000000000000000000000000000000000000000000000000000000";
+    char text[4096];
+    size_t length = strlen(valid);
+    const char *tail;
+    lazy_tree_t tree;
+    uint32_t count;
+    int fd;
+    
+    CHECK(load_text(probe, valid, &tree) == EXIT_SUCCESS);
+    count = tree.count;
+    CHECK(count == 1 + LAZY_FILE_COUNT + 3);
+    CHECK(tree.total_size == 10 + 5 + 0 + 7);
+    CHECK(find_child(&tree, FUSE_ROOT_ID, "icons", 5) != 0);
+    CHECK(find_child(&tree, FUSE_ROOT_ID, "icon", 4) == 0);
+    CHECK(find_child(&tree, FUSE_ROOT_ID, "icons/app.png", 13) == 0);
+    lazy_tree_free(&tree);
+    
+    // Lines that do not describe one usable file
+    CHECK_FORMAT(text, "z%s 1 a\n", zero + 1);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s  1 a\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s -1 a\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 99999999999999999999999 a\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 5a a\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 5 \n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 5\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%.63s 5 a\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 /a\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a//b\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a/./b\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a/../b\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a/\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a\n%s 2 a\n", zero, zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a\n%s 2 a/b\n", zero, zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a/b\n%s 2 a\n", zero, zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q\n", zero);
+    CHECK(refused(probe, text));
+    CHECK_FORMAT(text, "%s 1 a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p\n", zero);
+    CHECK(load_text(probe, text, &tree) == EXIT_SUCCESS);
+    lazy_tree_free(&tree);
+    
+    // An empty index and one without a final newline are fine
+    CHECK(load_text(probe, "", &tree) == EXIT_SUCCESS && tree.count == 1);
+    lazy_tree_free(&tree);
+    CHECK_FORMAT(text, "# comment\n\n%s 3 a", zero);
+    CHECK(load_text(probe, text, &tree) == EXIT_SUCCESS && tree.count == 2);
+    lazy_tree_free(&tree);
+    
+    // Each line's digest and size land on its node; hex digits may be of either case
+    CHECK(length < sizeof(text));
+    memcpy(text, valid, length + 1);
+    for (char *line = strstr(text, "\n\n") + 2; *line; line = strchr(line, '\n') + 1) {
+        for (int i = 0; i < SHA256_DIGEST_SIZE * 2; i++) {
+            line[i] = (char)toupper((unsigned char)line[i]);
+        }
+    }
+    CHECK(load_text(probe, text, &tree) == EXIT_SUCCESS);
+    for (size_t i = 0; i < LAZY_FILE_COUNT; i++) {
+        const char *name = lazy_files[i][0];
+        uint32_t ino = FUSE_ROOT_ID;
+        char hex[SHA256_HEX_SIZE];
+        char expected[SHA256_HEX_SIZE];
+        
+        for (const char *slash; ino != 0 && (slash = strchr(name, '/')) != NULL; name = slash + 1) {
+            ino = find_child(&tree, ino, name, (size_t)(slash - name));
+            CHECK(ino != 0 && tree.nodes[ino - 1].directory);
+        }
+        ino = ino ? find_child(&tree, ino, name, strlen(name)) : 0;
+        CHECK(ino != 0);
+        if (ino != 0) {
+            sha256_hex(tree.nodes[ino - 1].digest, hex);
+            digest_hex(lazy_files[i][1], expected);
+            CHECK(strcmp(hex, expected) == 0 && tree.nodes[ino - 1].size == strlen(lazy_files[i][1]));
+            CHECK(!tree.nodes[ino - 1].directory);
+        }
+    }
+    lazy_tree_free(&tree);
+    
+    // Cut inside the last line: without its newline it stands, without its path or size it does not
+    tail = strrchr(valid, '\n');
+    while (tail > valid && tail[-1] != '\n') {
+        tail--;
+    }
+    write_index(probe, valid, length - 1);
+    CHECK(load_index(probe, &tree) == EXIT_SUCCESS && tree.count == count);
+    lazy_tree_free(&tree);
+    write_index(probe, valid, (size_t)(strrchr(valid, '/') + 1 - valid));
+    CHECK(load_index(probe, &tree) == EXIT_BUNDLE_ERROR);
+    write_index(probe, valid, (size_t)(tail - valid) + SHA256_DIGEST_SIZE * 2 + 2);
+    CHECK(load_index(probe, &tree) == EXIT_BUNDLE_ERROR);
+    write_index(probe, valid, (size_t)(tail - valid) + SHA256_DIGEST_SIZE);
+    CHECK(load_index(probe, &tree) == EXIT_BUNDLE_ERROR);
+    
+    // Too large, or not a regular file
+    fd = openat(probe->dirfd, LAZY_INDEX_FILE, O_WRONLY | O_TRUNC);
+    CHECK(fd >= 0 && ftruncate(fd, LAZY_INDEX_MAX_SIZE + 1) == 0);
+    if (fd >= 0) {
+        close(fd);
+    }
+    CHECK(load_index(probe, &tree) == EXIT_BUNDLE_ERROR);
+    CHECK(unlinkat(probe->dirfd, LAZY_INDEX_FILE, 0) == 0);
+    CHECK(load_index(probe, &tree) == EXIT_BUNDLE_ERROR);
+    CHECK(mkdirat(probe->dirfd, LAZY_INDEX_FILE, 0755) == 0);
+    CHECK(load_index(probe, &tree) == EXIT_BUNDLE_ERROR);
+    CHECK(unlinkat(probe->dirfd, LAZY_INDEX_FILE, AT_REMOVEDIR) == 0);
+}
+
+/**
+ * @brief Check the resource URL parser
+ * @param probe Probe of the test bundle
+ */
+static void test_backend(bundle_probe_t *probe) {
+    static const char *const malformed[] = {
+        "https://example.com", "ftp://example.com", "http://", "http://:80", "http://host:", "http://host:8a",
+        "http://host:1234567", "http://host:65536", "http://host:0", "http://[::1", "http://[]:80",
+    };
+    char url[MAX_PATH_LENGTH + 16];
+    lazy_tree_t tree;
+    
+    CHECK(backend(probe, "http://example.com", &tree) == EXIT_SUCCESS);
+    CHECK(tree.remote && strcmp(tree.host, "example.com") == 0 && strcmp(tree.port, "80") == 0 && tree.prefix[0] == '\0');
+    CHECK(backend(probe, "http://example.com:8080/objects//", &tree) == EXIT_SUCCESS);
+    CHECK(strcmp(tree.host, "example.com") == 0 && strcmp(tree.port, "8080") == 0 && strcmp(tree.prefix, "/objects") == 0);
+    CHECK(backend(probe, "http://[::1]:81/o", &tree) == EXIT_SUCCESS);
+    CHECK(strcmp(tree.host, "::1") == 0 && strcmp(tree.port, "81") == 0 && strcmp(tree.prefix, "/o") == 0);
+    CHECK(backend(probe, "http://host/a/b", &tree) == EXIT_SUCCESS);
+    CHECK(strcmp(tree.host, "host") == 0 && strcmp(tree.prefix, "/a/b") == 0);
+    
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        CHECK(backend(probe, malformed[i], &tree) == EXIT_BUNDLE_ERROR);
+    }
+    memset(url, 'a', sizeof(url) - 1);
+    url[sizeof(url) - 1] = '\0';
+    memcpy(url, "http://", 7);
+    CHECK(backend(probe, url, &tree) == EXIT_INVALID_ARGS);
+    
+    // Without the variable info.yaml decides, and without either only the cache is read
+    unsetenv(LAZY_URL_ENV);
+    probe->metadata.resources_url.data = "http://meta.example/x";
+    probe->metadata.resources_url.length = strlen(probe->metadata.resources_url.data);
+    memset(&tree, 0, sizeof(tree));
+    CHECK(configure_backend(probe, &tree) == EXIT_SUCCESS);
+    CHECK(tree.remote && strcmp(tree.host, "meta.example") == 0 && strcmp(tree.prefix, "/x") == 0);
+    probe->metadata.resources_url.data = "";
+    probe->metadata.resources_url.length = 0;
+    memset(&tree, 0, sizeof(tree));
+    CHECK(configure_backend(probe, &tree) == EXIT_SUCCESS && tree.remote == 0);
+}
+
+/**
+ * @brief Check the HTTP range fetcher against good and bad replies
+ * @param cache Object cache directory
+ */
+static void test_fetch(const char *cache) {
+    char temp[MAX_PATH_LENGTH];
+    char object[MAX_PATH_LENGTH];
+    char expected[128];
+    char contents[16];
+    struct sockaddr_in address;
+    socklen_t address_size = sizeof(address);
+    lazy_tree_t tree;
+    lazy_node_t node;
+    lazy_fetch_t fetch;
+    pthread_t thread;
+    int closed;
+    
+    http_server.listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(bind(http_server.listener, (struct sockaddr *)&address, sizeof(address)) == 0);
+    CHECK(listen(http_server.listener, 8) == 0);
+    CHECK(getsockname(http_server.listener, (struct sockaddr *)&address, &address_size) == 0);
+    CHECK(pthread_create(&thread, NULL, http_worker, NULL) == 0);
+    pthread_detach(thread);
+    
+    memset(&tree, 0, sizeof(tree));
+    pthread_mutex_init(&tree.lock, NULL);
+    pthread_cond_init(&tree.fetched, NULL);
+    tree.remote = 1;
+    tree.cache_limit = UINT64_MAX;
+    snprintf(tree.host, sizeof(tree.host), "127.0.0.1");
+    snprintf(tree.port, sizeof(tree.port), "%u", (unsigned)ntohs(address.sin_port));
+    snprintf(tree.prefix, sizeof(tree.prefix), "/objects");
+    CHECK(strlen(cache) < sizeof(tree.cache));
+    memcpy(tree.cache, cache, strlen(cache) + 1);
+    
+    memset(&node, 0, sizeof(node));
+    node.name = "app.txt";
+    node.size = 10;
+    memset(&fetch, 0, sizeof(fetch));
+    fetch.tree = &tree;
+    fetch.node = &node;
+    digest_hex("0123456789", fetch.hex);
+    check_path("range", temp, sizeof(temp));
+    fetch.fd = open(temp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fetch.fd >= 0 && ftruncate(fetch.fd, 10) == 0);
+    
+    // A range is asked for and written where it belongs
+    http_reply("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 3-9/10\r\nContent-Length: 7\r\n\r\n3456789", 0);
+    CHECK(fetch_range(&fetch, 3, 10) == 0);
+    CHECK_FORMAT(expected, "GET /objects/%s HTTP/1.1\r\n", fetch.hex);
+    CHECK(http_requested(expected));
+    CHECK_FORMAT(expected, "\r\nHost: 127.0.0.1:%s\r\n", tree.port);
+    CHECK(http_requested(expected));
+    CHECK(http_requested("\r\nRange: bytes=3-9\r\n"));
+    CHECK(pread(fetch.fd, contents, 7, 3) == 7 && memcmp(contents, "3456789", 7) == 0);
+    
+    http_reply("HTTP/1.1 206 Partial Content\r\ncontent-range: bytes 0-2/10\r\n\r\n012", 0);
+    CHECK(fetch_range(&fetch, 0, 3) == 0);
+    http_reply("HTTP/1.0 200 OK\r\n\r\n0123456789", 0);
+    CHECK(fetch_range(&fetch, 0, 10) == 0);
+    CHECK(pread(fetch.fd, contents, 10, 0) == 10 && memcmp(contents, "0123456789", 10) == 0);
+    
+    // Extra body bytes are not written past the range
+    http_reply("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 7-9/10\r\n\r\n789XYZ", 0);
+    CHECK(fetch_range(&fetch, 7, 10) == 0);
+    CHECK(lseek(fetch.fd, 0, SEEK_END) == 10);
+    
+    // Replies that do not deliver the range
+    http_reply("HTTP/1.1 200 OK\r\n\r\n0123456789", 0);
+    CHECK(fetch_range(&fetch, 3, 10) == -1);
+    http_reply("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 0-6/10\r\n\r\n0123456", 0);
+    CHECK(fetch_range(&fetch, 3, 10) == -1);
+    http_reply("HTTP/1.1 206 Partial Content\r\n\r\n3456789", 0);
+    CHECK(fetch_range(&fetch, 3, 10) == -1);
+    http_reply("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\na\r\n0123456789\r\n0\r\n\r\n", 0);
+    CHECK(fetch_range(&fetch, 0, 10) == -1);
+    http_reply("HTTP/1.1 404 Not Found\r\n\r\n", 0);
+    CHECK(fetch_range(&fetch, 0, 10) == -1);
+    http_reply("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 3-9/10\r\n\r\n345", 0);
+    CHECK(fetch_range(&fetch, 3, 10) == -1);
+    http_reply("SSH-2.0-OpenSSH\r\n\r\n", 0);
+    CHECK(fetch_range(&fetch, 0, 10) == -1);
+    http_reply("HTTP/1.1 200 OK\r\nX-Padding: ", 70000);
+    CHECK(fetch_range(&fetch, 0, 10) == -1);
+    http_reply(NULL, 0);
+    CHECK(fetch_range(&fetch, 0, 10) == -1);
+    close(fetch.fd);
+    unlink(temp);
+    
+    // A whole object lands in the cache only if it matches its digest
+    CHECK(parse_digest(fetch.hex, node.digest) == 0);
+    CHECK_FORMAT(object, "%s/%s", cache, fetch.hex);
+    http_reply("HTTP/1.1 200 OK\r\n\r\n0123456789", 0);
+    CHECK(fetch_object(&tree, &node, fetch.hex, object) == 0);
+    CHECK(access(object, R_OK) == 0);
+    unlink(object);
+    
+    http_reply("HTTP/1.1 200 OK\r\n\r\n0123456788", 0);
+    CHECK(fetch_object(&tree, &node, fetch.hex, object) == -1);
+    CHECK(access(object, F_OK) != 0);
+    CHECK_FORMAT(temp, "%s.%ld.part", object, (long)getpid());
+    CHECK(access(temp, F_OK) != 0);
+    
+    // Failed ranges are retried before the object is given up
+    http_reply("HTTP/1.1 503 Service Unavailable\r\n\r\n", 0);
+    CHECK(fetch_object(&tree, &node, fetch.hex, object) == -1);
+    CHECK(http_server.connections == LAZY_RETRIES);
+    
+    tree.remote = 0;
+    CHECK(fetch_object(&tree, &node, fetch.hex, object) == -1);
+    tree.remote = 1;
+    
+    // Nobody listening
+    closed = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    address.sin_port = 0;
+    address_size = sizeof(address);
+    CHECK(bind(closed, (struct sockaddr *)&address, sizeof(address)) == 0);
+    CHECK(getsockname(closed, (struct sockaddr *)&address, &address_size) == 0);
+    snprintf(tree.port, sizeof(tree.port), "%u", (unsigned)ntohs(address.sin_port));
+    close(closed);
+    freeaddrinfo(tree.address);
+    tree.address = NULL;
+    fetch.fd = -1;
+    CHECK(fetch_range(&fetch, 0, 10) == -1);
+    
+    freeaddrinfo(tree.address);
+}
+
+/**
+ * @brief Check the FUSE request handler
+ * @param probe Probe of the test bundle
+ * @param valid Text of a valid index
+ * @param cache Object cache directory
+ */
+static void test_fuse(const bundle_probe_t *probe, const char *valid, const char *cache) {
+    char *text = malloc(strlen(valid) + LAZY_MANY_FILES * 96);
+    char object[MAX_PATH_LENGTH];
+    char hex[SHA256_HEX_SIZE];
+    char seen[LAZY_MANY_FILES];
+    char buffer[LAZY_MAX_READ];
+    struct fuse_entry_out entry;
+    struct fuse_attr_out attr;
+    struct fuse_init_in init;
+    struct fuse_init_out init_out;
+    struct fuse_open_in open_in;
+    struct fuse_open_out open_out;
+    struct fuse_read_in read_in;
+    struct fuse_release_in release_in;
+    struct fuse_statfs_out statfs_out;
+    struct fuse_in_header short_header;
+    lazy_tree_t tree;
+    uint64_t app;
+    uint64_t icons;
+    uint64_t many;
+    uint64_t offset = 0;
+    unsigned int names = 0;
+    int sockets[2];
+    ssize_t got;
+    size_t used;
+    int error;
+    int fd;
+    
+    // The test index plus a directory too large for one readdir reply
+    used = (size_t)sprintf(text, "%s", valid);
+    for (int i = 0; i < LAZY_MANY_FILES; i++) {
+        used += (size_t)sprintf(text + used, "%s 1 many/file%03d\n",
+                                "0000000000000000000000000000000000000000000000000000000000000000", i);
+    }
+    CHECK(load_text(probe, text, &tree) == EXIT_SUCCESS);
+    free(text);
+    CHECK(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == 0);
+    pthread_mutex_init(&tree.lock, NULL);
+    pthread_cond_init(&tree.fetched, NULL);
+    tree.fuse_fd = sockets[0];
+    tree.uid = getuid();
+    tree.gid = getgid();
+    tree.cache_limit = UINT64_MAX;
+    CHECK(strlen(cache) < sizeof(tree.cache));
+    memcpy(tree.cache, cache, strlen(cache) + 1);
+    
+    // Protocol negotiation
+    memset(&init, 0, sizeof(init));
+    init.major = FUSE_KERNEL_VERSION;
+    init.minor = FUSE_KERNEL_MINOR_VERSION;
+    init.flags = FUSE_ASYNC_READ | FUSE_WRITEBACK_CACHE;
+    got = fuse_call(&tree, sockets[1], FUSE_INIT, 0, &init, sizeof(init), &init_out, sizeof(init_out), &error);
+    CHECK(got == (ssize_t)sizeof(init_out) && error == 0);
+    CHECK(init_out.major == FUSE_KERNEL_VERSION && init_out.flags == FUSE_ASYNC_READ);
+    init.minor = 22;
+    got = fuse_call(&tree, sockets[1], FUSE_INIT, 0, &init, sizeof(init), &init_out, sizeof(init_out), &error);
+    CHECK(got == FUSE_COMPAT_22_INIT_OUT_SIZE && error == 0);
+    init.major = FUSE_KERNEL_VERSION + 1;
+    got = fuse_call(&tree, sockets[1], FUSE_INIT, 0, &init, sizeof(init), &init_out, sizeof(init_out), &error);
+    CHECK(got == 8 && error == 0 && init_out.major == FUSE_KERNEL_VERSION);
+    init.major = FUSE_KERNEL_VERSION - 1;
+    got = fuse_call(&tree, sockets[1], FUSE_INIT, 0, &init, sizeof(init), &init_out, sizeof(init_out), &error);
+    CHECK(got == 0 && error == EPROTO);
+    
+    // Lookups: hits carry attributes, misses are a zero node id
+    app = fuse_lookup(&tree, sockets[1], FUSE_ROOT_ID, "app.txt", &entry);
+    CHECK(app != 0 && entry.attr.size == 10 && entry.attr.mode == (S_IFREG | 0444) && entry.attr.ino == app);
+    icons = fuse_lookup(&tree, sockets[1], FUSE_ROOT_ID, "icons", &entry);
+    CHECK(icons != 0 && entry.attr.mode == (S_IFDIR | 0555));
+    CHECK(fuse_lookup(&tree, sockets[1], icons, "app.png", &entry) != 0 && entry.attr.size == 5);
+    CHECK(fuse_lookup(&tree, sockets[1], FUSE_ROOT_ID, "missing", &entry) == 0 && entry.entry_valid != 0);
+    CHECK(fuse_lookup(&tree, sockets[1], FUSE_ROOT_ID, "icons/app.png", &entry) == 0);
+    CHECK(fuse_lookup(&tree, sockets[1], app, "app.txt", &entry) == 0);
+    many = fuse_lookup(&tree, sockets[1], FUSE_ROOT_ID, "many", &entry);
+    CHECK(many != 0);
+    
+    // Node ids outside the index
+    CHECK(fuse_call(&tree, sockets[1], FUSE_GETATTR, 0, NULL, 0, &attr, sizeof(attr), &error) == 0 && error == ESTALE);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_GETATTR, tree.count + 1, NULL, 0, &attr, sizeof(attr), &error) == 0 &&
+          error == ESTALE);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_LOOKUP, UINT64_MAX, "a", 2, &entry, sizeof(entry), &error) == 0 &&
+          error == ESTALE);
+    got = fuse_call(&tree, sockets[1], FUSE_GETATTR, FUSE_ROOT_ID, NULL, 0, &attr, sizeof(attr), &error);
+    CHECK(got == (ssize_t)sizeof(attr) && error == 0 && attr.attr.mode == (S_IFDIR | 0555) && attr.attr.ino == FUSE_ROOT_ID);
+    
+    // Only files open, and only for reading; only directories list
+    memset(&open_in, 0, sizeof(open_in));
+    open_in.flags = O_RDONLY;
+    CHECK(fuse_call(&tree, sockets[1], FUSE_OPEN, icons, &open_in, sizeof(open_in), &open_out, sizeof(open_out), &error) == 0 &&
+          error == EISDIR);
+    open_in.flags = O_WRONLY;
+    CHECK(fuse_call(&tree, sockets[1], FUSE_OPEN, app, &open_in, sizeof(open_in), &open_out, sizeof(open_out), &error) == 0 &&
+          error == EROFS);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_OPENDIR, app, &open_in, sizeof(open_in), &open_out, sizeof(open_out), &error) == 0 &&
+          error == ENOTDIR);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_OPENDIR, many, &open_in, sizeof(open_in), &open_out, sizeof(open_out), &error) ==
+          (ssize_t)sizeof(open_out) && error == 0);
+    
+    // A file that is neither cached nor fetchable fails to open
+    open_in.flags = O_RDONLY;
+    CHECK(fuse_call(&tree, sockets[1], FUSE_OPEN, app, &open_in, sizeof(open_in), &open_out, sizeof(open_out), &error) == 0 &&
+          error == EIO);
+    
+    // A cached object opens and reads
+    digest_hex("0123456789", hex);
+    CHECK_FORMAT(object, "%s/%s", cache, hex);
+    fd = open(object, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && write(fd, "0123456789", 10) == 10);
+    if (fd >= 0) {
+        close(fd);
+    }
+    got = fuse_call(&tree, sockets[1], FUSE_OPEN, app, &open_in, sizeof(open_in), &open_out, sizeof(open_out), &error);
+    CHECK(got == (ssize_t)sizeof(open_out) && error == 0);
+    memset(&read_in, 0, sizeof(read_in));
+    read_in.fh = open_out.fh;
+    read_in.offset = 2;
+    read_in.size = 4;
+    got = fuse_call(&tree, sockets[1], FUSE_READ, app, &read_in, sizeof(read_in), buffer, sizeof(buffer), &error);
+    CHECK(got == 4 && error == 0 && memcmp(buffer, "2345", 4) == 0);
+    read_in.offset = 8;
+    read_in.size = 100;
+    got = fuse_call(&tree, sockets[1], FUSE_READ, app, &read_in, sizeof(read_in), buffer, sizeof(buffer), &error);
+    CHECK(got == 2 && error == 0 && memcmp(buffer, "89", 2) == 0);
+    memset(&release_in, 0, sizeof(release_in));
+    release_in.fh = open_out.fh;
+    CHECK(fuse_call(&tree, sockets[1], FUSE_RELEASE, app, &release_in, sizeof(release_in), buffer, sizeof(buffer), &error) == 0 &&
+          error == 0);
+    
+    // Listing a large directory a page at a time sees every entry once
+    memset(seen, 0, sizeof(seen));
+    for (int page = 0; page < 1000; page++) {
+        memset(&read_in, 0, sizeof(read_in));
+        read_in.offset = offset;
+        read_in.size = 256;
+        got = fuse_call(&tree, sockets[1], FUSE_READDIR, many, &read_in, sizeof(read_in), buffer, sizeof(buffer), &error);
+        CHECK(got >= 0 && got <= 256 && error == 0);
+        if (got <= 0) {
+            break;
+        }
+        for (size_t pos = 0; pos < (size_t)got; ) {
+            const struct fuse_dirent *dirent = (const struct fuse_dirent *)(const void *)(buffer + pos);
+            int index;
+            
+            if (dirent->namelen == 1 && dirent->name[0] == '.') {
+                CHECK(dirent->ino == many && dirent->type == DT_DIR);
+            } else if (dirent->namelen == 2 && memcmp(dirent->name, "..", 2) == 0) {
+                CHECK(dirent->ino == FUSE_ROOT_ID && dirent->type == DT_DIR);
+            } else if (dirent->namelen == 7 && memcmp(dirent->name, "file", 4) == 0 &&
+                       sscanf(dirent->name + 4, "%3d", &index) == 1 && index >= 0 && index < LAZY_MANY_FILES) {
+                CHECK(seen[index] == 0 && dirent->type == DT_REG);
+                seen[index] = 1;
+            } else {
+                CHECK(!"unexpected directory entry");
+            }
+            names++;
+            offset = dirent->off;
+            pos += FUSE_DIRENT_SIZE(dirent);
+        }
+    }
+    CHECK(names == LAZY_MANY_FILES + 2);
+    CHECK(memchr(seen, 0, sizeof(seen)) == NULL);
+    
+    // A buffer too small for any entry gets an empty reply
+    memset(&read_in, 0, sizeof(read_in));
+    read_in.size = 8;
+    CHECK(fuse_call(&tree, sockets[1], FUSE_READDIR, many, &read_in, sizeof(read_in), buffer, sizeof(buffer), &error) == 0 &&
+          error == 0);
+    
+    got = fuse_call(&tree, sockets[1], FUSE_STATFS, FUSE_ROOT_ID, NULL, 0, &statfs_out, sizeof(statfs_out), &error);
+    CHECK(got == (ssize_t)sizeof(statfs_out) && error == 0 && statfs_out.st.files == tree.count);
+    CHECK(statfs_out.st.blocks == (tree.total_size + 4095) / 4096);
+    
+    // Requests that get no reply, or no more than ENOSYS
+    CHECK(fuse_call(&tree, sockets[1], FUSE_FORGET, app, buffer, 8, buffer, sizeof(buffer), &error) == -1);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_INTERRUPT, 0, buffer, 8, buffer, sizeof(buffer), &error) == -1);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_WRITE, app, buffer, 64, buffer, sizeof(buffer), &error) == 0 &&
+          error == ENOSYS);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_MKDIR, FUSE_ROOT_ID, "new", 4, buffer, sizeof(buffer), &error) == 0 &&
+          error == ENOSYS);
+    
+    // Requests shorter than their header or their arguments
+    memset(&short_header, 0, sizeof(short_header));
+    short_header.len = sizeof(short_header) - 1;
+    short_header.opcode = FUSE_GETATTR;
+    short_header.nodeid = FUSE_ROOT_ID;
+    text = malloc(sizeof(short_header) - 1);
+    memcpy(text, &short_header, sizeof(short_header) - 1);
+    handle_request(&tree, text, sizeof(short_header) - 1, buffer);
+    free(text);
+    CHECK(recv(sockets[1], buffer, sizeof(buffer), MSG_DONTWAIT) == -1 && errno == EAGAIN);
+    short_header.len = sizeof(short_header) + 16;
+    handle_request(&tree, (const char *)&short_header, sizeof(short_header), buffer);
+    CHECK(recv(sockets[1], buffer, sizeof(buffer), MSG_DONTWAIT) == -1 && errno == EAGAIN);
+    
+    CHECK(fuse_call(&tree, sockets[1], FUSE_INIT, 0, &init, 8, buffer, sizeof(buffer), &error) == 0 && error == EINVAL);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_LOOKUP, FUSE_ROOT_ID, "app.txt", 7, buffer, sizeof(buffer), &error) == 0 &&
+          error == EINVAL);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_LOOKUP, FUSE_ROOT_ID, NULL, 0, buffer, sizeof(buffer), &error) == 0 &&
+          error == EINVAL);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_OPEN, app, NULL, 0, buffer, sizeof(buffer), &error) == 0 && error == EINVAL);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_READ, app, &read_in, 16, buffer, sizeof(buffer), &error) == 0 &&
+          error == EINVAL);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_READDIR, many, &read_in, 16, buffer, sizeof(buffer), &error) == 0 &&
+          error == EINVAL);
+    CHECK(fuse_call(&tree, sockets[1], FUSE_RELEASE, app, &release_in, 4, buffer, sizeof(buffer), &error) == 0 &&
+          error == EINVAL);
+    
+    CHECK(fuse_call(&tree, sockets[1], FUSE_DESTROY, 0, NULL, 0, buffer, sizeof(buffer), &error) == 0 && error == 0);
+    close(sockets[0]);
+    close(sockets[1]);
+    lazy_tree_free(&tree);
+}
+
+int main(void) {
+    char bundle[MAX_PATH_LENGTH];
+    char cache[MAX_PATH_LENGTH];
+    char valid[1024];
+    char hex[SHA256_HEX_SIZE];
+    bundle_probe_t probe;
+    size_t used = 0;
+    
+    log_set_level(LOG_ERROR);
+    check_path("Lazy.app", bundle, sizeof(bundle));
+    check_path("objects", cache, sizeof(cache));
+    CHECK(mkdir(bundle, 0755) == 0 && mkdir(cache, 0755) == 0);
+    
+    memset(&probe, 0, sizeof(probe));
+    CHECK(strlen(bundle) < sizeof(probe.path));
+    memcpy(probe.path, bundle, strlen(bundle) + 1);
+    probe.dirfd = open(bundle, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    CHECK(probe.dirfd >= 0);
+    
+    used += (size_t)snprintf(valid + used, sizeof(valid) - used, "# Lazy test index\n\n");
+    for (size_t i = 0; i < LAZY_FILE_COUNT; i++) {
+        digest_hex(lazy_files[i][1], hex);
+        used += (size_t)snprintf(valid + used, sizeof(valid) - used, "%s %zu %s\n", hex, strlen(lazy_files[i][1]),
+                                 lazy_files[i][0]);
+    }
+    CHECK(used < sizeof(valid));
+    
+    test_index(&probe, valid);
+    test_backend(&probe);
+    test_fetch(cache);
+    test_fuse(&probe, valid, cache);
+    
+    close(probe.dirfd);
+    return check_finish("test_lazy");
+}
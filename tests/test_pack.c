@@ -0,0 +1,406 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_pack.c
+ * @brief Tests of the .vapp image reader against truncated and corrupt images
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A small bundle is packed with pack_bundle() and its layout checked:
+ * names in strict order with parents first, file data page-aligned past
+ * the index. Each header field is then pushed out of range, the image is
+ * cut short at the index and data boundaries, and the index is damaged
+ * both with the checksum left stale and with it fixed up afterwards, so
+ * the structural checks behind the checksum are exercised too.
+ */
+
+#include "../src/pack.c"
+
+#include "check.h"
+
+/**
+ * @brief Create the bundle that is packed
+ * @param root Bundle directory to create
+ */
+static void make_bundle(const char *root) {
+    char path[MAX_PATH_LENGTH];
+    
+    mkdir(root, 0755);
+    CHECK_FORMAT(path, "%s/exec", root);
+    mkdir(path, 0755);
+    CHECK_FORMAT(path, "%s/library", root);
+    mkdir(path, 0755);
+    CHECK_FORMAT(path, "%s/resources", root);
+    mkdir(path, 0755);
+    CHECK_FORMAT(path, "%s/resources/sub", root);
+    mkdir(path, 0755);
+    check_write_file(root, "exec/base", "#!/bin/sh\nexit 0\n", 0755);
+    check_write_file(root, "info.yaml", "name: Packed\nversion: 1.0\n", 0644);
+    check_write_file(root, "library/libpacked.so", "not really a library\n", 0644);
+    check_write_file(root, "resources/sub/a.txt", "resource a\n", 0644);
+    CHECK_FORMAT(path, "%s/resources/link", root);
+    CHECK(symlink("sub/a.txt", path) == 0);
+}
+
+/**
+ * @brief Pack the bundle again with different metadata, making a new image version
+ * @param root Bundle directory
+ * @param image_path Image to replace
+ * @param metadata New info.yaml, of a length no earlier version had
+ */
+static void repack(const char *root, const char *image_path, const char *metadata) {
+    check_write_file(root, "info.yaml", metadata, 0644);
+    CHECK(pack_bundle(root, image_path) == EXIT_SUCCESS);
+}
+
+/**
+ * @brief Validate a copy of an image placed in an allocation of exactly its size
+ * @param data Image bytes
+ * @param size Number of bytes
+ * @return Result of image_valid()
+ */
+static int valid_copy(const char *data, size_t size) {
+    char *copy = check_copy(data, size);
+    pack_image_t image;
+    int valid;
+    
+    image.map = copy;
+    image.size = size;
+    valid = image_valid(&image);
+    free(copy);
+    return valid;
+}
+
+/**
+ * @brief Validate the first bytes of an image, with a header claiming that size
+ * @param data Valid image
+ * @param length Number of bytes kept, at least a header's worth
+ * @return Result of image_valid()
+ */
+static int valid_cut(const char *data, size_t length) {
+    char *copy = check_copy(data, length);
+    int valid;
+    
+    ((pack_header_t *)copy)->size = length;
+    valid = valid_copy(copy, length);
+    free(copy);
+    return valid;
+}
+
+/**
+ * @brief Recompute the index checksum of an image after editing it
+ * @param data Image bytes
+ */
+static void reseal(char *data) {
+    pack_header_t *header = (pack_header_t *)data;
+    
+    header->checksum = fnv1a(0x811c9dc5u, data + sizeof(*header), header->index_size);
+}
+
+/**
+ * @brief Find an index entry by name
+ * @param data Image bytes
+ * @param name Entry name
+ * @return Entry, or NULL
+ */
+static pack_entry_t *entry_named(char *data, const char *name) {
+    pack_header_t *header = (pack_header_t *)data;
+    pack_entry_t *entries = (pack_entry_t *)(data + sizeof(*header));
+    
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        if (strcmp(data + sizeof(*header) + entries[i].name_offset, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Apply one edit to a fresh copy of the image and validate it
+ * @param data Valid image
+ * @param size Image size
+ * @param name Entry to edit
+ * @param edit Edit to make to the entry
+ * @param sealed Non-zero to fix up the checksum afterwards
+ * @return Result of image_valid(), or -1 if the entry is missing
+ */
+static int valid_after(const char *data, size_t size, const char *name,
+                       void (*edit)(char *data, pack_entry_t *entry), int sealed) {
+    char *copy = check_copy(data, size);
+    pack_entry_t *entry;
+    int valid = -1;
+    
+    entry = entry_named(copy, name);
+    if (entry != NULL) {
+        edit(copy, entry);
+        if (sealed) {
+            reseal(copy);
+        }
+        valid = valid_copy(copy, size);
+    }
+    free(copy);
+    return valid;
+}
+
+static void edit_name_offset(char *data, pack_entry_t *entry) {
+    entry->name_offset = (uint32_t)((pack_header_t *)data)->index_size;
+}
+
+static void edit_name_inside_entries(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->name_offset = 0;
+}
+
+static void edit_name_length(char *data, pack_entry_t *entry) {
+    entry->name_length = (uint32_t)((pack_header_t *)data)->index_size;
+}
+
+static void edit_name_unterminated(char *data, pack_entry_t *entry) {
+    data[sizeof(pack_header_t) + entry->name_offset + entry->name_length] = 'x';
+}
+
+static void edit_name_dotdot(char *data, pack_entry_t *entry) {
+    memcpy(data + sizeof(pack_header_t) + entry->name_offset, "..", 3);
+    entry->name_length = 2;
+}
+
+static void edit_name_order(char *data, pack_entry_t *entry) {
+    data[sizeof(pack_header_t) + entry->name_offset] = 'z';
+}
+
+static void edit_offset_misaligned(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->offset += 1;
+}
+
+static void edit_offset_in_index(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->offset = 0;
+}
+
+static void edit_size_past_end(char *data, pack_entry_t *entry) {
+    entry->size = ((pack_header_t *)data)->size - entry->offset + 1;
+}
+
+static void edit_size_wraps(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->size = UINT64_MAX;
+}
+
+static void edit_mode_fifo(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->mode = S_IFIFO | 0644;
+}
+
+static void edit_parent_not_directory(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->mode = S_IFREG | 0644;
+    entry->offset = PACK_ALIGNMENT;
+    entry->size = 0;
+}
+
+static void edit_directory_size(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->size = 1;
+}
+
+static void edit_symlink_empty(char *data, pack_entry_t *entry) {
+    (void)data;
+    entry->size = 0;
+}
+
+int main(void) {
+    char bundle[MAX_PATH_LENGTH];
+    char image_path[MAX_PATH_LENGTH];
+    char unpacked[MAX_PATH_LENGTH];
+    char first[MAX_PATH_LENGTH];
+    char second[MAX_PATH_LENGTH];
+    char cache[MAX_PATH_LENGTH];
+    char orphan[MAX_PATH_LENGTH];
+    char fresh[MAX_PATH_LENGTH];
+    char buffer[64];
+    struct timespec old[2] = { { 1, 0 }, { 1, 0 } };
+    pack_header_t *header;
+    bundle_probe_t probe;
+    bundle_probe_t newer;
+    uint64_t data_start;
+    uint64_t data_end = 0;
+    uint64_t stored;
+    size_t size = 0;
+    char *data;
+    int fd;
+    
+    log_set_level(LOG_ERROR);
+    check_path("Packed.app", bundle, sizeof(bundle));
+    check_path("Packed.vapp", image_path, sizeof(image_path));
+    make_bundle(bundle);
+    
+    CHECK(pack_bundle(bundle, image_path) == EXIT_SUCCESS);
+    data = check_read_file(image_path, &size);
+    CHECK(data != NULL);
+    if (data == NULL) {
+        return check_finish("test_pack");
+    }
+    header = (pack_header_t *)data;
+    CHECK(valid_copy(data, size));
+    CHECK(header->entry_count == 9);
+    CHECK(size % PACK_ALIGNMENT == 0);
+    
+    // Names strictly sorted, directories empty, file data page-aligned past the index
+    data_start = sizeof(*header) + header->index_size;
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const pack_entry_t *entries = (const pack_entry_t *)(data + sizeof(*header));
+        const char *name = data + sizeof(*header) + entries[i].name_offset;
+        
+        CHECK(i == 0 || strcmp(data + sizeof(*header) + entries[i - 1].name_offset, name) < 0);
+        if (S_ISDIR(entries[i].mode)) {
+            CHECK(entries[i].size == 0);
+        } else {
+            CHECK(entries[i].offset % PACK_ALIGNMENT == 0 && entries[i].offset >= data_start);
+            if (entries[i].offset + entries[i].size > data_end) {
+                data_end = entries[i].offset + entries[i].size;
+            }
+        }
+    }
+    CHECK(entry_named(data, "resources/link") != NULL && S_ISLNK(entry_named(data, "resources/link")->mode));
+    
+    // The header describes exactly the file it heads
+    CHECK(valid_copy(data, size - 1) == 0);
+    CHECK(valid_copy(data, sizeof(*header) - 1) == 0);
+    CHECK(valid_cut(data, sizeof(*header)) == 0);
+    CHECK(valid_cut(data, (size_t)data_start) == 0);
+    CHECK(valid_cut(data, (size_t)data_end - 1) == 0);
+    
+    // Header fields out of range
+    header->magic ^= 1;
+    CHECK(valid_copy(data, size) == 0);
+    header->magic ^= 1;
+    header->version = PACK_VERSION + 1;
+    CHECK(valid_copy(data, size) == 0);
+    header->version = PACK_VERSION;
+    stored = header->index_size;
+    header->index_size = size - sizeof(*header) + 1;
+    CHECK(valid_copy(data, size) == 0);
+    header->index_size = (uint64_t)PACK_MAX_INDEX + 1;
+    CHECK(valid_copy(data, size) == 0);
+    header->index_size = stored;
+    header->entry_count = PACK_MAX_ENTRIES + 1;
+    CHECK(valid_copy(data, size) == 0);
+    header->entry_count = (uint32_t)(header->index_size / sizeof(pack_entry_t)) + 1;
+    CHECK(valid_copy(data, size) == 0);
+    
+    // The entry count is not checksummed: any prefix of the entries is still a tree
+    header->entry_count = 1;
+    CHECK(valid_copy(data, size));
+    header->entry_count = 9;
+    
+    // The checksum covers the entries and the names alike
+    data[sizeof(*header) + offsetof(pack_entry_t, size)] ^= 0x01;
+    CHECK(valid_copy(data, size) == 0);
+    data[sizeof(*header) + offsetof(pack_entry_t, size)] ^= 0x01;
+    data[sizeof(*header) + header->index_size - 2] ^= 0x20;
+    CHECK(valid_copy(data, size) == 0);
+    data[sizeof(*header) + header->index_size - 2] ^= 0x20;
+    header->checksum++;
+    CHECK(valid_copy(data, size) == 0);
+    header->checksum--;
+    CHECK(valid_copy(data, size));
+    
+    // Structural damage behind a matching checksum
+    CHECK(valid_after(data, size, "exec/base", edit_name_offset, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_name_inside_entries, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_name_length, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_name_unterminated, 1) == 0);
+    CHECK(valid_after(data, size, "exec", edit_name_dotdot, 1) == 0);
+    CHECK(valid_after(data, size, "exec", edit_name_order, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_offset_misaligned, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_offset_in_index, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_size_past_end, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_size_wraps, 1) == 0);
+    CHECK(valid_after(data, size, "info.yaml", edit_mode_fifo, 1) == 0);
+    CHECK(valid_after(data, size, "resources/sub", edit_parent_not_directory, 1) == 0);
+    CHECK(valid_after(data, size, "library", edit_directory_size, 1) == 0);
+    CHECK(valid_after(data, size, "resources/link", edit_symlink_empty, 1) == 0);
+    CHECK(valid_after(data, size, "exec/base", edit_offset_misaligned, 0) == 0);
+    
+    // The intact image unpacks to the same tree; a damaged one is refused
+    CHECK(pack_probe_open(&probe, image_path) == EXIT_SUCCESS);
+    CHECK_FORMAT(unpacked, "%s/resources/link", probe.path);
+    fd = open(unpacked, O_RDONLY);
+    CHECK(fd >= 0 && read(fd, buffer, sizeof(buffer)) == 11 && memcmp(buffer, "resource a\n", 11) == 0);
+    if (fd >= 0) {
+        close(fd);
+    }
+    CHECK(bundle_probe_is_file(&probe, COMPONENT_EXEC));
+    CHECK(bundle_probe_is_directory(&probe, COMPONENT_LIBRARY));
+    CHECK(probe.image_lock >= HANDOFF_FIRST_FD + HANDOFF_MAX_FDS && (fcntl(probe.image_lock, F_GETFD) & FD_CLOEXEC) == 0);
+    
+    // A replaced version stays while a launch holds it and goes once none does
+    CHECK_FORMAT(first, "%s", probe.path);
+    CHECK_FORMAT(cache, "%s", probe.path);
+    *strrchr(cache, '/') = '\0';
+    repack(bundle, image_path, "name: Packed\nversion: 2.0.0\n");
+    CHECK(pack_probe_open(&newer, image_path) == EXIT_SUCCESS);
+    CHECK(strcmp(newer.path, first) != 0);
+    CHECK(access(first, F_OK) == 0);
+    CHECK_FORMAT(second, "%s", newer.path);
+    bundle_probe_close(&probe);
+    bundle_probe_close(&newer);
+    
+    // Temporary trees are removed once unlocked and old enough to be a dead launch's
+    CHECK_FORMAT(orphan, "%s/dead%s1", cache, PACK_TEMP_SUFFIX);
+    CHECK(mkdir(orphan, 0755) == 0);
+    CHECK(utimensat(AT_FDCWD, orphan, old, 0) == 0);
+    CHECK_FORMAT(fresh, "%s/busy%s2", cache, PACK_TEMP_SUFFIX);
+    CHECK(mkdir(fresh, 0755) == 0);
+    repack(bundle, image_path, "name: Packed\nversion: 3.0.0.0\n");
+    CHECK(pack_probe_open(&probe, image_path) == EXIT_SUCCESS);
+    CHECK(access(first, F_OK) != 0 && access(second, F_OK) != 0);
+    CHECK(access(orphan, F_OK) != 0);
+    CHECK(access(fresh, F_OK) == 0);
+    CHECK(access(probe.path, F_OK) == 0);
+    bundle_probe_close(&probe);
+    
+    fd = open(image_path, O_WRONLY);
+    CHECK(fd >= 0 && pwrite(fd, "\xff", 1, sizeof(*header) + 3) == 1);
+    if (fd >= 0) {
+        close(fd);
+    }
+    CHECK(pack_probe_open(&probe, image_path) == EXIT_BUNDLE_ERROR);
+    bundle_probe_close(&probe);
+    
+    free(data);
+    return check_finish("test_pack");
+}
@@ -0,0 +1,621 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_png.c
+ * @brief Tests of the PNG decoder against valid, truncated and corrupt files
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * The sample images cover stored, fixed and dynamic deflate blocks, every
+ * row filter, sub-byte and 16-bit samples, palettes, tRNS and Adam7. Each
+ * one is decoded intact and compared against the formula it was drawn
+ * from, and must not decode without its IEND or with PLTE missing.
+ * Small grayscale files built around a stored deflate block check the
+ * chunk rules themselves: IHDR first, IDAT data concatenated, unknown
+ * chunks skipped, and exactly as many filtered rows as the header says.
+ */
+
+#include "../src/png.c"
+
+#include "check.h"
+
+static const uint8_t png_rgba8[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x05,
+    0x08, 0x06, 0x00, 0x00, 0x00, 0x89, 0x9a, 0xf6, 0xd8, 0x00, 0x00, 0x00,
+    0x45, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x60, 0x60, 0xf8,
+    0xaf, 0xc1, 0x20, 0xf2, 0x35, 0x80, 0x41, 0xe3, 0x75, 0x05, 0x83, 0xcd,
+    0xc3, 0x05, 0x0c, 0x01, 0xd7, 0x4f, 0x30, 0xa4, 0x9c, 0xfd, 0xc0, 0x50,
+    0x71, 0x98, 0x91, 0xc1, 0x48, 0x04, 0x24, 0xf9, 0x0d, 0x1b, 0x66, 0x02,
+    0x4a, 0x32, 0xe0, 0xc2, 0xcc, 0x0c, 0x29, 0x1a, 0x0d, 0x22, 0x92, 0x22,
+    0xbf, 0xb1, 0x61, 0x16, 0xb0, 0x2a, 0x06, 0xec, 0x18, 0x00, 0xdb, 0x42,
+    0x1e, 0xab, 0x94, 0xcd, 0x1e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+    0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+static const uint8_t png_palette2_interlaced[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x09,
+    0x02, 0x03, 0x00, 0x00, 0x01, 0xea, 0xf8, 0xde, 0x15, 0x00, 0x00, 0x00,
+    0x0c, 0x50, 0x4c, 0x54, 0x45, 0x0a, 0x14, 0x1e, 0x28, 0x32, 0x3c, 0x46,
+    0x50, 0x5a, 0x64, 0x6e, 0x78, 0xc6, 0x48, 0x77, 0xdf, 0x00, 0x00, 0x00,
+    0x03, 0x74, 0x52, 0x4e, 0x53, 0xff, 0x80, 0x00, 0x7f, 0x6d, 0x68, 0x78,
+    0x00, 0x00, 0x00, 0x3b, 0x49, 0x44, 0x41, 0x54, 0x78, 0x01, 0x01, 0x30,
+    0x00, 0xcf, 0xff, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0xa0, 0x01, 0xa0, 0x02, 0x00, 0x00, 0x22, 0x00, 0x01, 0x22,
+    0xde, 0x00, 0x77, 0x01, 0x77, 0x02, 0x00, 0x03, 0x3c, 0x04, 0x00, 0x00,
+    0xb1, 0xb1, 0x80, 0x01, 0xb1, 0x00, 0xcf, 0x02, 0x00, 0x00, 0x00, 0x03,
+    0x59, 0x00, 0xe8, 0x94, 0x63, 0x08, 0x46, 0x98, 0x24, 0xda, 0x36, 0x00,
+    0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+static const uint8_t png_rgb16_key[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x03,
+    0x10, 0x02, 0x00, 0x00, 0x00, 0x6b, 0x06, 0xe5, 0xd2, 0x00, 0x00, 0x00,
+    0x06, 0x74, 0x52, 0x4e, 0x53, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x55,
+    0x25, 0x9f, 0xda, 0x00, 0x00, 0x00, 0x26, 0x49, 0x44, 0x41, 0x54, 0x78,
+    0x9c, 0x63, 0x60, 0x00, 0x82, 0x06, 0x06, 0x41, 0x41, 0x10, 0xa9, 0xa4,
+    0x04, 0x22, 0x8d, 0x8d, 0x41, 0x24, 0x23, 0x03, 0x90, 0x0b, 0x91, 0x60,
+    0x40, 0x21, 0x99, 0x18, 0xc0, 0xea, 0x30, 0x49, 0x00, 0xe8, 0xc6, 0x05,
+    0x0a, 0xe2, 0x86, 0x26, 0xa9, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e,
+    0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+static const uint8_t png_gray8_large[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x40,
+    0x08, 0x00, 0x00, 0x00, 0x00, 0x8f, 0x02, 0x2e, 0x02, 0x00, 0x00, 0x05,
+    0xba, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0xad, 0x96, 0x0d, 0x4c, 0x13,
+    0x57, 0x00, 0xc7, 0xdf, 0x41, 0x81, 0x02, 0x05, 0x0a, 0x94, 0x52, 0x28,
+    0x94, 0x42, 0x4b, 0x29, 0xfd, 0xee, 0xd1, 0xf6, 0x0a, 0x1c, 0x2d, 0x31,
+    0x2c, 0x63, 0x0c, 0x0d, 0x61, 0xc8, 0x98, 0x03, 0x86, 0x80, 0x8e, 0x4d,
+    0xc2, 0x18, 0x12, 0xc3, 0x94, 0x11, 0xa7, 0xc4, 0x0f, 0x74, 0x8a, 0x80,
+    0x8a, 0xd8, 0x49, 0x41, 0x60, 0xa8, 0xe0, 0xaa, 0xd1, 0x0d, 0xd8, 0x47,
+    0x50, 0x91, 0xa1, 0x63, 0x0c, 0x8d, 0xc9, 0x70, 0x63, 0x8e, 0x28, 0x99,
+    0xcc, 0x38, 0x25, 0x06, 0x91, 0x31, 0xd4, 0xdd, 0x5d, 0xa9, 0x94, 0x22,
+    0xe8, 0xd6, 0xfe, 0x93, 0xbb, 0xf7, 0xee, 0x9a, 0x5c, 0x7e, 0xf9, 0xe5,
+    0xff, 0xde, 0x2b, 0x00, 0x90, 0x9d, 0x3d, 0xc9, 0xc1, 0xd1, 0x89, 0xec,
+    0xec, 0xe2, 0x4a, 0x71, 0x73, 0xf7, 0xa0, 0x7a, 0x7a, 0x79, 0xd3, 0x7c,
+    0xe8, 0xbe, 0x0c, 0x3f, 0x7f, 0x66, 0x40, 0x20, 0x2b, 0x88, 0x1d, 0x1c,
+    0xc2, 0xe1, 0x86, 0xf2, 0xc2, 0xf8, 0xe1, 0x02, 0xa1, 0x48, 0x2c, 0x91,
+    0xca, 0xe4, 0x70, 0x84, 0x42, 0xa9, 0x42, 0xd4, 0x91, 0x51, 0xd1, 0x68,
+    0x8c, 0x46, 0x0b, 0x01, 0x3b, 0x2b, 0x63, 0x2d, 0x81, 0x3d, 0xb0, 0xb7,
+    0x27, 0x91, 0x1c, 0x1c, 0x1c, 0x1d, 0x9d, 0x9c, 0xc8, 0x64, 0x67, 0x67,
+    0x17, 0x17, 0x57, 0x57, 0x0a, 0xc5, 0xcd, 0xcd, 0xdd, 0xdd, 0xc3, 0x83,
+    0x4a, 0xf5, 0xf4, 0xf4, 0xf2, 0xf2, 0xf6, 0xa6, 0xd1, 0x7c, 0x7c, 0xe8,
+    0x74, 0x5f, 0x5f, 0x06, 0xc3, 0xcf, 0xcf, 0xdf, 0x9f, 0xc9, 0x0c, 0x08,
+    0x08, 0x0c, 0x64, 0xb1, 0x82, 0x82, 0xd8, 0xec, 0xe0, 0xe0, 0x10, 0x92,
+    0x91, 0xe0, 0xff, 0x07, 0x00, 0x47, 0x8a, 0x17, 0x83, 0xc5, 0x15, 0xc8,
+    0x54, 0xe8, 0xb2, 0xf8, 0x15, 0x29, 0xab, 0xb2, 0xd6, 0xe6, 0x17, 0x95,
+    0x94, 0x95, 0x57, 0x54, 0x1e, 0xd0, 0x35, 0xb6, 0x9e, 0x3c, 0xd3, 0xd5,
+    0xdd, 0xdb, 0x7f, 0x75, 0xe8, 0xc6, 0xe8, 0x9d, 0xf1, 0xc9, 0x19, 0x3b,
+    0xb2, 0x3b, 0xcd, 0x9f, 0xcd, 0x13, 0xc1, 0x6a, 0x4d, 0x5c, 0x42, 0x52,
+    0x6a, 0x7a, 0x76, 0x5e, 0x41, 0xf1, 0x46, 0x08, 0x38, 0x59, 0x17, 0x1b,
+    0x48, 0x5c, 0xd2, 0x5f, 0x4d, 0xcd, 0xe2, 0xfe, 0x1a, 0x1b, 0x8f, 0x1e,
+    0x6d, 0x6a, 0x22, 0x99, 0x11, 0x2c, 0x4c, 0xa0, 0xcb, 0xe2, 0x89, 0x34,
+    0x0e, 0x00, 0xb8, 0xd2, 0x83, 0x45, 0xc8, 0xb2, 0xe5, 0x69, 0x39, 0x05,
+    0x1f, 0x95, 0xef, 0xad, 0x6b, 0x36, 0x7c, 0xdd, 0x7b, 0x65, 0xf8, 0xf6,
+    0x83, 0xc7, 0x64, 0x6f, 0x56, 0xb8, 0x42, 0x9b, 0xb0, 0x32, 0x6b, 0xdd,
+    0x86, 0x4f, 0x76, 0x1f, 0x6c, 0x6c, 0xef, 0xb8, 0x30, 0x70, 0x7d, 0xf4,
+    0xfe, 0xb4, 0x03, 0x95, 0xc9, 0x93, 0xa3, 0xaf, 0x26, 0x67, 0xe4, 0xad,
+    0x2f, 0xdb, 0x59, 0x53, 0x7f, 0xfc, 0x2c, 0x04, 0x28, 0xd6, 0xc5, 0x06,
+    0x12, 0x5f, 0xaa, 0x7f, 0x75, 0x87, 0xe7, 0xf7, 0x2f, 0x84, 0x83, 0xf9,
+    0x6b, 0x0e, 0xe5, 0xf1, 0xc2, 0x48, 0x96, 0x04, 0x58, 0xbc, 0x3d, 0x2c,
+    0x13, 0xba, 0xe0, 0x0d, 0x62, 0x9a, 0x00, 0x40, 0x65, 0xcb, 0x62, 0x93,
+    0xb2, 0x0a, 0x37, 0x57, 0xea, 0x0d, 0xdd, 0x83, 0x23, 0xe3, 0xff, 0xf5,
+    0x19, 0x02, 0x9e, 0xd6, 0xc5, 0x06, 0x12, 0x97, 0xf0, 0x57, 0x3b, 0xaf,
+    0x7f, 0xf5, 0x26, 0x7f, 0x1c, 0x2e, 0x37, 0xb4, 0xb9, 0x85, 0x17, 0x16,
+    0xc6, 0xe7, 0x87, 0x87, 0x5b, 0x48, 0xa4, 0x19, 0x09, 0x8c, 0x61, 0xd2,
+    0xcc, 0x13, 0x6e, 0xfe, 0xa0, 0x7a, 0x36, 0x03, 0xc0, 0x47, 0xa0, 0x4d,
+    0x79, 0xaf, 0xac, 0xba, 0xf5, 0xdb, 0xab, 0xb7, 0x67, 0x3c, 0x79, 0xd1,
+    0x49, 0x6b, 0x36, 0xee, 0x6d, 0xea, 0x1c, 0xb8, 0x35, 0xe5, 0x16, 0x82,
+    0x24, 0xae, 0xde, 0xb0, 0x4b, 0x7f, 0xf6, 0xf2, 0xef, 0x13, 0xce, 0xac,
+    0x88, 0xf8, 0x8c, 0xa2, 0xed, 0xba, 0x53, 0xbd, 0xbf, 0x8e, 0x3b, 0xf8,
+    0x4b, 0xe3, 0xde, 0x2a, 0xd8, 0x5a, 0xdb, 0x7e, 0xfe, 0xe7, 0xbb, 0x10,
+    0x5d, 0x08, 0x01, 0xba, 0x75, 0xb1, 0x81, 0xc4, 0x17, 0xed, 0x7f, 0x9f,
+    0xcd, 0xf5, 0xaf, 0x91, 0xf0, 0x87, 0xf7, 0x2f, 0xac, 0x15, 0xf3, 0x27,
+    0x10, 0x08, 0x85, 0x22, 0xd2, 0xf3, 0x09, 0xfc, 0x30, 0x02, 0x63, 0xd8,
+    0x7e, 0xcf, 0x22, 0x9c, 0x9b, 0xaa, 0x9e, 0xcd, 0x00, 0xf0, 0x57, 0xac,
+    0xc8, 0xdb, 0xa2, 0xfb, 0x72, 0xf0, 0x0e, 0x89, 0xa5, 0x4e, 0xce, 0xdf,
+    0xa6, 0xef, 0xba, 0x76, 0x8f, 0x1c, 0x82, 0xa6, 0x16, 0x56, 0x34, 0x7d,
+    0x37, 0xf4, 0x80, 0xc2, 0x8b, 0x5d, 0x55, 0xbc, 0xa7, 0xf5, 0xfc, 0xf0,
+    0x24, 0x55, 0x10, 0x97, 0x59, 0x52, 0xd5, 0xd6, 0x3b, 0x32, 0x4d, 0x93,
+    0xc4, 0x67, 0x97, 0x1e, 0x30, 0x5c, 0x1e, 0x7d, 0xc2, 0x80, 0x13, 0xd7,
+    0x42, 0x80, 0x69, 0x5d, 0x6c, 0x20, 0xf1, 0xe5, 0xce, 0x8f, 0x90, 0x39,
+    0x7f, 0x78, 0xff, 0x8e, 0xe3, 0xfe, 0x44, 0x62, 0xb1, 0xe4, 0x24, 0x69,
+    0x09, 0x02, 0x16, 0x46, 0x40, 0x84, 0xcb, 0x9a, 0x8d, 0x78, 0x76, 0x54,
+    0x9a, 0x5e, 0x68, 0x58, 0x00, 0x04, 0x69, 0x32, 0x4a, 0x0f, 0x77, 0x5d,
+    0x9f, 0xf2, 0x55, 0xad, 0x2c, 0xae, 0x3e, 0x7d, 0x65, 0xdc, 0x43, 0xb2,
+    0x3c, 0x7f, 0xd7, 0xf1, 0x4b, 0x63, 0x4e, 0xbc, 0x57, 0x72, 0xb7, 0x36,
+    0x9e, 0x1b, 0x79, 0xca, 0x8a, 0x49, 0xdf, 0x54, 0xd7, 0x39, 0xf4, 0x88,
+    0xae, 0x4c, 0x59, 0x5f, 0x75, 0x6a, 0xf0, 0xbe, 0xbb, 0x38, 0x71, 0x5d,
+    0xc5, 0xb1, 0xbe, 0xdb, 0x8e, 0xa1, 0x71, 0x39, 0x5b, 0x1a, 0x20, 0xc0,
+    0xb6, 0x2e, 0x36, 0x90, 0x38, 0xeb, 0x6f, 0xff, 0xac, 0xbf, 0x43, 0x2f,
+    0xf2, 0x47, 0xf4, 0xaf, 0x0d, 0xf3, 0x27, 0x91, 0x4a, 0x65, 0x06, 0xf9,
+    0x02, 0x89, 0x1c, 0x23, 0x01, 0x67, 0x96, 0x80, 0x83, 0x13, 0x70, 0x38,
+    0x3c, 0x8e, 0x31, 0x12, 0xe3, 0xa0, 0x9c, 0x7d, 0x8c, 0xe1, 0x70, 0x00,
+    0xe0, 0xc6, 0xe7, 0x57, 0x9e, 0x19, 0x9a, 0x61, 0xc7, 0xe5, 0xed, 0x36,
+    0x5c, 0x9b, 0x0a, 0x88, 0xcd, 0xdd, 0xd1, 0x36, 0x38, 0xc1, 0x40, 0xb3,
+    0xca, 0x5b, 0xfb, 0xc7, 0x69, 0xea, 0xf4, 0xcd, 0x4d, 0x7d, 0x77, 0xa9,
+    0x8a, 0xb4, 0x52, 0x7d, 0xcf, 0x18, 0x45, 0x96, 0x52, 0xa2, 0xeb, 0x1e,
+    0x25, 0x8b, 0x92, 0x8a, 0x6b, 0xbf, 0x19, 0x21, 0xf1, 0x13, 0x0b, 0x6b,
+    0x3a, 0x86, 0x21, 0x10, 0x6a, 0x5d, 0x6c, 0x20, 0xd1, 0xd8, 0xbf, 0x83,
+    0xc6, 0xfe, 0xcd, 0x3b, 0x3f, 0x1a, 0x9e, 0xe3, 0xef, 0x04, 0xd1, 0x3f,
+    0xdc, 0x9f, 0x4c, 0x2e, 0x87, 0xe1, 0x88, 0x08, 0x0b, 0x89, 0x7c, 0x73,
+    0x02, 0x3e, 0x41, 0xc0, 0x9f, 0x25, 0x20, 0x22, 0x31, 0x0e, 0x4a, 0xe3,
+    0x80, 0x62, 0x17, 0x00, 0xe1, 0xc9, 0x9b, 0x9a, 0x7e, 0x9c, 0x0c, 0x8a,
+    0xff, 0xb0, 0xee, 0xc2, 0x5d, 0x1f, 0xcd, 0xbb, 0x95, 0x9d, 0x37, 0x5d,
+    0x15, 0x19, 0xdb, 0xbe, 0x18, 0x82, 0x04, 0x6f, 0x94, 0x36, 0x0f, 0x3c,
+    0x62, 0xbf, 0x56, 0x74, 0xb8, 0xe7, 0x2f, 0xba, 0x36, 0x6f, 0x5f, 0xd7,
+    0x2d, 0x8a, 0x32, 0x73, 0xbb, 0xe1, 0xba, 0x9d, 0x30, 0xe5, 0xe3, 0x96,
+    0x9f, 0xa6, 0x82, 0x13, 0xd6, 0xeb, 0x2e, 0xde, 0xf3, 0x85, 0x80, 0xc0,
+    0xba, 0xd8, 0x40, 0xa2, 0x59, 0xff, 0x74, 0x84, 0xbf, 0x7a, 0xb3, 0xfd,
+    0xaf, 0x79, 0x5e, 0xff, 0x2c, 0xfc, 0x29, 0x14, 0x4a, 0xa5, 0x6a, 0xd1,
+    0xe5, 0x2c, 0x26, 0x08, 0xc4, 0x73, 0x04, 0x62, 0x9c, 0x40, 0x2c, 0x15,
+    0xe3, 0x51, 0x12, 0xf7, 0x68, 0xfc, 0x06, 0x80, 0x24, 0xbd, 0xa2, 0xe3,
+    0x0f, 0xda, 0xb2, 0xc2, 0x23, 0xfd, 0xd3, 0xfc, 0xd4, 0xf2, 0xd3, 0x23,
+    0xee, 0xe8, 0xfb, 0xb5, 0xbd, 0x13, 0x21, 0x49, 0x65, 0x6d, 0xbf, 0x90,
+    0x55, 0xb9, 0x55, 0xdd, 0xf7, 0x02, 0x12, 0x4a, 0x5a, 0xae, 0xd9, 0xc9,
+    0x32, 0x77, 0x77, 0x8d, 0xd1, 0xe3, 0x8a, 0xf4, 0x03, 0x33, 0x82, 0xb4,
+    0x6d, 0x67, 0x6e, 0x52, 0x35, 0xf9, 0x75, 0x7d, 0x93, 0xdc, 0x64, 0x08,
+    0x48, 0xad, 0x8b, 0x0d, 0x24, 0x12, 0xfb, 0x9f, 0x0e, 0xef, 0xdf, 0x11,
+    0xbc, 0x7f, 0x0d, 0x73, 0xeb, 0xb7, 0x05, 0xf7, 0x77, 0xcc, 0xc2, 0xdf,
+    0xa9, 0x39, 0x7f, 0x2a, 0x04, 0x51, 0xab, 0x97, 0xda, 0x13, 0x61, 0x9c,
+    0x00, 0xc6, 0x09, 0x60, 0x9c, 0x00, 0x26, 0x08, 0x60, 0xec, 0x03, 0xb0,
+    0x12, 0xbb, 0xe0, 0x28, 0xfc, 0xa6, 0x05, 0x20, 0x62, 0xed, 0xa1, 0xfe,
+    0xa7, 0xf0, 0x9a, 0xda, 0x1f, 0x9e, 0xc8, 0x73, 0x0f, 0x5e, 0x7e, 0x2c,
+    0xcb, 0x39, 0x70, 0x69, 0x46, 0x9a, 0xbd, 0xbf, 0xef, 0x1f, 0xc9, 0xea,
+    0x9a, 0xef, 0xa7, 0xc5, 0x59, 0xd5, 0xbd, 0x7f, 0x8b, 0xde, 0xa9, 0xba,
+    0x38, 0x25, 0xcc, 0xdc, 0xd7, 0xf3, 0x48, 0x90, 0x51, 0x79, 0x61, 0x32,
+    0x3c, 0x7d, 0xef, 0xf9, 0x87, 0xfc, 0xb7, 0xf7, 0x9c, 0x9b, 0x08, 0x5b,
+    0xf5, 0x29, 0x04, 0x14, 0xd6, 0xc5, 0x06, 0x12, 0xf1, 0xf5, 0x7b, 0x04,
+    0x5f, 0xbf, 0x7a, 0x7c, 0xff, 0x3b, 0xba, 0xf0, 0xfc, 0x68, 0x7b, 0x4e,
+    0xff, 0x08, 0x7f, 0x91, 0x91, 0x51, 0x51, 0xd1, 0x96, 0x12, 0x91, 0x79,
+    0x04, 0x08, 0x4e, 0x80, 0x98, 0x08, 0x10, 0x9c, 0x00, 0xc1, 0x09, 0x10,
+    0xec, 0x03, 0x91, 0x08, 0x16, 0x0d, 0x02, 0x80, 0xba, 0xb0, 0x75, 0x84,
+    0x91, 0xb4, 0xa3, 0x7b, 0x4a, 0x96, 0xa7, 0x1f, 0xa2, 0xc6, 0x6f, 0xee,
+    0x18, 0xe7, 0x67, 0xd5, 0x0e, 0x92, 0x63, 0x4b, 0x0c, 0x63, 0xec, 0xb4,
+    0xca, 0xbe, 0x17, 0xfd, 0x0e, 0x81, 0x48, 0xeb, 0x62, 0x03, 0x89, 0x26,
+    0x7f, 0xc4, 0xfa, 0xc5, 0xff, 0x3f, 0x7f, 0x6e, 0xbe, 0xff, 0xb5, 0x9b,
+    0xfc, 0x9d, 0x36, 0xf7, 0xd7, 0x41, 0xf8, 0x8b, 0x46, 0xd1, 0x98, 0x18,
+    0x0b, 0x89, 0xa8, 0x39, 0x01, 0x8a, 0x11, 0xa0, 0x26, 0x02, 0x14, 0x23,
+    0x40, 0x31, 0x02, 0x14, 0x27, 0x40, 0x31, 0x02, 0x14, 0x27, 0x40, 0x51,
+    0x00, 0x62, 0x36, 0x7e, 0x35, 0x21, 0x2f, 0x38, 0x31, 0x16, 0x9a, 0x5d,
+    0x3f, 0xec, 0x97, 0x5a, 0x3d, 0xe8, 0x96, 0xb0, 0xbd, 0x07, 0xd2, 0x6c,
+    0xea, 0x78, 0x08, 0x7f, 0xd0, 0xf6, 0x27, 0x2f, 0x47, 0xff, 0x9b, 0xff,
+    0x9b, 0x35, 0x57, 0xdc, 0x5f, 0xdf, 0x71, 0xd1, 0x4e, 0x5b, 0xda, 0x39,
+    0x19, 0x51, 0xd8, 0x7e, 0x27, 0x2c, 0xb7, 0xe1, 0x06, 0x33, 0x6d, 0xff,
+    0x55, 0x8f, 0xc4, 0x9d, 0xbd, 0xf6, 0x10, 0xd0, 0x58, 0x17, 0x1b, 0x48,
+    0x5c, 0xe4, 0xfc, 0x15, 0x2d, 0xd9, 0x3f, 0xc2, 0x9f, 0x46, 0xa3, 0xd5,
+    0xc6, 0xfe, 0x0b, 0xb1, 0xfc, 0x10, 0xa2, 0x60, 0x15, 0xcb, 0xe5, 0x00,
+    0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+static const uint8_t png_gray1_interlaced[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x03,
+    0x01, 0x00, 0x00, 0x00, 0x01, 0xf5, 0x41, 0x93, 0x4e, 0x00, 0x00, 0x00,
+    0x12, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x80, 0x82, 0x1f,
+    0x8c, 0x3f, 0x18, 0x56, 0x35, 0x00, 0x00, 0x0b, 0x98, 0x03, 0x1c, 0x3f,
+    0x7d, 0xf4, 0x11, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+    0x42, 0x60, 0x82,
+};
+
+static const uint8_t png_graya16[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x02,
+    0x10, 0x04, 0x00, 0x00, 0x00, 0x67, 0xed, 0x72, 0xd2, 0x00, 0x00, 0x00,
+    0x1b, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x60, 0xf8, 0xff,
+    0xdf, 0x01, 0x88, 0x1b, 0x80, 0x98, 0x91, 0x81, 0xa1, 0x1e, 0xc8, 0x61,
+    0x60, 0x00, 0x61, 0x00, 0x8d, 0x65, 0x08, 0xba, 0xcb, 0x22, 0xa8, 0xf3,
+    0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+static const uint8_t png_palette_bad_index[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01,
+    0x08, 0x03, 0x00, 0x00, 0x00, 0xce, 0xe2, 0xff, 0xff, 0x00, 0x00, 0x00,
+    0x09, 0x50, 0x4c, 0x54, 0x45, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x25, 0x85, 0x56, 0xf0, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x44,
+    0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x60, 0x64, 0x62, 0x06, 0x00, 0x00,
+    0x0f, 0x00, 0x07, 0x5b, 0xd0, 0x8b, 0x7d, 0x00, 0x00, 0x00, 0x00, 0x49,
+    0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+/**
+ * @brief Expected pixel of png_rgba8
+ * @param x Column
+ * @param y Row
+ * @param out Receives RGBA
+ */
+static void expect_rgba8(uint32_t x, uint32_t y, uint8_t out[4]) {
+    out[0] = (uint8_t)(x * 40);
+    out[1] = (uint8_t)(y * 50);
+    out[2] = (uint8_t)((x + y) * 20);
+    out[3] = (uint8_t)(255 - x * 10);
+}
+
+/**
+ * @brief Expected pixel of png_palette2_interlaced
+ * @param x Column
+ * @param y Row
+ * @param out Receives RGBA
+ */
+static void expect_palette2(uint32_t x, uint32_t y, uint8_t out[4]) {
+    static const uint8_t alpha[4] = { 255, 128, 0, 255 };
+    uint32_t index = (x + 2 * y) % 4;
+    
+    out[0] = (uint8_t)(10 + index * 30);
+    out[1] = (uint8_t)(20 + index * 30);
+    out[2] = (uint8_t)(30 + index * 30);
+    out[3] = alpha[index];
+}
+
+/**
+ * @brief Expected pixel of png_rgb16_key
+ * @param x Column
+ * @param y Row
+ * @param out Receives RGBA
+ */
+static void expect_rgb16_key(uint32_t x, uint32_t y, uint8_t out[4]) {
+    out[0] = (uint8_t)(x * 0x11);
+    out[1] = (uint8_t)(y * 0x22);
+    out[2] = 0x80;
+    out[3] = x == 0 && y == 0 ? 0 : 255;
+}
+
+/**
+ * @brief Expected pixel of png_gray8_large
+ * @param x Column
+ * @param y Row
+ * @param out Receives RGBA
+ */
+static void expect_gray8(uint32_t x, uint32_t y, uint8_t out[4]) {
+    out[0] = out[1] = out[2] = (uint8_t)(x * y + x);
+    out[3] = 255;
+}
+
+/**
+ * @brief Expected pixel of png_gray1_interlaced
+ * @param x Column
+ * @param y Row
+ * @param out Receives RGBA
+ */
+static void expect_gray1(uint32_t x, uint32_t y, uint8_t out[4]) {
+    out[0] = out[1] = out[2] = (x + y) & 1 ? 255 : 0;
+    out[3] = 255;
+}
+
+/**
+ * @brief Expected pixel of png_graya16
+ * @param x Column
+ * @param y Row
+ * @param out Receives RGBA
+ */
+static void expect_graya16(uint32_t x, uint32_t y, uint8_t out[4]) {
+    out[0] = out[1] = out[2] = (uint8_t)(x * 0x40);
+    out[3] = (uint8_t)(0xff - y * 0x80);
+}
+
+/* A sample image and the formula it was drawn from */
+typedef struct {
+    const char *name;
+    const uint8_t *data;
+    size_t size;
+    uint32_t width;
+    uint32_t height;
+    void (*expect)(uint32_t x, uint32_t y, uint8_t out[4]);
+} png_sample_t;
+
+#define SAMPLE(data, width, height, expect) { #data, data, sizeof(data), width, height, expect }
+
+static const png_sample_t png_samples[] = {
+    SAMPLE(png_rgba8, 7, 5, expect_rgba8),
+    SAMPLE(png_palette2_interlaced, 9, 9, expect_palette2),
+    SAMPLE(png_rgb16_key, 4, 3, expect_rgb16_key),
+    SAMPLE(png_gray8_large, 64, 64, expect_gray8),
+    SAMPLE(png_gray1_interlaced, 10, 3, expect_gray1),
+    SAMPLE(png_graya16, 3, 2, expect_graya16),
+};
+
+/* Offset of the IHDR fields: signature, chunk length and type */
+#define IHDR_BODY 16
+
+/* Size of the files build_gray8() writes into */
+#define BUILT_SIZE 256
+
+/**
+ * @brief Append a chunk to a file being built; its CRC is left zero, as the decoder ignores it
+ * @param out File being built
+ * @param pos Offset of the chunk
+ * @param type Chunk type
+ * @param body Chunk data
+ * @param length Size of the chunk data
+ * @return Offset past the chunk
+ */
+static size_t put_chunk(uint8_t *out, size_t pos, const char *type, const uint8_t *body, uint32_t length) {
+    out[pos] = (uint8_t)(length >> 24);
+    out[pos + 1] = (uint8_t)(length >> 16);
+    out[pos + 2] = (uint8_t)(length >> 8);
+    out[pos + 3] = (uint8_t)length;
+    memcpy(out + pos + 4, type, 4);
+    if (length > 0) {
+        memcpy(out + pos + 8, body, length);
+    }
+    memset(out + pos + 8 + length, 0, 4);
+    return pos + 12 + length;
+}
+
+/**
+ * @brief Build an 8-bit grayscale file whose image data is one stored deflate block
+ * @param width Image width
+ * @param height Image height
+ * @param raw Filtered rows, each led by its filter type
+ * @param raw_size Size of raw, at most 200 bytes
+ * @param split Non-zero to spread the image data over two IDAT chunks
+ * @param out Receives the file, BUILT_SIZE bytes
+ * @return Size of the file
+ */
+static size_t build_gray8(uint32_t width, uint32_t height, const uint8_t *raw, size_t raw_size, int split,
+                          uint8_t *out) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    uint8_t header[13] = { 0 };
+    uint8_t stream[216];
+    size_t stream_size = 7 + raw_size + 4;
+    size_t pos;
+    
+    header[0] = (uint8_t)(width >> 24);
+    header[1] = (uint8_t)(width >> 16);
+    header[2] = (uint8_t)(width >> 8);
+    header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24);
+    header[5] = (uint8_t)(height >> 16);
+    header[6] = (uint8_t)(height >> 8);
+    header[7] = (uint8_t)height;
+    header[8] = 8;
+    
+    // zlib header, one final stored block and a zero Adler-32, which the decoder does not check either
+    stream[0] = 0x78;
+    stream[1] = 0x01;
+    stream[2] = 0x01;
+    stream[3] = (uint8_t)raw_size;
+    stream[4] = (uint8_t)(raw_size >> 8);
+    stream[5] = (uint8_t)~raw_size;
+    stream[6] = (uint8_t)(~raw_size >> 8);
+    memcpy(stream + 7, raw, raw_size);
+    memset(stream + 7 + raw_size, 0, 4);
+    
+    memcpy(out, signature, sizeof(signature));
+    pos = put_chunk(out, sizeof(signature), "IHDR", header, sizeof(header));
+    if (split) {
+        pos = put_chunk(out, pos, "IDAT", stream, 5);
+        pos = put_chunk(out, pos, "IDAT", stream + 5, (uint32_t)(stream_size - 5));
+    } else {
+        pos = put_chunk(out, pos, "IDAT", stream, (uint32_t)stream_size);
+    }
+    return put_chunk(out, pos, "IEND", NULL, 0);
+}
+
+/**
+ * @brief Find a chunk in a file
+ * @param data File contents
+ * @param size File size
+ * @param type Chunk type
+ * @return Offset of the chunk, or 0 if there is none
+ */
+static size_t find_chunk(const uint8_t *data, size_t size, const char *type) {
+    for (size_t pos = 8; pos + 12 <= size; pos += 12 + read_be32(data + pos)) {
+        if (memcmp(data + pos + 4, type, 4) == 0) {
+            return pos;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decode a copy of a file placed in an allocation of exactly its size
+ * @param data File contents
+ * @param size Number of bytes
+ * @param image Receives the decoded image
+ * @return Result of png_decode()
+ */
+static int decode_copy(const uint8_t *data, size_t size, png_image_t *image) {
+    uint8_t *copy = check_copy(data, size);
+    int result;
+    
+    result = png_decode(copy, size, image);
+    free(copy);
+    if (result != 0) {
+        CHECK(image->pixels == NULL && image->width == 0 && image->height == 0);
+    }
+    return result;
+}
+
+/**
+ * @brief Decode a copy of a file with one byte replaced
+ * @param sample Sample image
+ * @param offset Byte to replace
+ * @param value Replacement
+ * @return Result of png_decode()
+ */
+static int decode_patched(const png_sample_t *sample, size_t offset, uint8_t value) {
+    uint8_t *copy = check_copy(sample->data, sample->size);
+    png_image_t image;
+    int result;
+    
+    copy[offset] = value;
+    result = decode_copy(copy, sample->size, &image);
+    png_image_free(&image);
+    free(copy);
+    return result;
+}
+
+/**
+ * @brief Check a decoded image against the formula it was drawn from
+ * @param sample Sample image
+ * @param image Decoded image
+ * @return 1 if every pixel matches, 0 otherwise
+ */
+static int matches(const png_sample_t *sample, const png_image_t *image) {
+    uint8_t expected[4];
+    
+    if (image->width != sample->width || image->height != sample->height || image->pixels == NULL) {
+        return 0;
+    }
+    for (uint32_t y = 0; y < sample->height; y++) {
+        for (uint32_t x = 0; x < sample->width; x++) {
+            sample->expect(x, y, expected);
+            if (memcmp(image->pixels + ((size_t)y * sample->width + x) * 4, expected, 4) != 0) {
+                fprintf(stderr, "%s: pixel %u,%u differs\n", sample->name, x, y);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int main(void) {
+    static const uint8_t raw[] = { 0, 10, 20, 2, 5, 5 };
+    uint8_t longer[sizeof(raw) + 1] = { 0 };
+    uint8_t built[BUILT_SIZE];
+    uint8_t file[BUILT_SIZE + 16];
+    uint8_t stream[64];
+    uint8_t out[256];
+    uint32_t seed = 1;
+    png_image_t image;
+    size_t built_size;
+    size_t file_size;
+    size_t idat;
+    
+    for (size_t s = 0; s < sizeof(png_samples) / sizeof(png_samples[0]); s++) {
+        const png_sample_t *sample = &png_samples[s];
+        size_t plte = find_chunk(sample->data, sample->size, "PLTE");
+        
+        CHECK(decode_copy(sample->data, sample->size, &image) == 0);
+        CHECK(matches(sample, &image));
+        png_image_free(&image);
+        
+        // Without IEND nothing decodes, however much image data came before it
+        CHECK(find_chunk(sample->data, sample->size, "IEND") == sample->size - 12);
+        CHECK(decode_copy(sample->data, sample->size - 12, &image) == -1);
+        CHECK(decode_copy(sample->data, sample->size - 1, &image) == -1);
+        
+        // A palette image with its PLTE renamed to an unknown chunk has nothing to index
+        if (plte != 0) {
+            CHECK(decode_patched(sample, plte + 4, 'p') == -1);
+        }
+    }
+    
+    // Rows 10 20 and, through the Up filter, 15 25
+    built_size = build_gray8(2, 2, raw, sizeof(raw), 0, built);
+    CHECK(decode_copy(built, built_size, &image) == 0);
+    CHECK(image.width == 2 && image.height == 2 && image.pixels != NULL);
+    if (image.pixels != NULL) {
+        CHECK(image.pixels[0] == 10 && image.pixels[4] == 20 && image.pixels[8] == 15 && image.pixels[12] == 25);
+        CHECK(image.pixels[3] == 255 && image.pixels[1] == 10 && image.pixels[2] == 10);
+    }
+    png_image_free(&image);
+    
+    // Image data spread over several IDAT chunks is one stream
+    built_size = build_gray8(2, 2, raw, sizeof(raw), 1, built);
+    CHECK(decode_copy(built, built_size, &image) == 0 && image.pixels != NULL && image.pixels[12] == 25);
+    png_image_free(&image);
+    
+    // Exactly the rows the header describes, each with a known filter type
+    built_size = build_gray8(2, 2, raw, sizeof(raw) - 1, 0, built);
+    CHECK(decode_copy(built, built_size, &image) == -1);
+    memcpy(longer, raw, sizeof(raw));
+    built_size = build_gray8(2, 2, longer, sizeof(longer), 0, built);
+    CHECK(decode_copy(built, built_size, &image) == -1);
+    built_size = build_gray8(3, 2, raw, sizeof(raw), 0, built);
+    CHECK(decode_copy(built, built_size, &image) == -1);
+    longer[3] = 5;
+    built_size = build_gray8(2, 2, longer, sizeof(raw), 0, built);
+    CHECK(decode_copy(built, built_size, &image) == -1);
+    
+    // Unknown chunks are skipped after IHDR, but nothing may come before it
+    built_size = build_gray8(2, 2, raw, sizeof(raw), 0, built);
+    memcpy(file, built, IHDR_BODY + 17);
+    file_size = put_chunk(file, IHDR_BODY + 17, "tEXt", (const uint8_t *)"k\0v", 3);
+    memcpy(file + file_size, built + IHDR_BODY + 17, built_size - IHDR_BODY - 17);
+    file_size += built_size - IHDR_BODY - 17;
+    CHECK(decode_copy(file, file_size, &image) == 0);
+    png_image_free(&image);
+    file_size = put_chunk(file, 8, "tEXt", (const uint8_t *)"k\0v", 3);
+    memcpy(file + file_size, built + 8, built_size - 8);
+    file_size += built_size - 8;
+    CHECK(decode_copy(file, file_size, &image) == -1);
+    
+    // A chunk running past the end of the file, and a file without image data
+    idat = find_chunk(built, built_size, "IDAT");
+    memcpy(file, built, built_size);
+    file[idat] = 0x7f;
+    CHECK(decode_copy(file, built_size, &image) == -1);
+    memcpy(file, built, idat);
+    file_size = put_chunk(file, idat, "IEND", NULL, 0);
+    CHECK(decode_copy(file, file_size, &image) == -1);
+    
+    // Header fields outside what the format allows
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 3, 0) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 2, 0x10) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 6, 0x10) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 8, 3) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 9, 5) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 10, 1) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 11, 1) == -1);
+    CHECK(decode_patched(&png_samples[0], IHDR_BODY + 12, 2) == -1);
+    CHECK(decode_patched(&png_samples[0], 0, 'x') == -1);
+    
+    // A palette index past the end of PLTE
+    CHECK(decode_copy(png_palette_bad_index, sizeof(png_palette_bad_index), &image) == -1);
+    
+    // Random deflate data after a valid zlib header never overruns either buffer
+    stream[0] = 0x78;
+    stream[1] = 0x01;
+    for (int round = 0; round < 20000; round++) {
+        for (size_t i = 2; i < sizeof(stream); i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            stream[i] = (uint8_t)seed;
+        }
+        zlib_inflate(stream, sizeof(stream), out, sizeof(out));
+    }
+    stream[1] = 0x21;
+    CHECK(zlib_inflate(stream, sizeof(stream), out, sizeof(out)) == -1);
+    
+    return check_finish("test_png");
+}
@@ -0,0 +1,321 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_resource.c
+ * @brief Tests of the resource blob reader against truncated and corrupt blobs
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * A blob is built with resource_index_build() from a small resources/
+ * tree and its layout checked: entries ordered by name hash, names
+ * NUL-terminated after them, contents page-aligned from data_offset.
+ * Header fields and single entries are then damaged, and resource_lookup()
+ * must refuse the blob or miss rather than return bytes outside it.
+ * Launches must stop receiving the blob once a file is added, removed or
+ * edited in place anywhere below resources/.
+ */
+
+#include "../src/resource.c"
+
+#include "check.h"
+
+/* Files below resources/ and their contents */
+static const char *const resource_files[][2] = {
+    { "app.txt", "application text\n" },
+    { "icons/app.png", "not really a png" },
+    { "icons/empty", "" },
+    { "deep/er/still.txt", "nested\n" },
+};
+
+#define RESOURCE_FILE_COUNT (sizeof(resource_files) / sizeof(resource_files[0]))
+
+/**
+ * @brief Search a copy of a blob placed in an allocation of exactly its size
+ * @param data Blob bytes
+ * @param size Number of bytes
+ * @param found Receives how many of the files were found with their contents
+ * @return Result of resource_valid()
+ */
+static int lookup_copy(const char *data, size_t size, size_t *found) {
+    char *copy = check_copy(data, size);
+    resource_map_t resources;
+    int valid;
+    
+    resources.map = copy;
+    resources.size = size;
+    *found = 0;
+    valid = resource_valid(copy, size);
+    for (size_t i = 0; valid && i < RESOURCE_FILE_COUNT; i++) {
+        const char *content = resource_files[i][1];
+        size_t length = 0;
+        const char *contents = resource_lookup(&resources, resource_files[i][0], &length);
+        
+        if (contents != NULL) {
+            // Whatever the damage, a hit lies inside the blob
+            CHECK(contents >= copy && length <= size && (size_t)(contents - copy) <= size - length);
+            if (length == strlen(content) && memcmp(contents, content, length) == 0) {
+                (*found)++;
+            }
+        }
+    }
+    if (valid) {
+        CHECK(resource_lookup(&resources, "missing", NULL) == NULL);
+        CHECK(resource_lookup(&resources, "", NULL) == NULL);
+    }
+    free(copy);
+    return valid;
+}
+
+/**
+ * @brief Check whether a launch of the bundle would be handed its blob
+ * @param bundle Bundle directory
+ * @return Non-zero if configure_resources() passed a descriptor on
+ */
+static int blob_handed_out(const char *bundle) {
+    bundle_probe_t probe;
+    env_builder_t env;
+    const char *value;
+    int handed = 0;
+    
+    CHECK(env_builder_init(&env, NULL) == 0);
+    CHECK(bundle_probe_open(&probe, bundle) == EXIT_SUCCESS);
+    CHECK(configure_resources(&probe, &env) == EXIT_SUCCESS);
+    value = env_builder_get(&env, RESOURCE_FD_ENV);
+    if (value != NULL) {
+        handed = 1;
+        close(atoi(value));
+    }
+    bundle_probe_close(&probe);
+    env_builder_free(&env);
+    return handed;
+}
+
+/**
+ * @brief Build the blob of a bundle afresh
+ * @param bundle Bundle directory
+ */
+static void rebuild_blob(const char *bundle) {
+    bundle_probe_t probe;
+    
+    CHECK(bundle_probe_open(&probe, bundle) == EXIT_SUCCESS);
+    CHECK(resource_index_build(&probe) == EXIT_SUCCESS);
+    bundle_probe_close(&probe);
+}
+
+/**
+ * @brief Rewrite a file in place with contents of the same size and a later mtime
+ * @param bundle Bundle directory
+ * @param name Path below the bundle
+ */
+static void edit_in_place(const char *bundle, const char *name) {
+    struct timespec later[2] = { { 0, UTIME_OMIT }, { 0, 0 } };
+    char path[MAX_PATH_LENGTH];
+    struct stat st;
+    int fd;
+    
+    CHECK_FORMAT(path, "%s/%s", bundle, name);
+    fd = open(path, O_WRONLY);
+    CHECK(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0 && pwrite(fd, "X", 1, 0) == 1);
+    if (fd >= 0) {
+        // Coarse timestamps could otherwise leave the mtime where it was
+        later[1].tv_sec = st.st_mtim.tv_sec + 1;
+        CHECK(futimens(fd, later) == 0);
+        close(fd);
+    }
+}
+
+int main(void) {
+    char bundle[MAX_PATH_LENGTH];
+    char path[MAX_PATH_LENGTH];
+    char number[16];
+    resource_header_t *header;
+    resource_entry_t *entries;
+    resource_map_t resources;
+    bundle_probe_t probe;
+    env_builder_t env;
+    const char *value;
+    uint64_t stored;
+    size_t found = 0;
+    size_t size = 0;
+    char *data;
+    int fd;
+    
+    log_set_level(LOG_ERROR);
+    check_path("Resources.app", bundle, sizeof(bundle));
+    mkdir(bundle, 0755);
+    check_write_file(bundle, "exec", "#!/bin/sh\nexit 0\n", 0755);
+    for (size_t i = 0; i < RESOURCE_FILE_COUNT; i++) {
+        CHECK_FORMAT(path, "resources/%s", resource_files[i][0]);
+        check_write_file(bundle, path, resource_files[i][1], 0644);
+    }
+    
+    CHECK(bundle_probe_open(&probe, bundle) == EXIT_SUCCESS);
+    CHECK(resource_index_build(&probe) == EXIT_SUCCESS);
+    CHECK_FORMAT(path, "%s/%s", bundle, RESOURCE_FILE_NAME);
+    data = check_read_file(path, &size);
+    CHECK(data != NULL);
+    if (data == NULL) {
+        bundle_probe_close(&probe);
+        return check_finish("test_resource");
+    }
+    header = (resource_header_t *)data;
+    CHECK(header->entry_count == RESOURCE_FILE_COUNT);
+    CHECK(lookup_copy(data, size, &found) && found == RESOURCE_FILE_COUNT);
+    
+    // A prefix or extension of a stored name is not a match
+    resources.map = data;
+    resources.size = size;
+    CHECK(resource_lookup(&resources, "icons", NULL) == NULL);
+    CHECK(resource_lookup(&resources, "app.txt2", NULL) == NULL);
+    CHECK(resource_lookup(&resources, "app.tx", NULL) == NULL);
+    
+    // Entries in (hash, name) order, names NUL-terminated after them, contents aligned past the names
+    entries = (resource_entry_t *)(header + 1);
+    CHECK(header->strings_offset == sizeof(*header) + RESOURCE_FILE_COUNT * sizeof(*entries));
+    CHECK(header->data_offset % 4096 == 0 && header->data_offset >= header->strings_offset + header->strings_size);
+    CHECK(header->file_count == RESOURCE_FILE_COUNT && header->size == size);
+    for (size_t i = 0; i < RESOURCE_FILE_COUNT; i++) {
+        const char *name = data + header->strings_offset + entries[i].name_offset;
+        
+        CHECK(name[entries[i].name_length] == '\0' && entries[i].hash == resource_hash(name, entries[i].name_length));
+        CHECK(i == 0 || entries[i - 1].hash < entries[i].hash ||
+              (entries[i - 1].hash == entries[i].hash &&
+               strcmp(data + header->strings_offset + entries[i - 1].name_offset, name) < 0));
+        CHECK(entries[i].offset >= header->data_offset && entries[i].offset % RESOURCE_ALIGNMENT == 0);
+    }
+    CHECK(resource_lookup(&resources, "icons/empty", &found) != NULL && found == 0);
+    
+    // A blob is only searched at exactly the size its header records
+    CHECK(lookup_copy(data, size - 1, &found) == 0);
+    CHECK(lookup_copy(data, sizeof(*header) - 1, &found) == 0);
+    CHECK(lookup_copy(data, (size_t)header->data_offset, &found) == 0);
+    
+    // Cut into the contents behind a header claiming the shorter size, files past the cut are missed
+    stored = header->size;
+    header->size = entries[RESOURCE_FILE_COUNT - 1].offset;
+    CHECK(lookup_copy(data, (size_t)header->size, &found) == 1);
+    CHECK(found < RESOURCE_FILE_COUNT);
+    header->size = stored;
+    
+    // Header fields out of range, or from another format version
+    header->magic ^= 1;
+    CHECK(lookup_copy(data, size, &found) == 0);
+    header->magic ^= 1;
+    header->version = RESOURCE_VERSION - 1;
+    CHECK(lookup_copy(data, size, &found) == 0);
+    header->version = RESOURCE_VERSION;
+    header->entry_count = UINT32_MAX;
+    CHECK(lookup_copy(data, size, &found) == 0);
+    header->entry_count = RESOURCE_FILE_COUNT;
+    header->strings_offset = (uint32_t)size + 1;
+    CHECK(lookup_copy(data, size, &found) == 0);
+    header->strings_offset = (uint32_t)(sizeof(*header) + RESOURCE_FILE_COUNT * sizeof(*entries));
+    header->strings_size = UINT32_MAX;
+    CHECK(lookup_copy(data, size, &found) == 0);
+    header->strings_size = (uint32_t)(size - header->strings_offset);
+    CHECK(lookup_copy(data, size, &found) == 1);
+    CHECK(found == RESOURCE_FILE_COUNT);
+    
+    // An entry pointing outside the blob or the names is missed, not followed
+    for (size_t i = 0; i < RESOURCE_FILE_COUNT; i++) {
+        resource_entry_t intact = entries[i];
+        
+        entries[i].offset = size - entries[i].size + 1;
+        CHECK(lookup_copy(data, size, &found) == 1 && found < RESOURCE_FILE_COUNT);
+        entries[i].offset = intact.offset;
+        entries[i].size = UINT64_MAX;
+        CHECK(lookup_copy(data, size, &found) == 1 && found < RESOURCE_FILE_COUNT);
+        entries[i].size = intact.size;
+        entries[i].name_length = header->strings_size;
+        CHECK(lookup_copy(data, size, &found) == 1 && found < RESOURCE_FILE_COUNT);
+        entries[i].name_length = intact.name_length;
+        entries[i].hash ^= 1;
+        CHECK(lookup_copy(data, size, &found) == 1 && found < RESOURCE_FILE_COUNT);
+        entries[i] = intact;
+    }
+    CHECK(lookup_copy(data, size, &found) == 1 && found == RESOURCE_FILE_COUNT);
+    
+    // The current blob is passed on and maps; a stale one is not
+    CHECK(env_builder_init(&env, NULL) == 0);
+    CHECK(configure_resources(&probe, &env) == EXIT_SUCCESS);
+    value = env_builder_get(&env, RESOURCE_FD_ENV);
+    CHECK(value != NULL);
+    if (value != NULL) {
+        CHECK(setenv(RESOURCE_FD_ENV, value, 1) == 0);
+        CHECK(resource_map_open(&resources) == 0);
+        CHECK(resource_lookup(&resources, "icons/app.png", &found) != NULL && found == 16);
+        resource_map_close(&resources);
+    }
+    
+    bundle_probe_close(&probe);
+    env_builder_free(&env);
+    
+    // Any change to a file below resources/ makes the blob stale, even one the directory does not see
+    check_write_file(bundle, "resources/added", "later\n", 0644);
+    CHECK(!blob_handed_out(bundle));
+    rebuild_blob(bundle);
+    CHECK(blob_handed_out(bundle));
+    edit_in_place(bundle, "resources/app.txt");
+    CHECK(!blob_handed_out(bundle));
+    rebuild_blob(bundle);
+    edit_in_place(bundle, "resources/deep/er/still.txt");
+    CHECK(!blob_handed_out(bundle));
+    rebuild_blob(bundle);
+    check_write_file(bundle, "resources/deep/er/new.txt", "nested addition\n", 0644);
+    CHECK(!blob_handed_out(bundle));
+    rebuild_blob(bundle);
+    CHECK_FORMAT(path, "%s/resources/deep/er/new.txt", bundle);
+    CHECK(unlink(path) == 0);
+    CHECK(!blob_handed_out(bundle));
+    rebuild_blob(bundle);
+    CHECK(blob_handed_out(bundle));
+    
+    // A damaged blob handed over by descriptor is refused
+    CHECK_FORMAT(path, "%s/%s", bundle, RESOURCE_FILE_NAME);
+    fd = open(path, O_RDWR);
+    CHECK(fd >= 0 && pwrite(fd, "\0", 1, offsetof(resource_header_t, version)) == 1);
+    CHECK_FORMAT(number, "%d", fd);
+    CHECK(setenv(RESOURCE_FD_ENV, number, 1) == 0);
+    CHECK(resource_map_open(&resources) == -1);
+    CHECK(resources.map == NULL);
+    if (fd >= 0) {
+        close(fd);
+    }
+    CHECK(setenv(RESOURCE_FD_ENV, "12x", 1) == 0);
+    CHECK(resource_map_open(&resources) == -1);
+    
+    free(data);
+    return check_finish("test_resource");
+}
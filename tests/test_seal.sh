@@ -0,0 +1,118 @@
+#!/bin/sh
+# BSD 3-Clause License
+# 
+# Copyright (c) 2025, Ariz Kamizuki
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+# 
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+
+# Seal round trip test
+# Version: 1.0.0
+# Author: Ariz Kamizuki
+# Date: 2025
+#
+# Seals a bundle with --seal, launches it with --require-digests, then
+# tampers with it in the ways the manifest has to catch and checks that
+# each launch is refused with the bundle error status. Launches run
+# warm as well as cold so a stale integrity cache cannot hide a change.
+
+BUNDLE="$TEST_TMPDIR/Sealed.app"
+failures=0
+
+# Launch the bundle and compare the exit status with the expected one
+expect() {
+    want=$1
+    shift
+    timeout 30 "$LAUNCHER" "$@" > "$TEST_TMPDIR/launch.log" 2>&1
+    got=$?
+    if [ $got -ne $want ]; then
+        echo "expected status $want, got $got: $LAUNCHER $*"
+        sed 's/^/    /' "$TEST_TMPDIR/launch.log"
+        failures=$((failures + 1))
+    fi
+}
+
+mkdir -p "$BUNDLE/exec" "$BUNDLE/library/sub"
+printf '#!/bin/sh\nexit 0\n' > "$BUNDLE/exec/base"
+chmod 755 "$BUNDLE/exec/base"
+echo "library" > "$BUNDLE/library/libsealed.so"
+echo "nested" > "$BUNDLE/library/sub/data"
+
+# Unsealed bundles launch unless digests are required
+expect 0 "$BUNDLE"
+expect 2 --require-digests "$BUNDLE"
+
+expect 0 --seal "$BUNDLE"
+[ -f "$BUNDLE/digests.sha256" ] || { echo "no digests.sha256 written"; exit 1; }
+cp "$BUNDLE/digests.sha256" "$TEST_TMPDIR/digests.sha256"
+expect 0 --require-digests "$BUNDLE"
+expect 0 --require-digests "$BUNDLE"
+
+# Changed contents, cold and after a warm launch
+echo "tampered" > "$BUNDLE/library/libsealed.so"
+expect 2 --require-digests "$BUNDLE"
+expect 2 "$BUNDLE"
+echo "library" > "$BUNDLE/library/libsealed.so"
+expect 0 --require-digests "$BUNDLE"
+
+printf '#!/bin/sh\nexit 1\n' > "$BUNDLE/exec/base"
+expect 2 "$BUNDLE"
+printf '#!/bin/sh\nexit 0\n' > "$BUNDLE/exec/base"
+expect 0 "$BUNDLE"
+
+# A file the manifest does not list
+echo "extra" > "$BUNDLE/library/sub/extra.so"
+expect 2 "$BUNDLE"
+rm -f "$BUNDLE/library/sub/extra.so"
+expect 0 "$BUNDLE"
+
+# A listed file that is gone
+mv "$BUNDLE/library/sub/data" "$TEST_TMPDIR/data"
+expect 2 "$BUNDLE"
+mv "$TEST_TMPDIR/data" "$BUNDLE/library/sub/data"
+expect 0 "$BUNDLE"
+
+# A damaged manifest
+chmod g+w "$BUNDLE/digests.sha256"
+expect 2 "$BUNDLE"
+chmod g-w "$BUNDLE/digests.sha256"
+chmod o+w "$BUNDLE"
+expect 2 "$BUNDLE"
+chmod o-w "$BUNDLE"
+expect 0 "$BUNDLE"
+
+sed -e 's/^0/1/;t' -e 's/^./0/' "$TEST_TMPDIR/digests.sha256" > "$BUNDLE/digests.sha256"
+expect 2 "$BUNDLE"
+echo "not a digest line" > "$BUNDLE/digests.sha256"
+expect 2 "$BUNDLE"
+rm -f "$BUNDLE/digests.sha256"
+expect 2 --require-digests "$BUNDLE"
+
+# Sealing again accepts the current contents
+echo "updated" > "$BUNDLE/library/libsealed.so"
+expect 0 --seal "$BUNDLE"
+expect 0 --require-digests "$BUNDLE"
+
+[ $failures -eq 0 ]
@@ -0,0 +1,231 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2025, Ariz Kamizuki
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file test_sha256.c
+ * @brief Known-answer tests of SHA-256 for the portable and SHA-NI block functions
+ * @version 1.0.0
+ * @author Ariz Kamizuki
+ * @date 2025
+ *
+ * Each FIPS 180-4 vector is padded here and run through sha256_block()
+ * and, where the CPU has the SHA extensions, sha256_blocks_shani(), so
+ * both paths are checked whatever sha256_blocks() would pick. The public
+ * functions are then checked with the input split at every chunk size,
+ * and the two block functions against each other on many lengths.
+ */
+
+#include "../src/sha256.c"
+
+#include <fcntl.h>
+#include <limits.h>
+
+#include "check.h"
+
+/* A message and its digest in hex */
+typedef struct {
+    const char *message;
+    size_t repeat;
+    const char *digest;
+} sha256_vector_t;
+
+static const sha256_vector_t sha256_vectors[] = {
+    { "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+      "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+    { "a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+};
+
+#define SHA256_VECTOR_COUNT (sizeof(sha256_vectors) / sizeof(sha256_vectors[0]))
+
+/* Compresses count consecutive blocks into the state */
+typedef void (*blocks_fn)(sha256_t *ctx, const uint8_t *data, size_t count);
+
+/**
+ * @brief Run the portable block function over consecutive blocks
+ * @param ctx Digest state
+ * @param data Blocks to process
+ * @param count Number of blocks
+ */
+static void portable_blocks(sha256_t *ctx, const uint8_t *data, size_t count) {
+    for (; count > 0; count--, data += 64) {
+        sha256_block(ctx, data);
+    }
+}
+
+/**
+ * @brief Expand a vector into its full message
+ * @param vector Test vector
+ * @param size Receives the message size
+ * @return Heap copy of the message
+ */
+static uint8_t *vector_message(const sha256_vector_t *vector, size_t *size) {
+    size_t length = strlen(vector->message);
+    uint8_t *message = malloc(length * vector->repeat + 1);
+    
+    for (size_t i = 0; i < vector->repeat; i++) {
+        memcpy(message + i * length, vector->message, length);
+    }
+    *size = length * vector->repeat;
+    return message;
+}
+
+/**
+ * @brief Digest a message with one block function, padding it here
+ * @param blocks Block function
+ * @param message Message bytes
+ * @param size Message size
+ * @param hex Receives the digest in hex
+ */
+static void digest_with(blocks_fn blocks, const uint8_t *message, size_t size, char hex[SHA256_HEX_SIZE]) {
+    size_t padded = (size + 9 + 63) / 64 * 64;
+    uint8_t *data = calloc(padded, 1);
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint64_t bits = (uint64_t)size * 8;
+    sha256_t ctx;
+    
+    memcpy(data, message, size);
+    data[size] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        data[padded - 8 + i] = (uint8_t)(bits >> (56 - i * 8));
+    }
+    
+    sha256_init(&ctx);
+    blocks(&ctx, data, padded / 64);
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(ctx.state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(ctx.state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(ctx.state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)ctx.state[i];
+    }
+    sha256_hex(digest, hex);
+    free(data);
+}
+
+/**
+ * @brief Digest a message through the public functions in fixed-size pieces
+ * @param message Message bytes
+ * @param size Message size
+ * @param chunk Size of each sha256_update() call
+ * @param hex Receives the digest in hex
+ */
+static void digest_chunked(const uint8_t *message, size_t size, size_t chunk, char hex[SHA256_HEX_SIZE]) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_t ctx;
+    
+    sha256_init(&ctx);
+    for (size_t done = 0; done < size; done += chunk) {
+        sha256_update(&ctx, message + done, size - done < chunk ? size - done : chunk);
+    }
+    sha256_final(&ctx, digest);
+    sha256_hex(digest, hex);
+}
+
+int main(void) {
+    char path[PATH_MAX];
+    char hex[SHA256_HEX_SIZE];
+    char other[SHA256_HEX_SIZE];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t random[1024];
+    uint32_t seed = 1;
+    int shani = 0;
+    int fd;
+    
+#ifdef SHA256_SHANI
+    shani = sha256_shani_supported();
+#endif
+    if (!shani) {
+        printf("SHA extensions not available, checking the portable path only\n");
+    }
+    
+    for (size_t v = 0; v < SHA256_VECTOR_COUNT; v++) {
+        size_t size;
+        uint8_t *message = vector_message(&sha256_vectors[v], &size);
+        
+        digest_with(portable_blocks, message, size, hex);
+        CHECK(strcmp(hex, sha256_vectors[v].digest) == 0);
+#ifdef SHA256_SHANI
+        if (shani) {
+            digest_with(sha256_blocks_shani, message, size, hex);
+            CHECK(strcmp(hex, sha256_vectors[v].digest) == 0);
+        }
+#endif
+        
+        // Every split lands the block boundary somewhere else in the input
+        for (size_t chunk = 1; chunk <= 130 && chunk <= (size ? size : 1); chunk++) {
+            if (size > 4096 && chunk % 13 != 0) {
+                continue;
+            }
+            digest_chunked(message, size, chunk, hex);
+            CHECK(strcmp(hex, sha256_vectors[v].digest) == 0);
+        }
+        digest_chunked(message, size, size ? size : 1, hex);
+        CHECK(strcmp(hex, sha256_vectors[v].digest) == 0);
+        free(message);
+    }
+    
+    // Both block functions agree on every padding case and multi-block runs
+    for (size_t i = 0; i < sizeof(random); i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        random[i] = (uint8_t)seed;
+    }
+    for (size_t size = 0; size <= sizeof(random) - 9; size++) {
+        digest_with(portable_blocks, random, size, hex);
+        digest_chunked(random, size, 7, other);
+        CHECK(strcmp(hex, other) == 0);
+#ifdef SHA256_SHANI
+        if (shani) {
+            digest_with(sha256_blocks_shani, random, size, other);
+            CHECK(strcmp(hex, other) == 0);
+        }
+#endif
+    }
+    
+    // sha256_fd() digests from the current offset
+    check_path("vector", path, sizeof(path));
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && write(fd, "xxabc", 5) == 5 && lseek(fd, 2, SEEK_SET) == 2);
+    CHECK(sha256_fd(fd, digest) == 0);
+    sha256_hex(digest, hex);
+    CHECK(strcmp(hex, sha256_vectors[1].digest) == 0);
+    if (fd >= 0) {
+        close(fd);
+    }
+    
+    return check_finish("test_sha256");
+}